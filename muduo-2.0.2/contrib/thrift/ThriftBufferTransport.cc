@@ -0,0 +1,63 @@
+#include "contrib/thrift/ThriftBufferTransport.h"
+
+#include <thrift/transport/TTransportException.h>
+
+using apache::thrift::transport::TTransportException;
+
+uint32_t ThriftBufferTransport::read(uint8_t* buf, uint32_t len)
+{
+  uint32_t n = std::min(len, remaining_);
+  if (n > 0)
+  {
+    memcpy(buf, input_->peek(), n);
+    consume(n);
+  }
+  return n;
+}
+
+uint32_t ThriftBufferTransport::readAll(uint8_t* buf, uint32_t len)
+{
+  if (len > remaining_)
+  {
+    throw TTransportException(TTransportException::END_OF_FILE,
+                              "ThriftBufferTransport: frame underflow");
+  }
+  return read(buf, len);
+}
+
+void ThriftBufferTransport::write(const uint8_t* buf, uint32_t len)
+{
+  output_->append(buf, len);
+}
+
+const uint8_t* ThriftBufferTransport::borrow(uint8_t* buf, uint32_t* len)
+{
+  if (*len <= remaining_)
+  {
+    *len = remaining_;
+    return reinterpret_cast<const uint8_t*>(input_->peek());
+  }
+  return NULL;
+}
+
+void ThriftBufferTransport::consume(uint32_t len)
+{
+  if (len > remaining_)
+  {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "ThriftBufferTransport: consume too much");
+  }
+  input_->retrieve(len);
+  remaining_ -= len;
+}
+
+uint32_t ThriftBufferTransport::readEnd()
+{
+  uint32_t skipped = remaining_;
+  if (skipped > 0)
+  {
+    input_->retrieve(skipped);
+    remaining_ = 0;
+  }
+  return skipped;
+}
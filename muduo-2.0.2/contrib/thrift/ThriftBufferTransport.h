@@ -0,0 +1,83 @@
+#ifndef MUDUO_CONTRIB_THRIFT_THRIFTBUFFERTRANSPORT_H
+#define MUDUO_CONTRIB_THRIFT_THRIFTBUFFERTRANSPORT_H
+
+#include "muduo/net/Buffer.h"
+
+#include <thrift/transport/TVirtualTransport.h>
+
+using apache::thrift::transport::TVirtualTransport;
+
+/// A thrift transport directly over muduo::net::Buffer.
+///
+/// Reads consume at most @c frameSize bytes from the input buffer,
+/// writes append to the output buffer.  No intermediate copy is made,
+/// and borrow() hands out pointers into the input buffer, so
+/// TBinaryProtocol/TCompactProtocol decode strings in place.
+///
+/// The output buffer keeps Buffer::kCheapPrepend bytes in front,
+/// so the frame header can be prepended after the reply is serialized.
+class ThriftBufferTransport : public TVirtualTransport<ThriftBufferTransport>
+{
+ public:
+  ThriftBufferTransport()
+    : input_(NULL),
+      output_(NULL),
+      remaining_(0)
+  {
+  }
+
+  void resetInput(muduo::net::Buffer* input, uint32_t frameSize)
+  {
+    assert(input->readableBytes() >= frameSize);
+    input_ = input;
+    remaining_ = frameSize;
+  }
+
+  void resetOutput(muduo::net::Buffer* output)
+  {
+    output_ = output;
+  }
+
+  uint32_t remaining() const
+  {
+    return remaining_;
+  }
+
+  bool isOpen()
+  {
+    return true;
+  }
+
+  bool peek()
+  {
+    return remaining_ > 0;
+  }
+
+  void open()
+  {
+  }
+
+  void close()
+  {
+  }
+
+  uint32_t read(uint8_t* buf, uint32_t len);
+
+  uint32_t readAll(uint8_t* buf, uint32_t len);
+
+  void write(const uint8_t* buf, uint32_t len);
+
+  const uint8_t* borrow(uint8_t* buf, uint32_t* len);
+
+  void consume(uint32_t len);
+
+  // Skips the unread part of the frame, for a processor that gave up early.
+  uint32_t readEnd();
+
+ private:
+  muduo::net::Buffer* input_;
+  muduo::net::Buffer* output_;
+  uint32_t remaining_;
+};
+
+#endif  // MUDUO_CONTRIB_THRIFT_THRIFTBUFFERTRANSPORT_H
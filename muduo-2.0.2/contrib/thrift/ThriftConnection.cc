@@ -11,26 +11,26 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+const size_t kMaxFreeRequests = 16;
+}
+
 ThriftConnection::ThriftConnection(ThriftServer* server,
                                   const TcpConnectionPtr& conn)
   : server_(server),
     conn_(conn),
     state_(kExpectFrameSize),
-    frameSize_(0)
+    frameSize_(0),
+    nextSeq_(0),
+    nextReplySeq_(0),
+    inflight_(0),
+    readingPaused_(false)
 {
   conn_->setMessageCallback(boost::bind(&ThriftConnection::onMessage,
                                         this, _1, _2, _3));
   nullTransport_.reset(new TNullTransport());
-  inputTransport_.reset(new TMemoryBuffer(NULL, 0));
-  outputTransport_.reset(new TMemoryBuffer());
-
-  factoryInputTransport_ = server_->getInputTransportFactory()->getTransport(inputTransport_);
-  factoryOutputTransport_ = server_->getOutputTransportFactory()->getTransport(outputTransport_);
-
-  inputProtocol_ = server_->getInputProtocolFactory()->getProtocol(factoryInputTransport_);
-  outputProtocol_ = server_->getOutputProtocolFactory()->getProtocol(factoryOutputTransport_);
-
-  processor_ = server_->getProcessor(inputProtocol_, outputProtocol_, nullTransport_);
+  inlineRequest_ = newRequest();
 }
 
 void ThriftConnection::onMessage(const TcpConnectionPtr& conn,
@@ -56,23 +56,7 @@ void ThriftConnection::onMessage(const TcpConnectionPtr& conn,
     {
       if (buffer->readableBytes() >= frameSize_)
       {
-        uint8_t* buf = reinterpret_cast<uint8_t*>((const_cast<char*>(buffer->peek())));
-
-        inputTransport_->resetBuffer(buf, frameSize_, TMemoryBuffer::COPY);
-        outputTransport_->resetBuffer();
-        outputTransport_->getWritePtr(4);
-        outputTransport_->wroteBytes(4);
-
-        if (server_->isWorkerThreadPoolProcessing())
-        {
-          server_->workerThreadPool().run(boost::bind(&ThriftConnection::process, this));
-        }
-        else
-        {
-          process();
-        }
-
-        buffer->retrieve(frameSize_);
+        dispatch(buffer);
         state_ = kExpectFrameSize;
       }
       else
@@ -83,39 +67,180 @@ void ThriftConnection::onMessage(const TcpConnectionPtr& conn,
   }
 }
 
-void ThriftConnection::process()
+void ThriftConnection::dispatch(Buffer* buffer)
 {
-  try
+  if (server_->isWorkerThreadPoolProcessing())
   {
-    processor_->process(inputProtocol_, outputProtocol_, NULL);
+    RequestPtr req = newRequest();
+    req->seq = nextSeq_++;
+    if (buffer->readableBytes() == frameSize_)
+    {
+      // a lone frame, take over its bytes instead of copying them
+      req->input.swap(*buffer);
+    }
+    else
+    {
+      req->input.append(buffer->peek(), frameSize_);
+      buffer->retrieve(frameSize_);
+    }
+    req->transport->resetInput(&req->input, frameSize_);
 
-    uint8_t* buf;
-    uint32_t size;
-    outputTransport_->getBuffer(&buf, &size);
+    {
+      MutexLockGuard lock(mutex_);
+      ++inflight_;
+      int maxPipelined = server_->maxPipelinedRequests();
+      if (maxPipelined > 0 && inflight_ >= maxPipelined && !readingPaused_)
+      {
+        readingPaused_ = true;
+        conn_->stopRead();
+      }
+    }
+    server_->workerThreadPool().run(boost::bind(&ThriftConnection::process,
+                                                shared_from_this(), req));
+  }
+  else
+  {
+    // parse in place, the frame is consumed from buffer as it is decoded
+    Request* req = inlineRequest_.get();
+    req->transport->resetInput(buffer, frameSize_);
+    processRequest(req);
+    if (req->output.readableBytes() > 0)
+    {
+      conn_->send(&req->output);
+    }
+  }
+}
 
-    assert(size >= 4);
-    uint32_t frameSize = static_cast<uint32_t>(htonl(size - 4));
-    memcpy(buf, &frameSize, 4);
+void ThriftConnection::process(const RequestPtr& req)
+{
+  processRequest(req.get());
+  sendReply(req->seq, &req->output);
+  recycle(req);
+}
 
-    conn_->send(buf, size);
+void ThriftConnection::processRequest(Request* req)
+{
+  req->output.retrieveAll();
+  bool ok = false;
+  try
+  {
+    req->processor->process(req->inputProtocol, req->outputProtocol, NULL);
+    ok = true;
   } catch (const TTransportException& ex)
   {
     LOG_ERROR << "ThriftServer TTransportException: " << ex.what();
-    close();
+    close(req);
   } catch (const std::exception& ex)
   {
     LOG_ERROR << "ThriftServer std::exception: " << ex.what();
-    close();
+    close(req);
   } catch (...)
   {
     LOG_ERROR << "ThriftServer unknown exception";
-    close();
+    close(req);
+  }
+  req->transport->readEnd();
+
+  if (!ok)
+  {
+    req->output.retrieveAll();
+  }
+  else if (req->output.readableBytes() > 0)
+  {
+    // oneway calls write nothing and get no frame back
+    req->output.prependInt32(static_cast<int32_t>(req->output.readableBytes()));
+  }
+}
+
+void ThriftConnection::sendReply(uint64_t seq, Buffer* reply)
+{
+  if (server_->isOutOfOrderResponses())
+  {
+    // pipelining clients match replies by seqid
+    if (reply->readableBytes() > 0)
+    {
+      conn_->send(reply);
+    }
+  }
+
+  MutexLockGuard lock(mutex_);
+  if (!server_->isOutOfOrderResponses())
+  {
+    // sending under the lock keeps replies in request order
+    if (seq != nextReplySeq_)
+    {
+      pendingReplies_[seq].swap(*reply);
+    }
+    else
+    {
+      if (reply->readableBytes() > 0)
+      {
+        conn_->send(reply);
+      }
+      ++nextReplySeq_;
+
+      std::map<uint64_t, Buffer>::iterator it = pendingReplies_.begin();
+      while (it != pendingReplies_.end() && it->first == nextReplySeq_)
+      {
+        if (it->second.readableBytes() > 0)
+        {
+          conn_->send(&it->second);
+        }
+        ++nextReplySeq_;
+        pendingReplies_.erase(it++);
+      }
+    }
+  }
+
+  --inflight_;
+  if (readingPaused_ && inflight_ < server_->maxPipelinedRequests())
+  {
+    readingPaused_ = false;
+    conn_->startRead();
+  }
+}
+
+ThriftConnection::RequestPtr ThriftConnection::newRequest()
+{
+  {
+    MutexLockGuard lock(mutex_);
+    if (!freeRequests_.empty())
+    {
+      RequestPtr req = freeRequests_.back();
+      freeRequests_.pop_back();
+      return req;
+    }
+  }
+
+  RequestPtr req(new Request);
+  req->seq = 0;
+  req->transport.reset(new ThriftBufferTransport());
+  req->transport->resetOutput(&req->output);
+
+  req->factoryInputTransport = server_->getInputTransportFactory()->getTransport(req->transport);
+  req->factoryOutputTransport = server_->getOutputTransportFactory()->getTransport(req->transport);
+
+  req->inputProtocol = server_->getInputProtocolFactory()->getProtocol(req->factoryInputTransport);
+  req->outputProtocol = server_->getOutputProtocolFactory()->getProtocol(req->factoryOutputTransport);
+
+  req->processor = server_->getProcessor(req->inputProtocol, req->outputProtocol, nullTransport_);
+  return req;
+}
+
+void ThriftConnection::recycle(const RequestPtr& req)
+{
+  req->input.retrieveAll();
+  req->output.retrieveAll();
+  MutexLockGuard lock(mutex_);
+  if (freeRequests_.size() < kMaxFreeRequests)
+  {
+    freeRequests_.push_back(req);
   }
 }
 
-void ThriftConnection::close()
+void ThriftConnection::close(Request* req)
 {
   nullTransport_->close();
-  factoryInputTransport_->close();
-  factoryOutputTransport_->close();
+  req->factoryInputTransport->close();
+  req->factoryOutputTransport->close();
 }
@@ -1,15 +1,21 @@
 #ifndef MUDUO_CONTRIB_THRIFT_THRIFTCONNECTION_H
 #define MUDUO_CONTRIB_THRIFT_THRIFTCONNECTION_H
 
+#include <map>
+#include <vector>
+
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/noncopyable.hpp>
 
+#include "muduo/base/Mutex.h"
 #include "muduo/net/TcpConnection.h"
 
 #include <thrift/protocol/TProtocol.h>
 #include <thrift/transport/TBufferTransports.h>
 #include <thrift/transport/TTransportUtils.h>
 
+#include "contrib/thrift/ThriftBufferTransport.h"
+
 using apache::thrift::TProcessor;
 using apache::thrift::protocol::TProtocol;
 using apache::thrift::transport::TMemoryBuffer;
@@ -32,13 +38,41 @@ class ThriftConnection : boost::noncopyable,
   ThriftConnection(ThriftServer* server, const muduo::net::TcpConnectionPtr& conn);
 
  private:
+  // One decoded frame and everything needed to process it.
+  // Frames handed to the worker thread pool own their input bytes,
+  // frames processed in the io thread read the connection Buffer in place.
+  struct Request : boost::noncopyable
+  {
+    uint64_t seq;
+    muduo::net::Buffer input;
+    muduo::net::Buffer output;
+
+    boost::shared_ptr<ThriftBufferTransport> transport;
+    boost::shared_ptr<TTransport> factoryInputTransport;
+    boost::shared_ptr<TTransport> factoryOutputTransport;
+    boost::shared_ptr<TProtocol> inputProtocol;
+    boost::shared_ptr<TProtocol> outputProtocol;
+    boost::shared_ptr<TProcessor> processor;
+  };
+  typedef boost::shared_ptr<Request> RequestPtr;
+
   void onMessage(const muduo::net::TcpConnectionPtr& conn,
                  muduo::net::Buffer* buffer,
                  muduo::Timestamp receiveTime);
 
-  void process();
+  void dispatch(muduo::net::Buffer* buffer);
+
+  void process(const RequestPtr& req);
+
+  void processRequest(Request* req);
+
+  void sendReply(uint64_t seq, muduo::net::Buffer* reply);
 
-  void close();
+  RequestPtr newRequest();
+
+  void recycle(const RequestPtr& req);
+
+  void close(Request* req);
 
  private:
   ThriftServer* server_;
@@ -46,19 +80,21 @@ class ThriftConnection : boost::noncopyable,
 
   boost::shared_ptr<TNullTransport> nullTransport_;
 
-  boost::shared_ptr<TMemoryBuffer> inputTransport_;
-  boost::shared_ptr<TMemoryBuffer> outputTransport_;
-
-  boost::shared_ptr<TTransport> factoryInputTransport_;
-  boost::shared_ptr<TTransport> factoryOutputTransport_;
-
-  boost::shared_ptr<TProtocol> inputProtocol_;
-  boost::shared_ptr<TProtocol> outputProtocol_;
-
-  boost::shared_ptr<TProcessor> processor_;
+  RequestPtr inlineRequest_;
 
   enum State state_;
   uint32_t frameSize_;
+
+  // sequence number of the next frame, io thread only
+  uint64_t nextSeq_;
+
+  muduo::MutexLock mutex_;
+  uint64_t nextReplySeq_ GUARDED_BY(mutex_);
+  // replies finished ahead of their turn, keyed by seq
+  std::map<uint64_t, muduo::net::Buffer> pendingReplies_ GUARDED_BY(mutex_);
+  std::vector<RequestPtr> freeRequests_ GUARDED_BY(mutex_);
+  int inflight_ GUARDED_BY(mutex_);
+  bool readingPaused_ GUARDED_BY(mutex_);
 };
 
 typedef boost::shared_ptr<ThriftConnection> ThriftConnectionPtr;
@@ -32,6 +32,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processorFactory),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -47,6 +49,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processor),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -63,6 +67,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processorFactory),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -81,6 +87,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processor),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -100,6 +108,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processorFactory),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -121,6 +131,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processor),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -144,6 +156,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processorFactory),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -167,6 +181,8 @@ class ThriftServer : boost::noncopyable,
     : TServer(processor),
       server_(eventloop, addr, name),
       numWorkerThreads_(0),
+      outOfOrderResponses_(false),
+      maxPipelinedRequests_(0),
       workerThreadPool_(name + muduo::string("WorkerThreadPool"))
   {
     server_.setConnectionCallback(boost::bind(&ThriftServer::onConnection,
@@ -206,6 +222,35 @@ class ThriftServer : boost::noncopyable,
     numWorkerThreads_ = numWorkerThreads;
   }
 
+  bool isOutOfOrderResponses() const
+  {
+    return outOfOrderResponses_;
+  }
+
+  /// With worker threads, pipelined requests of one connection run concurrently.
+  /// By default replies are held back and sent in request order,
+  /// set this for clients that match replies by seqid, so a slow call
+  /// doesn't delay the replies behind it.
+  /// Not thread safe, call before start().
+  void setOutOfOrderResponses(bool on)
+  {
+    outOfOrderResponses_ = on;
+  }
+
+  int maxPipelinedRequests() const
+  {
+    return maxPipelinedRequests_;
+  }
+
+  /// Stops reading from a connection while it has this many requests
+  /// in the worker thread pool, 0 for unlimited (default).
+  /// Not thread safe, call before start().
+  void setMaxPipelinedRequests(int maxRequests)
+  {
+    assert(maxRequests >= 0);
+    maxPipelinedRequests_ = maxRequests;
+  }
+
  private:
   friend class ThriftConnection;
 
@@ -214,6 +259,8 @@ class ThriftServer : boost::noncopyable,
  private:
   muduo::net::TcpServer server_;
   int numWorkerThreads_;
+  bool outOfOrderResponses_;
+  int maxPipelinedRequests_;
   muduo::ThreadPool workerThreadPool_;
   muduo::MutexLock mutex_;
   std::map<muduo::string, ThriftConnectionPtr> conns_;
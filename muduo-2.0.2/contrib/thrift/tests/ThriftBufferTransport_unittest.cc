@@ -0,0 +1,108 @@
+#include "contrib/thrift/ThriftBufferTransport.h"
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TTransportException.h>
+
+//#define BOOST_TEST_MODULE ThriftBufferTransportTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <string>
+
+using apache::thrift::protocol::TBinaryProtocolT;
+using apache::thrift::protocol::TMessageType;
+using apache::thrift::transport::TTransportException;
+using muduo::net::Buffer;
+
+typedef TBinaryProtocolT<ThriftBufferTransport> Protocol;
+
+// Serializes a message the way ThriftConnection sends a reply:
+// into the output Buffer, with the frame length prepended.
+static void writeFrame(Buffer* output, const std::string& name,
+                       int32_t seqid, const std::string& payload)
+{
+  std::shared_ptr<ThriftBufferTransport> transport(new ThriftBufferTransport);
+  Protocol protocol(transport);
+  transport->resetOutput(output);
+  protocol.writeMessageBegin(name, apache::thrift::protocol::T_CALL, seqid);
+  protocol.writeString(payload);
+  protocol.writeMessageEnd();
+  output->prependInt32(static_cast<int32_t>(output->readableBytes()));
+}
+
+BOOST_AUTO_TEST_CASE(testRoundTrip)
+{
+  Buffer frame1;
+  Buffer frame2;
+  const std::string payload(1000, 'x');
+  writeFrame(&frame1, "echo", 1, payload);
+  writeFrame(&frame2, "echo", 2, "second");
+  BOOST_CHECK_EQUAL(frame1.prependableBytes(), Buffer::kCheapPrepend - 4);
+
+  // Pipelined frames back to back in one input buffer.
+  Buffer buf;
+  buf.append(frame1.peek(), frame1.readableBytes());
+  buf.append(frame2.peek(), frame2.readableBytes());
+
+  std::shared_ptr<ThriftBufferTransport> transport(new ThriftBufferTransport);
+  Protocol protocol(transport);
+  for (int32_t i = 1; i <= 2; ++i)
+  {
+    uint32_t frameSize = static_cast<uint32_t>(buf.readInt32());
+    transport->resetInput(&buf, frameSize);
+
+    std::string name;
+    TMessageType type;
+    int32_t seqid = 0;
+    std::string str;
+    protocol.readMessageBegin(name, type, seqid);
+    protocol.readString(str);
+    protocol.readMessageEnd();
+
+    BOOST_CHECK_EQUAL(name, "echo");
+    BOOST_CHECK_EQUAL(type, apache::thrift::protocol::T_CALL);
+    BOOST_CHECK_EQUAL(seqid, i);
+    BOOST_CHECK_EQUAL(str, i == 1 ? payload : std::string("second"));
+    BOOST_CHECK_EQUAL(transport->remaining(), 0);
+  }
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testBorrowInPlace)
+{
+  Buffer buf;
+  buf.append("abcdefgh", 8);
+
+  ThriftBufferTransport transport;
+  transport.resetInput(&buf, 6);
+  uint32_t len = 4;
+  const uint8_t* p = transport.borrow(NULL, &len);
+  BOOST_CHECK(p == reinterpret_cast<const uint8_t*>(buf.peek()));
+  BOOST_CHECK_EQUAL(len, 6);
+
+  len = 7;
+  BOOST_CHECK(transport.borrow(NULL, &len) == NULL);
+
+  transport.consume(2);
+  uint8_t out[8];
+  BOOST_CHECK_EQUAL(transport.read(out, sizeof out), 4);
+  BOOST_CHECK_EQUAL(std::string(reinterpret_cast<char*>(out), 4), "cdef");
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), "gh");
+}
+
+BOOST_AUTO_TEST_CASE(testFrameBounds)
+{
+  Buffer buf;
+  buf.append("abcdefgh", 8);
+
+  ThriftBufferTransport transport;
+  transport.resetInput(&buf, 4);
+  uint8_t out[8];
+  BOOST_CHECK_THROW(transport.readAll(out, 5), TTransportException);
+  BOOST_CHECK_THROW(transport.consume(5), TTransportException);
+  BOOST_CHECK_EQUAL(transport.readEnd(), 4);
+  BOOST_CHECK(!transport.peek());
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 4);
+}
@@ -0,0 +1,169 @@
+// Pipelining load generator for muduo_thrift_bench_server.
+//
+// Usage: muduo_thrift_bench_client <host_ip> <port> <threads> <sessions> <pipeline> <payload> <seconds>
+//
+// Every session keeps <pipeline> Echo.echo() calls in flight on one connection,
+// the request frame is encoded once and replies are counted but not decoded.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "Echo.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::transport::TMemoryBuffer;
+
+string encodeRequest(int payload)
+{
+  boost::shared_ptr<TMemoryBuffer> transport(new TMemoryBuffer());
+  boost::shared_ptr<TBinaryProtocol> protocol(new TBinaryProtocol(transport));
+  echo::EchoClient client(protocol);
+  client.send_echo(std::string(payload, 'x'));
+
+  Buffer frame;
+  std::string body = transport->getBufferAsString();
+  frame.append(body.data(), body.size());
+  frame.prependInt32(static_cast<int32_t>(body.size()));
+  return frame.retrieveAllAsString();
+}
+
+class Session : noncopyable
+{
+ public:
+  Session(EventLoop* loop,
+          const InetAddress& serverAddr,
+          const string& name,
+          const string* request,
+          int pipeline,
+          AtomicInt64* replies)
+    : client_(loop, serverAddr, name),
+      request_(request),
+      pipeline_(pipeline),
+      replies_(replies)
+  {
+    client_.setConnectionCallback(
+        std::bind(&Session::onConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&Session::onMessage, this, _1, _2, _3));
+  }
+
+  void start()
+  {
+    client_.connect();
+  }
+
+  void stop()
+  {
+    client_.disconnect();
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+      for (int i = 0; i < pipeline_; ++i)
+      {
+        conn->send(*request_);
+      }
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    int64_t n = 0;
+    while (buf->readableBytes() >= sizeof(int32_t))
+    {
+      size_t len = static_cast<size_t>(buf->peekInt32()) + sizeof(int32_t);
+      if (buf->readableBytes() < len)
+      {
+        break;
+      }
+      buf->retrieve(len);
+      ++n;
+    }
+
+    if (n > 0)
+    {
+      replies_->add(n);
+      string more;
+      more.reserve(request_->size() * n);
+      for (int64_t i = 0; i < n; ++i)
+      {
+        more += *request_;
+      }
+      conn->send(more);
+    }
+  }
+
+  TcpClient client_;
+  const string* request_;
+  int pipeline_;
+  AtomicInt64* replies_;
+};
+
+int main(int argc, char* argv[])
+{
+  if (argc != 8)
+  {
+    fprintf(stderr, "Usage: %s <host_ip> <port> <threads> <sessions> <pipeline> <payload> <seconds>\n", argv[0]);
+    return 1;
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  InetAddress serverAddr(argv[1], static_cast<uint16_t>(atoi(argv[2])));
+  int threads = atoi(argv[3]);
+  int sessionCount = atoi(argv[4]);
+  int pipeline = atoi(argv[5]);
+  string request = encodeRequest(atoi(argv[6]));
+  int seconds = atoi(argv[7]);
+
+  EventLoop loop;
+  EventLoopThreadPool threadPool(&loop, "bench-client");
+  threadPool.setThreadNum(threads);
+  threadPool.start();
+
+  AtomicInt64 replies;
+  std::vector<std::unique_ptr<Session>> sessions;
+  for (int i = 0; i < sessionCount; ++i)
+  {
+    char name[32];
+    snprintf(name, sizeof name, "C%05d", i);
+    sessions.emplace_back(new Session(threadPool.getNextLoop(), serverAddr, name,
+                                      &request, pipeline, &replies));
+    sessions.back()->start();
+  }
+
+  // skip the first second, connections are still ramping up
+  int64_t start = 0;
+  loop.runAfter(1.0, [&] { start = replies.get(); });
+  loop.runAfter(1.0 + seconds, [&] {
+    int64_t total = replies.get() - start;
+    printf("%d sessions, pipeline %d, %zd bytes/request: %.1f requests/s\n",
+           sessionCount, pipeline, request.size(),
+           static_cast<double>(total) / seconds);
+    for (auto& session : sessions)
+    {
+      session->stop();
+    }
+    loop.quit();
+  });
+  loop.loop();
+}
@@ -0,0 +1,119 @@
+// Echo server for comparing ThriftServer with apache TNonblockingServer.
+//
+// Usage: muduo_thrift_bench_server <muduo|nonblocking> <io_threads> <worker_threads> [ordered|unordered]
+//
+// Drive it with muduo_thrift_bench_client, same echo.thrift and framed binary protocol.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <thrift/protocol/TBinaryProtocol.h>
+
+#ifdef HAVE_THRIFT_NONBLOCKING
+#include <thrift/concurrency/PosixThreadFactory.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/server/TNonblockingServer.h>
+#endif
+
+#include "ThriftServer.h"
+
+#include "Echo.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+using apache::thrift::protocol::TBinaryProtocolFactory;
+
+using namespace echo;
+
+class EchoHandler : virtual public EchoIf
+{
+ public:
+  void echo(std::string& str, const std::string& s)
+  {
+    str = s;
+  }
+};
+
+const uint16_t kPort = 9090;
+
+void runMuduo(const boost::shared_ptr<TProcessor>& processor,
+              const boost::shared_ptr<TProtocolFactory>& protocolFactory,
+              int ioThreads, int workerThreads, bool outOfOrder)
+{
+  EventLoop loop;
+  InetAddress addr(kPort);
+  ThriftServer server(processor, protocolFactory, &loop, addr, "BenchServer");
+  server.setThreadNum(ioThreads);
+  if (workerThreads > 0)
+  {
+    server.setWorkerThreadNum(workerThreads);
+    server.setOutOfOrderResponses(outOfOrder);
+  }
+  server.start();
+  loop.loop();
+}
+
+#ifdef HAVE_THRIFT_NONBLOCKING
+void runNonblocking(const boost::shared_ptr<TProcessor>& processor,
+                    const boost::shared_ptr<TProtocolFactory>& protocolFactory,
+                    int ioThreads, int workerThreads)
+{
+  using apache::thrift::concurrency::PosixThreadFactory;
+  using apache::thrift::concurrency::ThreadManager;
+  using apache::thrift::server::TNonblockingServer;
+
+  boost::shared_ptr<ThreadManager> threadManager;
+  if (workerThreads > 0)
+  {
+    threadManager = ThreadManager::newSimpleThreadManager(workerThreads);
+    threadManager->threadFactory(boost::shared_ptr<PosixThreadFactory>(new PosixThreadFactory()));
+    threadManager->start();
+  }
+  TNonblockingServer server(processor, protocolFactory, kPort, threadManager);
+  server.setNumIOThreads(ioThreads > 0 ? ioThreads : 1);
+  server.serve();
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+  if (argc < 4)
+  {
+    fprintf(stderr, "Usage: %s <muduo|nonblocking> <io_threads> <worker_threads> [ordered|unordered]\n", argv[0]);
+    return 1;
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  int ioThreads = atoi(argv[2]);
+  int workerThreads = atoi(argv[3]);
+  bool outOfOrder = argc > 4 && strcmp(argv[4], "unordered") == 0;
+
+  boost::shared_ptr<EchoHandler> handler(new EchoHandler());
+  boost::shared_ptr<TProcessor> processor(new EchoProcessor(handler));
+  boost::shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
+
+  if (strcmp(argv[1], "muduo") == 0)
+  {
+    runMuduo(processor, protocolFactory, ioThreads, workerThreads, outOfOrder);
+  }
+  else if (strcmp(argv[1], "nonblocking") == 0)
+  {
+#ifdef HAVE_THRIFT_NONBLOCKING
+    runNonblocking(processor, protocolFactory, ioThreads, workerThreads);
+#else
+    fprintf(stderr, "built without libthriftnb\n");
+    return 1;
+#endif
+  }
+  else
+  {
+    fprintf(stderr, "unknown server %s\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
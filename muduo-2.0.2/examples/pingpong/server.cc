@@ -2,6 +2,7 @@
 
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Logging.h"
+#include "muduo/base/ProcessInfo.h"
 #include "muduo/base/Thread.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/InetAddress.h"
@@ -9,6 +10,7 @@
 #include <utility>
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -27,11 +29,46 @@ void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
   conn->send(buf);
 }
 
+// Cpu sets of the io threads for a topology:
+// - none: no affinity, round-robin
+// - cpu: io thread i pinned to cpu i
+// - node: io thread i pinned to all cpus of NUMA node i % nodes
+std::vector<std::vector<int>> cpuSets(const char* topology, int threadCount)
+{
+  std::vector<std::vector<int>> result;
+  int numCpus = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+  if (strcmp(topology, "cpu") == 0)
+  {
+    for (int i = 0; i < threadCount; ++i)
+    {
+      result.push_back(std::vector<int>(1, i % numCpus));
+    }
+  }
+  else if (strcmp(topology, "node") == 0)
+  {
+    std::vector<std::vector<int>> nodes;
+    for (int cpu = 0; cpu < numCpus; ++cpu)
+    {
+      int node = std::max(ProcessInfo::numaNodeOfCpu(cpu), 0);
+      if (implicit_cast<size_t>(node) >= nodes.size())
+      {
+        nodes.resize(node + 1);
+      }
+      nodes[node].push_back(cpu);
+    }
+    for (int i = 0; i < threadCount; ++i)
+    {
+      result.push_back(nodes[i % nodes.size()]);
+    }
+  }
+  return result;
+}
+
 int main(int argc, char* argv[])
 {
   if (argc < 4)
   {
-    fprintf(stderr, "Usage: server <address> <port> <threads>\n");
+    fprintf(stderr, "Usage: server <address> <port> <threads> [none|cpu|node]\n");
   }
   else
   {
@@ -55,6 +92,16 @@ int main(int argc, char* argv[])
       server.setThreadNum(threadCount);
     }
 
+    if (argc > 4 && threadCount > 1)
+    {
+      std::vector<std::vector<int>> cpus = cpuSets(argv[4], threadCount);
+      if (!cpus.empty())
+      {
+        server.setThreadCpuAffinity(cpus);
+        server.setIncomingCpuRouting(true);
+      }
+    }
+
     server.start();
 
     loop.loop();
@@ -10,8 +10,10 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/net/Endian.h"
+#include "muduo/net/protobuf/ProtobufCodecLite.h"
 #include "muduo/net/protorpc/google-inl.h"
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/descriptor.h>
 
 #include <zlib.h>  // adler32
@@ -147,8 +149,10 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
     else if (buf->readableBytes() >= implicit_cast<size_t>(len + kHeaderLen))
     {
       ErrorCode errorCode = kNoError;
-      MessagePtr message = parse(buf->peek()+kHeaderLen, len, &errorCode);
-      if (errorCode == kNoError && message)
+      google::protobuf::Arena* arena = arenaDecode_ ? ProtobufCodecLite::threadArena() : NULL;
+      MessagePtr message = parse(buf->peek()+kHeaderLen, len, &errorCode, arena);
+      bool ok = errorCode == kNoError && message;
+      if (ok)
       {
         messageCallback_(conn, message, receiveTime);
         buf->retrieve(kHeaderLen+len);
@@ -156,6 +160,14 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
       else
       {
         errorCallback_(conn, buf, receiveTime, errorCode);
+      }
+      if (arena)
+      {
+        message.reset();
+        arena->Reset();
+      }
+      if (!ok)
+      {
         break;
       }
     }
@@ -166,7 +178,8 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
   }
 }
 
-google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeName)
+google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeName,
+                                                        google::protobuf::Arena* arena)
 {
   google::protobuf::Message* message = NULL;
   const google::protobuf::Descriptor* descriptor =
@@ -177,13 +190,14 @@ google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeN
       google::protobuf::MessageFactory::generated_factory()->GetPrototype(descriptor);
     if (prototype)
     {
-      message = prototype->New();
+      message = prototype->New(arena);
     }
   }
   return message;
 }
 
-MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
+MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error,
+                                google::protobuf::Arena* arena)
 {
   MessagePtr message;
 
@@ -201,7 +215,16 @@ MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
     {
       std::string typeName(buf + kHeaderLen, buf + kHeaderLen + nameLen - 1);
       // create message object
-      message.reset(createMessage(typeName));
+      google::protobuf::Message* raw = createMessage(typeName, arena);
+      if (arena)
+      {
+        // aliasing an empty shared_ptr, the arena owns the message
+        message = MessagePtr(MessagePtr(), raw);
+      }
+      else
+      {
+        message.reset(raw);
+      }
       if (message)
       {
         // parse from buffer
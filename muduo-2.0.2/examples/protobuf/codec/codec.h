@@ -53,16 +53,22 @@ class ProtobufCodec : muduo::noncopyable
 
   explicit ProtobufCodec(const ProtobufMessageCallback& messageCb)
     : messageCallback_(messageCb),
-      errorCallback_(defaultErrorCallback)
+      errorCallback_(defaultErrorCallback),
+      arenaDecode_(false)
   {
   }
 
   ProtobufCodec(const ProtobufMessageCallback& messageCb, const ErrorCallback& errorCb)
     : messageCallback_(messageCb),
-      errorCallback_(errorCb)
+      errorCallback_(errorCb),
+      arenaDecode_(false)
   {
   }
 
+  // Decodes into a per thread arena which is reset after each message callback,
+  // the callback must not keep the MessagePtr.
+  void setArenaDecode(bool on) { arenaDecode_ = on; }
+
   void onMessage(const muduo::net::TcpConnectionPtr& conn,
                  muduo::net::Buffer* buf,
                  muduo::Timestamp receiveTime);
@@ -78,8 +84,11 @@ class ProtobufCodec : muduo::noncopyable
 
   static const muduo::string& errorCodeToString(ErrorCode errorCode);
   static void fillEmptyBuffer(muduo::net::Buffer* buf, const google::protobuf::Message& message);
-  static google::protobuf::Message* createMessage(const std::string& type_name);
-  static MessagePtr parse(const char* buf, int len, ErrorCode* errorCode);
+  static google::protobuf::Message* createMessage(const std::string& type_name,
+                                                  google::protobuf::Arena* arena = NULL);
+  // if arena is not NULL, the returned MessagePtr does not own the message
+  static MessagePtr parse(const char* buf, int len, ErrorCode* errorCode,
+                          google::protobuf::Arena* arena = NULL);
 
  private:
   static void defaultErrorCallback(const muduo::net::TcpConnectionPtr&,
@@ -89,6 +98,7 @@ class ProtobufCodec : muduo::noncopyable
 
   ProtobufMessageCallback messageCallback_;
   ErrorCallback errorCallback_;
+  bool arenaDecode_;
 
   const static int kHeaderLen = sizeof(int32_t);
   const static int kMinMessageLen = 2*kHeaderLen + 2; // nameLen + typeName + checkSum
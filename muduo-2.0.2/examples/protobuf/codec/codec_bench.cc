@@ -0,0 +1,147 @@
+// Decoding throughput of the protobuf codecs, heap allocated vs arena allocated messages.
+//
+// Frames are encoded once and fed through onMessage() from a Buffer in batches,
+// the message callback only touches the decoded message.
+// Also compares ParseFromArray with parsing through BufferInputStream.
+
+#include "examples/protobuf/codec/codec.h"
+#include "examples/protobuf/codec/query.pb.h"
+
+#include "muduo/net/protobuf/BufferStream.h"
+#include "muduo/net/protobuf/ProtobufCodecLite.h"
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kBatch = 1000;
+const double kSeconds = 1.0;
+
+char g_queryTag[] = "QUERY";
+typedef ProtobufCodecLiteT<muduo::Query, g_queryTag> QueryCodec;
+
+int64_t g_checksum = 0;
+
+muduo::Query makeQuery(int questions, int questionLen)
+{
+  muduo::Query query;
+  query.set_id(1);
+  query.set_questioner("Chen Shuo");
+  for (int i = 0; i < questions; ++i)
+  {
+    query.add_question(std::string(questionLen, static_cast<char>('a' + i % 26)));
+  }
+  return query;
+}
+
+// feeds batches of frame through decode until kSeconds elapsed, returns messages per second
+template<typename DECODE>
+double run(const string& frame, DECODE decode)
+{
+  string batch;
+  for (int i = 0; i < kBatch; ++i)
+  {
+    batch += frame;
+  }
+
+  Buffer buf;
+  int64_t messages = 0;
+  Timestamp start(Timestamp::now());
+  double elapsed = 0;
+  do
+  {
+    buf.append(batch);
+    decode(&buf);
+    assert(buf.readableBytes() == 0);
+    messages += kBatch;
+    elapsed = timeDifference(Timestamp::now(), start);
+  } while (elapsed < kSeconds);
+  return static_cast<double>(messages) / elapsed;
+}
+
+void benchLite(const muduo::Query& query, bool arena)
+{
+  QueryCodec codec([](const TcpConnectionPtr&,
+                      const std::shared_ptr<muduo::Query>& message,
+                      Timestamp)
+                   {
+                     g_checksum += message->id() + message->question_size();
+                   });
+  codec.setArenaDecode(arena);
+  Buffer frame;
+  codec.fillEmptyBuffer(&frame, query);
+  double rate = run(frame.retrieveAllAsString(), [&codec](Buffer* buf) {
+      codec.onMessage(TcpConnectionPtr(), buf, Timestamp());
+    });
+  printf("  ProtobufCodecLite %-5s %10.0f msgs/s\n", arena ? "arena" : "heap", rate);
+}
+
+void benchCodec(const muduo::Query& query, bool arena)
+{
+  ProtobufCodec codec([](const TcpConnectionPtr&,
+                         const MessagePtr& message,
+                         Timestamp)
+                      {
+                        g_checksum += static_cast<int64_t>(message->ByteSizeLong());
+                      });
+  codec.setArenaDecode(arena);
+  Buffer frame;
+  ProtobufCodec::fillEmptyBuffer(&frame, query);
+  double rate = run(frame.retrieveAllAsString(), [&codec](Buffer* buf) {
+      codec.onMessage(TcpConnectionPtr(), buf, Timestamp());
+    });
+  printf("  ProtobufCodec     %-5s %10.0f msgs/s\n", arena ? "arena" : "heap", rate);
+}
+
+void benchParse(const muduo::Query& query, bool stream)
+{
+  string payload = query.SerializeAsString();
+  int len = static_cast<int>(payload.size());
+  google::protobuf::Arena arena;
+  double rate = run(payload, [&](Buffer* buf) {
+      while (buf->readableBytes() > 0)
+      {
+        muduo::Query* message = google::protobuf::Arena::CreateMessage<muduo::Query>(&arena);
+        bool ok = false;
+        if (stream)
+        {
+          BufferInputStream input(buf, len);
+          ok = message->ParseFromZeroCopyStream(&input);
+        }
+        else
+        {
+          ok = message->ParseFromArray(buf->peek(), len);
+        }
+        assert(ok); (void) ok;
+        g_checksum += message->id();
+        buf->retrieve(len);
+        arena.Reset();
+      }
+    });
+  printf("  %-23s %10.0f msgs/s\n", stream ? "BufferInputStream" : "ParseFromArray", rate);
+}
+
+int main()
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  struct { const char* name; int questions; int questionLen; } cases[] = {
+    { "small", 3, 16 },
+    { "large", 100, 64 },
+  };
+  for (const auto& c : cases)
+  {
+    muduo::Query query = makeQuery(c.questions, c.questionLen);
+    printf("%s query, %zd bytes\n", c.name, query.ByteSizeLong());
+    benchLite(query, false);
+    benchLite(query, true);
+    benchCodec(query, false);
+    benchCodec(query, true);
+    benchParse(query, false);
+    benchParse(query, true);
+  }
+  printf("checksum %ld\n", g_checksum);
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
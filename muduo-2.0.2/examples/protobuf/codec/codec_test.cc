@@ -42,6 +42,14 @@ void testQuery()
 
   std::shared_ptr<muduo::Query> newQuery = down_pointer_cast<muduo::Query>(message);
   assert(newQuery != NULL);
+
+  google::protobuf::Arena arena;
+  MessagePtr arenaMessage = ProtobufCodec::parse(buf.peek(), len, &errorCode, &arena);
+  assert(errorCode == ProtobufCodec::kNoError);
+  assert(arenaMessage != NULL);
+  assert(arenaMessage->GetArena() == &arena);
+  assert(arenaMessage.use_count() == 0);
+  assert(arenaMessage->DebugString() == query.DebugString());
 }
 
 void testAnswer()
@@ -199,7 +207,7 @@ void onMessage(const muduo::net::TcpConnectionPtr& conn,
   g_count++;
 }
 
-void testOnMessage()
+void testOnMessage(bool arena)
 {
   muduo::Query query;
   query.set_id(1);
@@ -224,6 +232,7 @@ void testOnMessage()
   muduo::net::TcpConnectionPtr conn;
   muduo::Timestamp t;
   ProtobufCodec codec(onMessage);
+  codec.setArenaDecode(arena);
   for (size_t len = 0; len <= totalLen; ++len)
   {
     Buffer input;
@@ -254,7 +263,8 @@ int main()
   puts("");
   testBadBuffer();
   puts("");
-  testOnMessage();
+  testOnMessage(false);
+  testOnMessage(true);
   puts("");
 
   puts("All pass!!!");
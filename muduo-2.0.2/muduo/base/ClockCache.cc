@@ -0,0 +1,92 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/base/ClockCache.h"
+
+#include "muduo/base/TimeZone.h"
+
+#include <atomic>
+#include <limits>
+
+#include <assert.h>
+#include <stdio.h>
+
+namespace muduo
+{
+namespace ClockCache
+{
+
+const time_t kNoSecond = std::numeric_limits<time_t>::min();
+
+__thread time_t t_utcSecond = kNoSecond;
+__thread char t_utcText[64];
+
+__thread time_t t_localSecond = kNoSecond;
+__thread int t_localGeneration;
+__thread char t_localText[64];
+
+__thread time_t t_httpSecond = kNoSecond;
+__thread char t_httpText[64];
+
+std::atomic<int> g_zoneGeneration(0);
+
+const char* kWeekdays[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char* kMonths[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+void formatTm(const struct tm& tm_time, char* buf, size_t size)
+{
+  int len = snprintf(buf, size, "%4d%02d%02d %02d:%02d:%02d",
+      tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+      tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+  assert(len == kFormattedLength); (void)len;
+}
+
+}  // namespace ClockCache
+}  // namespace muduo
+
+using namespace muduo;
+
+const char* ClockCache::formatUtc(time_t seconds)
+{
+  if (seconds != t_utcSecond)
+  {
+    t_utcSecond = seconds;
+    struct tm tm_time;
+    ::gmtime_r(&seconds, &tm_time);
+    formatTm(tm_time, t_utcText, sizeof t_utcText);
+  }
+  return t_utcText;
+}
+
+const char* ClockCache::formatLocal(time_t seconds, const TimeZone& tz)
+{
+  int generation = g_zoneGeneration.load(std::memory_order_relaxed);
+  if (seconds != t_localSecond || generation != t_localGeneration)
+  {
+    t_localSecond = seconds;
+    t_localGeneration = generation;
+    formatTm(tz.toLocalTime(seconds), t_localText, sizeof t_localText);
+  }
+  return t_localText;
+}
+
+void ClockCache::zoneChanged()
+{
+  g_zoneGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* ClockCache::httpDate(time_t seconds)
+{
+  if (seconds != t_httpSecond)
+  {
+    t_httpSecond = seconds;
+    struct tm tm_time;
+    ::gmtime_r(&seconds, &tm_time);
+    int len = snprintf(t_httpText, sizeof t_httpText, "%s, %02d %s %4d %02d:%02d:%02d GMT",
+        kWeekdays[tm_time.tm_wday], tm_time.tm_mday, kMonths[tm_time.tm_mon],
+        tm_time.tm_year + 1900, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    assert(len == kHttpDateLength); (void)len;
+  }
+  return t_httpText;
+}
@@ -0,0 +1,51 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_CLOCKCACHE_H
+#define MUDUO_BASE_CLOCKCACHE_H
+
+#include <time.h>
+
+namespace muduo
+{
+
+class TimeZone;
+
+///
+/// Per thread cache of the calendar text of the current second.
+///
+/// Log lines and HTTP Date headers of one second share the same text,
+/// the broken-down time is recomputed only when the second changes.
+/// muduo runs one EventLoop per thread, so this is also a per loop cache,
+/// and no locking is needed.
+///
+namespace ClockCache
+{
+  // "20120315 08:31:01", 17 chars, UTC
+  const char* formatUtc(time_t seconds);
+
+  // "20120315 16:31:01", 17 chars, converted with tz.
+  // Only one local zone is cached, call zoneChanged() after switching to another tz.
+  const char* formatLocal(time_t seconds, const TimeZone& tz);
+  void zoneChanged();
+
+  // "Thu, 15 Mar 2012 08:31:01 GMT", 29 chars, IMF-fixdate of RFC 7231
+  const char* httpDate(time_t seconds);
+
+  // writes 6 zero padded digits, no terminating NUL
+  inline void formatMicroseconds(int microseconds, char* buf)
+  {
+    for (int i = 5; i >= 0; --i)
+    {
+      buf[i] = static_cast<char>('0' + microseconds % 10);
+      microseconds /= 10;
+    }
+  }
+
+  const int kFormattedLength = 17;
+  const int kHttpDateLength = 29;
+}  // namespace ClockCache
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CLOCKCACHE_H
@@ -5,6 +5,7 @@
 
 #include "muduo/base/Logging.h"
 
+#include "muduo/base/ClockCache.h"
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/base/TimeZone.h"
@@ -36,8 +37,6 @@ class LoggerImpl
 */
 
 __thread char t_errnobuf[512];
-__thread char t_time[64];
-__thread time_t t_lastSecond;
 
 const char* strerror_tl(int savedErrno)
 {
@@ -108,13 +107,14 @@ void defaultFlush()
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 TimeZone g_logTimeZone;
+bool g_logCoarseClock = false;
 
 }  // namespace muduo
 
 using namespace muduo;
 
 Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int line)
-  : time_(Timestamp::now()),
+  : time_(g_logCoarseClock ? Timestamp::coarseNow() : Timestamp::now()),
     stream_(),
     level_(level),
     line_(line),
@@ -135,36 +135,32 @@ void Logger::Impl::formatTime()
   int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
   time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
   int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
-  if (seconds != t_lastSecond)
+
+  const char* date;
+  if (g_logTimeZone.valid())
+  {
+    date = ClockCache::formatLocal(seconds, g_logTimeZone);
+  }
+  else
   {
-    t_lastSecond = seconds;
-    struct tm tm_time;
-    if (g_logTimeZone.valid())
-    {
-      tm_time = g_logTimeZone.toLocalTime(seconds);
-    }
-    else
-    {
-      ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
-    }
-
-    int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-    assert(len == 17); (void)len;
+    date = ClockCache::formatUtc(seconds);
   }
 
+  // ".123456 " or ".123456Z ", not NUL terminated, so not through T
+  char us[9];
+  us[0] = '.';
+  ClockCache::formatMicroseconds(microseconds, us + 1);
+  stream_ << T(date, ClockCache::kFormattedLength);
   if (g_logTimeZone.valid())
   {
-    Fmt us(".%06d ", microseconds);
-    assert(us.length() == 8);
-    stream_ << T(t_time, 17) << T(us.data(), 8);
+    us[7] = ' ';
+    stream_.append(us, 8);
   }
   else
   {
-    Fmt us(".%06dZ ", microseconds);
-    assert(us.length() == 9);
-    stream_ << T(t_time, 17) << T(us.data(), 9);
+    us[7] = 'Z';
+    us[8] = ' ';
+    stream_.append(us, 9);
   }
 }
 
@@ -224,4 +220,10 @@ void Logger::setFlush(FlushFunc flush)
 void Logger::setTimeZone(const TimeZone& tz)
 {
   g_logTimeZone = tz;
+  ClockCache::zoneChanged();
+}
+
+void Logger::setCoarseClock(bool on)
+{
+  g_logCoarseClock = on;
 }
@@ -76,6 +76,9 @@ class Logger
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
   static void setTimeZone(const TimeZone& tz);
+  // Stamps log lines with Timestamp::coarseNow(), microseconds are
+  // then only as precise as the kernel tick.
+  static void setCoarseClock(bool on);
 
  private:
 
@@ -42,6 +42,16 @@ int taskDirFilter(const struct dirent* d)
   return 0;
 }
 
+__thread int t_numaNode = -1;
+int cpuDirFilter(const struct dirent* d)
+{
+  if (strncmp(d->d_name, "node", 4) == 0 && ::isdigit(d->d_name[4]))
+  {
+    t_numaNode = atoi(d->d_name + 4);
+  }
+  return 0;
+}
+
 int scanDir(const char *dirpath, int (*filter)(const struct dirent *))
 {
   struct dirent** namelist = NULL;
@@ -234,6 +244,16 @@ int ProcessInfo::numThreads()
   return result;
 }
 
+int ProcessInfo::numaNodeOfCpu(int cpu)
+{
+  // cpuN links its node as /sys/devices/system/cpu/cpuN/nodeM
+  char path[64];
+  snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+  t_numaNode = -1;
+  scanDir(path, cpuDirFilter);
+  return t_numaNode;
+}
+
 std::vector<pid_t> ProcessInfo::threads()
 {
   std::vector<pid_t> result;
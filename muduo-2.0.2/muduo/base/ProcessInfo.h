@@ -61,6 +61,9 @@ namespace ProcessInfo
 
   int numThreads();
   std::vector<pid_t> threads();
+
+  /// NUMA node of a cpu from /sys/devices/system/cpu, -1 if unknown
+  int numaNodeOfCpu(int cpu);
 }  // namespace ProcessInfo
 
 }  // namespace muduo
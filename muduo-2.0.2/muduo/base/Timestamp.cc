@@ -5,8 +5,11 @@
 
 #include "muduo/base/Timestamp.h"
 
+#include "muduo/base/ClockCache.h"
+
 #include <sys/time.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifndef __STDC_FORMAT_MACROS
 #define __STDC_FORMAT_MACROS
@@ -30,26 +33,19 @@ string Timestamp::toString() const
 
 string Timestamp::toFormattedString(bool showMicroseconds) const
 {
-  char buf[64] = {0};
   time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
-  struct tm tm_time;
-  gmtime_r(&seconds, &tm_time);
+  char buf[32];
+  memcpy(buf, ClockCache::formatUtc(seconds), ClockCache::kFormattedLength);
+  size_t len = ClockCache::kFormattedLength;
 
   if (showMicroseconds)
   {
     int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
-    snprintf(buf, sizeof(buf), "%4d%02d%02d %02d:%02d:%02d.%06d",
-             tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-             tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
-             microseconds);
-  }
-  else
-  {
-    snprintf(buf, sizeof(buf), "%4d%02d%02d %02d:%02d:%02d",
-             tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-             tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    buf[len++] = '.';
+    ClockCache::formatMicroseconds(microseconds, buf + len);
+    len += 6;
   }
-  return buf;
+  return string(buf, len);
 }
 
 Timestamp Timestamp::now()
@@ -60,3 +56,10 @@ Timestamp Timestamp::now()
   return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+Timestamp Timestamp::coarseNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  int64_t seconds = ts.tv_sec;
+  return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
@@ -63,6 +63,12 @@ class Timestamp : public muduo::copyable,
   /// Get time of now.
   ///
   static Timestamp now();
+
+  ///
+  /// Get time of now from CLOCK_REALTIME_COARSE,
+  /// cheaper than now() but only as precise as the kernel tick (1~4ms).
+  ///
+  static Timestamp coarseNow();
   static Timestamp invalid()
   {
     return Timestamp();
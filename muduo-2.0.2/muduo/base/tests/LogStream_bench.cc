@@ -1,5 +1,7 @@
 #include "muduo/base/LogStream.h"
+#include "muduo/base/Logging.h"
 #include "muduo/base/Timestamp.h"
+#include "muduo/base/TimeZone.h"
 
 #include <sstream>
 #include <stdio.h>
@@ -55,6 +57,34 @@ void benchLogStream()
   printf("benchLogStream %f\n", timeDifference(end, start));
 }
 
+void dummyOutput(const char* msg, int len)
+{
+}
+
+void benchLogging(const char* name)
+{
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+  {
+    LOG_INFO << i;
+  }
+  Timestamp end(Timestamp::now());
+
+  printf("benchLogging %s %f\n", name, timeDifference(end, start));
+}
+
+void benchFormattedString()
+{
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+  {
+    Timestamp::now().toFormattedString();
+  }
+  Timestamp end(Timestamp::now());
+
+  printf("benchFormattedString %f\n", timeDifference(end, start));
+}
+
 int main()
 {
   benchPrintf<int>("%d");
@@ -79,4 +109,14 @@ int main()
   benchStringStream<void*>();
   benchLogStream<void*>();
 
+  puts("log line");
+  Logger::setOutput(dummyOutput);
+  benchLogging("utc");
+  Logger::setTimeZone(TimeZone(8*3600, "CST"));
+  benchLogging("local");
+  Logger::setCoarseClock(true);
+  benchLogging("local coarse");
+
+  puts("timestamp");
+  benchFormattedString();
 }
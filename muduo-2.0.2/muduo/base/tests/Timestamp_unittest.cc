@@ -1,6 +1,9 @@
 #include "muduo/base/Timestamp.h"
+#include "muduo/base/ClockCache.h"
 #include <vector>
+#include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 using muduo::Timestamp;
 
@@ -55,8 +58,28 @@ void benchmark()
   }
 }
 
+void testFormat()
+{
+  Timestamp t(Timestamp::fromUnixTime(1331800261, 7));
+  assert(t.toFormattedString() == "20120315 08:31:01.000007");
+  assert(t.toFormattedString(false) == "20120315 08:31:01");
+  assert(strcmp(muduo::ClockCache::httpDate(t.secondsSinceEpoch()),
+                "Thu, 15 Mar 2012 08:31:01 GMT") == 0);
+
+  // cached text must follow the second
+  Timestamp next(Timestamp::fromUnixTime(1331800262, 999999));
+  assert(next.toFormattedString() == "20120315 08:31:02.999999");
+  assert(t.toFormattedString() == "20120315 08:31:01.000007");
+
+  Timestamp coarse(Timestamp::coarseNow());
+  double diff = timeDifference(Timestamp::now(), coarse);
+  assert(diff >= 0.0 && diff < 0.1);
+  (void)diff;
+}
+
 int main()
 {
+  testFormat();
   Timestamp now(Timestamp::now());
   printf("%s\n", now.toString().c_str());
   passByValue(now);
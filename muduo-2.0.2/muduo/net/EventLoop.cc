@@ -67,11 +67,14 @@ EventLoop::EventLoop()
     eventHandling_(false),
     callingPendingFunctors_(false),
     iteration_(0),
+    numaNode_(-1),
     threadId_(CurrentThread::tid()),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)),
+    functorBudget_(0),
+    numDeferred_(0),
     currentActiveChannel_(NULL)
 {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
@@ -127,6 +130,10 @@ void EventLoop::loop()
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
     doPendingFunctors();
+    if (iterationCallback_)
+    {
+      iterationCallback_(pollReturnTime_);
+    }
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -145,7 +152,7 @@ void EventLoop::quit()
   }
 }
 
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor cb, Priority priority)
 {
   if (isInLoopThread())
   {
@@ -153,15 +160,16 @@ void EventLoop::runInLoop(Functor cb)
   }
   else
   {
-    queueInLoop(std::move(cb));
+    queueInLoop(std::move(cb), priority);
   }
 }
 
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor cb, Priority priority, Timestamp deadline)
 {
+  assert(0 <= priority && priority < kNumPriorities);
   {
   MutexLockGuard lock(mutex_);
-  pendingFunctors_.push_back(std::move(cb));
+  pendingFunctors_[priority].emplace_back(std::move(cb), deadline);
   }
 
   if (!isInLoopThread() || callingPendingFunctors_)
@@ -173,7 +181,12 @@ void EventLoop::queueInLoop(Functor cb)
 size_t EventLoop::queueSize() const
 {
   MutexLockGuard lock(mutex_);
-  return pendingFunctors_.size();
+  size_t size = numDeferred_;
+  for (const PendingFunctorList& functors : pendingFunctors_)
+  {
+    size += functors.size();
+  }
+  return size;
 }
 
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
@@ -253,19 +266,106 @@ void EventLoop::handleRead()
 
 void EventLoop::doPendingFunctors()
 {
-  std::vector<Functor> functors;
+  PendingFunctorList functors[kNumPriorities];
   callingPendingFunctors_ = true;
 
   {
   MutexLockGuard lock(mutex_);
-  functors.swap(pendingFunctors_);
+  for (int i = 0; i < kNumPriorities; ++i)
+  {
+    functors[i].swap(pendingFunctors_[i]);
+  }
   }
 
-  for (const Functor& functor : functors)
+  Timestamp start(functorBudget_ > 0 ? Timestamp::now() : Timestamp::invalid());
+  Timestamp exhausted;  // valid once the budget is used up
+  size_t deferred = 0;
+  for (int i = 0; i < kNumPriorities; ++i)
   {
-    functor();
+    // functors deferred last time go first
+    RunnableFunctors& runnable = runnableFunctors_[i];
+    for (PendingFunctor& pending : functors[i])
+    {
+      if (pending.deadline.valid() && i != kHighPriority)
+      {
+        runnable.deadlines.push(Deadline{ pending.deadline,
+                                          runnable.frontSeq + runnable.functors.size() });
+      }
+      runnable.functors.push_back(RunnableFunctor{ std::move(pending.functor), false });
+    }
+
+    while (!runnable.functors.empty())
+    {
+      if (runnable.functors.front().done)
+      {
+        runnable.functors.pop_front();
+        ++runnable.frontSeq;
+        --runnable.numDone;
+        continue;
+      }
+      if (start.valid() && i != kHighPriority)
+      {
+        if (!exhausted.valid())
+        {
+          Timestamp now(Timestamp::now());
+          if (now.microSecondsSinceEpoch() - start.microSecondsSinceEpoch() >= functorBudget_)
+          {
+            exhausted = now;
+          }
+        }
+        if (exhausted.valid())
+        {
+          break;
+        }
+      }
+      Functor functor(std::move(runnable.functors.front().functor));
+      runnable.functors.pop_front();
+      ++runnable.frontSeq;
+      functor();
+    }
+
+    if (exhausted.valid() && i != kHighPriority)
+    {
+      runExpiredFunctors(&runnable, exhausted);
+    }
+    if (runnable.functors.empty())
+    {
+      runnable.deadlines = std::priority_queue<Deadline>();
+    }
+    deferred += runnable.functors.size() - runnable.numDone;
   }
+  numDeferred_ = deferred;
   callingPendingFunctors_ = false;
+
+  if (deferred > 0)
+  {
+    // don't block in poll with work left over
+    wakeup();
+  }
+}
+
+void EventLoop::runExpiredFunctors(RunnableFunctors* runnable, Timestamp now)
+{
+  while (!runnable->deadlines.empty())
+  {
+    Deadline deadline = runnable->deadlines.top();
+    if (deadline.seq >= runnable->frontSeq && now < deadline.when)
+    {
+      break;
+    }
+    runnable->deadlines.pop();
+    if (deadline.seq < runnable->frontSeq)
+    {
+      continue;  // already run in order
+    }
+
+    RunnableFunctor& expired = runnable->functors[deadline.seq - runnable->frontSeq];
+    assert(!expired.done);
+    expired.done = true;
+    ++runnable->numDone;
+    Functor functor(std::move(expired.functor));
+    functor();
+  }
 }
 
 void EventLoop::printActiveChannels() const
@@ -12,7 +12,9 @@
 #define MUDUO_NET_EVENTLOOP_H
 
 #include <atomic>
+#include <deque>
 #include <functional>
+#include <queue>
 #include <vector>
 
 #include <boost/any.hpp>
@@ -40,6 +42,16 @@ class EventLoop : noncopyable
 {
  public:
   typedef std::function<void()> Functor;
+  typedef std::function<void(Timestamp pollReturnTime)> IterationCallback;
+
+  /// Order in which pending functors run after I/O of an iteration.
+  enum Priority
+  {
+    kHighPriority,    // latency critical, never deferred by the budget
+    kNormalPriority,  // default
+    kLowPriority,     // maintenance, runs after the other two
+    kNumPriorities,
+  };
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for std::unique_ptr members.
@@ -64,18 +76,43 @@ class EventLoop : noncopyable
 
   int64_t iteration() const { return iteration_; }
 
+  ///
+  /// NUMA node the loop thread is pinned to, -1 if not pinned.
+  ///
+  int numaNode() const { return numaNode_; }
+  // internal usage
+  void setNumaNode(int node) { numaNode_ = node; }
+
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
   /// Safe to call from other threads.
-  void runInLoop(Functor cb);
+  void runInLoop(Functor cb, Priority priority = kNormalPriority);
   /// Queues callback in the loop thread.
-  /// Runs after finish pooling.
+  /// Runs after finish pooling, higher priority first, FIFO within a priority.
+  /// A valid @c deadline is the latest time the functor may be deferred to
+  /// when the functor budget is used up.
   /// Safe to call from other threads.
-  void queueInLoop(Functor cb);
+  void queueInLoop(Functor cb,
+                   Priority priority = kNormalPriority,
+                   Timestamp deadline = Timestamp::invalid());
 
   size_t queueSize() const;
 
+  ///
+  /// Caps the time spent on normal and low priority functors in one iteration,
+  /// the rest are deferred to the next iteration so I/O isn't starved.
+  /// 0 (default) runs all of them.
+  /// Must be called in the loop thread.
+  ///
+  void setFunctorBudget(double seconds)
+  { functorBudget_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond); }
+
+  /// Called at the end of every iteration, for instrumentation.
+  /// Must be called in the loop thread.
+  void setIterationCallback(IterationCallback cb)
+  { iterationCallback_ = std::move(cb); }
+
   // timers
 
   ///
@@ -137,11 +174,49 @@ class EventLoop : noncopyable
 
   typedef std::vector<Channel*> ChannelList;
 
+  struct PendingFunctor
+  {
+    PendingFunctor(Functor&& f, Timestamp d)
+      : functor(std::move(f)), deadline(d)
+    { }
+
+    Functor functor;
+    Timestamp deadline;
+  };
+  typedef std::vector<PendingFunctor> PendingFunctorList;
+
+  // Functors of one priority deferred by the budget, FIFO.
+  // The one with sequence number n is at functors[n - frontSeq],
+  // those with a deadline are also in a heap, earliest first,
+  // so expired ones run without scanning the backlog.
+  struct RunnableFunctor
+  {
+    Functor functor;
+    bool done;  // run ahead for its deadline
+  };
+  struct Deadline
+  {
+    Timestamp when;
+    uint64_t seq;
+    bool operator<(const Deadline& rhs) const { return rhs.when < when; }
+  };
+  struct RunnableFunctors
+  {
+    RunnableFunctors() : frontSeq(0), numDone(0) { }
+
+    std::deque<RunnableFunctor> functors;
+    std::priority_queue<Deadline> deadlines;
+    uint64_t frontSeq;
+    size_t numDone;
+  };
+  void runExpiredFunctors(RunnableFunctors* runnable, Timestamp now);
+
   bool looping_; /* atomic */
   std::atomic<bool> quit_;
   bool eventHandling_; /* atomic */
   bool callingPendingFunctors_; /* atomic */
   int64_t iteration_;
+  int numaNode_;
   const pid_t threadId_;
   Timestamp pollReturnTime_;
   std::unique_ptr<Poller> poller_;
@@ -151,13 +226,18 @@ class EventLoop : noncopyable
   // we don't expose Channel to client.
   std::unique_ptr<Channel> wakeupChannel_;
   boost::any context_;
+  int64_t functorBudget_;  // in microseconds
+  IterationCallback iterationCallback_;
+  // deferred by the budget, loop thread only
+  RunnableFunctors runnableFunctors_[kNumPriorities];
+  std::atomic<size_t> numDeferred_;  // for queueSize()
 
   // scratch variables
   ChannelList activeChannels_;
   Channel* currentActiveChannel_;
 
   mutable MutexLock mutex_;
-  std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+  PendingFunctorList pendingFunctors_[kNumPriorities] GUARDED_BY(mutex_);
 };
 
 }  // namespace net
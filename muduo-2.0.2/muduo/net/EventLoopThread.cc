@@ -8,8 +8,13 @@
 
 #include "muduo/net/EventLoopThread.h"
 
+#include "muduo/base/Logging.h"
+#include "muduo/base/ProcessInfo.h"
 #include "muduo/net/EventLoop.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -56,7 +61,29 @@ EventLoop* EventLoopThread::startLoop()
 
 void EventLoopThread::threadFunc()
 {
+  int node = -1;
+  if (!cpus_.empty())
+  {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int cpu : cpus_)
+    {
+      CPU_SET(cpu, &cpuset);
+    }
+    int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof cpuset, &cpuset);
+    if (ret != 0)
+    {
+      LOG_ERROR << "EventLoopThread::threadFunc pthread_setaffinity_np failed "
+                << strerror_tl(ret);
+    }
+    else
+    {
+      node = ProcessInfo::numaNodeOfCpu(cpus_.front());
+    }
+  }
+
   EventLoop loop;
+  loop.setNumaNode(node);
 
   if (callback_)
   {
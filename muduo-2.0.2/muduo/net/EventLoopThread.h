@@ -15,6 +15,8 @@
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Thread.h"
 
+#include <vector>
+
 namespace muduo
 {
 namespace net
@@ -30,6 +32,13 @@ class EventLoopThread : noncopyable
   EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
                   const string& name = string());
   ~EventLoopThread();
+
+  /// Pins the loop thread to these cpus, before startLoop().
+  /// The EventLoop is created after pinning, so memory it first touches
+  /// comes from the NUMA node of the cpus.
+  void setCpuAffinity(const std::vector<int>& cpus)
+  { cpus_ = cpus; }
+
   EventLoop* startLoop();
 
  private:
@@ -41,6 +50,7 @@ class EventLoopThread : noncopyable
   MutexLock mutex_;
   Condition cond_ GUARDED_BY(mutex_);
   ThreadInitCallback callback_;
+  std::vector<int> cpus_;
 };
 
 }  // namespace net
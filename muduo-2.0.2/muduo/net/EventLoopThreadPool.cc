@@ -8,10 +8,12 @@
 
 #include "muduo/net/EventLoopThreadPool.h"
 
+#include "muduo/base/ProcessInfo.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThread.h"
 
 #include <stdio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -37,13 +39,41 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
 
   started_ = true;
 
+  if (!cpuSets_.empty())
+  {
+    // looked up for every accepted connection by getLoopForCpu()
+    int numCpus = static_cast<int>(::sysconf(_SC_NPROCESSORS_CONF));
+    for (int cpu = 0; cpu < numCpus; ++cpu)
+    {
+      nodeOfCpu_.push_back(ProcessInfo::numaNodeOfCpu(cpu));
+    }
+  }
+
   for (int i = 0; i < numThreads_; ++i)
   {
     char buf[name_.size() + 32];
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
     EventLoopThread* t = new EventLoopThread(cb, buf);
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
-    loops_.push_back(t->startLoop());
+    if (!cpuSets_.empty())
+    {
+      t->setCpuAffinity(cpuSets_[i % cpuSets_.size()]);
+    }
+    EventLoop* loop = t->startLoop();
+    loops_.push_back(loop);
+
+    if (!cpuSets_.empty())
+    {
+      const std::vector<int>& cpus = cpuSets_[i % cpuSets_.size()];
+      for (int cpu : cpus)
+      {
+        loopsOfCpu_[cpu].loops.push_back(loop);
+      }
+      if (loop->numaNode() >= 0)
+      {
+        loopsOfNode_[loop->numaNode()].loops.push_back(loop);
+      }
+    }
   }
   if (numThreads_ == 0 && cb)
   {
@@ -82,6 +112,42 @@ EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode)
   return loop;
 }
 
+EventLoop* EventLoopThreadPool::getLoopForCpu(int cpu)
+{
+  baseLoop_->assertInLoopThread();
+  assert(started_);
+
+  LoopGroup* group = NULL;
+  if (cpu >= 0)
+  {
+    std::map<int, LoopGroup>::iterator it = loopsOfCpu_.find(cpu);
+    if (it != loopsOfCpu_.end())
+    {
+      group = &it->second;
+    }
+    else if (implicit_cast<size_t>(cpu) < nodeOfCpu_.size() && nodeOfCpu_[cpu] >= 0)
+    {
+      it = loopsOfNode_.find(nodeOfCpu_[cpu]);
+      if (it != loopsOfNode_.end())
+      {
+        group = &it->second;
+      }
+    }
+  }
+
+  if (group == NULL)
+  {
+    return getNextLoop();
+  }
+
+  EventLoop* loop = group->loops[group->next];
+  if (++group->next >= group->loops.size())
+  {
+    group->next = 0;
+  }
+  return loop;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
   baseLoop_->assertInLoopThread();
@@ -15,6 +15,7 @@
 #include "muduo/base/Types.h"
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -35,6 +36,10 @@ class EventLoopThreadPool : noncopyable
   EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
   ~EventLoopThreadPool();
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+
+  /// Pins loop thread i to cpuSets[i % cpuSets.size()], before start().
+  void setCpuAffinity(const std::vector<std::vector<int>>& cpuSets)
+  { cpuSets_ = cpuSets; }
   void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
   // valid after calling start()
@@ -44,6 +49,10 @@ class EventLoopThreadPool : noncopyable
   /// with the same hash code, it will always return the same EventLoop
   EventLoop* getLoopForHash(size_t hashCode);
 
+  /// round-robin among loops pinned to this cpu, or else on its NUMA node,
+  /// falls back to getNextLoop().
+  EventLoop* getLoopForCpu(int cpu);
+
   std::vector<EventLoop*> getAllLoops();
 
   bool started() const
@@ -61,6 +70,18 @@ class EventLoopThreadPool : noncopyable
   int next_;
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop*> loops_;
+
+  struct LoopGroup
+  {
+    LoopGroup() : next(0) { }
+
+    std::vector<EventLoop*> loops;
+    size_t next;
+  };
+  std::vector<std::vector<int>> cpuSets_;
+  std::map<int, LoopGroup> loopsOfCpu_;
+  std::map<int, LoopGroup> loopsOfNode_;
+  std::vector<int> nodeOfCpu_;
 };
 
 }  // namespace net
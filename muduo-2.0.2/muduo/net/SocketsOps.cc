@@ -257,6 +257,21 @@ int sockets::getSocketError(int sockfd)
   }
 }
 
+int sockets::getIncomingCpu(int sockfd)
+{
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t optlen = static_cast<socklen_t>(sizeof cpu);
+  if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &optlen) < 0)
+  {
+    return -1;
+  }
+  return cpu;
+#else
+  return -1;
+#endif
+}
+
 struct sockaddr_in6 sockets::getLocalAddr(int sockfd)
 {
   struct sockaddr_in6 localaddr;
@@ -46,6 +46,8 @@ void fromIpPort(const char* ip, uint16_t port,
                 struct sockaddr_in6* addr);
 
 int getSocketError(int sockfd);
+// cpu that handled the last packet of the socket (SO_INCOMING_CPU), -1 if unknown
+int getIncomingCpu(int sockfd);
 
 const struct sockaddr* sockaddr_cast(const struct sockaddr_in* addr);
 const struct sockaddr* sockaddr_cast(const struct sockaddr_in6* addr);
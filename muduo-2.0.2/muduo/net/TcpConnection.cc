@@ -325,6 +325,13 @@ void TcpConnection::connectEstablished()
   loop_->assertInLoopThread();
   assert(state_ == kConnecting);
   setState(kConnected);
+  if (loop_->numaNode() >= 0)
+  {
+    // the buffers were allocated by the acceptor thread,
+    // re-allocate them here so their pages come from the loop's node
+    inputBuffer_.shrink(0);
+    outputBuffer_.shrink(0);
+  }
   channel_->tie(shared_from_this());
   channel_->enableReading();
 
@@ -30,6 +30,7 @@ TcpServer::TcpServer(EventLoop* loop,
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
+    incomingCpuRouting_(false),
     nextConnId_(1)
 {
   acceptor_->setNewConnectionCallback(
@@ -56,6 +57,11 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setThreadCpuAffinity(const std::vector<std::vector<int>>& cpuSets)
+{
+  threadPool_->setCpuAffinity(cpuSets);
+}
+
 void TcpServer::start()
 {
   if (started_.getAndSet(1) == 0)
@@ -71,7 +77,9 @@ void TcpServer::start()
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
   loop_->assertInLoopThread();
-  EventLoop* ioLoop = threadPool_->getNextLoop();
+  EventLoop* ioLoop = incomingCpuRouting_
+      ? threadPool_->getLoopForCpu(sockets::getIncomingCpu(sockfd))
+      : threadPool_->getNextLoop();
   char buf[64];
   snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
   ++nextConnId_;
@@ -16,6 +16,7 @@
 #include "muduo/net/TcpConnection.h"
 
 #include <map>
+#include <vector>
 
 namespace muduo
 {
@@ -62,6 +63,18 @@ class TcpServer : noncopyable
   /// - N means a thread pool with N threads, new connections
   ///   are assigned on a round-robin basis.
   void setThreadNum(int numThreads);
+
+  /// Pins I/O thread i to the cpus in cpuSets[i % cpuSets.size()].
+  /// Must be called before @c start
+  void setThreadCpuAffinity(const std::vector<std::vector<int>>& cpuSets);
+
+  /// Assigns a new connection to a loop pinned to the cpu whose RX queue
+  /// received it (SO_INCOMING_CPU), or else to one on the same NUMA node,
+  /// instead of round-robin.  Needs setThreadCpuAffinity().
+  /// Must be called before @c start
+  void setIncomingCpuRouting(bool on)
+  { incomingCpuRouting_ = on; }
+
   void setThreadInitCallback(const ThreadInitCallback& cb)
   { threadInitCallback_ = cb; }
   /// valid after calling start()
@@ -109,6 +122,7 @@ class TcpServer : noncopyable
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback threadInitCallback_;
   AtomicInt32 started_;
+  bool incomingCpuRouting_;
   // always in loop thread
   int nextConnId_;
   ConnectionMap connections_;
@@ -8,6 +8,7 @@
 //
 
 #include "muduo/net/http/HttpResponse.h"
+#include "muduo/base/ClockCache.h"
 #include "muduo/net/Buffer.h"
 
 #include <stdio.h>
@@ -34,6 +35,14 @@ void HttpResponse::appendToBuffer(Buffer* output) const
     output->append("Connection: Keep-Alive\r\n");
   }
 
+  if (headers_.find("Date") == headers_.end())
+  {
+    Timestamp date = date_.valid() ? date_ : Timestamp::coarseNow();
+    output->append("Date: ");
+    output->append(ClockCache::httpDate(date.secondsSinceEpoch()), ClockCache::kHttpDateLength);
+    output->append("\r\n");
+  }
+
   for (const auto& header : headers_)
   {
     output->append(header.first);
@@ -12,6 +12,7 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include "muduo/base/copyable.h"
+#include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
 
 #include <map>
@@ -62,6 +63,10 @@ class HttpResponse : public muduo::copyable
   void setBody(const string& body)
   { body_ = body; }
 
+  // time for the Date header, Timestamp::coarseNow() if not set
+  void setDate(Timestamp date)
+  { date_ = date; }
+
   void appendToBuffer(Buffer* output) const;
 
  private:
@@ -71,6 +76,7 @@ class HttpResponse : public muduo::copyable
   string statusMessage_;
   bool closeConnection_;
   string body_;
+  Timestamp date_;
 };
 
 }  // namespace net
@@ -88,6 +88,8 @@ void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
   bool close = connection == "close" ||
     (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
   HttpResponse response(close);
+  // the loop's poll time, so replies of one iteration share the cached Date text
+  response.setDate(req.receiveTime());
   httpCallback_(req, &response);
   Buffer buf;
   response.appendToBuffer(&buf);
@@ -7,6 +7,7 @@
 //
 // This is a public header file, it must only include public header files.
 #pragma once
+#include "muduo/base/Logging.h"
 #include "muduo/net/Buffer.h"
 #include <google/protobuf/io/zero_copy_stream.h>
 namespace muduo
@@ -14,10 +15,59 @@ namespace muduo
 namespace net
 {
 
-// FIXME:
-// class BufferInputStream : google::protobuf::io::ZeroCopyInputStream
-// {
-// };
+// Reads the first size readable bytes of a Buffer in place, without retrieving them.
+// The Buffer must not be written to while the stream is in use.
+class BufferInputStream : public google::protobuf::io::ZeroCopyInputStream
+{
+ public:
+  BufferInputStream(const Buffer* buf, int size)
+    : data_(CHECK_NOTNULL(buf)->peek()),
+      size_(size),
+      position_(0)
+  {
+    assert(size >= 0 && implicit_cast<size_t>(size) <= buf->readableBytes());
+  }
+
+  virtual bool Next(const void** data, int* size) // override
+  {
+    if (position_ < size_)
+    {
+      *data = data_ + position_;
+      *size = size_ - position_;
+      position_ = size_;
+      return true;
+    }
+    return false;
+  }
+
+  virtual void BackUp(int count) // override
+  {
+    assert(count >= 0 && count <= position_);
+    position_ -= count;
+  }
+
+  virtual bool Skip(int count) // override
+  {
+    assert(count >= 0);
+    if (count > size_ - position_)
+    {
+      position_ = size_;
+      return false;
+    }
+    position_ += count;
+    return true;
+  }
+
+  virtual int64_t ByteCount() const // override
+  {
+    return position_;
+  }
+
+ private:
+  const char* data_;
+  int size_;
+  int position_;
+};
 
 class BufferOutputStream : public google::protobuf::io::ZeroCopyOutputStream
 {
@@ -10,13 +10,17 @@
 // #include <muduo/net/protobuf/BufferStream.h>
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/ThreadLocalSingleton.h"
 #include "muduo/net/Endian.h"
 #include "muduo/net/TcpConnection.h"
 #include "muduo/net/protorpc/google-inl.h"
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 #include <zlib.h>
 
+#include <memory>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -28,6 +32,35 @@ namespace
     return 0;
   }
   int __attribute__ ((unused)) dummy = ProtobufVersionCheck();
+
+  // One per thread, thus one per EventLoop.
+  // The initial block is owned by us and survives Arena::Reset(),
+  // so small messages are decoded without touching malloc at all.
+  class DecodeArena : noncopyable
+  {
+   public:
+    DecodeArena()
+      : block_(new char[kInitialBlockSize]),
+        arena_(options(block_.get()))
+    {
+    }
+
+    google::protobuf::Arena* arena() { return &arena_; }
+
+   private:
+    static const size_t kInitialBlockSize = 64*1024;
+
+    static google::protobuf::ArenaOptions options(char* block)
+    {
+      google::protobuf::ArenaOptions opts;
+      opts.initial_block = block;
+      opts.initial_block_size = kInitialBlockSize;
+      return opts;
+    }
+
+    std::unique_ptr<char[]> block_;
+    google::protobuf::Arena arena_;
+  };
 }
 
 void ProtobufCodecLite::send(const TcpConnectionPtr& conn,
@@ -74,7 +107,18 @@ void ProtobufCodecLite::onMessage(const TcpConnectionPtr& conn,
         buf->retrieve(kHeaderLen+len);
         continue;
       }
-      MessagePtr message(prototype_->New());
+      google::protobuf::Arena* arena = NULL;
+      MessagePtr message;
+      if (arenaDecode_)
+      {
+        arena = threadArena();
+        // aliasing an empty shared_ptr: no control block, no ownership, the arena owns it
+        message = MessagePtr(MessagePtr(), prototype_->New(arena));
+      }
+      else
+      {
+        message.reset(prototype_->New());
+      }
       // FIXME: can we move deserialization & callback to other thread?
       ErrorCode errorCode = parse(buf->peek()+kHeaderLen, len, message.get());
       if (errorCode == kNoError)
@@ -86,6 +130,14 @@ void ProtobufCodecLite::onMessage(const TcpConnectionPtr& conn,
       else
       {
         errorCallback_(conn, buf, receiveTime, errorCode);
+      }
+      if (arena)
+      {
+        message.reset();
+        arena->Reset();
+      }
+      if (errorCode != kNoError)
+      {
         break;
       }
     }
@@ -141,6 +193,11 @@ int ProtobufCodecLite::serializeToBuffer(const google::protobuf::Message& messag
   return byte_size;
 }
 
+google::protobuf::Arena* ProtobufCodecLite::threadArena()
+{
+  return ThreadLocalSingleton<DecodeArena>::instance().arena();
+}
+
 namespace
 {
   const string kNoErrorStr = "NoError";
@@ -26,6 +26,7 @@ namespace google
 {
 namespace protobuf
 {
+class Arena;
 class Message;
 }
 }
@@ -88,6 +89,7 @@ class ProtobufCodecLite : noncopyable
       messageCallback_(messageCb),
       rawCb_(rawCb),
       errorCallback_(errorCb),
+      arenaDecode_(false),
       kMinMessageLen(tagArg.size() + kChecksumLen)
   {
   }
@@ -96,6 +98,14 @@ class ProtobufCodecLite : noncopyable
 
   const string& tag() const { return tag_; }
 
+  /// Decodes into an arena of the calling thread (i.e. of the EventLoop)
+  /// instead of heap allocating every message and its fields.
+  /// The arena is reset after each message callback returns,
+  /// so the callback must not keep the MessagePtr, copy the message instead.
+  /// Not thread safe, call before the first message arrives.
+  void setArenaDecode(bool on) { arenaDecode_ = on; }
+  bool arenaDecode() const { return arenaDecode_; }
+
   void send(const TcpConnectionPtr& conn,
             const ::google::protobuf::Message& message);
 
@@ -112,6 +122,10 @@ class ProtobufCodecLite : noncopyable
   ErrorCode parse(const char* buf, int len, ::google::protobuf::Message* message);
   void fillEmptyBuffer(muduo::net::Buffer* buf, const google::protobuf::Message& message);
 
+  // arena of the calling thread used by setArenaDecode(true),
+  // its first 64KiB survive Arena::Reset().
+  static google::protobuf::Arena* threadArena();
+
   static int32_t checksum(const void* buf, int len);
   static bool validateChecksum(const char* buf, int len);
   static int32_t asInt32(const char* buf);
@@ -126,6 +140,7 @@ class ProtobufCodecLite : noncopyable
   ProtobufMessageCallback messageCallback_;
   RawMessageCallback rawCb_;
   ErrorCallback errorCallback_;
+  bool arenaDecode_;
   const int kMinMessageLen;
 };
 
@@ -155,6 +170,8 @@ class ProtobufCodecLiteT
 
   const string& tag() const { return codec_.tag(); }
 
+  void setArenaDecode(bool on) { codec_.setArenaDecode(on); }
+
   void send(const TcpConnectionPtr& conn,
             const MSG& message)
   {
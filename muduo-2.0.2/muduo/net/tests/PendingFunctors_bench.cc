@@ -0,0 +1,124 @@
+// Latency of cross thread functors under a flood of maintenance work.
+//
+// A flooder thread queues low priority functors that each burn ~20us,
+// a pinger thread queues a latency critical functor every millisecond.
+// Compares plain FIFO against priority classes with a functor budget,
+// reporting queue-to-run latency of pings and loop iteration time.
+
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kSeconds = 3;
+const int kFloodBurst = 200;
+
+void burn(int microseconds)
+{
+  Timestamp start(Timestamp::now());
+  while (timeDifference(Timestamp::now(), start) * 1e6 < microseconds)
+  {
+  }
+}
+
+double percentile(std::vector<int64_t>* samples, double p)
+{
+  if (samples->empty())
+    return 0;
+  size_t n = static_cast<size_t>(static_cast<double>(samples->size() - 1) * p);
+  std::nth_element(samples->begin(), samples->begin() + n, samples->end());
+  return static_cast<double>((*samples)[n]);
+}
+
+void run(const char* name, bool prioritized)
+{
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  // written in loop thread, read after the loop thread is joined
+  std::vector<int64_t> iterations;
+  std::vector<int64_t> latencies;
+  CountDownLatch ready(1);
+  loop->runInLoop([&] {
+    if (prioritized)
+    {
+      loop->setFunctorBudget(0.001);
+    }
+    loop->setIterationCallback([&](Timestamp pollReturnTime) {
+      iterations.push_back(Timestamp::now().microSecondsSinceEpoch()
+                           - pollReturnTime.microSecondsSinceEpoch());
+    });
+    ready.countDown();
+  });
+  ready.wait();
+
+  std::atomic<bool> running(true);
+  EventLoop::Priority floodPriority = prioritized ? EventLoop::kLowPriority : EventLoop::kNormalPriority;
+  EventLoop::Priority pingPriority = prioritized ? EventLoop::kHighPriority : EventLoop::kNormalPriority;
+
+  Thread flooder([&] {
+    while (running)
+    {
+      // keep roughly one burst in flight
+      if (loop->queueSize() < kFloodBurst)
+      {
+        for (int i = 0; i < kFloodBurst; ++i)
+        {
+          loop->queueInLoop([] { burn(20); }, floodPriority);
+        }
+      }
+      usleep(1000);
+    }
+  }, "flooder");
+
+  Thread pinger([&] {
+    while (running)
+    {
+      Timestamp sent(Timestamp::now());
+      loop->queueInLoop([&latencies, sent] {
+        latencies.push_back(Timestamp::now().microSecondsSinceEpoch()
+                            - sent.microSecondsSinceEpoch());
+      }, pingPriority);
+      usleep(1000);
+    }
+  }, "pinger");
+
+  flooder.start();
+  pinger.start();
+  sleep(kSeconds);
+  running = false;
+  flooder.join();
+  pinger.join();
+
+  CountDownLatch done(1);
+  std::vector<int64_t> its, lats;
+  loop->runInLoop([&] {
+    loop->setIterationCallback(EventLoop::IterationCallback());
+    its.swap(iterations);
+    lats.swap(latencies);
+    done.countDown();
+  }, EventLoop::kHighPriority);
+  done.wait();
+
+  printf("%-12s pings %5zd  latency us p50 %8.0f p99 %8.0f  "
+         "iterations %6zd  iteration us p50 %6.0f p99 %6.0f\n",
+         name, lats.size(), percentile(&lats, 0.5), percentile(&lats, 0.99),
+         its.size(), percentile(&its, 0.5), percentile(&its, 0.99));
+}
+
+int main()
+{
+  run("fifo", false);
+  run("prioritized", true);
+}
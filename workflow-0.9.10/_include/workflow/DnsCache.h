@@ -0,0 +1,220 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Wu Jiaxu (wujiaxu@sogou-inc.com)
+*/
+
+#ifndef _DNSCACHE_H_
+#define _DNSCACHE_H_
+
+#include <netdb.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include "DnsUtil.h"
+
+#define GET_TYPE_TTL		0
+#define GET_TYPE_CONFIDENT	1
+
+#define DNS_CACHE_SHARDS	16
+/* Buckets of a shard at first. A shard doubles them when it holds more
+ * than two entries per bucket, and never shrinks. */
+#define DNS_CACHE_BUCKETS	64
+
+struct DnsCacheValue
+{
+	struct addrinfo *addrinfo;
+	int64_t confident_time;
+	int64_t expire_time;
+};
+
+// RAII: NO. Release handle by user
+// Thread safety: YES
+// MUST call release when handle no longer used
+// Lookups take no lock. Only put and del lock one of the shards.
+class DnsCache
+{
+public:
+	using HostPort = std::pair<std::string, unsigned short>;
+
+	// DONOT change value by handle, use DnsCache::put instead
+	class DnsHandle
+	{
+	public:
+		DnsCacheValue value;
+
+	private:
+		DnsHandle(const HostPort& k, size_t h, const DnsCacheValue& v) :
+			value(v), key(k), hash(h), ref(2)
+		{
+		}
+
+		HostPort key;
+		size_t hash;
+		// Chains of a table use one of the two, and those of the table
+		// replacing it on a resize the other one.
+		std::atomic<DnsHandle *> next[2];
+		std::atomic<int> ref;
+
+		friend class DnsCache;
+	};
+
+public:
+	// get handler
+	// Need call release when handle no longer needed
+	//Handle *get(const KEY &key);
+	const DnsHandle *get(const HostPort& host_port);
+
+	const DnsHandle *get(const std::string& host, unsigned short port)
+	{
+		return get(HostPort(host, port));
+	}
+
+	const DnsHandle *get(const char *host, unsigned short port)
+	{
+		return get(std::string(host), port);
+	}
+
+	const DnsHandle *get_ttl(const HostPort& host_port)
+	{
+		return get_inner(host_port, GET_TYPE_TTL);
+	}
+
+	const DnsHandle *get_ttl(const std::string& host, unsigned short port)
+	{
+		return get_ttl(HostPort(host, port));
+	}
+
+	const DnsHandle *get_ttl(const char *host, unsigned short port)
+	{
+		return get_ttl(std::string(host), port);
+	}
+
+	const DnsHandle *get_confident(const HostPort& host_port)
+	{
+		return get_inner(host_port, GET_TYPE_CONFIDENT);
+	}
+
+	const DnsHandle *get_confident(const std::string& host, unsigned short port)
+	{
+		return get_confident(HostPort(host, port));
+	}
+
+	const DnsHandle *get_confident(const char *host, unsigned short port)
+	{
+		return get_confident(std::string(host), port);
+	}
+
+	const DnsHandle *put(const HostPort& host_port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min);
+
+	const DnsHandle *put(const std::string& host,
+						 unsigned short port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min)
+	{
+		return put(HostPort(host, port), addrinfo, dns_ttl_default, dns_ttl_min);
+	}
+
+	const DnsHandle *put(const char *host,
+						 unsigned short port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min)
+	{
+		return put(std::string(host), port, addrinfo, dns_ttl_default, dns_ttl_min);
+	}
+
+	// release handle by get/put
+	void release(const DnsHandle *handle);
+
+	// delete from cache, deleter delay called when all inuse-handle release.
+	void del(const HostPort& key);
+
+	void del(const std::string& host, unsigned short port)
+	{
+		del(HostPort(host, port));
+	}
+
+	void del(const char *host, unsigned short port)
+	{
+		del(std::string(host), port);
+	}
+
+private:
+	const DnsHandle *get_inner(const HostPort& host_port, int type);
+
+	struct Table
+	{
+		size_t size;				// power of 2
+		int link;					// index of DnsHandle::next
+		std::atomic<DnsHandle *> *buckets;
+	};
+
+	// Readers count themselves in one of two counters, and a writer waits
+	// for both to drain before freeing what it has unlinked, or a table
+	// it has replaced.
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::atomic<int> phase;
+		std::atomic<int> readers[2];
+		std::atomic<Table *> table;
+		size_t count;
+	};
+
+	Shard *get_shard(size_t hash) { return &shards_[hash % DNS_CACHE_SHARDS]; }
+	static std::atomic<DnsHandle *> *get_bucket(Table *table, size_t hash)
+	{
+		return &table->buckets[hash / DNS_CACHE_SHARDS & (table->size - 1)];
+	}
+
+	static Table *new_table(size_t size, int link);
+	static void delete_table(Table *table);
+	DnsHandle *lookup(Table *table, const HostPort& key, size_t hash);
+	void grow(Shard *shard);
+	void synchronize(Shard *shard);
+	void unref(DnsHandle *handle);
+
+	class ValueDeleter
+	{
+	public:
+		void operator() (const DnsCacheValue& value) const
+		{
+			struct addrinfo *ai = value.addrinfo;
+
+			if (ai && (ai->ai_flags & AI_PASSIVE))
+				freeaddrinfo(ai);
+			else
+				DnsUtil::freeaddrinfo(ai);
+		}
+	};
+
+	Shard shards_[DNS_CACHE_SHARDS];
+	ValueDeleter value_deleter_;
+
+public:
+	DnsCache();
+	~DnsCache();
+};
+
+#endif
+
@@ -0,0 +1,580 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _HASHLRUCACHE_H_
+#define _HASHLRUCACHE_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <mutex>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include "list.h"
+
+/**
+ * @file   HashLRUCache.h
+ * @brief  Template LRU/CLOCK Cache with hash index and slab allocated handles
+ */
+
+#define CACHE_POLICY_LRU	0
+#define CACHE_POLICY_CLOCK	1
+
+// RAII: NO. Release ref by HashLRUCache::release
+// Thread safety: NO.
+// DONOT change value by handler, use Cache::put instead
+template<typename KEY, typename VALUE>
+class HashLRUHandle
+{
+public:
+	VALUE value;
+
+private:
+	HashLRUHandle(const KEY& k, const VALUE& v, size_t h, size_t c) :
+		value(v), key(k), hash(h), charge(c)
+	{
+	}
+
+	HashLRUHandle(const KEY& k, VALUE&& v, size_t h, size_t c) :
+		value(std::move(v)), key(k), hash(h), charge(c)
+	{
+	}
+
+	KEY key;
+	size_t hash;
+	size_t charge;
+	HashLRUHandle *next;
+	struct list_head list;
+	bool in_cache;
+	bool visited;
+	int ref;
+
+	template<typename, typename, class, class> friend class HashLRUCache;
+	template<typename, typename, class, class> friend class ShardedLRUCache;
+};
+
+// RAII: NO. Release ref by HashLRUCache::release
+// Define ValueDeleter(VALUE& v) for value deleter
+// Thread safety: NO
+// Same interface as LRUCache, but KEY needs HASH and operator== instead of
+// operator<. Handles are allocated from slabs that are kept until the cache
+// is destroyed, so no heap allocation is made once the cache is warm.
+//
+// With CACHE_POLICY_LRU, get moves the entry to the tail of the list. With
+// CACHE_POLICY_CLOCK, get only marks the entry, and eviction gives a marked
+// entry a second chance. Entries with unreleased handles are never evicted.
+template<typename KEY, typename VALUE, class ValueDeleter,
+		 class HASH = std::hash<KEY>>
+class HashLRUCache
+{
+public:
+	typedef HashLRUHandle<KEY, VALUE>		Handle;
+
+public:
+	HashLRUCache(int policy = CACHE_POLICY_LRU)
+	{
+		INIT_LIST_HEAD(&this->lru);
+		this->policy = policy;
+		this->buckets = new Handle *[16]();
+		this->buckets_shift = 64 - 4;
+		this->free_list = NULL;
+		this->slabs = NULL;
+		this->max_size = 0;
+		this->max_memory = 0;
+		this->size = 0;
+		this->memory = 0;
+	}
+
+	~HashLRUCache()
+	{
+		struct list_head *pos, *tmp;
+		Handle *e;
+
+		list_for_each_safe(pos, tmp, &this->lru)
+		{
+			e = list_entry(pos, Handle, list);
+			assert(e->in_cache);
+			// Error if caller has an unreleased handle
+			assert(e->ref == 1);
+			e->in_cache = false;
+			this->unref(e);
+		}
+
+		while (this->slabs)
+		{
+			Slab *slab = this->slabs;
+
+			this->slabs = slab->next;
+			delete slab;
+		}
+
+		delete []this->buckets;
+	}
+
+	// default max_size=0 means no-limit cache
+	// max_size means max cache number of key-value pairs
+	void set_max_size(size_t max_size)
+	{
+		this->max_size = max_size;
+		this->evict();
+	}
+
+	// default max_memory=0 means no-limit cache
+	// max_memory is the sum of the charges given to put, plus the size of
+	// the handles.
+	void set_max_memory(size_t max_memory)
+	{
+		this->max_memory = max_memory;
+		this->evict();
+	}
+
+	// CACHE_POLICY_LRU or CACHE_POLICY_CLOCK
+	void set_policy(int policy)
+	{
+		this->policy = policy;
+	}
+
+	size_t get_size() const { return this->size; }
+	size_t get_memory() const { return this->memory; }
+
+	// Remove all cache that are not actively in use.
+	void prune()
+	{
+		struct list_head *pos, *tmp;
+		Handle *e;
+
+		list_for_each_safe(pos, tmp, &this->lru)
+		{
+			e = list_entry(pos, Handle, list);
+			if (e->ref == 1)
+			{
+				this->unlink(e);
+				this->erase_node(e);
+			}
+		}
+	}
+
+	// release handle by get/put
+	void release(const Handle *handle)
+	{
+		this->unref(const_cast<Handle *>(handle));
+	}
+
+	// get handler
+	// Need call release when handle no longer needed
+	const Handle *get(const KEY& key)
+	{
+		return this->get(key, this->hasher(key));
+	}
+
+	// put copy
+	// Need call release when handle no longer needed
+	const Handle *put(const KEY& key, const VALUE& value, size_t charge = 0)
+	{
+		return this->put(key, value, charge, this->hasher(key));
+	}
+
+	// put by moving the value
+	const Handle *put(const KEY& key, VALUE&& value, size_t charge = 0)
+	{
+		return this->put(key, std::move(value), charge, this->hasher(key));
+	}
+
+	// delete from cache, deleter delay called when all inuse-handle release.
+	void del(const KEY& key)
+	{
+		this->del(key, this->hasher(key));
+	}
+
+public:
+	// The same, with the hash of the key computed by caller.
+	const Handle *get(const KEY& key, size_t hash)
+	{
+		Handle *e = *this->find_pointer(key, hash);
+
+		if (e)
+		{
+			if (this->policy == CACHE_POLICY_LRU)
+				list_move_tail(&e->list, &this->lru);
+			else
+				e->visited = true;
+
+			e->ref++;
+		}
+
+		return e;
+	}
+
+	const Handle *put(const KEY& key, const VALUE& value, size_t charge,
+					  size_t hash)
+	{
+		return this->insert(this->alloc_handle(key, value, hash, charge));
+	}
+
+	const Handle *put(const KEY& key, VALUE&& value, size_t charge,
+					  size_t hash)
+	{
+		return this->insert(this->alloc_handle(key, std::move(value),
+											   hash, charge));
+	}
+
+	void del(const KEY& key, size_t hash)
+	{
+		Handle **p = this->find_pointer(key, hash);
+		Handle *e = *p;
+
+		if (e)
+		{
+			*p = e->next;
+			this->erase_node(e);
+		}
+	}
+
+private:
+	struct Slab
+	{
+		Slab *next;
+		typename std::aligned_storage<sizeof (Handle),
+									  alignof (Handle)>::type handles[64];
+	};
+
+	const Handle *insert(Handle *e)
+	{
+		Handle **p = this->find_pointer(e->key, e->hash);
+		Handle *old = *p;
+
+		e->in_cache = true;
+		e->visited = false;
+		e->ref = 2;
+		list_add_tail(&e->list, &this->lru);
+		this->size++;
+		this->memory += sizeof (Handle) + e->charge;
+		if (old)
+		{
+			e->next = old->next;
+			*p = e;
+			this->erase_node(old);
+		}
+		else
+		{
+			e->next = NULL;
+			*p = e;
+			if (this->size > this->buckets_mask() + 1)
+				this->expand();
+		}
+
+		this->evict();
+		return e;
+	}
+
+	Handle *alloc_handle(const KEY& key, const VALUE& value,
+						 size_t hash, size_t charge)
+	{
+		return new(this->alloc_slot()) Handle(key, value, hash, charge);
+	}
+
+	Handle *alloc_handle(const KEY& key, VALUE&& value,
+						 size_t hash, size_t charge)
+	{
+		return new(this->alloc_slot()) Handle(key, std::move(value),
+											  hash, charge);
+	}
+
+	void *alloc_slot()
+	{
+		void *p;
+
+		if (!this->free_list)
+		{
+			Slab *slab = new Slab;
+			int i;
+
+			slab->next = this->slabs;
+			this->slabs = slab;
+			for (i = 0; i < 64; i++)
+			{
+				p = &slab->handles[i];
+				*(void **)p = this->free_list;
+				this->free_list = p;
+			}
+		}
+
+		p = this->free_list;
+		this->free_list = *(void **)p;
+		return p;
+	}
+
+	void free_handle(Handle *e)
+	{
+		void *p = e;
+
+		this->value_deleter(e->value);
+		e->~Handle();
+		*(void **)p = this->free_list;
+		this->free_list = p;
+	}
+
+	size_t buckets_mask() const
+	{
+		return ((size_t)1 << (64 - this->buckets_shift)) - 1;
+	}
+
+	// Fibonacci hashing, so that the low bits of hash may be used by
+	// ShardedLRUCache to choose the shard.
+	Handle **bucket_of(size_t hash) const
+	{
+		uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ULL;
+
+		return &this->buckets[h >> this->buckets_shift];
+	}
+
+	Handle **find_pointer(const KEY& key, size_t hash)
+	{
+		Handle **p = this->bucket_of(hash);
+
+		while (*p && ((*p)->hash != hash || !((*p)->key == key)))
+			p = &(*p)->next;
+
+		return p;
+	}
+
+	void expand()
+	{
+		size_t n = this->buckets_mask() + 1;
+		Handle **old = this->buckets;
+		Handle *e, *next;
+		Handle **p;
+		size_t i;
+
+		this->buckets = new Handle *[2 * n]();
+		this->buckets_shift--;
+		for (i = 0; i < n; i++)
+		{
+			for (e = old[i]; e; e = next)
+			{
+				next = e->next;
+				p = this->bucket_of(e->hash);
+				e->next = *p;
+				*p = e;
+			}
+		}
+
+		delete []old;
+	}
+
+	bool over_limit() const
+	{
+		return (this->max_size > 0 && this->size > this->max_size) ||
+			   (this->max_memory > 0 && this->memory > this->max_memory);
+	}
+
+	void evict()
+	{
+		size_t steps = 2 * this->size;
+		Handle *e;
+
+		while (this->over_limit() && steps-- > 0)
+		{
+			e = list_entry(this->lru.next, Handle, list);
+			if (e->ref > 1 || e->visited)
+			{
+				e->visited = false;
+				list_move_tail(&e->list, &this->lru);
+			}
+			else
+			{
+				this->unlink(e);
+				this->erase_node(e);
+			}
+		}
+	}
+
+	void unlink(Handle *e)
+	{
+		Handle **p = this->bucket_of(e->hash);
+
+		while (*p != e)
+			p = &(*p)->next;
+
+		*p = e->next;
+	}
+
+	void unref(Handle *e)
+	{
+		assert(e->ref > 0);
+		if (--e->ref == 0)
+		{
+			assert(!e->in_cache);
+			this->free_handle(e);
+		}
+	}
+
+	// e is already out of the hash table
+	void erase_node(Handle *e)
+	{
+		assert(e->in_cache);
+		list_del(&e->list);
+		e->in_cache = false;
+		this->size--;
+		this->memory -= sizeof (Handle) + e->charge;
+		this->unref(e);
+	}
+
+	int policy;
+	size_t max_size;
+	size_t max_memory;
+	size_t size;
+	size_t memory;
+
+	struct list_head lru;
+	Handle **buckets;
+	int buckets_shift;
+	void *free_list;
+	Slab *slabs;
+
+	HASH hasher;
+	ValueDeleter value_deleter;
+};
+
+// RAII: NO. Release ref by ShardedLRUCache::release
+// Thread safety: YES
+// HashLRUCache split into shards by hash, each with its own lock.
+// The limits are divided evenly among the shards.
+template<typename KEY, typename VALUE, class ValueDeleter,
+		 class HASH = std::hash<KEY>>
+class ShardedLRUCache
+{
+public:
+	typedef HashLRUHandle<KEY, VALUE>		Handle;
+
+public:
+	ShardedLRUCache(size_t nshards = 16, int policy = CACHE_POLICY_LRU)
+	{
+		size_t i;
+
+		this->shards = new Shard[nshards];
+		this->nshards = nshards;
+		for (i = 0; i < nshards; i++)
+			this->shards[i].cache.set_policy(policy);
+	}
+
+	~ShardedLRUCache()
+	{
+		delete []this->shards;
+	}
+
+	void set_max_size(size_t max_size)
+	{
+		size_t per_shard = (max_size + this->nshards - 1) / this->nshards;
+		size_t i;
+
+		for (i = 0; i < this->nshards; i++)
+		{
+			std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+			this->shards[i].cache.set_max_size(per_shard);
+		}
+	}
+
+	void set_max_memory(size_t max_memory)
+	{
+		size_t per_shard = (max_memory + this->nshards - 1) / this->nshards;
+		size_t i;
+
+		for (i = 0; i < this->nshards; i++)
+		{
+			std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+			this->shards[i].cache.set_max_memory(per_shard);
+		}
+	}
+
+	void prune()
+	{
+		size_t i;
+
+		for (i = 0; i < this->nshards; i++)
+		{
+			std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+			this->shards[i].cache.prune();
+		}
+	}
+
+	void release(const Handle *handle)
+	{
+		Shard *shard = this->shard_of(handle->hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		shard->cache.release(handle);
+	}
+
+	const Handle *get(const KEY& key)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->shard_of(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		return shard->cache.get(key, hash);
+	}
+
+	const Handle *put(const KEY& key, const VALUE& value, size_t charge = 0)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->shard_of(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		return shard->cache.put(key, value, charge, hash);
+	}
+
+	const Handle *put(const KEY& key, VALUE&& value, size_t charge = 0)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->shard_of(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		return shard->cache.put(key, std::move(value), charge, hash);
+	}
+
+	void del(const KEY& key)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->shard_of(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		shard->cache.del(key, hash);
+	}
+
+private:
+	typedef HashLRUCache<KEY, VALUE, ValueDeleter, HASH> Cache;
+
+	struct Shard
+	{
+		std::mutex mutex;
+		Cache cache;
+	};
+
+	Shard *shard_of(size_t hash) const
+	{
+		return &this->shards[hash % this->nshards];
+	}
+
+	Shard *shards;
+	size_t nshards;
+	HASH hasher;
+};
+
+#endif
+
@@ -0,0 +1,99 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _HTTP2HPACK_H_
+#define _HTTP2HPACK_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+
+/**
+ * @file   Http2Hpack.h
+ * @brief  HPACK header compression for HTTP/2 (RFC 7541)
+ */
+
+namespace protocol
+{
+
+using Http2HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+class HpackTable
+{
+public:
+	/* Index in the static and dynamic table address space, 0 if none.
+	 * 'name_index' is set to an entry with the same name if any. */
+	size_t find(const std::string& name, const std::string& value,
+				size_t *name_index) const;
+	const std::pair<std::string, std::string> *get(size_t index) const;
+
+	void add(const std::string& name, const std::string& value);
+	void set_max_size(size_t max_size);
+	size_t get_max_size() const { return this->max_size; }
+
+private:
+	void evict(size_t limit);
+
+private:
+	std::deque<std::pair<std::string, std::string>> entries;
+	size_t size;
+	size_t max_size;
+
+public:
+	HpackTable() : size(0), max_size(4096) { }
+};
+
+class HpackEncoder
+{
+public:
+	/* Header names must be in lower case. Never emits Huffman strings. */
+	void encode(const std::string& name, const std::string& value,
+				std::string& out);
+
+	/* The peer's SETTINGS_HEADER_TABLE_SIZE. Takes effect in the next
+	 * header block, which starts with a table size update. */
+	void set_max_table_size(size_t size);
+
+	/* Call at the start of every header block. */
+	void begin_block(std::string& out);
+
+private:
+	HpackTable table;
+	size_t pending_size;
+	bool size_changed;
+
+public:
+	HpackEncoder() : pending_size(4096), size_changed(false) { }
+};
+
+class HpackDecoder
+{
+public:
+	/* Decodes one complete header block and appends to 'headers'.
+	 * Returns 0, or -1 with errno EBADMSG on a compression error, after
+	 * which the connection cannot be used. */
+	int decode(const void *buf, size_t size, Http2HeaderList& headers);
+
+private:
+	HpackTable table;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,259 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _HTTP2MESSAGE_H_
+#define _HTTP2MESSAGE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <utility>
+#include "HttpMessage.h"
+#include "Http2Hpack.h"
+
+/**
+ * @file   Http2Message.h
+ * @brief  HTTP/2 Protocol Interface
+ */
+
+/* An HTTP/2 message is an HttpMessage sent and received as frames of one
+ * stream. Received headers and body are parsed into the HttpMessage, so
+ * HttpHeaderCursor and the other http utilities work unchanged. Version of
+ * a received message is "HTTP/2", and requests carry ':authority' as Host.
+ *
+ * A message may carry the streams of other messages too. A client request
+ * sends the requests added to it as streams of its own, and its response
+ * receives all of their responses, in any order. A server request ends
+ * with the data received once all of its streams have ended. No message
+ * receives while the server processes a request, so a client request ends
+ * all of its streams together, after all of their frames, and the server
+ * gets every stream of the request before any of them ends. The server
+ * announces SETTINGS_MAX_CONCURRENT_STREAMS 100, and more streams of one
+ * request are refused. A new client connection starts with a SETTINGS
+ * exchange, see Http2Handshake.
+ *
+ * DATA is sent as far as the peer's flow control windows allow. The rest of
+ * a body is queued in the session, as are frames the socket does not take
+ * while receiving. Received DATA is given back to the peer by WINDOW_UPDATE
+ * frames of the stream and of the connection. Both sides give the largest
+ * windows and take frames of 1MB, so DATA is held back only for peers
+ * giving less. A client writes the DATA it holds back while receiving the
+ * response, as WINDOW_UPDATE frames arrive. A server writes it with its
+ * next reply: a server request with no stream ends once some of it may be
+ * written, and is replied without being processed. */
+
+namespace protocol
+{
+
+/* DATA of a stream waiting for the peer's flow control windows. */
+struct Http2Blocked
+{
+	uint32_t stream_id;
+	int64_t window;				/* stream send window */
+	std::string data;
+	size_t pos;					/* bytes of 'data' sent */
+};
+
+/* State of one HTTP/2 connection, shared by the messages that use it. */
+class Http2Session
+{
+public:
+	/* Client connection preface with our SETTINGS. */
+	static void client_preface(std::string& out);
+	/* Server connection preface, sent when the client preface arrives. */
+	static void server_preface(std::string& out);
+
+public:
+	bool is_server() const { return this->server; }
+
+public:
+	HpackEncoder encoder;
+	HpackDecoder decoder;
+
+	bool preface_done;			/* client: preface sent; server: received */
+	bool settings_received;		/* peer SETTINGS received */
+	bool settings_acked;		/* peer acked our SETTINGS */
+	bool goaway;
+	uint32_t last_stream_id;
+	uint32_t peer_max_frame_size;
+	uint32_t peer_max_streams;
+	uint32_t peer_initial_window;
+	int64_t peer_window;		/* connection send window */
+	int64_t recv_window;		/* connection receive window */
+
+	/* Header block being received, of stream 'continuation_id'. */
+	uint32_t continuation_id;
+	std::string header_block;
+
+	/* In the order the streams were sent. */
+	std::list<Http2Blocked> blocked;
+	bool flush_ping;			/* PING sent for more of them */
+
+	/* A partial frame, for the next append. */
+	std::string pending;
+
+	/* Frames the socket did not take, written first next time. */
+	std::string unsent;
+
+private:
+	bool server;
+
+public:
+	Http2Session(bool server);
+};
+
+struct Http2Stream
+{
+	uint32_t stream_id;
+	bool headers_done;
+	bool end_stream;
+	bool reset;					/* reset by the peer, or not sent */
+	bool refused;				/* not processed, may be sent again */
+	size_t size_limit;
+	size_t recv_unacked;		/* received, no WINDOW_UPDATE yet */
+	Http2HeaderList headers;
+	std::string body;
+};
+
+/* Client connection preface, and the server SETTINGS and ack in reply.
+ * Exchanged on a new connection before the first request, so that request
+ * is sent with the server's settings. One instance sends, another one
+ * receives. */
+class Http2Handshake : public ProtocolMessage
+{
+protected:
+	virtual int encode(struct iovec vectors[], int max);
+	virtual int append(const void *buf, size_t *size);
+
+private:
+	Http2Session *session;
+	std::string output;
+
+public:
+	Http2Handshake(Http2Session *session) : session(session) { }
+};
+
+class Http2Response;
+
+class Http2Request : public HttpRequest
+{
+public:
+	void set_session(Http2Session *session, bool https)
+	{
+		this->session = session;
+		this->https = https;
+	}
+
+	/* Server: 0 for a request with no stream. */
+	uint32_t get_stream_id() const { return this->stream.stream_id; }
+
+	/* Client: another request sent as a stream of this one, and the
+	 * response receiving its reply. Neither is owned. */
+	void add_stream(Http2Request *req, Http2Response *resp)
+	{
+		this->streams.emplace_back(req, resp);
+	}
+
+	void clear_streams() { this->streams.clear(); }
+
+	/* Server: the other streams received with this one. */
+	std::list<Http2Request> *get_streams() { return &this->received; }
+
+protected:
+	virtual int encode(struct iovec vectors[], int max);
+	virtual int append(const void *buf, size_t *size);
+	virtual void *get_buffer(size_t *size) { return NULL; }
+
+private:
+	int parse_stream();
+
+private:
+	Http2Session *session;
+	bool https;
+	Http2Stream stream;
+	std::string output;
+	std::string tail;
+	std::vector<std::pair<Http2Request *, Http2Response *>> streams;
+	std::list<Http2Request> received;
+
+	friend class Http2Response;
+
+public:
+	Http2Request() : session(NULL), https(false), stream() { }
+
+	/* for std::move() */
+public:
+	Http2Request(Http2Request&& req) = default;
+	Http2Request& operator = (Http2Request&& req) = default;
+};
+
+class Http2Response : public HttpResponse
+{
+public:
+	/* Server: the reply of a stream. */
+	void set_session(Http2Session *session, uint32_t stream_id)
+	{
+		this->session = session;
+		this->stream.stream_id = stream_id;
+	}
+
+	/* Client: receives the replies of 'req' and of the streams added to it,
+	 * after 'req' is sent. */
+	void set_session(Http2Session *session, const Http2Request *req);
+
+	uint32_t get_stream_id() const { return this->stream.stream_id; }
+
+	/* Server: the reply of another stream, sent with this one. Not owned. */
+	void add_stream(Http2Response *resp) { this->streams.push_back(resp); }
+
+	/* Server: resets the stream instead of replying. */
+	void set_reset() { this->stream.reset = true; }
+
+	/* Client: the stream was reset, and so has no reply. A refused one was
+	 * not processed by the server, and may be sent again. A response of a
+	 * single stream fails with ECONNRESET instead. */
+	bool is_reset() const { return this->stream.reset; }
+	bool is_refused() const { return this->stream.refused; }
+
+protected:
+	virtual int encode(struct iovec vectors[], int max);
+	virtual int append(const void *buf, size_t *size);
+	virtual void *get_buffer(size_t *size) { return NULL; }
+
+private:
+	int parse_stream();
+
+private:
+	Http2Session *session;
+	Http2Stream stream;
+	std::string output;
+	std::string tail;
+	std::vector<Http2Response *> streams;
+
+public:
+	Http2Response() : session(NULL), stream() { }
+
+	/* for std::move() */
+public:
+	Http2Response(Http2Response&& resp) = default;
+	Http2Response& operator = (Http2Response&& resp) = default;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,699 @@
+/*
+  Copyright (c) 2020 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Author: Xie Han (xiehan@sogou-inc.com)
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+#include "rbtree.h"
+#include "list.h"
+
+namespace algorithm
+{
+
+template<typename VAL>
+struct __ReduceValue
+{
+	struct list_head list;
+	VAL value;
+	__ReduceValue(VAL&& val) : value(std::move(val)) { }
+};
+
+template<typename KEY, typename VAL>
+struct __ReduceKey
+{
+	struct rb_node rb;
+	KEY key;
+	struct list_head value_list;
+	size_t value_cnt;
+
+	__ReduceKey(KEY&& k) : key(std::move(k))
+	{
+		INIT_LIST_HEAD(&this->value_list);
+		this->value_cnt = 0;
+	}
+
+	void insert(VAL&& value)
+	{
+		__ReduceValue<VAL> *entry = new __ReduceValue<VAL>(std::move(value));
+		list_add_tail(&entry->list, &this->value_list);
+		this->value_cnt++;
+	}
+
+	~__ReduceKey()
+	{
+		struct list_head *pos, *tmp;
+		list_for_each_safe(pos, tmp, &this->value_list)
+			delete list_entry(pos, struct __ReduceValue<VAL>, list);
+	}
+};
+
+template<typename VAL, bool = std::is_class<VAL>::value>
+class __ReduceIterator;
+
+#define __REDUCE_ITERATOR_HEAP_MAX		256
+
+/* VAL is a class. VAL must have size() method. */
+template<typename VAL>
+class __ReduceIterator<VAL, true> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next();
+	virtual size_t size() { return this->original_size; }
+
+private:
+	void reduce_begin() { this->original_size = this->heap_size; }
+
+	void reduce_end(VAL&& value)
+	{
+		size_t n = this->original_size;
+
+		assert(n != this->heap_size);
+		while (--n != this->heap_size)
+			delete this->heap[n];
+
+		this->heap[n]->value = std::move(value);
+		this->heap_insert(this->heap[n]);
+	}
+
+	size_t count() { return this->heap_size; }
+
+	__ReduceValue<VAL> *value() { return this->heap[0]; }
+
+private:
+	void heapify(int top);
+	void heap_insert(__ReduceValue<VAL> *data);
+
+private:
+	__ReduceValue<VAL> *heap[__REDUCE_ITERATOR_HEAP_MAX];
+	size_t heap_size;
+	size_t original_size;
+
+private:
+	__ReduceIterator(struct list_head *value_list, size_t *value_cnt);
+	template<class, class> friend class Reducer;
+};
+
+template<typename VAL>
+const VAL *__ReduceIterator<VAL, true>::next()
+{
+	__ReduceValue<VAL> *data = this->heap[0];
+
+	if (this->heap_size == 0)
+		return NULL;
+
+	this->heap[0] = this->heap[--this->heap_size];
+	this->heapify(0);
+	this->heap[this->heap_size] = data;
+	return &data->value;
+}
+
+template<typename VAL>
+void __ReduceIterator<VAL, true>::heapify(int top)
+{
+	__ReduceValue<VAL> *data = this->heap[top];
+	__ReduceValue<VAL> **child;
+	int last = this->heap_size - 1;
+	int i;
+
+	while (i = 2 * top + 1, i < last)
+	{
+		child = &this->heap[i];
+		if (child[0]->value.size() < data->value.size())
+		{
+			if (child[1]->value.size() < child[0]->value.size())
+			{
+				this->heap[top] = child[1];
+				top = i + 1;
+			}
+			else
+			{
+				this->heap[top] = child[0];
+				top = i;
+			}
+		}
+		else
+		{
+			if (child[1]->value.size() < data->value.size())
+			{
+				this->heap[top] = child[1];
+				top = i + 1;
+			}
+			else
+			{
+				this->heap[top] = data;
+				return;
+			}
+		}
+	}
+
+	if (i == last)
+	{
+		child = &this->heap[i];
+		if (child[0]->value.size() < data->value.size())
+		{
+			this->heap[top] = child[0];
+			top = i;
+		}
+	}
+
+	this->heap[top] = data;
+}
+
+template<typename VAL>
+void __ReduceIterator<VAL, true>::heap_insert(__ReduceValue<VAL> *data)
+{
+	__ReduceValue<VAL> *parent;
+	int i = this->heap_size;
+
+	while (i > 0)
+	{
+		parent = this->heap[(i - 1) / 2];
+		if (data->value.size() < parent->value.size())
+		{
+			this->heap[i] = parent;
+			i = (i - 1) / 2;
+		}
+		else
+			break;
+	}
+
+	this->heap[i] = data;
+	this->heap_size++;
+}
+
+template<typename VAL>
+__ReduceIterator<VAL, true>::__ReduceIterator(struct list_head *value_list,
+											  size_t *value_cnt)
+{
+	struct list_head *pos, *tmp;
+	int n = 0;
+
+	list_for_each_safe(pos, tmp, value_list)
+	{
+		if (n == __REDUCE_ITERATOR_HEAP_MAX)
+			break;
+
+		list_del(pos);
+		this->heap[n++] = list_entry(pos, __ReduceValue<VAL>, list);
+	}
+
+	this->heap_size = n;
+	*value_cnt -= n;
+	n /= 2;
+	while (n > 0)
+		this->heapify(--n);
+}
+
+#undef __REDUCE_ITERATOR_HEAP_MAX
+
+/* VAL is not a class. */
+template<typename VAL>
+class __ReduceIterator<VAL, false> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next()
+	{
+		if (this->cursor->next == &this->value_list)
+			return NULL;
+
+		this->cursor = this->cursor->next;
+		this->value_cnt--;
+		return &list_entry(this->cursor, __ReduceValue<VAL>, list)->value;
+	}
+
+	virtual size_t size() { return this->original_size; }
+
+private:
+	void reduce_begin()
+	{
+		this->cursor = &this->value_list;
+		this->original_size = this->value_cnt;
+	}
+
+	void reduce_end(VAL&& value);
+
+	size_t count() { return this->value_cnt; }
+
+	__ReduceValue<VAL> *value()
+	{
+		return list_entry(this->value_list.next, __ReduceValue<VAL>, list);
+	}
+
+private:
+	struct list_head value_list;
+	size_t value_cnt;
+	size_t original_size;
+	struct list_head *cursor;
+
+private:
+	__ReduceIterator(struct list_head *value_list, size_t *value_cnt)
+	{
+		INIT_LIST_HEAD(&this->value_list);
+		list_splice_init(value_list, &this->value_list);
+		this->value_cnt = *value_cnt;
+		*value_cnt = 0;
+	}
+
+	template<class, class> friend class Reducer;
+};
+
+template<class VAL>
+void __ReduceIterator<VAL, false>::reduce_end(VAL&& value)
+{
+	__ReduceValue<VAL> *entry;
+
+	assert(this->cursor != &this->value_list);
+	while (this->value_list.next != this->cursor)
+	{
+		entry = list_entry(this->value_list.next, __ReduceValue<VAL>, list);
+		list_del(&entry->list);
+		delete entry;
+	}
+
+	entry = list_entry(this->cursor, __ReduceValue<VAL>, list);
+	entry->value = std::move(value);
+	list_move_tail(&entry->list, &this->value_list);
+	this->value_cnt++;
+}
+
+template<typename KEY, typename VAL>
+void Reducer<KEY, VAL>::insert(KEY&& key, VAL&& value)
+{
+	struct rb_node **p = &this->key_tree.rb_node;
+	struct rb_node *parent = NULL;
+	__ReduceKey<KEY, VAL> *entry;
+
+	while (*p)
+	{
+		parent = *p;
+		using TYPE = __ReduceKey<KEY, VAL>;
+		entry = rb_entry(*p, TYPE, rb);
+		if (key < entry->key)
+			p = &(*p)->rb_left;
+		else if (key > entry->key)
+			p = &(*p)->rb_right;
+		else
+			break;
+	}
+
+	if (!*p)
+	{
+		entry = new __ReduceKey<KEY, VAL>(std::move(key));
+		rb_link_node(&entry->rb, parent, p);
+		rb_insert_color(&entry->rb, &this->key_tree);
+	}
+
+	entry->insert(std::move(value));
+}
+
+template<typename KEY, typename VAL>
+void Reducer<KEY, VAL>::start(reduce_function_t<KEY, VAL> reduce,
+							  std::vector<std::pair<KEY, VAL>> *result)
+{
+	struct rb_node *p = rb_first(&this->key_tree);
+	__ReduceKey<KEY, VAL> *key;
+	__ReduceValue<VAL> *value;
+
+	while (p)
+	{
+		using TYPE = __ReduceKey<KEY, VAL>;
+		key = rb_entry(p, TYPE, rb);
+		while (key->value_cnt > 1)
+		{
+			__ReduceIterator<VAL> iter(&key->value_list, &key->value_cnt);
+
+			do
+			{
+				VAL tmp;
+				iter.reduce_begin();
+				reduce(&key->key, &iter, &tmp);
+				iter.reduce_end(std::move(tmp));
+			} while (iter.count() > 1);
+
+			list_add_tail(&iter.value()->list, &key->value_list);
+			key->value_cnt++;
+		}
+
+		value = list_entry(key->value_list.next, __ReduceValue<VAL>, list);
+		list_del(&value->list);
+		result->emplace_back(std::move(key->key), std::move(value->value));
+		delete value;
+
+		p = rb_next(p);
+		rb_erase(&key->rb, &this->key_tree);
+		delete key;
+	}
+}
+
+template<typename KEY, typename VAL>
+Reducer<KEY, VAL>::~Reducer()
+{
+	__ReduceKey<KEY, VAL> *entry;
+
+	while (this->key_tree.rb_node)
+	{
+		using TYPE = __ReduceKey<KEY, VAL>;
+		entry = rb_entry(this->key_tree.rb_node, TYPE, rb);
+		rb_erase(&entry->rb, &this->key_tree);
+		delete entry;
+	}
+}
+
+template<typename VAL>
+struct __HashReduceValue
+{
+	__HashReduceValue<VAL> *next;
+	VAL value;
+	__HashReduceValue(VAL&& val) : next(NULL), value(std::move(val)) { }
+};
+
+template<typename KEY, typename VAL>
+struct __HashReduceKey
+{
+	KEY key;
+	size_t hash;
+	__HashReduceValue<VAL> *first;
+	__HashReduceValue<VAL> *last;
+
+	__HashReduceKey(KEY&& k, size_t h) : key(std::move(k))
+	{
+		this->hash = h;
+		this->first = NULL;
+		this->last = NULL;
+	}
+};
+
+template<typename VAL, bool = std::is_class<VAL>::value>
+class __HashReduceIterator;
+
+#define __HASH_REDUCE_HEAP_MAX		256
+
+/* VAL is a class. The smallest values first, at most __HASH_REDUCE_HEAP_MAX
+ * values at a time, as __ReduceIterator. */
+template<typename VAL>
+class __HashReduceIterator<VAL, true> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next()
+	{
+		if (this->heap_size == 0)
+			return NULL;
+
+		std::pop_heap(this->values->begin(),
+					  this->values->begin() + this->heap_size,
+					  __HashReduceIterator::greater);
+		return &(*this->values)[--this->heap_size]->value;
+	}
+
+	virtual size_t size() { return this->original_size; }
+
+private:
+	static bool greater(__HashReduceValue<VAL> *a, __HashReduceValue<VAL> *b)
+	{
+		return b->value.size() < a->value.size();
+	}
+
+	void reduce_begin() { this->original_size = this->heap_size; }
+
+	void reduce_end(VAL&& value)
+	{
+		std::vector<__HashReduceValue<VAL> *>& values = *this->values;
+		size_t n = this->original_size;
+
+		assert(n != this->heap_size);
+		while (--n != this->heap_size)
+			values[n]->value.~VAL();
+
+		values[n]->value = std::move(value);
+		values.resize(++this->heap_size);
+		std::push_heap(values.begin(), values.end(),
+					   __HashReduceIterator::greater);
+	}
+
+	size_t count() { return this->heap_size; }
+
+	__HashReduceValue<VAL> *value() { return (*this->values)[0]; }
+
+private:
+	std::vector<__HashReduceValue<VAL> *> *values;
+	size_t heap_size;
+	size_t original_size;
+
+private:
+	__HashReduceIterator(__HashReduceValue<VAL> **first,
+						 std::vector<__HashReduceValue<VAL> *> *values)
+	{
+		__HashReduceValue<VAL> *value = *first;
+
+		values->clear();
+		while (value && values->size() < __HASH_REDUCE_HEAP_MAX)
+		{
+			values->push_back(value);
+			value = value->next;
+		}
+
+		*first = value;
+		this->values = values;
+		this->heap_size = values->size();
+		std::make_heap(values->begin(), values->end(),
+					   __HashReduceIterator::greater);
+	}
+
+	template<class, class> friend class HashReducer;
+};
+
+/* VAL is not a class. All values in order, the result last. */
+template<typename VAL>
+class __HashReduceIterator<VAL, false> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next()
+	{
+		if (this->cursor == this->values->size())
+			return NULL;
+
+		return &(*this->values)[this->cursor++]->value;
+	}
+
+	virtual size_t size() { return this->original_size; }
+
+private:
+	void reduce_begin()
+	{
+		this->cursor = this->begin;
+		this->original_size = this->values->size() - this->begin;
+	}
+
+	void reduce_end(VAL&& value)
+	{
+		assert(this->cursor != this->begin);
+		(*this->values)[this->cursor - 1]->value = std::move(value);
+		this->values->push_back((*this->values)[this->cursor - 1]);
+		this->begin = this->cursor;
+	}
+
+	size_t count() { return this->values->size() - this->begin; }
+
+	__HashReduceValue<VAL> *value() { return this->values->back(); }
+
+private:
+	std::vector<__HashReduceValue<VAL> *> *values;
+	size_t begin;
+	size_t cursor;
+	size_t original_size;
+
+private:
+	__HashReduceIterator(__HashReduceValue<VAL> **first,
+						 std::vector<__HashReduceValue<VAL> *> *values)
+	{
+		values->clear();
+		for (; *first; *first = (*first)->next)
+			values->push_back(*first);
+
+		this->values = values;
+		this->begin = 0;
+	}
+
+	template<class, class> friend class HashReducer;
+};
+
+#undef __HASH_REDUCE_HEAP_MAX
+
+#define __HASH_REDUCE_TABLE_MIN		64
+#define __HASH_REDUCE_BLOCK_SIZE	(64 * 1024)
+
+template<typename KEY, typename VAL>
+HashReducer<KEY, VAL>::HashReducer() :
+	table(__HASH_REDUCE_TABLE_MIN, 0)
+{
+	this->cur = NULL;
+	this->end = NULL;
+}
+
+template<typename KEY, typename VAL>
+__HashReduceValue<VAL> *HashReducer<KEY, VAL>::alloc_value(VAL&& val)
+{
+	using VALUE = __HashReduceValue<VAL>;
+	size_t align = alignof (VALUE);
+	size_t size = (sizeof (VALUE) + align - 1) / align * align;
+	char *p = (char *)(((uintptr_t)this->cur + align - 1) / align * align);
+
+	if (!this->cur || p + size > this->end)
+	{
+		size_t block_size = std::max<size_t>(__HASH_REDUCE_BLOCK_SIZE, size);
+
+		p = (char *)malloc(block_size);
+		if (!p)
+			abort();
+
+		this->blocks.push_back(p);
+		this->end = p + block_size;
+	}
+
+	this->cur = p + size;
+	return new(p) VALUE(std::move(val));
+}
+
+/* Tables of 2^n slots, of indexes + 1 in 'keys', no more than half full. */
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::grow()
+{
+	size_t mask = this->table.size() * 2 - 1;
+	size_t i;
+
+	this->table.assign(mask + 1, 0);
+	for (size_t n = 0; n < this->keys.size(); n++)
+	{
+		i = this->keys[n].hash & mask;
+		while (this->table[i])
+			i = (i + 1) & mask;
+
+		this->table[i] = n + 1;
+	}
+}
+
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::insert(KEY&& key, VAL&& val, size_t hash)
+{
+	__HashReduceValue<VAL> *value = this->alloc_value(std::move(val));
+	__HashReduceKey<KEY, VAL> *entry;
+	size_t mask;
+	size_t i;
+
+	if (this->keys.size() * 2 >= this->table.size())
+		this->grow();
+
+	mask = this->table.size() - 1;
+	i = hash & mask;
+	while (this->table[i])
+	{
+		entry = &this->keys[this->table[i] - 1];
+		if (entry->hash == hash && entry->key == key)
+		{
+			entry->last->next = value;
+			entry->last = value;
+			return;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	this->keys.emplace_back(std::move(key), hash);
+	this->table[i] = this->keys.size();
+	entry = &this->keys.back();
+	entry->first = value;
+	entry->last = value;
+}
+
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::start(const reduce_function_t<KEY, VAL>& reduce,
+								  std::vector<std::pair<KEY, VAL>> *result)
+{
+	std::vector<__HashReduceValue<VAL> *> values;
+	__HashReduceValue<VAL> *value;
+
+	/* Free the table, and leave a small one for the next inserts. */
+	std::vector<size_t>(__HASH_REDUCE_TABLE_MIN, 0).swap(this->table);
+	std::sort(this->keys.begin(), this->keys.end(),
+			  [](const __HashReduceKey<KEY, VAL>& a,
+				 const __HashReduceKey<KEY, VAL>& b) {
+				return a.key < b.key;
+			  });
+
+	result->reserve(result->size() + this->keys.size());
+	for (__HashReduceKey<KEY, VAL>& key : this->keys)
+	{
+		while (key.first->next)
+		{
+			__HashReduceIterator<VAL> iter(&key.first, &values);
+
+			do
+			{
+				VAL tmp;
+				iter.reduce_begin();
+				reduce(&key.key, &iter, &tmp);
+				iter.reduce_end(std::move(tmp));
+			} while (iter.count() > 1);
+
+			value = iter.value();
+			value->next = NULL;
+			if (key.first)
+				key.last->next = value;
+			else
+				key.first = value;
+
+			key.last = value;
+		}
+
+		value = key.first;
+		result->emplace_back(std::move(key.key), std::move(value->value));
+		value->value.~VAL();
+		key.first = NULL;
+	}
+
+	this->keys.clear();
+}
+
+template<typename KEY, typename VAL>
+HashReducer<KEY, VAL>::~HashReducer()
+{
+	__HashReduceValue<VAL> *value;
+	__HashReduceValue<VAL> *next;
+
+	for (__HashReduceKey<KEY, VAL>& key : this->keys)
+	{
+		for (value = key.first; value; value = next)
+		{
+			next = value->next;
+			value->value.~VAL();
+		}
+	}
+
+	for (void *block : this->blocks)
+		free(block);
+}
+
+#undef __HASH_REDUCE_BLOCK_SIZE
+#undef __HASH_REDUCE_TABLE_MIN
+
+}
@@ -0,0 +1,113 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Wu Jiaxu (wujiaxu@sogou-inc.com)
+*/
+
+#ifndef _ROUTEMANAGER_H_
+#define _ROUTEMANAGER_H_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include "WFConnection.h"
+#include "EndpointParams.h"
+#include "CommScheduler.h"
+
+#define ROUTE_MANAGER_SHARDS	16
+/* Buckets of a shard at first. A shard doubles them when it holds more
+ * than two entries per bucket. */
+#define ROUTE_MANAGER_BUCKETS	64
+
+class RouteResultEntry;
+
+class RouteManager
+{
+public:
+	class RouteResult
+	{
+	public:
+		void *cookie;
+		CommSchedObject *request_object;
+
+	public:
+		RouteResult(): cookie(NULL), request_object(NULL) { }
+		void clear() { cookie = NULL; request_object = NULL; }
+	};
+
+	class RouteTarget : public CommSchedTarget
+	{
+	public:
+		int state;
+
+	private:
+		virtual WFConnection *new_connection(int connect_fd)
+		{
+			return new WFConnection;
+		}
+
+	public:
+		RouteTarget() : state(0) { }
+	};
+
+public:
+	int get(TransportType type,
+			const struct addrinfo *addrinfo,
+			const std::string& other_info,
+			const struct EndpointParams *endpoint_params,
+			const std::string& hostname,
+			RouteResult& result);
+
+	RouteManager();
+	~RouteManager();
+
+private:
+	struct Table
+	{
+		size_t size;				// power of 2
+		int link;					// index of RouteResultEntry::next
+		std::atomic<RouteResultEntry *> *buckets;
+	};
+
+	// Entries are never removed before the manager is destroyed, so that a
+	// lookup takes no lock. Only creating an entry locks its shard. Readers
+	// count themselves in one of two counters, so that a table replaced by
+	// a larger one is freed after they are gone.
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::atomic<int> phase;
+		std::atomic<int> readers[2];
+		std::atomic<Table *> table;
+		size_t count;
+	};
+
+	static Table *new_table(size_t size, int link);
+	static void delete_table(Table *table);
+	void grow(Shard *shard);
+	void synchronize(Shard *shard);
+
+	Shard shards_[ROUTE_MANAGER_SHARDS];
+
+public:
+	static void notify_unavailable(void *cookie, CommTarget *target);
+	static void notify_available(void *cookie, CommTarget *target);
+};
+
+#endif
+
@@ -0,0 +1,1150 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Author: Xie Han (xiehan@sogou-inc.com)
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <functional>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include "Workflow.h"
+#include "WFGlobal.h"
+
+/********** Classes without CMP **********/
+
+template<typename T>
+class __WFSortTask : public WFSortTask<T>
+{
+protected:
+	virtual void execute()
+	{
+		std::sort(this->input.first, this->input.last);
+		this->output.first = this->input.first;
+		this->output.last = this->input.last;
+	}
+
+public:
+	__WFSortTask(ExecQueue *queue, Executor *executor,
+				 T *first, T *last,
+				 sort_callback_t<T>&& cb) :
+		WFSortTask<T>(queue, executor, std::move(cb))
+	{
+		this->input.first = first;
+		this->input.last = last;
+		this->output.first = NULL;
+		this->output.last = NULL;
+	}
+};
+
+template<typename T>
+class __WFMergeTask : public WFMergeTask<T>
+{
+protected:
+	virtual void execute();
+
+public:
+	__WFMergeTask(ExecQueue *queue, Executor *executor,
+				  T *first1, T *last1, T *first2, T *last2, T *d_first,
+				  merge_callback_t<T>&& cb) :
+		WFMergeTask<T>(queue, executor, std::move(cb))
+	{
+		this->input.first1 = first1;
+		this->input.last1 = last1;
+		this->input.first2 = first2;
+		this->input.last2 = last2;
+		this->input.d_first = d_first;
+		this->output.first = NULL;
+		this->output.last = NULL;
+	}
+};
+
+template<typename T>
+void __WFMergeTask<T>::execute()
+{
+	auto *input = &this->input;
+	auto *output = &this->output;
+
+	if (input->first1 == input->d_first && input->last1 == input->first2)
+	{
+		std::inplace_merge(input->first1, input->first2, input->last2);
+		output->last = input->last2;
+	}
+	else if (input->first2 == input->d_first && input->last2 == input->first1)
+	{
+		std::inplace_merge(input->first2, input->first1, input->last1);
+		output->last = input->last1;
+	}
+	else
+	{
+		output->last = std::merge(input->first1, input->last1,
+								  input->first2, input->first2,
+								  input->d_first);
+	}
+
+	output->first = input->d_first;
+}
+
+/********** Classes with CMP **********/
+
+template<typename T, class CMP>
+class __WFSortTaskCmp : public __WFSortTask<T>
+{
+protected:
+	virtual void execute()
+	{
+		std::sort(this->input.first, this->input.last,
+				  std::move(this->compare));
+		this->output.first = this->input.first;
+		this->output.last = this->input.last;
+	}
+
+protected:
+	CMP compare;
+
+public:
+	__WFSortTaskCmp(ExecQueue *queue, Executor *executor,
+					T *first, T *last, CMP&& cmp,
+					sort_callback_t<T>&& cb) :
+		__WFSortTask<T>(queue, executor, first, last, std::move(cb)),
+		compare(std::move(cmp))
+	{
+	}
+};
+
+template<typename T, class CMP>
+class __WFMergeTaskCmp : public __WFMergeTask<T>
+{
+protected:
+	virtual void execute();
+
+protected:
+	CMP compare;
+
+public:
+	__WFMergeTaskCmp(ExecQueue *queue, Executor *executor,
+					 T *first1, T *last1, T *first2, T *last2,
+					 T *d_first, CMP&& cmp,
+					 merge_callback_t<T>&& cb) :
+		__WFMergeTask<T>(queue, executor, first1, last1, first2, last2, d_first,
+						 std::move(cb)),
+		compare(std::move(cmp))
+	{
+	}
+};
+
+template<typename T, class CMP>
+void __WFMergeTaskCmp<T, CMP>::execute()
+{
+	auto *input = &this->input;
+	auto *output = &this->output;
+
+	if (input->first1 == input->d_first && input->last1 == input->first2)
+	{
+		std::inplace_merge(input->first1, input->first2, input->last2,
+						   std::move(this->compare));
+		output->last = input->last2;
+	}
+	else if (input->first2 == input->d_first && input->last2 == input->first1)
+	{
+		std::inplace_merge(input->first2, input->first1, input->last1,
+						   std::move(this->compare));
+		output->last = input->last1;
+	}
+	else
+	{
+		output->last = std::merge(input->first1, input->last1,
+								  input->first2, input->first2,
+								  input->d_first,
+								  std::move(this->compare));
+	}
+
+	output->first = input->d_first;
+}
+
+/********** Parallel sorts **********/
+
+#define PSORT_SERIAL_MAX	(64 * 1024)
+#define PSORT_OVERSAMPLE	16
+
+/* One chunk of a step of the parallel sorts. */
+class __WFSortChunkTask : public WFGoTask
+{
+protected:
+	virtual void execute()
+	{
+		this->func(this->index);
+	}
+
+protected:
+	std::function<void (size_t)> func;
+	size_t index;
+
+public:
+	__WFSortChunkTask(ExecQueue *queue, Executor *executor,
+					  const std::function<void (size_t)>& func,
+					  size_t index) :
+		WFGoTask(queue, executor),
+		func(func)
+	{
+		this->index = index;
+	}
+};
+
+/* Several chunks a thread, so that a thread done early takes another. */
+static inline size_t __psort_chunks()
+{
+	int n = WFGlobal::get_global_settings()->compute_threads;
+
+	if (n <= 0)
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return 4 * (n > 0 ? n : 1);
+}
+
+/* Runs func(0) ... func(n - 1) in parallel before 'task' in its series. */
+static inline void __psort_push_parallel(SubTask *task, ExecQueue *queue,
+										 Executor *executor, size_t n,
+										 const std::function<void (size_t)>& func)
+{
+	SeriesWork *series = series_of(task);
+	ParallelWork *parallel = Workflow::create_parallel_work(nullptr);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		auto *chunk = new __WFSortChunkTask(queue, executor, func, i);
+		parallel->add_series(Workflow::create_series_work(chunk, nullptr));
+	}
+
+	series->push_front(task);
+	series->push_front(parallel);
+}
+
+/* Sample sort. Distinct splitters from a sorted sample cut the input into
+ * buckets, and the elements equal to a splitter get a bucket of their own
+ * that needs no sort, so a key repeated all over the input does not make
+ * one bucket of most of it. Each chunk of the input is classified, then
+ * scattered into a buffer by the prefix sums of the counts, and each bucket
+ * is sorted and moved back. One buffer is allocated, instead of one in each
+ * level of merging. */
+template<typename T, class CMP>
+class __WFSampleSortTask : public __WFSortTaskCmp<T, CMP>
+{
+public:
+	virtual void dispatch();
+
+protected:
+	virtual SubTask *done()
+	{
+		if (this->flag)
+			return series_of(this)->pop();
+
+		assert(this->state == WFT_STATE_SUCCESS);
+		return this->WFSortTask<T>::done();
+	}
+
+	virtual void execute()
+	{
+		if (this->buf)
+		{
+			this->output.first = this->input.first;
+			this->output.last = this->input.last;
+		}
+		else
+			this->__WFSortTaskCmp<T, CMP>::execute();
+	}
+
+private:
+	size_t chunk_pos(size_t i) const { return this->n * i / this->chunks; }
+	bool sample();
+	void classify(size_t i);
+	void prefix_sum();
+	void scatter(size_t i);
+	void sort_bucket(size_t i);
+
+protected:
+	int flag;
+	int step;
+	size_t n;
+	size_t chunks;
+	size_t buckets;
+	std::vector<T> splitters;
+	std::vector<unsigned char> ids;
+	std::vector<size_t> offsets;
+	std::vector<size_t> bounds;
+	T *buf;
+
+public:
+	__WFSampleSortTask(ExecQueue *queue, Executor *executor,
+					   T *first, T *last, CMP cmp,
+					   sort_callback_t<T>&& cb) :
+		__WFSortTaskCmp<T, CMP>(queue, executor, first, last, std::move(cmp),
+								std::move(cb))
+	{
+		this->flag = 0;
+		this->step = 0;
+		this->n = last - first;
+		this->chunks = 0;
+		this->buckets = 0;
+		this->buf = NULL;
+	}
+
+	virtual ~__WFSampleSortTask()
+	{
+		free(this->buf);
+	}
+};
+
+template<typename T, class CMP>
+bool __WFSampleSortTask<T, CMP>::sample()
+{
+	std::mt19937 gen(std::random_device{}());
+	std::vector<T> samples;
+	size_t k;
+
+	this->buf = (T *)malloc(this->n * sizeof (T));
+	if (!this->buf)
+		return false;
+
+	/* 2 * k - 1 buckets of k - 1 splitters fit the ids. */
+	this->chunks = __psort_chunks();
+	k = std::min<size_t>(this->chunks, 128);
+	samples.reserve(k * PSORT_OVERSAMPLE);
+	for (size_t i = 0; i < k * PSORT_OVERSAMPLE; i++)
+		samples.push_back(this->input.first[gen() % this->n]);
+
+	std::sort(samples.begin(), samples.end(), this->compare);
+	for (size_t i = 1; i < k; i++)
+	{
+		const T& splitter = samples[i * PSORT_OVERSAMPLE];
+
+		if (this->splitters.empty() ||
+			this->compare(this->splitters.back(), splitter))
+			this->splitters.push_back(splitter);
+	}
+
+	this->buckets = 2 * this->splitters.size() + 1;
+	this->ids.resize(this->n);
+	this->offsets.assign(this->chunks * this->buckets, 0);
+	this->bounds.resize(this->buckets + 1);
+	return true;
+}
+
+template<typename T, class CMP>
+void __WFSampleSortTask<T, CMP>::classify(size_t i)
+{
+	size_t *count = &this->offsets[i * this->buckets];
+	size_t last = this->chunk_pos(i + 1);
+	unsigned char id;
+	size_t b;
+
+	/* Bucket 2 * b holds the elements between splitters b - 1 and b, and
+	 * bucket 2 * b - 1 those equal to splitter b - 1. */
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+	{
+		const T& x = this->input.first[j];
+
+		b = std::upper_bound(this->splitters.begin(), this->splitters.end(),
+							 x, this->compare) - this->splitters.begin();
+		if (b > 0 && !this->compare(this->splitters[b - 1], x))
+			id = 2 * b - 1;
+		else
+			id = 2 * b;
+
+		this->ids[j] = id;
+		count[id]++;
+	}
+}
+
+/* The offsets become where each chunk puts its elements of each bucket. */
+template<typename T, class CMP>
+void __WFSampleSortTask<T, CMP>::prefix_sum()
+{
+	size_t sum = 0;
+	size_t count;
+
+	for (size_t b = 0; b < this->buckets; b++)
+	{
+		this->bounds[b] = sum;
+		for (size_t i = 0; i < this->chunks; i++)
+		{
+			count = this->offsets[i * this->buckets + b];
+			this->offsets[i * this->buckets + b] = sum;
+			sum += count;
+		}
+	}
+
+	this->bounds[this->buckets] = sum;
+}
+
+template<typename T, class CMP>
+void __WFSampleSortTask<T, CMP>::scatter(size_t i)
+{
+	size_t *offset = &this->offsets[i * this->buckets];
+	size_t last = this->chunk_pos(i + 1);
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+		new (this->buf + offset[this->ids[j]]++) T(std::move(this->input.first[j]));
+}
+
+template<typename T, class CMP>
+void __WFSampleSortTask<T, CMP>::sort_bucket(size_t i)
+{
+	T *first = this->buf + this->bounds[i];
+	T *last = this->buf + this->bounds[i + 1];
+	T *dest = this->input.first + this->bounds[i];
+
+	if (i % 2 == 0)
+		std::sort(first, last, this->compare);
+
+	for (T *p = first; p < last; p++)
+	{
+		*dest++ = std::move(*p);
+		p->~T();
+	}
+}
+
+template<typename T, class CMP>
+void __WFSampleSortTask<T, CMP>::dispatch()
+{
+	using namespace std::placeholders;
+	std::function<void (size_t)> func;
+	size_t tasks = this->chunks;
+
+	this->flag = 0;
+	switch (this->step++)
+	{
+	case 0:
+		if (this->n > PSORT_SERIAL_MAX && this->sample())
+		{
+			tasks = this->chunks;
+			func = std::bind(&__WFSampleSortTask::classify, this, _1);
+		}
+
+		break;
+
+	case 1:
+		this->prefix_sum();
+		func = std::bind(&__WFSampleSortTask::scatter, this, _1);
+		break;
+
+	case 2:
+		std::vector<unsigned char>().swap(this->ids);
+		tasks = this->buckets;
+		func = std::bind(&__WFSampleSortTask::sort_bucket, this, _1);
+		break;
+	}
+
+	if (func)
+	{
+		__psort_push_parallel(this, this->queue, this->executor, tasks, func);
+		this->flag = 1;
+		this->subtask_done();
+	}
+	else
+		this->__WFSortTaskCmp<T, CMP>::dispatch();
+}
+
+template<typename T>
+struct __RadixKey
+{
+	using type = typename std::conditional<sizeof (T) == 1, uint8_t,
+				 typename std::conditional<sizeof (T) == 2, uint16_t,
+				 typename std::conditional<sizeof (T) == 4, uint32_t,
+										   uint64_t>::type>::type>::type;
+
+	/* Unsigned keys in the order of the values. */
+	static type get(T value)
+	{
+		static constexpr type sign = (type)1 << (sizeof (T) * 8 - 1);
+		type key;
+
+		memcpy(&key, &value, sizeof (T));
+		if (std::is_floating_point<T>::value)
+			return (key & sign) ? (type)~key : (type)(key | sign);
+
+		if (std::is_signed<T>::value)
+			return key ^ sign;
+
+		return key;
+	}
+};
+
+/* LSD radix sort of 8-bit digits. Each pass counts the digit of each chunk,
+ * and scatters the chunks by the prefix sums of the counts, between the
+ * input and one buffer. A digit that is the same for all is skipped. */
+template<typename T>
+class __WFRadixSortTask : public __WFSortTask<T>
+{
+	static_assert(std::is_arithmetic<T>::value && sizeof (T) <= 8,
+				  "radix sort of integral or floating point types only");
+
+public:
+	virtual void dispatch();
+
+protected:
+	virtual SubTask *done()
+	{
+		if (this->flag)
+			return series_of(this)->pop();
+
+		assert(this->state == WFT_STATE_SUCCESS);
+		return this->WFSortTask<T>::done();
+	}
+
+	virtual void execute()
+	{
+		if (this->buf.empty())
+			this->__WFSortTask<T>::execute();
+		else
+		{
+			this->output.first = this->input.first;
+			this->output.last = this->input.last;
+		}
+	}
+
+private:
+	enum
+	{
+		RADIX_START,
+		RADIX_PLAN,
+		RADIX_COUNT,
+		RADIX_SCATTER,
+		RADIX_END,
+	};
+
+	size_t chunk_pos(size_t i) const { return this->n * i / this->chunks; }
+	unsigned int digit(T value) const
+	{
+		return (__RadixKey<T>::get(value) >> (this->digits[this->pass] * 8)) & 0xff;
+	}
+
+	void count_all(size_t i);
+	void plan();
+	void count(size_t i);
+	void scatter(size_t i);
+	void copy_back(size_t i);
+
+protected:
+	int flag;
+	int step;
+	size_t n;
+	size_t chunks;
+	std::vector<size_t> counts;
+	std::vector<int> digits;
+	size_t pass;
+	T *src;
+	T *dst;
+	std::vector<T> buf;
+
+public:
+	__WFRadixSortTask(ExecQueue *queue, Executor *executor,
+					  T *first, T *last,
+					  sort_callback_t<T>&& cb) :
+		__WFSortTask<T>(queue, executor, first, last, std::move(cb))
+	{
+		this->flag = 0;
+		this->step = RADIX_START;
+		this->n = last - first;
+		this->chunks = 0;
+		this->pass = 0;
+		this->src = first;
+		this->dst = NULL;
+	}
+};
+
+/* All digits in one read, to find those to skip. */
+template<typename T>
+void __WFRadixSortTask<T>::count_all(size_t i)
+{
+	size_t *count = &this->counts[i * sizeof (T) * 256];
+	size_t last = this->chunk_pos(i + 1);
+	typename __RadixKey<T>::type key;
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+	{
+		key = __RadixKey<T>::get(this->src[j]);
+		for (size_t d = 0; d < sizeof (T); d++)
+			count[d * 256 + ((key >> (d * 8)) & 0xff)]++;
+	}
+}
+
+/* The counts of the first pass are still those of the input. */
+template<typename T>
+void __WFRadixSortTask<T>::plan()
+{
+	typename __RadixKey<T>::type key = __RadixKey<T>::get(this->src[0]);
+	std::vector<size_t> first_counts;
+	unsigned int v;
+	size_t total;
+
+	for (size_t d = 0; d < sizeof (T); d++)
+	{
+		v = (key >> (d * 8)) & 0xff;
+		total = 0;
+		for (size_t i = 0; i < this->chunks; i++)
+			total += this->counts[(i * sizeof (T) + d) * 256 + v];
+
+		if (total != this->n)
+			this->digits.push_back(d);
+	}
+
+	if (this->digits.empty())
+		return;
+
+	first_counts.resize(this->chunks * 256);
+	for (size_t i = 0; i < this->chunks; i++)
+	{
+		std::copy(&this->counts[(i * sizeof (T) + this->digits[0]) * 256],
+				  &this->counts[(i * sizeof (T) + this->digits[0] + 1) * 256],
+				  &first_counts[i * 256]);
+	}
+
+	this->counts.swap(first_counts);
+}
+
+template<typename T>
+void __WFRadixSortTask<T>::count(size_t i)
+{
+	size_t *count = &this->counts[i * 256];
+	size_t last = this->chunk_pos(i + 1);
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+		count[this->digit(this->src[j])]++;
+}
+
+template<typename T>
+void __WFRadixSortTask<T>::scatter(size_t i)
+{
+	size_t *offset = &this->counts[i * 256];
+	size_t last = this->chunk_pos(i + 1);
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+		this->dst[offset[this->digit(this->src[j])]++] = this->src[j];
+}
+
+template<typename T>
+void __WFRadixSortTask<T>::copy_back(size_t i)
+{
+	std::copy(this->src + this->chunk_pos(i), this->src + this->chunk_pos(i + 1),
+			  this->input.first + this->chunk_pos(i));
+}
+
+template<typename T>
+void __WFRadixSortTask<T>::dispatch()
+{
+	using namespace std::placeholders;
+	std::function<void (size_t)> func;
+	size_t sum;
+	size_t count;
+
+	this->flag = 0;
+	while (!func && this->step != RADIX_END)
+	{
+		switch (this->step)
+		{
+		case RADIX_START:
+			if (this->n <= PSORT_SERIAL_MAX)
+			{
+				this->step = RADIX_END;
+				break;
+			}
+
+			this->chunks = __psort_chunks();
+			this->counts.assign(this->chunks * sizeof (T) * 256, 0);
+			this->buf.resize(this->n);
+			this->dst = this->buf.data();
+			func = std::bind(&__WFRadixSortTask::count_all, this, _1);
+			this->step = RADIX_PLAN;
+			break;
+
+		case RADIX_PLAN:
+			this->plan();
+			this->step = this->digits.empty() ? RADIX_END : RADIX_SCATTER;
+			break;
+
+		case RADIX_COUNT:
+			/* A pass is scattered. */
+			std::swap(this->src, this->dst);
+			if (++this->pass < this->digits.size())
+			{
+				this->counts.assign(this->chunks * 256, 0);
+				func = std::bind(&__WFRadixSortTask::count, this, _1);
+				this->step = RADIX_SCATTER;
+			}
+			else
+			{
+				if (this->src != this->input.first)
+					func = std::bind(&__WFRadixSortTask::copy_back, this, _1);
+
+				this->step = RADIX_END;
+			}
+
+			break;
+
+		case RADIX_SCATTER:
+			sum = 0;
+			for (size_t v = 0; v < 256; v++)
+			{
+				for (size_t i = 0; i < this->chunks; i++)
+				{
+					count = this->counts[i * 256 + v];
+					this->counts[i * 256 + v] = sum;
+					sum += count;
+				}
+			}
+
+			func = std::bind(&__WFRadixSortTask::scatter, this, _1);
+			this->step = RADIX_COUNT;
+			break;
+		}
+	}
+
+	if (func)
+	{
+		__psort_push_parallel(this, this->queue, this->executor,
+							  this->chunks, func);
+		this->flag = 1;
+		this->subtask_done();
+	}
+	else
+		this->__WFSortTask<T>::dispatch();
+}
+
+/********** Factory functions without CMP **********/
+
+template<typename T, class CB>
+WFSortTask<T> *WFAlgoTaskFactory::create_sort_task(const std::string& name,
+												   T *first, T *last,
+												   CB callback)
+{
+	return new __WFSortTask<T>(WFGlobal::get_exec_queue(name),
+							   WFGlobal::get_compute_executor(),
+							   first, last,
+							   std::move(callback));
+}
+
+template<typename T, class CB>
+WFMergeTask<T> *WFAlgoTaskFactory::create_merge_task(const std::string& name,
+													 T *first1, T *last1,
+													 T *first2, T *last2,
+													 T *d_first,
+													 CB callback)
+{
+	return new __WFMergeTask<T>(WFGlobal::get_exec_queue(name),
+							    WFGlobal::get_compute_executor(),
+								first1, last1, first2, last2, d_first,
+								std::move(callback));
+}
+
+template<typename T, class CB>
+WFSortTask<T> *WFAlgoTaskFactory::create_psort_task(const std::string& name,
+													T *first, T *last,
+													CB callback)
+{
+	return new __WFSampleSortTask<T, std::less<T>>(WFGlobal::get_exec_queue(name),
+												   WFGlobal::get_compute_executor(),
+												   first, last, std::less<T>(),
+												   std::move(callback));
+}
+
+template<typename T, class CB>
+WFSortTask<T> *WFAlgoTaskFactory::create_radix_sort_task(const std::string& name,
+														 T *first, T *last,
+														 CB callback)
+{
+	return new __WFRadixSortTask<T>(WFGlobal::get_exec_queue(name),
+									WFGlobal::get_compute_executor(),
+									first, last,
+									std::move(callback));
+}
+
+/********** Factory functions with CMP **********/
+
+template<typename T, class CMP, class CB>
+WFSortTask<T> *WFAlgoTaskFactory::create_sort_task(const std::string& name,
+												   T *first, T *last,
+												   CMP compare,
+												   CB callback)
+{
+	return new __WFSortTaskCmp<T, CMP>(WFGlobal::get_exec_queue(name),
+									   WFGlobal::get_compute_executor(),
+									   first, last, std::move(compare),
+									   std::move(callback));
+}
+
+template<typename T, class CMP, class CB>
+WFMergeTask<T> *WFAlgoTaskFactory::create_merge_task(const std::string& name,
+													 T *first1, T *last1,
+													 T *first2, T *last2,
+													 T *d_first,
+													 CMP compare,
+													 CB callback)
+{
+	return new __WFMergeTaskCmp<T, CMP>(WFGlobal::get_exec_queue(name),
+										WFGlobal::get_compute_executor(),
+										first1, last1, first2, last2,
+										d_first, std::move(compare),
+										std::move(callback));
+}
+
+template<typename T, class CMP, class CB>
+WFSortTask<T> *WFAlgoTaskFactory::create_psort_task(const std::string& name,
+													T *first, T *last,
+													CMP compare,
+													CB callback)
+{
+	return new __WFSampleSortTask<T, CMP>(WFGlobal::get_exec_queue(name),
+										  WFGlobal::get_compute_executor(),
+										  first, last, std::move(compare),
+										  std::move(callback));
+}
+
+/****************** MapReduce ******************/
+
+template<typename KEY, typename VAL>
+class __WFReduceTask : public WFReduceTask<KEY, VAL>
+{
+protected:
+	virtual void execute();
+
+protected:
+	algorithm::reduce_function_t<KEY, VAL> reduce;
+
+public:
+	__WFReduceTask(ExecQueue *queue, Executor *executor,
+				   algorithm::reduce_function_t<KEY, VAL>&& red,
+				   reduce_callback_t<KEY, VAL>&& cb) :
+		WFReduceTask<KEY, VAL>(queue, executor, std::move(cb)),
+		reduce(std::move(red))
+	{
+	}
+
+	__WFReduceTask(ExecQueue *queue, Executor *executor,
+				   algorithm::ReduceInput<KEY, VAL>&& input,
+				   algorithm::reduce_function_t<KEY, VAL>&& red,
+				   reduce_callback_t<KEY, VAL>&& cb) :
+		WFReduceTask<KEY, VAL>(queue, executor, std::move(cb)),
+		reduce(std::move(red))
+	{
+		this->input = std::move(input);
+	}
+};
+
+template<class KEY, class VAL>
+void __WFReduceTask<KEY, VAL>::execute()
+{
+	algorithm::Reducer<KEY, VAL> reducer;
+	auto iter = this->input.begin();
+
+	while (iter != this->input.end())
+	{
+		reducer.insert(std::move(iter->first), std::move(iter->second));
+		iter++;
+	}
+
+	this->input.clear();
+	reducer.start(this->reduce, &this->output);
+}
+
+#define PREDUCE_SERIAL_MAX	(64 * 1024)
+
+/* Hash partitioned reduce. The pairs are hashed and counted by chunks, and
+ * their indexes scattered by partition. Each partition is reduced by a
+ * HashReducer, and the sorted partitions are merged into the output. */
+template<typename KEY, typename VAL>
+class __WFParReduceTask : public __WFReduceTask<KEY, VAL>
+{
+public:
+	virtual void dispatch();
+
+protected:
+	virtual SubTask *done()
+	{
+		if (this->flag)
+			return series_of(this)->pop();
+
+		assert(this->state == WFT_STATE_SUCCESS);
+		return this->WFReduceTask<KEY, VAL>::done();
+	}
+
+	virtual void execute();
+
+private:
+	size_t chunk_pos(size_t i) const { return this->n * i / this->chunks; }
+	size_t partition(size_t hash) const
+	{
+		return (hash >> (sizeof (size_t) * 4)) % this->parts;
+	}
+
+	void hash_chunk(size_t i);
+	void scatter(size_t i);
+	void reduce_partition(size_t i);
+
+protected:
+	int flag;
+	int step;
+	size_t n;
+	size_t chunks;
+	size_t parts;
+	std::vector<size_t> hashes;
+	std::vector<size_t> offsets;
+	std::vector<size_t> bounds;
+	std::vector<size_t> order;
+	std::vector<algorithm::ReduceOutput<KEY, VAL>> outputs;
+
+public:
+	__WFParReduceTask(ExecQueue *queue, Executor *executor,
+					  algorithm::reduce_function_t<KEY, VAL>&& red,
+					  reduce_callback_t<KEY, VAL>&& cb) :
+		__WFReduceTask<KEY, VAL>(queue, executor, std::move(red),
+								 std::move(cb))
+	{
+		this->flag = 0;
+		this->step = 0;
+		this->n = 0;
+		this->chunks = 0;
+		this->parts = 0;
+	}
+
+	__WFParReduceTask(ExecQueue *queue, Executor *executor,
+					  algorithm::ReduceInput<KEY, VAL>&& input,
+					  algorithm::reduce_function_t<KEY, VAL>&& red,
+					  reduce_callback_t<KEY, VAL>&& cb) :
+		__WFReduceTask<KEY, VAL>(queue, executor, std::move(input),
+								 std::move(red), std::move(cb))
+	{
+		this->flag = 0;
+		this->step = 0;
+		this->n = 0;
+		this->chunks = 0;
+		this->parts = 0;
+	}
+};
+
+/* std::hash of integers may be the identity. Mixed, the high bits choose
+ * the partition and the low bits the slot. */
+template<typename KEY, typename VAL>
+void __WFParReduceTask<KEY, VAL>::hash_chunk(size_t i)
+{
+	std::hash<KEY> hash;
+	size_t *count = &this->offsets[i * this->parts];
+	size_t last = this->chunk_pos(i + 1);
+	uint64_t h;
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+	{
+		h = hash(this->input[j].first);
+		h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+		h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		this->hashes[j] = (size_t)h;
+		count[this->partition(this->hashes[j])]++;
+	}
+}
+
+template<typename KEY, typename VAL>
+void __WFParReduceTask<KEY, VAL>::scatter(size_t i)
+{
+	size_t *offset = &this->offsets[i * this->parts];
+	size_t last = this->chunk_pos(i + 1);
+
+	for (size_t j = this->chunk_pos(i); j < last; j++)
+		this->order[offset[this->partition(this->hashes[j])]++] = j;
+}
+
+template<typename KEY, typename VAL>
+void __WFParReduceTask<KEY, VAL>::reduce_partition(size_t i)
+{
+	algorithm::HashReducer<KEY, VAL> reducer;
+	size_t j;
+
+	for (size_t k = this->bounds[i]; k < this->bounds[i + 1]; k++)
+	{
+		j = this->order[k];
+		reducer.insert(std::move(this->input[j].first),
+					   std::move(this->input[j].second),
+					   this->hashes[j]);
+	}
+
+	reducer.start(this->reduce, &this->outputs[i]);
+}
+
+template<typename KEY, typename VAL>
+void __WFParReduceTask<KEY, VAL>::dispatch()
+{
+	using namespace std::placeholders;
+	std::function<void (size_t)> func;
+	size_t tasks = this->chunks;
+	size_t sum = 0;
+	size_t count;
+
+	this->flag = 0;
+	switch (this->step++)
+	{
+	case 0:
+		this->n = this->input.size();
+		if (this->n > PREDUCE_SERIAL_MAX)
+		{
+			this->chunks = __psort_chunks();
+			this->parts = this->chunks;
+			this->hashes.resize(this->n);
+			this->offsets.assign(this->chunks * this->parts, 0);
+			tasks = this->chunks;
+			func = std::bind(&__WFParReduceTask::hash_chunk, this, _1);
+		}
+
+		break;
+
+	case 1:
+		this->bounds.resize(this->parts + 1);
+		for (size_t p = 0; p < this->parts; p++)
+		{
+			this->bounds[p] = sum;
+			for (size_t i = 0; i < this->chunks; i++)
+			{
+				count = this->offsets[i * this->parts + p];
+				this->offsets[i * this->parts + p] = sum;
+				sum += count;
+			}
+		}
+
+		this->bounds[this->parts] = sum;
+		this->order.resize(this->n);
+		func = std::bind(&__WFParReduceTask::scatter, this, _1);
+		break;
+
+	case 2:
+		this->outputs.resize(this->parts);
+		tasks = this->parts;
+		func = std::bind(&__WFParReduceTask::reduce_partition, this, _1);
+		break;
+	}
+
+	if (func)
+	{
+		__psort_push_parallel(this, this->queue, this->executor, tasks, func);
+		this->flag = 1;
+		this->subtask_done();
+	}
+	else
+		this->__WFReduceTask<KEY, VAL>::dispatch();
+}
+
+/* A key is in one partition only, so the merge is in the order of keys. */
+template<typename KEY, typename VAL>
+void __WFParReduceTask<KEY, VAL>::execute()
+{
+	std::vector<std::pair<size_t, size_t>> heap;
+	size_t total = 0;
+	size_t p;
+
+	if (this->outputs.empty())
+	{
+		this->__WFReduceTask<KEY, VAL>::execute();
+		return;
+	}
+
+	auto greater = [this](const std::pair<size_t, size_t>& a,
+						  const std::pair<size_t, size_t>& b) {
+		return this->outputs[b.first][b.second].first <
+			   this->outputs[a.first][a.second].first;
+	};
+
+	algorithm::ReduceInput<KEY, VAL>().swap(this->input);
+	std::vector<size_t>().swap(this->hashes);
+	std::vector<size_t>().swap(this->order);
+	for (p = 0; p < this->parts; p++)
+	{
+		total += this->outputs[p].size();
+		if (!this->outputs[p].empty())
+			heap.emplace_back(p, 0);
+	}
+
+	this->output.reserve(total);
+	std::make_heap(heap.begin(), heap.end(), greater);
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), greater);
+		std::pair<size_t, size_t>& top = heap.back();
+		this->output.push_back(std::move(this->outputs[top.first][top.second]));
+		if (++top.second < this->outputs[top.first].size())
+			std::push_heap(heap.begin(), heap.end(), greater);
+		else
+			heap.pop_back();
+	}
+
+	this->outputs.clear();
+}
+
+template<typename KEY, typename VAL, class RED, class CB>
+WFReduceTask<KEY, VAL> *
+WFAlgoTaskFactory::create_reduce_task(const std::string& name,
+									  RED reduce,
+									  CB callback)
+{
+	return new __WFReduceTask<KEY, VAL>(WFGlobal::get_exec_queue(name),
+										WFGlobal::get_compute_executor(),
+										std::move(reduce),
+										std::move(callback));
+}
+
+template<typename KEY, typename VAL, class RED, class CB>
+WFReduceTask<KEY, VAL> *
+WFAlgoTaskFactory::create_reduce_task(const std::string& name,
+									  algorithm::ReduceInput<KEY, VAL> input,
+									  RED reduce,
+									  CB callback)
+{
+	return new __WFReduceTask<KEY, VAL>(WFGlobal::get_exec_queue(name),
+										WFGlobal::get_compute_executor(),
+										std::move(input),
+										std::move(reduce),
+										std::move(callback));
+}
+
+template<typename KEY, typename VAL, class RED, class CB>
+WFReduceTask<KEY, VAL> *
+WFAlgoTaskFactory::create_preduce_task(const std::string& name,
+									   RED reduce,
+									   CB callback)
+{
+	return new __WFParReduceTask<KEY, VAL>(WFGlobal::get_exec_queue(name),
+										   WFGlobal::get_compute_executor(),
+										   std::move(reduce),
+										   std::move(callback));
+}
+
+template<typename KEY, typename VAL, class RED, class CB>
+WFReduceTask<KEY, VAL> *
+WFAlgoTaskFactory::create_preduce_task(const std::string& name,
+									   algorithm::ReduceInput<KEY, VAL> input,
+									   RED reduce,
+									   CB callback)
+{
+	return new __WFParReduceTask<KEY, VAL>(WFGlobal::get_exec_queue(name),
+										   WFGlobal::get_compute_executor(),
+										   std::move(input),
+										   std::move(reduce),
+										   std::move(callback));
+}
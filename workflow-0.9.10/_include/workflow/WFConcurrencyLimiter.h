@@ -0,0 +1,107 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFCONCURRENCYLIMITER_H_
+#define _WFCONCURRENCYLIMITER_H_
+
+#include <stddef.h>
+#include <mutex>
+
+struct WFConcurrencyLimitParams
+{
+	int initial_limit;
+	int min_limit;
+	int max_limit;
+	int priority_classes;	/* priority 0 is the highest */
+	double tolerance;		/* latency growth accepted before shrinking */
+	double smoothing;
+	double backoff_ratio;
+	int max_latency;		/* in milliseconds. -1 for unlimited */
+};
+
+/* The limit follows the gradient of the latency: the no-load latency, the
+ * lowest window average seen, against the average of the last window, a
+ * window being about 'limit' requests. A window with a request slower than
+ * 'max_latency', or with one dropped before replying, instead cuts the limit
+ * by 'backoff_ratio'. */
+static constexpr struct WFConcurrencyLimitParams CONCURRENCY_LIMIT_PARAMS_DEFAULT =
+{
+	.initial_limit		=	20,
+	.min_limit			=	4,
+	.max_limit			=	1000,
+	.priority_classes	=	1,
+	.tolerance			=	1.5,
+	.smoothing			=	0.2,
+	.backoff_ratio		=	0.9,
+	.max_latency		=	-1,
+};
+
+class WFConcurrencyLimiter
+{
+public:
+	void init(const struct WFConcurrencyLimitParams *params);
+	bool is_enabled() const { return this->enabled; }
+
+	/* Priority p may use (classes - p) / classes of the limit, so that the
+	 * lowest class is shed first. */
+	bool try_acquire(int priority);
+
+	/* 'latency' in microseconds. 'dropped' if there is not to be a reply. */
+	void release(long long latency, bool dropped);
+
+public:
+	int get_limit() const { return (int)this->limit; }
+	int get_inflight() const { return this->inflight; }
+	size_t get_accepted() const { return this->accepted; }
+	size_t get_rejected() const { return this->rejected; }
+
+private:
+	void update_limit();
+
+private:
+	struct WFConcurrencyLimitParams params;
+	bool enabled;
+	double limit;
+	int inflight;
+	size_t accepted;
+	size_t rejected;
+	double noload_latency;
+
+	/* The current window. */
+	int samples;
+	int max_inflight;
+	long long total_latency;
+	bool backoff;
+	std::mutex mutex;
+
+public:
+	WFConcurrencyLimiter()
+	{
+		this->enabled = false;
+		this->limit = 0;
+		this->inflight = 0;
+		this->accepted = 0;
+		this->rejected = 0;
+		this->samples = 0;
+		this->max_inflight = 0;
+		this->total_latency = 0;
+		this->backoff = false;
+		this->noload_latency = 0;
+	}
+};
+
+#endif
+
@@ -0,0 +1,145 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFCOROUTINE_H_
+#define _WFCOROUTINE_H_
+
+#if __cplusplus <= 201703L
+#error "WFCoroutine.h requires C++20. The rest of workflow builds with C++11."
+#endif
+
+#include <stdlib.h>
+#include <coroutine>
+#include "SubTask.h"
+#include "Workflow.h"
+
+/*
+ * A coroutine returning WFCoroutine starts at once and runs until its first
+ * co_await. Awaiting a task (network, timer, go, thread, file, counter task
+ * or ParallelWork) puts it into a series, and the coroutine is resumed from
+ * the task's callback, in the thread that runs the callback. So awaiting
+ * allocates nothing beyond the task itself, and never switches threads.
+ *
+ * The result of 'co_await WFCoroutine::await(task)' is the task, which is
+ * valid until the coroutine awaits again or returns, just as a task is
+ * valid in its callback. The task's own callback is replaced.
+ *
+ * The first await starts a new series, and the later ones go to the same
+ * series. A coroutine that serves a server task should join the series of
+ * the server task first, so that the response is sent after it returns:
+ *
+ *   WFCoroutine process(WFHttpTask *server_task)
+ *   {
+ *       co_await WFCoroutine::join(series_of(server_task));
+ *       auto *task = co_await WFCoroutine::await(create_http_task(...));
+ *       ...
+ *   }
+ */
+
+class WFCoroutine
+{
+public:
+	struct promise_type
+	{
+		WFCoroutine get_return_object() { return WFCoroutine(); }
+		std::suspend_never initial_suspend() noexcept { return { }; }
+		std::suspend_never final_suspend() noexcept { return { }; }
+		void return_void() { }
+		void unhandled_exception() { abort(); }
+
+		/* The series that the next awaited task goes to. */
+		SeriesWork *series = NULL;
+	};
+
+	using handle_type = std::coroutine_handle<promise_type>;
+
+public:
+	template<class TASK>
+	class TaskAwaiter
+	{
+	public:
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(handle_type handle)
+		{
+			SeriesWork *series = handle.promise().series;
+
+			this->handle = handle;
+			this->task->set_callback([this](const SubTask *task) {
+				this->handle.promise().series = series_of(task);
+				this->handle.resume();
+			});
+
+			/* Nothing may touch this awaiter after starting the task, for
+			 * the coroutine may be resumed and finished right away. */
+			if (series)
+			{
+				handle.promise().series = NULL;
+				series->push_back(this->task);
+			}
+			else
+				this->task->start();
+		}
+
+		TASK *await_resume() const noexcept { return this->task; }
+
+	private:
+		TASK *task;
+		handle_type handle;
+
+	public:
+		TaskAwaiter(TASK *task) : task(task) { }
+	};
+
+	class SeriesAwaiter
+	{
+	public:
+		bool await_ready() const noexcept { return false; }
+
+		bool await_suspend(handle_type handle) noexcept
+		{
+			handle.promise().series = this->series;
+			return false;
+		}
+
+		void await_resume() const noexcept { }
+
+	private:
+		SeriesWork *series;
+
+	public:
+		SeriesAwaiter(SeriesWork *series) : series(series) { }
+	};
+
+public:
+	template<class TASK>
+	static TaskAwaiter<TASK> await(TASK *task)
+	{
+		return TaskAwaiter<TASK>(task);
+	}
+
+	/* Let the following awaits run in a running series. Each awaited task is
+	 * pushed back, so it runs after the tasks already queued in the series.
+	 * Only call it when the series cannot finish meanwhile, typically the
+	 * series of the task whose process or callback starts the coroutine. */
+	static SeriesAwaiter join(SeriesWork *series)
+	{
+		return SeriesAwaiter(series);
+	}
+};
+
+#endif
+
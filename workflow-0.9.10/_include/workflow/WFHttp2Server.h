@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFHTTP2SERVER_H_
+#define _WFHTTP2SERVER_H_
+
+#include <utility>
+#include "Http2Message.h"
+#include "WFServer.h"
+#include "WFTaskFactory.h"
+
+/* Serves HTTP/2 with prior knowledge (h2c), or over TLS when started
+ * with a certificate. There is no HTTP/1 upgrade.
+ *
+ * The streams of a request are processed in parallel, each by its own task,
+ * and replied to together; SETTINGS_MAX_CONCURRENT_STREAMS is 100. Nothing
+ * is read while a request is processed or replied, and a client sending
+ * frames then loses the connection. WFHttp2Client sends concurrent tasks
+ * as the streams of one request, so it never does. */
+
+using http2_process_t = std::function<void (WFHttp2Task *)>;
+using WFHttp2Server = WFServer<protocol::Http2Request,
+							   protocol::Http2Response>;
+
+static constexpr struct WFServerParams HTTP2_SERVER_PARAMS_DEFAULT =
+{
+	.max_connections		=	2000,
+	.peer_response_timeout	=	10 * 1000,
+	.receive_timeout		=	-1,
+	.keep_alive_timeout		=	60 * 1000,
+	.request_size_limit		=	(size_t)-1,
+	.ssl_accept_timeout		=	10 * 1000,
+};
+
+template<>
+inline WFHttp2Server::WFServer(http2_process_t proc) :
+	WFServerBase(&HTTP2_SERVER_PARAMS_DEFAULT),
+	process(std::move(proc))
+{
+}
+
+template<>
+inline CommSession *WFHttp2Server::new_session(long long seq, CommConnection *conn)
+{
+	WFHttp2Task *task;
+
+	task = WFServerTaskFactory::create_http2_task(this, this->process);
+	task->set_keep_alive(this->params.keep_alive_timeout);
+	task->set_receive_timeout(this->params.receive_timeout);
+	task->get_req()->set_size_limit(this->params.request_size_limit);
+
+	return task;
+}
+
+#endif
+
@@ -0,0 +1,103 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFHTTPCACHECLIENT_H_
+#define _WFHTTPCACHECLIENT_H_
+
+#include <stddef.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "WFTaskFactory.h"
+#include "HashLRUCache.h"
+
+/**
+ * @file   WFHttpCacheClient.h
+ * @brief  Http client with response cache and request coalescing
+ */
+
+/* A client side caching layer for http GET requests.
+ * Identical requests (url, method and all request headers) in flight at the
+ * same time are sent upstream only once, and every task gets the response.
+ * 200 responses are kept in memory for their 's-maxage', 'max-age' or
+ * 'Expires', in that order, capped at one year. Responses with 'private' or
+ * 'no-store' are never kept, and stale entries with an 'ETag' or
+ * 'Last-Modified' are revalidated.
+ *
+ * Requests that are not GET, or carry 'Cache-Control: no-cache|no-store',
+ * 'Range' or a conditional header, bypass the layer.
+ * The timeouts and prepare function of a task are used only when the task
+ * itself is sent upstream. A task answered from the cache or by another
+ * task's request has no connection and no peer address. */
+
+struct WFHttpCacheStats
+{
+	size_t requests;	/* tasks started */
+	size_t hits;		/* answered by a fresh entry */
+	size_t revalidated;	/* answered by a stale entry after a 304 */
+	size_t upstream;	/* requests sent to the server */
+	size_t coalesced;	/* answered by another task's request */
+	size_t bypassed;	/* not eligible for the cache */
+};
+
+struct __HttpCacheEntry;
+struct __HttpCacheFlight;
+
+class WFHttpCacheClient
+{
+public:
+	/* max_memory: bytes of cached responses (status line, headers, body). */
+	int init(size_t max_memory);
+	void deinit();
+
+	WFHttpTask *create_http_task(const std::string& url,
+								 int redirect_max,
+								 int retry_max,
+								 http_callback_t callback);
+
+public:
+	WFHttpCacheStats get_stats() const;
+
+public:
+	WFHttpCacheClient() : cache(16, CACHE_POLICY_CLOCK) { }
+	virtual ~WFHttpCacheClient() { }
+
+private:
+	struct EntryDeleter
+	{
+		void operator() (__HttpCacheEntry *entry) const;
+	};
+
+	using Cache = ShardedLRUCache<std::string, __HttpCacheEntry *,
+								  EntryDeleter>;
+
+	Cache cache;
+	std::mutex mutex;
+	std::unordered_map<std::string, __HttpCacheFlight *> flights;
+
+	std::atomic<size_t> requests{0};
+	std::atomic<size_t> hits{0};
+	std::atomic<size_t> revalidated{0};
+	std::atomic<size_t> upstream{0};
+	std::atomic<size_t> coalesced{0};
+	std::atomic<size_t> bypassed{0};
+
+	friend class __WFHttpCacheTask;
+};
+
+#endif
+
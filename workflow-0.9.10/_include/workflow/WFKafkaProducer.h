@@ -0,0 +1,148 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFKAFKAPRODUCER_H_
+#define _WFKAFKAPRODUCER_H_
+
+#include <stddef.h>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <string>
+#include <utility>
+#include "WFKafkaClient.h"
+
+struct WFKafkaProducerParams
+{
+	size_t batch_size;
+	int linger_ms;
+	size_t max_inflight_bytes;
+	int retry_max;
+};
+
+/* A partition's records are sent when they reach 'batch_size' bytes, or
+ * 'linger_ms' after the first of them. Records that are queued or not yet
+ * acknowledged count in 'max_inflight_bytes'. */
+static constexpr struct WFKafkaProducerParams KAFKA_PRODUCER_PARAMS_DEFAULT =
+{
+	.batch_size			=	16 * 1024,
+	.linger_ms			=	5,
+	.max_inflight_bytes	=	32 * 1024 * 1024,
+	.retry_max			=	2,
+};
+
+struct WFKafkaPartitionStats
+{
+	size_t records;			// acknowledged
+	size_t failed;
+	size_t batches;
+	size_t bytes;
+	long long total_latency;	// in microseconds, from send() to the ack
+	long long max_latency;
+};
+
+/* Records are accumulated by topic and partition, and each batch is sent
+ * with a produce task of the client. Records given partition -1 share one
+ * batch per topic, and the partitioner of the task spreads them. Stats are
+ * kept under the partitions records are sent to, or under -1 for a batch
+ * that failed before its partitions were known.
+ * The callback, if set, is called with every produce task. */
+class WFKafkaProducer
+{
+public:
+	int init(const std::string& broker_url);
+
+	/* Sends all that is queued and waits for the acks, and for the linger
+	 * timers to expire. */
+	void deinit();
+
+	void set_config(protocol::KafkaConfig conf)
+	{
+		this->config = std::move(conf);
+	}
+
+	void set_partitioner(kafka_partitioner_t partitioner)
+	{
+		this->partitioner = std::move(partitioner);
+	}
+
+	void set_callback(kafka_callback_t cb)
+	{
+		this->callback = std::move(cb);
+	}
+
+	/* Returns -1 with errno EAGAIN when 'max_inflight_bytes' is reached. */
+	int send(const std::string& topic, int partition,
+			 protocol::KafkaRecord record);
+
+	/* Sends all that is queued now, without waiting for the lingers. */
+	void flush();
+
+	bool get_partition_stats(const std::string& topic, int partition,
+							 struct WFKafkaPartitionStats *stats);
+
+	size_t get_inflight_bytes();
+
+public:
+	WFKafkaProducer() :
+		WFKafkaProducer(&KAFKA_PRODUCER_PARAMS_DEFAULT)
+	{
+	}
+
+	WFKafkaProducer(const struct WFKafkaProducerParams *params);
+	virtual ~WFKafkaProducer();
+
+private:
+	using PartitionKey = std::pair<std::string, int>;
+
+	/* The records are added to the produce task as they come. */
+	struct Batch
+	{
+		WFKafkaTask *task;
+		size_t records;
+		size_t bytes;
+		long long first_time;
+		long long total_time;
+	};
+
+	struct Partition
+	{
+		Batch batch;
+		unsigned long long batch_seq;
+		struct WFKafkaPartitionStats stats;
+	};
+
+	void send_batch(const PartitionKey& key, const Batch& batch);
+	void produce_callback(WFKafkaTask *task, const PartitionKey& key,
+						  const Batch& batch);
+	void linger_callback(const PartitionKey& key, unsigned long long seq);
+	void done(size_t bytes);
+
+private:
+	struct WFKafkaProducerParams params;
+	WFKafkaClient client;
+	protocol::KafkaConfig config;
+	kafka_partitioner_t partitioner;
+	kafka_callback_t callback;
+	std::map<PartitionKey, Partition> partitions;
+	size_t inflight_bytes;
+	int pending;
+	std::mutex mutex;
+	std::condition_variable cond;
+};
+
+#endif
+
@@ -0,0 +1,77 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFREDISKVSERVER_H_
+#define _WFREDISKVSERVER_H_
+
+#include <stddef.h>
+#include "RedisMessage.h"
+#include "WFRedisServer.h"
+
+/**
+ * @file   WFRedisKVServer.h
+ * @brief  Redis server with an in-process KV store
+ */
+
+/* Keys are hashed to shards, by default as many as the handler threads,
+ * each with its own lock. The commands that arrive together on a connection
+ * are executed in order as one pipelined request.
+ *
+ * Strings, hashes and key expiry are supported:
+ *   PING ECHO SELECT DBSIZE FLUSHDB FLUSHALL CONFIG COMMAND
+ *   GET SET SETEX SETNX MGET MSET GETSET APPEND STRLEN
+ *   INCR DECR INCRBY DECRBY DEL EXISTS TYPE
+ *   EXPIRE PEXPIRE TTL PTTL PERSIST
+ *   HSET HSETNX HGET HMGET HDEL HLEN HEXISTS HGETALL HKEYS HVALS HINCRBY
+ * A command of several keys is not atomic if they are in different shards.
+ * Expired keys are removed when accessed, and a few at each command to
+ * their shard. */
+
+class __RedisKVEngine;
+
+class WFRedisKVServer : public WFRedisServer
+{
+public:
+	/* shards: 0 for the number of handler threads. */
+	WFRedisKVServer(const struct WFServerParams *params, size_t shards);
+
+	WFRedisKVServer(size_t shards) :
+		WFRedisKVServer(&REDIS_SERVER_PARAMS_DEFAULT, shards)
+	{
+	}
+
+	WFRedisKVServer() : WFRedisKVServer(0) { }
+
+	virtual ~WFRedisKVServer();
+
+public:
+	/* Executes one command, as a client of this server would. */
+	void execute(const protocol::RedisValueView& command,
+				 protocol::RedisValue& reply);
+
+	size_t get_key_count() const;
+
+protected:
+	virtual CommSession *new_session(long long seq, CommConnection *conn);
+
+private:
+	void process_pipeline(WFRedisTask *task);
+
+	__RedisKVEngine *engine;
+};
+
+#endif
+
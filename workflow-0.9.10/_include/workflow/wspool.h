@@ -0,0 +1,49 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WSPOOL_H_
+#define _WSPOOL_H_
+
+#include <stddef.h>
+#include "thrdpool.h"
+
+typedef struct __wspool wspool_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * A work-stealing thread pool with the same task and life cycle rules as
+ * thrdpool. Every thread has its own task queue. A task scheduled by a pool
+ * thread goes to the tail of that thread's queue, other tasks are spread
+ * over the threads in turn. A thread runs its own queue in FIFO order, and
+ * when it is empty, steals the older half of another thread's queue.
+ */
+
+wspool_t *wspool_create(size_t nthreads, size_t stacksize);
+int wspool_schedule(const struct thrdpool_task *task, wspool_t *pool);
+int wspool_in_pool(wspool_t *pool);
+void wspool_destroy(void (*pending)(const struct thrdpool_task *),
+					wspool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
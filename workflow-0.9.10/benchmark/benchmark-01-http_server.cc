@@ -20,8 +20,10 @@ int main(int argc, char ** argv)
 	size_t pollers;
 	unsigned short port;
 	size_t length;
+	std::string backend = "default";
+	size_t n = parse_args(argc, argv, pollers, port, length, backend);
 
-	if (parse_args(argc, argv, pollers, port, length) != 3)
+	if (n != 3 && n != 4)
 	{
 		return -1;
 	}
@@ -31,6 +33,8 @@ int main(int argc, char ** argv)
 
 	WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
 	settings.poller_threads = pollers;
+	if (backend == "uring_poll")
+		settings.io_backend = IO_BACKEND_URING_POLL;
 	WORKFLOW_library_init(&settings);
 
 	const std::string content = make_content(length);
@@ -1,5 +1,6 @@
 #include <csignal>
 #include <cstring>
+#include <string>
 
 #include <workflow/WFHttpServer.h>
 #include <workflow/WFGlobal.h>
@@ -46,9 +47,20 @@ int main(int argc, char ** argv)
 
 		resp->add_header_pair("Content-Type", "text/plain; charset=UTF-8");
 
-		resp->append_output_body_nocopy(content.data(), content.size());
-
 		auto req = task->get_req();
+		const void * body;
+		size_t size;
+
+		// Large uploads are answered with the number of body bytes received.
+		if (req->get_parsed_body(&body, &size) && size != 0)
+		{
+			resp->append_output_body(std::to_string(size));
+		}
+		else
+		{
+			resp->append_output_body_nocopy(content.data(), content.size());
+		}
+
 		auto uri = req->get_request_uri();
 		if (std::strcmp(uri, "/long_req/") == 0)
 		{
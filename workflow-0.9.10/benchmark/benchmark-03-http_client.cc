@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <workflow/WFTaskFactory.h>
+#include <workflow/HttpUtil.h>
+#include <workflow/WFGlobal.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Closed loop load generator: every connection keeps exactly one request in
+// flight and sends the next one from the callback of the previous one.
+// Responses other than 200 count as rejected, and with a deadline, those
+// slower than it count as late; the rest is the goodput.
+
+using clock_type = std::chrono::steady_clock;
+
+static std::string url;
+static std::string body;
+static clock_type::time_point deadline;
+static long long deadline_us;
+static std::atomic<long long> errors{0};
+static std::atomic<long long> rejected{0};
+static std::atomic<long long> late{0};
+static std::mutex latency_mutex;
+static std::vector<long long> latencies;
+
+struct connection_context
+{
+	clock_type::time_point start;
+	std::vector<long long> latencies;
+	WFFacilities::WaitGroup * wait_group;
+};
+
+static void next_request(connection_context * ctx, SeriesWork * series);
+
+static void http_callback(WFHttpTask * task)
+{
+	auto * ctx = static_cast<connection_context *>(task->user_data);
+	auto now = clock_type::now();
+
+	if (task->get_state() != WFT_STATE_SUCCESS)
+		errors++;
+	else if (std::strcmp(task->get_resp()->get_status_code(), "200") != 0)
+		rejected++;
+	else
+	{
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - ctx->start);
+		ctx->latencies.push_back(us.count());
+		if (deadline_us > 0 && us.count() > deadline_us)
+		{
+			late++;
+		}
+	}
+
+	if (now < deadline)
+		next_request(ctx, series_of(task));
+	else
+	{
+		std::lock_guard<std::mutex> lock(latency_mutex);
+		latencies.insert(latencies.end(), ctx->latencies.begin(), ctx->latencies.end());
+		ctx->wait_group->done();
+	}
+}
+
+static void next_request(connection_context * ctx, SeriesWork * series)
+{
+	auto * task = WFTaskFactory::create_http_task(url, 0, 0, http_callback);
+
+	if (!body.empty())
+	{
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(body.data(), body.size());
+	}
+
+	task->user_data = ctx;
+	ctx->start = clock_type::now();
+	if (series)
+		series->push_back(task);
+	else
+		task->start();
+}
+
+static long long percentile(const std::vector<long long> & v, double p)
+{
+	if (v.empty())
+		return 0;
+
+	return v[static_cast<size_t>((v.size() - 1) * p)];
+}
+
+int main(int argc, char ** argv)
+{
+	size_t connections = 0;
+	size_t seconds = 0;
+	size_t pollers = 0;
+	std::string backend = "default";
+	size_t body_size = 0;
+	size_t deadline_ms = 0;
+	size_t n = parse_args(argc, argv, url, connections, seconds, pollers, backend, body_size, deadline_ms);
+
+	if (n < 4 || n > 7)
+	{
+		fprintf(stderr, "USAGE: %s <url> <connections> <seconds> <pollers> [default|uring_poll] [post body size] [deadline ms]\n", argv[0]);
+		return -1;
+	}
+
+	deadline_us = static_cast<long long>(deadline_ms) * 1000;
+
+	body.assign(body_size, 'x');
+
+	WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
+	settings.poller_threads = pollers;
+	settings.endpoint_params.max_connections = connections;
+	if (backend == "uring_poll")
+		settings.io_backend = IO_BACKEND_URING_POLL;
+	WORKFLOW_library_init(&settings);
+
+	std::vector<connection_context> contexts(connections);
+	WFFacilities::WaitGroup wait_group(connections);
+	auto start = clock_type::now();
+
+	deadline = start + std::chrono::seconds(seconds);
+	for (auto & ctx : contexts)
+	{
+		ctx.wait_group = &wait_group;
+		next_request(&ctx, nullptr);
+	}
+
+	wait_group.wait();
+	double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+	std::sort(latencies.begin(), latencies.end());
+	printf("%s: %zu connections, %.1fs, %zu requests, %lld errors\n",
+		   backend.c_str(), connections, elapsed, latencies.size(), errors.load());
+	printf("QPS %.0f, latency us p50 %lld p99 %lld max %lld\n",
+		   latencies.size() / elapsed, percentile(latencies, 0.5),
+		   percentile(latencies, 0.99), percentile(latencies, 1.0));
+	printf("goodput %.0f, %lld rejected, %lld late\n",
+		   (latencies.size() - late.load()) / elapsed, rejected.load(), late.load());
+	return 0;
+}
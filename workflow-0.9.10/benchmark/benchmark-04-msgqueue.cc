@@ -0,0 +1,96 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <workflow/msgqueue.h>
+
+#include "util/args.h"
+
+// Messages per second through a msgqueue, with producers standing for the
+// poller threads and consumers for the handler threads of a Communicator.
+
+struct message
+{
+	void * link;
+	size_t producer;
+};
+
+int main(int argc, char ** argv)
+{
+	size_t producers = 0;
+	size_t consumers = 0;
+	size_t messages = 0;
+	std::string type = "default";
+	size_t n = parse_args(argc, argv, producers, consumers, messages, type);
+
+	if (n != 3 && n != 4)
+	{
+		fprintf(stderr, "USAGE: %s <producers> <consumers> <messages per producer> [default|lockfree]\n", argv[0]);
+		return -1;
+	}
+
+	msgqueue_t * queue;
+	if (type == "lockfree")
+	{
+		queue = msgqueue_create_lockfree(4096, offsetof(message, link));
+	}
+	else
+	{
+		queue = msgqueue_create(4096, offsetof(message, link));
+	}
+
+	std::vector<message> msgs(producers * messages);
+	std::vector<std::thread> threads;
+	std::atomic<size_t> received{0};
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < consumers; i++)
+	{
+		threads.emplace_back([queue, &received]()
+		{
+			size_t count = 0;
+
+			while (msgqueue_get(queue))
+			{
+				count++;
+			}
+
+			received += count;
+		});
+	}
+
+	for (size_t i = 0; i < producers; i++)
+	{
+		threads.emplace_back([queue, &msgs, i, messages]()
+		{
+			for (size_t j = 0; j < messages; j++)
+			{
+				msgs[i * messages + j].producer = i;
+				msgqueue_put(&msgs[i * messages + j], queue);
+			}
+		});
+	}
+
+	for (size_t i = 0; i < producers; i++)
+	{
+		threads[consumers + i].join();
+	}
+
+	msgqueue_set_nonblock(queue);
+	for (size_t i = 0; i < consumers; i++)
+	{
+		threads[i].join();
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%s: %zu producers, %zu consumers, %zu messages, %.3fs, %.0f msgs/s\n",
+		   type.c_str(), producers, consumers, received.load(), elapsed,
+		   received.load() / elapsed);
+
+	msgqueue_destroy(queue);
+	return 0;
+}
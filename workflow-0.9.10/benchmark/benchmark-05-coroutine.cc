@@ -0,0 +1,96 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <workflow/WFCoroutine.h>
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Chains of go tasks, each task awaited in turn, written with series
+// callbacks and with coroutines.
+
+static std::atomic<size_t> executed{0};
+
+static void work()
+{
+	executed++;
+}
+
+static void series_next(WFGoTask * task, size_t left, WFFacilities::WaitGroup * wg)
+{
+	if (left > 1)
+	{
+		auto * next = WFTaskFactory::create_go_task("bench", work);
+
+		next->set_callback([left, wg](WFGoTask * next)
+		{
+			series_next(next, left - 1, wg);
+		});
+		series_of(task)->push_back(next);
+	}
+	else
+	{
+		wg->done();
+	}
+}
+
+static void series_chain(size_t length, WFFacilities::WaitGroup * wg)
+{
+	auto * task = WFTaskFactory::create_go_task("bench", work);
+
+	task->set_callback([length, wg](WFGoTask * task)
+	{
+		series_next(task, length, wg);
+	});
+	task->start();
+}
+
+static WFCoroutine coroutine_chain(size_t length, WFFacilities::WaitGroup * wg)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		co_await WFCoroutine::await(WFTaskFactory::create_go_task("bench", work));
+	}
+
+	wg->done();
+}
+
+int main(int argc, char ** argv)
+{
+	size_t chains = 0;
+	size_t length = 0;
+	std::string type = "coroutine";
+	size_t n = parse_args(argc, argv, chains, length, type);
+
+	if ((n != 2 && n != 3) || (type != "coroutine" && type != "series"))
+	{
+		fprintf(stderr, "USAGE: %s <chains> <tasks per chain> [coroutine|series]\n", argv[0]);
+		return -1;
+	}
+
+	WFFacilities::WaitGroup wg(chains);
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < chains; i++)
+	{
+		if (type == "series")
+		{
+			series_chain(length, &wg);
+		}
+		else
+		{
+			coroutine_chain(length, &wg);
+		}
+	}
+
+	wg.wait();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%s: %zu chains, %zu tasks, %.3fs, %.0f tasks/s\n",
+		   type.c_str(), chains, executed.load(), elapsed,
+		   executed.load() / elapsed);
+
+	return 0;
+}
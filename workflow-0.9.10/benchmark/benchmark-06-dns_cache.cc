@@ -0,0 +1,94 @@
+#include <netdb.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <workflow/DnsCache.h>
+#include <workflow/RouteManager.h>
+#include <workflow/EndpointParams.h>
+
+#include "util/args.h"
+
+// Lookups per second through the DnsCache and the RouteManager, as every
+// client task start does once its host is resolved.
+
+int main(int argc, char ** argv)
+{
+	size_t threads = 0;
+	size_t hosts = 0;
+	size_t lookups = 0;
+	size_t n = parse_args(argc, argv, threads, hosts, lookups);
+
+	if (n != 3 || hosts == 0 || hosts > 250)
+	{
+		fprintf(stderr, "USAGE: %s <threads> <hosts (1-250)> <lookups per thread>\n", argv[0]);
+		return -1;
+	}
+
+	DnsCache dns_cache;
+	RouteManager route_manager;
+	std::vector<std::string> names;
+	struct addrinfo hints = { };
+
+	hints.ai_flags = AI_NUMERICHOST | AI_PASSIVE;
+	hints.ai_socktype = SOCK_STREAM;
+	for (size_t i = 0; i < hosts; i++)
+	{
+		std::string name = "127.0.0." + std::to_string(i + 1);
+		struct addrinfo * ai;
+
+		if (getaddrinfo(name.c_str(), "80", &hints, &ai) != 0)
+		{
+			fprintf(stderr, "getaddrinfo failed for %s\n", name.c_str());
+			return -1;
+		}
+
+		dns_cache.release(dns_cache.put(name, 80, ai, -1, -1));
+		names.push_back(name);
+	}
+
+	std::vector<std::thread> workers;
+	std::atomic<size_t> failed{0};
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			RouteManager::RouteResult result;
+
+			for (size_t j = 0; j < lookups; j++)
+			{
+				const std::string & name = names[(i + j) % hosts];
+				auto * handle = dns_cache.get_ttl(name, 80);
+
+				if (!handle || route_manager.get(TT_TCP, handle->value.addrinfo, "",
+												 &ENDPOINT_PARAMS_DEFAULT, name,
+												 result) < 0)
+				{
+					failed++;
+				}
+
+				if (handle)
+				{
+					dns_cache.release(handle);
+				}
+			}
+		});
+	}
+
+	for (auto & t : workers)
+	{
+		t.join();
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%zu threads, %zu hosts, %zu lookups, %zu failed, %.3fs, %.0f lookups/s\n",
+		   threads, hosts, threads * lookups, failed.load(), elapsed,
+		   threads * lookups / elapsed);
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <workflow/LRUCache.h>
+#include <workflow/HashLRUCache.h>
+
+#include "util/args.h"
+
+// Hit, miss and eviction latency of LRUCache and HashLRUCache in one thread,
+// then throughput of a locked LRUCache and a ShardedLRUCache from threads.
+
+struct Deleter
+{
+	void operator() (const long & value) const { }
+};
+
+using Tree = LRUCache<long, long, Deleter>;
+using Hash = HashLRUCache<long, long, Deleter>;
+using Sharded = ShardedLRUCache<long, long, Deleter>;
+
+static std::vector<long> random_keys(size_t n, long range, unsigned int seed)
+{
+	std::mt19937_64 gen(seed);
+	std::vector<long> keys(n);
+
+	for (auto & key : keys)
+	{
+		key = gen() % range;
+	}
+
+	return keys;
+}
+
+template<class CACHE>
+static double get_ns(CACHE & cache, const std::vector<long> & keys)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (long key : keys)
+	{
+		auto * handle = cache.get(key);
+
+		if (handle)
+		{
+			cache.release(handle);
+		}
+	}
+
+	std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+	return ns.count() / keys.size();
+}
+
+template<class CACHE>
+static double put_ns(CACHE & cache, const std::vector<long> & keys)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (long key : keys)
+	{
+		cache.release(cache.put(key, key));
+	}
+
+	std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+	return ns.count() / keys.size();
+}
+
+template<class CACHE>
+static void single(const char * name, CACHE & cache, size_t size, size_t ops)
+{
+	std::vector<long> fill(size);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		fill[i] = i;
+	}
+
+	put_ns(cache, fill);
+
+	double hit = get_ns(cache, random_keys(ops, size, 1));
+
+	for (auto & key : fill)
+	{
+		key += size;
+	}
+
+	double miss = get_ns(cache, fill);
+	cache.set_max_size(size);
+	double evict = put_ns(cache, random_keys(ops, 4 * size, 3));
+
+	printf("%-18s hit %6.1f ns, miss %6.1f ns, put with eviction %6.1f ns\n",
+		   name, hit, miss, evict);
+}
+
+template<class CACHE, class LOCK>
+static double threaded(CACHE & cache, LOCK & lock, size_t size, size_t ops, size_t threads)
+{
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+
+	cache.set_max_size(size);
+	for (size_t i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			// 9 in 10 keys are hot, and most lookups hit.
+			for (long key : random_keys(ops, 10 * size, i))
+			{
+				if (key % 10 != 0)
+				{
+					key %= size / 2;
+				}
+
+				lock.lock();
+				auto * handle = cache.get(key);
+				lock.unlock();
+
+				if (!handle)
+				{
+					lock.lock();
+					handle = cache.put(key, key);
+					lock.unlock();
+				}
+
+				lock.lock();
+				cache.release(handle);
+				lock.unlock();
+			}
+		});
+	}
+
+	for (auto & t : workers)
+	{
+		t.join();
+	}
+
+	std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+	return threads * ops / seconds.count();
+}
+
+struct NoLock
+{
+	void lock() { }
+	void unlock() { }
+};
+
+int main(int argc, char ** argv)
+{
+	size_t size = 0;
+	size_t ops = 0;
+	size_t threads = 4;
+	size_t n = parse_args(argc, argv, size, ops, threads);
+
+	if ((n != 2 && n != 3) || size < 2)
+	{
+		fprintf(stderr, "USAGE: %s <cache size> <operations> [threads]\n", argv[0]);
+		return -1;
+	}
+
+	{
+		Tree cache;
+		single("LRUCache", cache, size, ops);
+	}
+
+	{
+		Hash cache(CACHE_POLICY_LRU);
+		single("HashLRUCache", cache, size, ops);
+	}
+
+	{
+		Hash cache(CACHE_POLICY_CLOCK);
+		single("HashLRUCache/CLOCK", cache, size, ops);
+	}
+
+	std::mutex mutex;
+	NoLock nolock;
+	double tree;
+	double sharded;
+
+	{
+		Tree cache;
+		tree = threaded(cache, mutex, size, ops, threads);
+	}
+
+	{
+		Sharded cache(16, CACHE_POLICY_CLOCK);
+		sharded = threaded(cache, nolock, size, ops, threads);
+	}
+
+	printf("%zu threads: LRUCache with mutex %.0f ops/s, ShardedLRUCache %.0f ops/s\n",
+		   threads, tree, sharded);
+	return 0;
+}
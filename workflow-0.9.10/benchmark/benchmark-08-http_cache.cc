@@ -0,0 +1,144 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <workflow/WFHttpServer.h>
+#include <workflow/WFHttpCacheClient.h>
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Concurrent clients fetch a small set of urls from a local server whose
+// every response takes a few milliseconds, with and without the cache layer.
+// The cached responses live for one second, so upstream requests drop to
+// about one per url per second plus the requests coalesced while in flight.
+
+static const int PORT = 8808;
+static const int DELAY_MS = 5;
+
+static std::atomic<size_t> upstream{0};
+static std::atomic<size_t> sent{0};
+static std::atomic<size_t> failed{0};
+
+static void process(WFHttpTask * task)
+{
+	upstream++;
+	task->get_resp()->add_header_pair("Cache-Control", "max-age=1");
+	task->get_resp()->append_output_body(task->get_req()->get_request_uri());
+	series_of(task)->push_back(WFTaskFactory::create_timer_task(DELAY_MS * 1000, nullptr));
+}
+
+struct Client
+{
+	WFHttpCacheClient * cache;
+	size_t keys;
+	size_t requests;
+	std::mt19937 gen;
+	WFFacilities::WaitGroup * wg;
+};
+
+static WFHttpTask * create_request(Client * client);
+
+static void callback(WFHttpTask * task)
+{
+	Client * client = (Client *)task->user_data;
+
+	if (task->get_state() != WFT_STATE_SUCCESS)
+	{
+		failed++;
+	}
+
+	// Cache hits complete at once, so keep them in one series instead of
+	// starting each from the previous callback.
+	if (sent++ < client->requests)
+	{
+		series_of(task)->push_back(create_request(client));
+	}
+	else
+	{
+		client->wg->done();
+	}
+}
+
+static WFHttpTask * create_request(Client * client)
+{
+	std::string url = "http://127.0.0.1:" + std::to_string(PORT) + "/" +
+					  std::to_string(client->gen() % client->keys);
+	WFHttpTask * task;
+
+	if (client->cache)
+	{
+		task = client->cache->create_http_task(url, 0, 0, callback);
+	}
+	else
+	{
+		task = WFTaskFactory::create_http_task(url, 0, 0, callback);
+	}
+
+	task->user_data = client;
+	return task;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t concurrency = 0;
+	size_t keys = 0;
+	size_t requests = 0;
+	std::string type = "cache";
+	size_t n = parse_args(argc, argv, concurrency, keys, requests, type);
+
+	if ((n != 3 && n != 4) || keys == 0 || (type != "cache" && type != "plain"))
+	{
+		fprintf(stderr, "USAGE: %s <concurrency> <urls> <requests> [cache|plain]\n", argv[0]);
+		return -1;
+	}
+
+	WFHttpServer server(process);
+
+	if (server.start(PORT) != 0)
+	{
+		perror("server start");
+		return -1;
+	}
+
+	WFHttpCacheClient cache;
+	WFFacilities::WaitGroup wg(concurrency);
+	std::vector<Client> clients(concurrency);
+
+	cache.init(64 * 1024 * 1024);
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < concurrency; i++)
+	{
+		clients[i].cache = (type == "cache") ? &cache : nullptr;
+		clients[i].keys = keys;
+		clients[i].requests = requests;
+		clients[i].gen.seed(i);
+		sent++;
+		clients[i].wg = &wg;
+		create_request(&clients[i])->start();
+	}
+
+	wg.wait();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s: %zu requests, %zu failed, %.3fs, %.0f requests/s, upstream %zu (%.0f/s)\n",
+		   type.c_str(), requests, failed.load(), elapsed, requests / elapsed,
+		   upstream.load(), upstream.load() / elapsed);
+
+	if (type == "cache")
+	{
+		WFHttpCacheStats stats = cache.get_stats();
+
+		printf("hits %zu, coalesced %zu, revalidated %zu\n",
+			   stats.hits, stats.coalesced, stats.revalidated);
+	}
+
+	cache.deinit();
+	server.stop();
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <workflow/WFHttpServer.h>
+#include <workflow/WFHttp2Server.h>
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+#include <workflow/HttpUtil.h>
+
+#include "util/args.h"
+
+// Concurrent clients send requests with a body of the given length to a
+// local echo server, over HTTP/1.1 keep-alive or HTTP/2 connections, each
+// client sending its next request from the callback of the previous one.
+
+static const int HTTP1_PORT = 8809;
+static const int HTTP2_PORT = 8810;
+
+static std::atomic<size_t> sent{0};
+static std::atomic<size_t> failed{0};
+static std::atomic<long long> latency{0};
+
+template<class TASK>
+static void process(TASK * task)
+{
+	const void * body;
+	size_t size;
+
+	if (task->get_req()->get_parsed_body(&body, &size))
+	{
+		task->get_resp()->append_output_body_nocopy(body, size);
+	}
+}
+
+struct Client
+{
+	bool http2;
+	size_t requests;
+	const std::string * body;
+	std::chrono::steady_clock::time_point start;
+	WFFacilities::WaitGroup * wg;
+};
+
+static SubTask * create_request(Client * client);
+
+template<class TASK>
+static void callback(TASK * task)
+{
+	Client * client = (Client *)task->user_data;
+	auto now = std::chrono::steady_clock::now();
+
+	if (task->get_state() != WFT_STATE_SUCCESS)
+	{
+		failed++;
+	}
+
+	latency += std::chrono::duration_cast<std::chrono::microseconds>(now - client->start).count();
+	if (sent++ < client->requests)
+	{
+		series_of(task)->push_back(create_request(client));
+	}
+	else
+	{
+		client->wg->done();
+	}
+}
+
+static SubTask * create_request(Client * client)
+{
+	client->start = std::chrono::steady_clock::now();
+	if (client->http2)
+	{
+		std::string url = "http://127.0.0.1:" + std::to_string(HTTP2_PORT) + "/";
+		WFHttp2Task * task = WFTaskFactory::create_http2_task(url, 0, callback<WFHttp2Task>);
+
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(client->body->data(), client->body->size());
+		task->user_data = client;
+		return task;
+	}
+	else
+	{
+		std::string url = "http://127.0.0.1:" + std::to_string(HTTP1_PORT) + "/";
+		WFHttpTask * task = WFTaskFactory::create_http_task(url, 0, 0, callback<WFHttpTask>);
+
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(client->body->data(), client->body->size());
+		task->user_data = client;
+		return task;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	size_t concurrency = 0;
+	size_t requests = 0;
+	size_t length = 0;
+	std::string type = "http2";
+	size_t n = parse_args(argc, argv, concurrency, requests, length, type);
+
+	if ((n != 3 && n != 4) || (type != "http1" && type != "http2"))
+	{
+		fprintf(stderr, "USAGE: %s <concurrency> <requests> <body length> [http1|http2]\n", argv[0]);
+		return -1;
+	}
+
+	WFHttpServer http1_server(process<WFHttpTask>);
+	WFHttp2Server http2_server(process<WFHttp2Task>);
+
+	if (http1_server.start(HTTP1_PORT) != 0 || http2_server.start(HTTP2_PORT) != 0)
+	{
+		perror("server start");
+		return -1;
+	}
+
+	std::string body(length, 'x');
+	WFFacilities::WaitGroup wg(concurrency);
+	std::vector<Client> clients(concurrency);
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < concurrency; i++)
+	{
+		clients[i].http2 = (type == "http2");
+		clients[i].requests = requests;
+		clients[i].body = &body;
+		clients[i].wg = &wg;
+		sent++;
+		Workflow::start_series_work(create_request(&clients[i]), nullptr);
+	}
+
+	wg.wait();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	size_t total = sent.load() - concurrency;
+
+	printf("%s: %zu requests, %zu failed, %.3fs, %.0f requests/s, latency %.1fus\n",
+		   type.c_str(), total, failed.load(), elapsed, total / elapsed,
+		   (double)latency.load() / total);
+
+	http2_server.stop();
+	http1_server.stop();
+	return 0;
+}
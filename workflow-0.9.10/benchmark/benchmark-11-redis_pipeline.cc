@@ -0,0 +1,207 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <workflow/WFRedisServer.h>
+#include <workflow/WFRedisPipelineClient.h>
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Concurrent clients send GET and SET commands to a local redis server,
+// one task at a time each, through WFTaskFactory with one request in flight
+// on each connection, or through WFRedisPipelineClient, which writes the
+// commands of concurrent tasks back to back on a few connections.
+// The server answers all the commands that arrive together at once.
+
+static const int PORT = 8811;
+
+class KVServer : public WFRedisServer
+{
+public:
+	KVServer() :
+		WFRedisServer(std::bind(&KVServer::process, this, std::placeholders::_1))
+	{
+	}
+
+	std::atomic<size_t> commands{0};
+	std::atomic<size_t> messages{0};
+
+protected:
+	virtual CommSession * new_session(long long seq, CommConnection * conn)
+	{
+		CommSession * session = WFRedisServer::new_session(seq, conn);
+
+		static_cast<WFRedisTask *>(session)->get_req()->accept_pipeline();
+		return session;
+	}
+
+private:
+	void process(WFRedisTask * task)
+	{
+		std::vector<std::vector<std::string>> requests;
+		protocol::RedisValue result;
+
+		task->get_req()->get_pipeline(requests);
+		result.set_array(requests.size());
+		messages++;
+		commands += requests.size();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const std::vector<std::string> & req = requests[i];
+
+			if (req[0] == "SET" && req.size() == 3)
+			{
+				kv[req[1]] = req[2];
+				result[i].set_status("OK");
+			}
+			else if (req[0] == "GET" && req.size() == 2)
+			{
+				auto it = kv.find(req[1]);
+
+				if (it != kv.end())
+				{
+					result[i].set_string(it->second);
+				}
+			}
+			else
+			{
+				result[i].set_error("ERR unknown command");
+			}
+		}
+
+		task->get_resp()->set_pipeline_result(result);
+	}
+
+	std::mutex mutex;
+	std::unordered_map<std::string, std::string> kv;
+};
+
+static WFRedisPipelineClient * pipeline;
+static std::string url;
+static std::string value;
+static size_t keys;
+static size_t total;
+static std::atomic<size_t> sent{0};
+static std::atomic<size_t> failed{0};
+static WFFacilities::WaitGroup * wg;
+
+static WFRedisTask * create_request(size_t seq);
+
+static void callback(WFRedisTask * task)
+{
+	protocol::RedisValue val;
+
+	task->get_resp()->get_result(val);
+	if (task->get_state() != WFT_STATE_SUCCESS || val.is_error())
+	{
+		failed++;
+	}
+
+	size_t seq = sent++;
+
+	if (seq < total)
+	{
+		series_of(task)->push_back(create_request(seq));
+	}
+	else
+	{
+		wg->done();
+	}
+}
+
+static WFRedisTask * create_request(size_t seq)
+{
+	std::string key = "key:" + std::to_string(seq % keys);
+	WFRedisTask * task;
+
+	if (pipeline)
+	{
+		task = pipeline->create_redis_task(url, 0, callback);
+	}
+	else
+	{
+		task = WFTaskFactory::create_redis_task(url, 0, callback);
+	}
+
+	// One SET in four, as a read mostly cache.
+	if (seq % 4 == 0)
+	{
+		task->get_req()->set_request("SET", {key, value});
+	}
+	else
+	{
+		task->get_req()->set_request("GET", {key});
+	}
+
+	return task;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t concurrency = 0;
+	size_t length = 0;
+	size_t max_inflight = 1;
+	std::string type = "pipeline";
+	size_t n = parse_args(argc, argv, concurrency, total, length, type, max_inflight);
+
+	keys = 1000;
+	if ((n < 3 || n > 5) || concurrency == 0 || max_inflight == 0 ||
+		(type != "pipeline" && type != "plain"))
+	{
+		fprintf(stderr, "USAGE: %s <concurrency> <requests> <value length> [pipeline|plain] [max inflight]\n", argv[0]);
+		return -1;
+	}
+
+	KVServer server;
+
+	if (server.start(PORT) != 0)
+	{
+		perror("server start");
+		return -1;
+	}
+
+	WFRedisPipelineClient client;
+	WFFacilities::WaitGroup wait_group(concurrency);
+
+	client.init(1024, (int)max_inflight);
+	pipeline = (type == "pipeline") ? &client : nullptr;
+	url = "redis://127.0.0.1:" + std::to_string(PORT);
+	value.assign(length, 'v');
+	wg = &wait_group;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < concurrency; i++)
+	{
+		create_request(sent++)->start();
+	}
+
+	wait_group.wait();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s: %zu requests, %zu failed, %.3fs, %.0f requests/s, server messages %zu (%.1f commands each)\n",
+		   type.c_str(), total, failed.load(), elapsed, total / elapsed,
+		   server.messages.load(),
+		   (double)server.commands.load() / server.messages.load());
+
+	if (pipeline)
+	{
+		WFRedisPipelineStats stats = client.get_stats();
+
+		printf("batches %zu, commands %zu, bypassed %zu\n",
+			   stats.batches, stats.commands, stats.bypassed);
+	}
+
+	client.deinit();
+	server.stop();
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <workflow/redis_parser.h>
+#include <workflow/RedisMessage.h>
+
+#include "util/args.h"
+
+// Parses large array replies with redis_parser, whole or fed in fragments of
+// a fixed size, and reads the values through a RedisValue copy or a
+// RedisValueView. Each reply is parsed by a new parser, as a client task does.
+//   mget:   1000 values of 256 bytes, one in ten nil.
+//   lrange: 10000 values of 8 to 16 bytes.
+
+static std::string mget_reply()
+{
+	std::string reply = "*1000\r\n";
+	std::string value(256, 'v');
+
+	for (int i = 0; i < 1000; i++)
+	{
+		if (i % 10 == 9)
+		{
+			reply += "$-1\r\n";
+		}
+		else
+		{
+			reply += "$256\r\n" + value + "\r\n";
+		}
+	}
+
+	return reply;
+}
+
+static std::string lrange_reply()
+{
+	std::string reply = "*10000\r\n";
+
+	for (int i = 0; i < 10000; i++)
+	{
+		std::string value = "item:" + std::to_string(i * 7919);
+
+		reply += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+	}
+
+	return reply;
+}
+
+static size_t parse(const std::string & data, size_t fragment, const std::string & mode)
+{
+	redis_parser_t parser;
+	size_t pos = 0;
+	size_t bytes = 0;
+	size_t n;
+	int ret = 0;
+
+	redis_parser_init(&parser);
+	while (pos < data.size())
+	{
+		n = data.size() - pos;
+		if (fragment != 0 && n > fragment)
+		{
+			n = fragment;
+		}
+
+		ret = redis_parser_append_message(data.data() + pos, &n, &parser);
+		if (ret != 0)
+		{
+			break;
+		}
+
+		pos += n;
+	}
+
+	if (ret == 1 && mode == "value")
+	{
+		protocol::RedisValue value;
+
+		value.set(&parser.reply);
+		for (size_t i = 0; i < value.arr_size(); i++)
+		{
+			bytes += value[i].string_view() ? value[i].string_view()->size() : 0;
+		}
+	}
+	else if (ret == 1 && mode == "view")
+	{
+		protocol::RedisValueView view(&parser.reply);
+
+		for (size_t i = 0; i < view.arr_size(); i++)
+		{
+			bytes += view[i].string_size();
+		}
+	}
+	else if (ret == 1)
+	{
+		bytes = 1;
+	}
+
+	redis_parser_deinit(&parser);
+	return bytes;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t times = 0;
+	std::string type;
+	std::string mode = "parse";
+	size_t fragment = 0;
+	size_t n = parse_args(argc, argv, times, type, mode, fragment);
+
+	if ((n < 2 || n > 4) || (type != "mget" && type != "lrange") ||
+		(mode != "parse" && mode != "value" && mode != "view"))
+	{
+		fprintf(stderr, "USAGE: %s <times> <mget|lrange> [parse|value|view] [fragment size]\n", argv[0]);
+		return -1;
+	}
+
+	std::string data = (type == "mget") ? mget_reply() : lrange_reply();
+
+	if (parse(data, fragment, mode) == 0)
+	{
+		fprintf(stderr, "parse error\n");
+		return -1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < times; i++)
+	{
+		parse(data, fragment, mode);
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s %s: %zu replies, %.3fs, %.0f replies/s, %.1f MB/s\n",
+		   type.c_str(), mode.c_str(), times, elapsed, times / elapsed,
+		   times * data.size() / elapsed / 1e6);
+	return 0;
+}
@@ -0,0 +1,290 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <workflow/WFRedisKVServer.h>
+#include <workflow/WFFacilities.h>
+#include <workflow/redis_parser.h>
+
+#include "util/args.h"
+
+// Load test of WFRedisKVServer in the manner of redis-benchmark: each client
+// has a connection, writes <pipeline> commands back to back and reads their
+// replies, with random keys in a keyspace, until the requests are done.
+// With 0 clients, only the server is started, to be tested by redis-benchmark:
+//   redis-benchmark -p <port> -t set,get,incr,hset,mset -P 16 -r 100000
+
+static WFFacilities::WaitGroup wait_group{1};
+
+void signal_handler(int)
+{
+	wait_group.done();
+}
+
+static std::string command(const std::vector<std::string> & args)
+{
+	std::string cmd = "*" + std::to_string(args.size()) + "\r\n";
+
+	for (const std::string & arg : args)
+	{
+		cmd += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+	}
+
+	return cmd;
+}
+
+static std::string random_key(const char * prefix, std::mt19937 & gen, size_t keyspace)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof buf, "%s%012zu", prefix, (size_t)(gen() % keyspace));
+	return buf;
+}
+
+static std::string make_batch(const std::string & test, size_t pipeline,
+							  const std::string & value, std::mt19937 & gen,
+							  size_t keyspace)
+{
+	std::string batch;
+
+	for (size_t i = 0; i < pipeline; i++)
+	{
+		if (test == "ping")
+		{
+			batch += command({"PING"});
+		}
+		else if (test == "set")
+		{
+			batch += command({"SET", random_key("key:", gen, keyspace), value});
+		}
+		else if (test == "get")
+		{
+			batch += command({"GET", random_key("key:", gen, keyspace)});
+		}
+		else if (test == "incr")
+		{
+			batch += command({"INCR", random_key("counter:", gen, keyspace)});
+		}
+		else if (test == "hset")
+		{
+			batch += command({"HSET", "myhash", random_key("element:", gen, keyspace), value});
+		}
+		else
+		{
+			std::vector<std::string> args = {"MSET"};
+
+			for (int j = 0; j < 10; j++)
+			{
+				args.push_back(random_key("key:", gen, keyspace));
+				args.push_back(value);
+			}
+
+			batch += command(args);
+		}
+	}
+
+	return batch;
+}
+
+// Returns the number of error replies, or -1 on connection failure.
+static long run_client(unsigned short port, const std::string & test,
+					   size_t requests, size_t pipeline, const std::string & value,
+					   size_t keyspace, unsigned int seed)
+{
+	std::mt19937 gen(seed);
+	std::vector<std::string> batches;
+	struct sockaddr_in addr = { };
+	char buf[65536];
+	long errors = 0;
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+
+		return -1;
+	}
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+	// Up to 4096 commands made in advance, so that the client costs little.
+	for (size_t i = 0; i < requests && i < 4096; i += pipeline)
+	{
+		batches.push_back(make_batch(test, pipeline, value, gen, keyspace));
+	}
+
+	for (size_t done = 0; done < requests; done += pipeline)
+	{
+		const std::string & batch = batches[(done / pipeline) % batches.size()];
+		size_t pos = 0;
+		redis_parser_t parser;
+		int ret = 0;
+
+		while (pos < batch.size())
+		{
+			ssize_t n = write(fd, batch.data() + pos, batch.size() - pos);
+
+			if (n <= 0)
+			{
+				close(fd);
+				return -1;
+			}
+
+			pos += n;
+		}
+
+		redis_parser_init(&parser);
+		redis_parser_set_pipeline(pipeline, &parser);
+		while (ret == 0)
+		{
+			ssize_t n = read(fd, buf, sizeof buf);
+			size_t size = n;
+
+			if (n <= 0)
+			{
+				break;
+			}
+
+			ret = redis_parser_append_message(buf, &size, &parser);
+		}
+
+		if (ret != 1)
+		{
+			redis_parser_deinit(&parser);
+			close(fd);
+			return -1;
+		}
+
+		for (size_t i = 0; i < parser.reply.elements; i++)
+		{
+			if (parser.reply.element[i]->type == REDIS_REPLY_TYPE_ERROR)
+			{
+				errors++;
+			}
+		}
+
+		redis_parser_deinit(&parser);
+	}
+
+	close(fd);
+	return errors;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned short port = 0;
+	size_t clients = 0;
+	size_t requests = 0;
+	size_t pipeline = 1;
+	std::string tests = "ping,set,get,incr,hset,mset";
+	size_t data_size = 3;
+	size_t keyspace = 100000;
+	size_t n = parse_args(argc, argv, port, clients, requests, pipeline, tests, data_size, keyspace);
+
+	if (n != 1 && (n < 3 || n > 7 || pipeline == 0 || keyspace == 0))
+	{
+		fprintf(stderr, "USAGE: %s <port> [<clients> <requests> [pipeline] [tests] [data size] [keyspace]]\n", argv[0]);
+		return -1;
+	}
+
+	WFRedisKVServer server;
+
+	if (server.start(port) != 0)
+	{
+		perror("server start");
+		return -1;
+	}
+
+	if (clients == 0)
+	{
+		std::signal(SIGINT, signal_handler);
+		std::signal(SIGTERM, signal_handler);
+		wait_group.wait();
+		server.stop();
+		return 0;
+	}
+
+	std::string value(data_size, 'x');
+	std::stringstream ss(tests);
+	std::string test;
+
+	while (std::getline(ss, test, ','))
+	{
+		if (test != "ping" && test != "set" && test != "get" &&
+			test != "incr" && test != "hset" && test != "mset")
+		{
+			fprintf(stderr, "unknown test %s\n", test.c_str());
+			continue;
+		}
+
+		std::vector<std::thread> threads;
+		std::atomic<long> errors{0};
+		std::atomic<bool> failed{false};
+		size_t per_client = (requests / clients + pipeline - 1) / pipeline * pipeline;
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < clients; i++)
+		{
+			threads.emplace_back([&, i]()
+			{
+				long ret = run_client(port, test, per_client, pipeline, value, keyspace, (unsigned int)i);
+
+				if (ret < 0)
+				{
+					failed = true;
+				}
+				else
+				{
+					errors += ret;
+				}
+			});
+		}
+
+		for (std::thread & t : threads)
+		{
+			t.join();
+		}
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (char & c : test)
+		{
+			c = toupper(c);
+		}
+
+		if (failed)
+		{
+			printf("%s: connection failed\n", test.c_str());
+		}
+		else
+		{
+			printf("%s: %.2f requests per second, %zu requests, %ld errors\n",
+				   test.c_str(), per_client * clients / elapsed,
+				   per_client * clients, errors.load());
+		}
+	}
+
+	printf("keys: %zu\n", server.get_key_count());
+	server.stop();
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <workflow/WFHttpServer.h>
+#include <workflow/WFGlobal.h>
+#include <workflow/WFFacilities.h>
+#include <workflow/HttpUtil.h>
+
+#include "util/args.h"
+
+// Every request holds a compute thread for a fixed time, so the server has
+// a fixed capacity, as if waiting for a pool of backend connections. With a maximal latency, the server limits
+// the requests in process, and answers the others with 503 at once.
+// Requests to /low are of the lower priority class.
+
+static WFFacilities::WaitGroup wait_group{1};
+
+void signal_handler(int)
+{
+	wait_group.done();
+}
+
+static void work(size_t microseconds)
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+}
+
+int main(int argc, char ** argv)
+{
+	size_t pollers = 0;
+	unsigned short port = 0;
+	size_t compute_threads = 0;
+	size_t microseconds = 0;
+	size_t max_latency = 0;
+	size_t n = parse_args(argc, argv, pollers, port, compute_threads, microseconds, max_latency);
+
+	if (n != 4 && n != 5)
+	{
+		fprintf(stderr, "USAGE: %s <pollers> <port> <compute threads> <work us> [max latency ms]\n", argv[0]);
+		return -1;
+	}
+
+	std::signal(SIGINT, signal_handler);
+	std::signal(SIGTERM, signal_handler);
+
+	WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
+	settings.poller_threads = pollers;
+	settings.compute_threads = compute_threads;
+	WORKFLOW_library_init(&settings);
+
+	WFHttpServer server([microseconds](WFHttpTask * task)
+	{
+		task->get_resp()->add_header_pair("Content-Type", "text/plain");
+		task->get_resp()->append_output_body_nocopy("ok", 2);
+		series_of(task)->push_back(WFTaskFactory::create_go_task("work", work, microseconds));
+	});
+
+	if (max_latency > 0)
+	{
+		struct WFConcurrencyLimitParams params = CONCURRENCY_LIMIT_PARAMS_DEFAULT;
+
+		params.priority_classes = 2;
+		params.max_latency = static_cast<int>(max_latency);
+		server.set_concurrency_limit(&params, [](WFHttpTask * task)
+		{
+			protocol::HttpUtil::set_response_status(task->get_resp(), HttpStatusServiceUnavailable);
+		}, [](WFHttpTask * task)
+		{
+			return std::strncmp(task->get_req()->get_request_uri(), "/low", 4) == 0 ? 1 : 0;
+		});
+	}
+
+	if (server.start(port) == 0)
+	{
+		wait_group.wait();
+		server.stop();
+
+		const WFConcurrencyLimiter & limiter = server.get_concurrency_limiter();
+		if (limiter.is_enabled())
+		{
+			printf("limit %d, %zu accepted, %zu rejected\n",
+				   limiter.get_limit(), limiter.get_accepted(), limiter.get_rejected());
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <workflow/UpstreamPolicies.h>
+#include <workflow/URIParser.h>
+
+#include "util/args.h"
+
+// Lookup cost of the consistent hash policies over many upstream addresses
+// with uniform keys, then the spread of requests with skewed (zipf) keys,
+// while a number of requests are kept in process as a client would.
+
+static unsigned int path_hash(const char * path, const char * query, const char * fragment)
+{
+	return std::hash<std::string>()(path);
+}
+
+// Requests in process are counted by the router task of a real client.
+template<class POLICY>
+class Policy : public POLICY
+{
+public:
+	Policy() : POLICY(path_hash) { }
+
+	void hold(EndpointAddress * addr)
+	{
+		addr->inflight++;
+		this->ninflight++;
+	}
+
+	void release(EndpointAddress * addr)
+	{
+		addr->inflight--;
+		this->ninflight--;
+	}
+};
+
+static std::vector<ParsedURI> make_uris(size_t n)
+{
+	std::vector<ParsedURI> uris(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		URIParser::parse("http://upstream/key" + std::to_string(i), uris[i]);
+	}
+
+	return uris;
+}
+
+static std::vector<size_t> uniform_keys(size_t n, size_t range, unsigned int seed)
+{
+	std::mt19937_64 gen(seed);
+	std::vector<size_t> keys(n);
+
+	for (auto & key : keys)
+	{
+		key = gen() % range;
+	}
+
+	return keys;
+}
+
+static std::vector<size_t> zipf_keys(size_t n, size_t range, unsigned int seed)
+{
+	std::mt19937_64 gen(seed);
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	std::vector<double> cdf(range);
+	std::vector<size_t> keys(n);
+	double sum = 0;
+
+	for (size_t i = 0; i < range; i++)
+	{
+		sum += 1.0 / (i + 1);
+		cdf[i] = sum;
+	}
+
+	for (auto & key : keys)
+	{
+		key = std::lower_bound(cdf.begin(), cdf.end(), dist(gen) * sum) - cdf.begin();
+		key = std::min(key, range - 1);
+	}
+
+	return keys;
+}
+
+template<class POLICY>
+static void run(const char * name, size_t servers, const std::vector<ParsedURI> & uris,
+				size_t lookups, size_t inflight)
+{
+	Policy<POLICY> policy;
+	AddressParams params = ADDRESS_PARAMS_DEFAULT;
+	WFNSTracing tracing;
+	EndpointAddress * addr;
+
+	for (size_t i = 0; i < servers; i++)
+	{
+		policy.add_server("10." + std::to_string(i / 250) + "." + std::to_string(i % 250) + ".1:80",
+						  &params);
+	}
+
+	std::vector<size_t> keys = uniform_keys(lookups, uris.size(), 1);
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t key : keys)
+	{
+		if (policy.select(uris[key], &tracing, &addr))
+		{
+			addr->ref--;
+		}
+	}
+
+	std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+	std::map<const EndpointAddress *, size_t> count;
+	std::deque<EndpointAddress *> window;
+
+	for (size_t key : zipf_keys(lookups, uris.size(), 2))
+	{
+		if (!policy.select(uris[key], &tracing, &addr))
+		{
+			continue;
+		}
+
+		addr->ref--;
+		count[addr]++;
+		policy.hold(addr);
+		window.push_back(addr);
+		if (window.size() > inflight)
+		{
+			policy.release(window.front());
+			window.pop_front();
+		}
+	}
+
+	for (EndpointAddress * p : window)
+	{
+		policy.release(p);
+	}
+
+	double mean = (double)lookups / servers;
+	double var = 0;
+	size_t max = 0;
+
+	for (const auto & kv : count)
+	{
+		var += (kv.second - mean) * (kv.second - mean);
+		max = std::max(max, kv.second);
+	}
+
+	var += (servers - count.size()) * mean * mean;
+	printf("%-14s lookup %8.1f ns, zipf load stddev/mean %5.2f, max/mean %6.2f\n",
+		   name, ns.count() / lookups, std::sqrt(var / servers) / mean, max / mean);
+}
+
+int main(int argc, char ** argv)
+{
+	size_t servers = 1000;
+	size_t lookups = 100000;
+	size_t inflight = 1000;
+	parse_args(argc, argv, servers, lookups, inflight);
+
+	if (argc != 1 || servers == 0 || lookups == 0)
+	{
+		fprintf(stderr, "USAGE: %s [servers] [lookups] [inflight]\n", argv[0]);
+		return -1;
+	}
+
+	std::vector<ParsedURI> uris = make_uris(100000);
+
+	run<UPSConsistentHashPolicy>("ring", servers, uris, lookups, inflight);
+	run<UPSJumpHashPolicy>("jump", servers, uris, lookups, inflight);
+	run<UPSBoundedLoadHashPolicy>("bounded load", servers, uris, lookups, inflight);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <workflow/WFAlgoTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Word count of random words, by the reduce task on one thread, and by the
+// parallel reduce of hash partitions on the compute threads.
+
+using Words = algorithm::ReduceInput<std::string, size_t>;
+using Counts = algorithm::ReduceOutput<std::string, size_t>;
+using WordCountTask = WFReduceTask<std::string, size_t>;
+
+static void count_words(const std::string * word, algorithm::ReduceIterator<size_t> * iter, size_t * res)
+{
+	const size_t * count;
+
+	*res = 0;
+	while ((count = iter->next()) != nullptr)
+	{
+		*res += *count;
+	}
+}
+
+static Words random_words(size_t n, size_t distinct)
+{
+	std::mt19937_64 gen(1);
+	Words words;
+
+	words.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		words.emplace_back("word" + std::to_string(gen() % distinct), 1);
+	}
+
+	return words;
+}
+
+static double run(bool parallel, const Words & words, Counts & counts)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	Words input = words;
+	auto callback = [&wait_group, &counts](WordCountTask * task)
+	{
+		counts = std::move(*task->get_output());
+		wait_group.done();
+	};
+	WordCountTask * task;
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (parallel)
+	{
+		task = WFAlgoTaskFactory::create_preduce_task("preduce", std::move(input), count_words, callback);
+	}
+	else
+	{
+		task = WFAlgoTaskFactory::create_reduce_task("reduce", std::move(input), count_words, callback);
+	}
+
+	task->start();
+	wait_group.wait();
+
+	std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+	return ms.count();
+}
+
+int main(int argc, char ** argv)
+{
+	size_t compute_threads = 0;
+	size_t n = 10000000;
+	size_t distinct = 100000;
+	size_t done = parse_args(argc, argv, compute_threads, n, distinct);
+
+	if (done < 1 || argc != 1 || n == 0 || distinct == 0)
+	{
+		fprintf(stderr, "USAGE: %s <compute threads> [words] [distinct words]\n", argv[0]);
+		return -1;
+	}
+
+	WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
+	settings.compute_threads = compute_threads;
+	WORKFLOW_library_init(&settings);
+
+	Words words = random_words(n, distinct);
+	Counts serial;
+	Counts parallel;
+	double serial_ms = run(false, words, serial);
+	double parallel_ms = run(true, words, parallel);
+
+	printf("%zu words, %zu distinct\n", n, serial.size());
+	printf("reduce  %8.0f ms\n", serial_ms);
+	printf("preduce %8.0f ms, %s\n", parallel_ms, parallel == serial ? "same counts" : "COUNTS DIFFER");
+	return parallel == serial ? 0 : -1;
+}
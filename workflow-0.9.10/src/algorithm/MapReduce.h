@@ -60,6 +60,41 @@ public:
 	virtual ~Reducer();
 };
 
+template<typename KEY, typename VAL>
+struct __HashReduceKey;
+
+template<typename VAL>
+struct __HashReduceValue;
+
+/* As Reducer, but keys are grouped by an open addressing table, with their
+ * hash values given, and values are allocated from an arena. KEY must have
+ * operator== besides operator<. The output is in the order of the keys. */
+template<typename KEY, typename VAL>
+class HashReducer
+{
+public:
+	void insert(KEY&& key, VAL&& val, size_t hash);
+
+public:
+	void start(const reduce_function_t<KEY, VAL>& reduce,
+			   std::vector<std::pair<KEY, VAL>> *output);
+
+private:
+	__HashReduceValue<VAL> *alloc_value(VAL&& val);
+	void grow();
+
+private:
+	std::vector<__HashReduceKey<KEY, VAL>> keys;
+	std::vector<size_t> table;
+	std::vector<void *> blocks;
+	char *cur;
+	char *end;
+
+public:
+	HashReducer();
+	virtual ~HashReducer();
+};
+
 }
 
 #include "MapReduce.inl"
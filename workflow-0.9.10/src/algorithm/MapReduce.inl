@@ -17,6 +17,10 @@
 */
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
 #include <utility>
 #include <vector>
 #include <type_traits>
@@ -375,5 +379,321 @@ Reducer<KEY, VAL>::~Reducer()
 	}
 }
 
+template<typename VAL>
+struct __HashReduceValue
+{
+	__HashReduceValue<VAL> *next;
+	VAL value;
+	__HashReduceValue(VAL&& val) : next(NULL), value(std::move(val)) { }
+};
+
+template<typename KEY, typename VAL>
+struct __HashReduceKey
+{
+	KEY key;
+	size_t hash;
+	__HashReduceValue<VAL> *first;
+	__HashReduceValue<VAL> *last;
+
+	__HashReduceKey(KEY&& k, size_t h) : key(std::move(k))
+	{
+		this->hash = h;
+		this->first = NULL;
+		this->last = NULL;
+	}
+};
+
+template<typename VAL, bool = std::is_class<VAL>::value>
+class __HashReduceIterator;
+
+#define __HASH_REDUCE_HEAP_MAX		256
+
+/* VAL is a class. The smallest values first, at most __HASH_REDUCE_HEAP_MAX
+ * values at a time, as __ReduceIterator. */
+template<typename VAL>
+class __HashReduceIterator<VAL, true> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next()
+	{
+		if (this->heap_size == 0)
+			return NULL;
+
+		std::pop_heap(this->values->begin(),
+					  this->values->begin() + this->heap_size,
+					  __HashReduceIterator::greater);
+		return &(*this->values)[--this->heap_size]->value;
+	}
+
+	virtual size_t size() { return this->original_size; }
+
+private:
+	static bool greater(__HashReduceValue<VAL> *a, __HashReduceValue<VAL> *b)
+	{
+		return b->value.size() < a->value.size();
+	}
+
+	void reduce_begin() { this->original_size = this->heap_size; }
+
+	void reduce_end(VAL&& value)
+	{
+		std::vector<__HashReduceValue<VAL> *>& values = *this->values;
+		size_t n = this->original_size;
+
+		assert(n != this->heap_size);
+		while (--n != this->heap_size)
+			values[n]->value.~VAL();
+
+		values[n]->value = std::move(value);
+		values.resize(++this->heap_size);
+		std::push_heap(values.begin(), values.end(),
+					   __HashReduceIterator::greater);
+	}
+
+	size_t count() { return this->heap_size; }
+
+	__HashReduceValue<VAL> *value() { return (*this->values)[0]; }
+
+private:
+	std::vector<__HashReduceValue<VAL> *> *values;
+	size_t heap_size;
+	size_t original_size;
+
+private:
+	__HashReduceIterator(__HashReduceValue<VAL> **first,
+						 std::vector<__HashReduceValue<VAL> *> *values)
+	{
+		__HashReduceValue<VAL> *value = *first;
+
+		values->clear();
+		while (value && values->size() < __HASH_REDUCE_HEAP_MAX)
+		{
+			values->push_back(value);
+			value = value->next;
+		}
+
+		*first = value;
+		this->values = values;
+		this->heap_size = values->size();
+		std::make_heap(values->begin(), values->end(),
+					   __HashReduceIterator::greater);
+	}
+
+	template<class, class> friend class HashReducer;
+};
+
+/* VAL is not a class. All values in order, the result last. */
+template<typename VAL>
+class __HashReduceIterator<VAL, false> : public ReduceIterator<VAL>
+{
+public:
+	virtual const VAL *next()
+	{
+		if (this->cursor == this->values->size())
+			return NULL;
+
+		return &(*this->values)[this->cursor++]->value;
+	}
+
+	virtual size_t size() { return this->original_size; }
+
+private:
+	void reduce_begin()
+	{
+		this->cursor = this->begin;
+		this->original_size = this->values->size() - this->begin;
+	}
+
+	void reduce_end(VAL&& value)
+	{
+		assert(this->cursor != this->begin);
+		(*this->values)[this->cursor - 1]->value = std::move(value);
+		this->values->push_back((*this->values)[this->cursor - 1]);
+		this->begin = this->cursor;
+	}
+
+	size_t count() { return this->values->size() - this->begin; }
+
+	__HashReduceValue<VAL> *value() { return this->values->back(); }
+
+private:
+	std::vector<__HashReduceValue<VAL> *> *values;
+	size_t begin;
+	size_t cursor;
+	size_t original_size;
+
+private:
+	__HashReduceIterator(__HashReduceValue<VAL> **first,
+						 std::vector<__HashReduceValue<VAL> *> *values)
+	{
+		values->clear();
+		for (; *first; *first = (*first)->next)
+			values->push_back(*first);
+
+		this->values = values;
+		this->begin = 0;
+	}
+
+	template<class, class> friend class HashReducer;
+};
+
+#undef __HASH_REDUCE_HEAP_MAX
+
+#define __HASH_REDUCE_TABLE_MIN		64
+#define __HASH_REDUCE_BLOCK_SIZE	(64 * 1024)
+
+template<typename KEY, typename VAL>
+HashReducer<KEY, VAL>::HashReducer() :
+	table(__HASH_REDUCE_TABLE_MIN, 0)
+{
+	this->cur = NULL;
+	this->end = NULL;
+}
+
+template<typename KEY, typename VAL>
+__HashReduceValue<VAL> *HashReducer<KEY, VAL>::alloc_value(VAL&& val)
+{
+	using VALUE = __HashReduceValue<VAL>;
+	size_t align = alignof (VALUE);
+	size_t size = (sizeof (VALUE) + align - 1) / align * align;
+	char *p = (char *)(((uintptr_t)this->cur + align - 1) / align * align);
+
+	if (!this->cur || p + size > this->end)
+	{
+		size_t block_size = std::max<size_t>(__HASH_REDUCE_BLOCK_SIZE, size);
+
+		p = (char *)malloc(block_size);
+		if (!p)
+			abort();
+
+		this->blocks.push_back(p);
+		this->end = p + block_size;
+	}
+
+	this->cur = p + size;
+	return new(p) VALUE(std::move(val));
+}
+
+/* Tables of 2^n slots, of indexes + 1 in 'keys', no more than half full. */
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::grow()
+{
+	size_t mask = this->table.size() * 2 - 1;
+	size_t i;
+
+	this->table.assign(mask + 1, 0);
+	for (size_t n = 0; n < this->keys.size(); n++)
+	{
+		i = this->keys[n].hash & mask;
+		while (this->table[i])
+			i = (i + 1) & mask;
+
+		this->table[i] = n + 1;
+	}
+}
+
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::insert(KEY&& key, VAL&& val, size_t hash)
+{
+	__HashReduceValue<VAL> *value = this->alloc_value(std::move(val));
+	__HashReduceKey<KEY, VAL> *entry;
+	size_t mask;
+	size_t i;
+
+	if (this->keys.size() * 2 >= this->table.size())
+		this->grow();
+
+	mask = this->table.size() - 1;
+	i = hash & mask;
+	while (this->table[i])
+	{
+		entry = &this->keys[this->table[i] - 1];
+		if (entry->hash == hash && entry->key == key)
+		{
+			entry->last->next = value;
+			entry->last = value;
+			return;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	this->keys.emplace_back(std::move(key), hash);
+	this->table[i] = this->keys.size();
+	entry = &this->keys.back();
+	entry->first = value;
+	entry->last = value;
 }
 
+template<typename KEY, typename VAL>
+void HashReducer<KEY, VAL>::start(const reduce_function_t<KEY, VAL>& reduce,
+								  std::vector<std::pair<KEY, VAL>> *result)
+{
+	std::vector<__HashReduceValue<VAL> *> values;
+	__HashReduceValue<VAL> *value;
+
+	/* Free the table, and leave a small one for the next inserts. */
+	std::vector<size_t>(__HASH_REDUCE_TABLE_MIN, 0).swap(this->table);
+	std::sort(this->keys.begin(), this->keys.end(),
+			  [](const __HashReduceKey<KEY, VAL>& a,
+				 const __HashReduceKey<KEY, VAL>& b) {
+				return a.key < b.key;
+			  });
+
+	result->reserve(result->size() + this->keys.size());
+	for (__HashReduceKey<KEY, VAL>& key : this->keys)
+	{
+		while (key.first->next)
+		{
+			__HashReduceIterator<VAL> iter(&key.first, &values);
+
+			do
+			{
+				VAL tmp;
+				iter.reduce_begin();
+				reduce(&key.key, &iter, &tmp);
+				iter.reduce_end(std::move(tmp));
+			} while (iter.count() > 1);
+
+			value = iter.value();
+			value->next = NULL;
+			if (key.first)
+				key.last->next = value;
+			else
+				key.first = value;
+
+			key.last = value;
+		}
+
+		value = key.first;
+		result->emplace_back(std::move(key.key), std::move(value->value));
+		value->value.~VAL();
+		key.first = NULL;
+	}
+
+	this->keys.clear();
+}
+
+template<typename KEY, typename VAL>
+HashReducer<KEY, VAL>::~HashReducer()
+{
+	__HashReduceValue<VAL> *value;
+	__HashReduceValue<VAL> *next;
+
+	for (__HashReduceKey<KEY, VAL>& key : this->keys)
+	{
+		for (value = key.first; value; value = next)
+		{
+			next = value->next;
+			value->value.~VAL();
+		}
+	}
+
+	for (void *block : this->blocks)
+		free(block);
+}
+
+#undef __HASH_REDUCE_BLOCK_SIZE
+#undef __HASH_REDUCE_TABLE_MIN
+
+}
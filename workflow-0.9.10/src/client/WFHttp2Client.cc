@@ -0,0 +1,318 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include "WFGlobal.h"
+#include "URIParser.h"
+#include "HttpUtil.h"
+#include "WFHttp2Client.h"
+
+#define HTTP2_KEEPALIVE_DEFAULT	(60 * 1000)
+
+/* Times a stream is queued again before it fails. */
+#define HTTP2_REFUSED_MAX		8
+
+using namespace protocol;
+
+class __WFHttp2ClientTask;
+
+struct __Http2ClientQueue
+{
+	std::deque<__WFHttp2ClientTask *> tasks;
+	int inflight;
+};
+
+class __WFHttp2ClientTask : public WFClientTask<Http2Request, Http2Response>
+{
+public:
+	__WFHttp2ClientTask(WFHttp2Client *client, const std::string& url,
+						int retry_max, http2_callback_t&& callback);
+
+protected:
+	virtual void dispatch();
+
+private:
+	void finish(int state, int error, int timeout_reason);
+
+	static std::vector<__WFHttp2ClientTask *>
+	take_batch(__Http2ClientQueue *queue, size_t max_streams);
+	static void start_batch(WFHttp2Client *client, const std::string& key,
+							std::vector<__WFHttp2ClientTask *>&& tasks);
+	static void batch_done(WFHttp2Task *task, WFHttp2Client *client,
+						   const std::string& key,
+						   const std::vector<__WFHttp2ClientTask *>& tasks);
+
+private:
+	WFHttp2Client *client;
+	ParsedURI uri;
+	std::string key;
+	int retry_max;
+	int refused;
+};
+
+/* Request line and Host as a task of WFTaskFactory::create_http2_task()
+ * has them, and the server of the url, which tasks share connections to. */
+__WFHttp2ClientTask::__WFHttp2ClientTask(WFHttp2Client *client,
+										 const std::string& url,
+										 int retry_max,
+										 http2_callback_t&& callback) :
+	WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback))
+{
+	std::string request_uri;
+	std::string header_host;
+	bool https;
+
+	this->keep_alive_timeo = HTTP2_KEEPALIVE_DEFAULT;
+	this->client = client;
+	this->retry_max = retry_max;
+	this->refused = 0;
+	this->req.set_method(HttpMethodGet);
+	this->req.set_http_version("HTTP/2");
+	if (URIParser::parse(url, this->uri) < 0 || !this->uri.scheme ||
+		!this->uri.host)
+	{
+		this->key = url;
+		return;
+	}
+
+	https = (strcasecmp(this->uri.scheme, "https") == 0);
+	if (this->uri.path && this->uri.path[0])
+		request_uri = this->uri.path;
+	else
+		request_uri = "/";
+
+	if (this->uri.query && this->uri.query[0])
+	{
+		request_uri += "?";
+		request_uri += this->uri.query;
+	}
+
+	header_host = this->uri.host;
+	if (this->uri.port && this->uri.port[0] &&
+		atoi(this->uri.port) != (https ? 443 : 80))
+	{
+		header_host += ":";
+		header_host += this->uri.port;
+	}
+
+	this->req.set_request_uri(request_uri);
+	this->req.set_header_pair("Host", header_host);
+	this->key = this->uri.scheme;
+	this->key += "://";
+	this->key += header_host;
+}
+
+void __WFHttp2ClientTask::finish(int state, int error, int timeout_reason)
+{
+	this->state = state;
+	this->error = error;
+	this->timeout_reason = timeout_reason;
+	this->subtask_done();
+}
+
+void __WFHttp2ClientTask::dispatch()
+{
+	WFHttp2Client *client = this->client;
+	std::vector<__WFHttp2ClientTask *> tasks;
+	__Http2ClientQueue *queue;
+
+	client->requests++;
+	std::unique_lock<std::mutex> lock(client->mutex);
+	auto it = client->queues.find(this->key);
+
+	if (it != client->queues.end())
+		queue = it->second;
+	else
+	{
+		queue = new __Http2ClientQueue;
+		queue->inflight = 0;
+		client->queues.emplace(this->key, queue);
+	}
+
+	queue->tasks.push_back(this);
+	if (queue->inflight < client->max_inflight)
+	{
+		tasks = take_batch(queue, client->max_streams);
+		queue->inflight++;
+	}
+
+	lock.unlock();
+	if (!tasks.empty())
+		start_batch(client, this->key, std::move(tasks));
+}
+
+/* The first task waiting, and others sent with the same timeouts and
+ * retry_max, in order. */
+std::vector<__WFHttp2ClientTask *>
+__WFHttp2ClientTask::take_batch(__Http2ClientQueue *queue, size_t max_streams)
+{
+	std::vector<__WFHttp2ClientTask *> tasks;
+	__WFHttp2ClientTask *first = queue->tasks.front();
+	auto it = queue->tasks.begin();
+
+	while (it != queue->tasks.end() && tasks.size() < max_streams)
+	{
+		__WFHttp2ClientTask *task = *it;
+
+		if (task->send_timeo == first->send_timeo &&
+			task->receive_timeo == first->receive_timeo &&
+			task->keep_alive_timeo == first->keep_alive_timeo &&
+			task->retry_max == first->retry_max)
+		{
+			tasks.push_back(task);
+			it = queue->tasks.erase(it);
+		}
+		else
+			++it;
+	}
+
+	return tasks;
+}
+
+/* The first task's request is the one sent, with the others' added. They
+ * all have its timeouts. */
+void __WFHttp2ClientTask::start_batch(WFHttp2Client *client,
+								const std::string& key,
+								std::vector<__WFHttp2ClientTask *>&& tasks)
+{
+	__WFHttp2ClientTask *first = tasks[0];
+	WFHttp2Task *task;
+	size_t i;
+
+	client->batches++;
+	client->streams += tasks.size();
+	task = WFTaskFactory::create_http2_task(first->uri, first->retry_max,
+		[client, key, tasks](WFHttp2Task *task) {
+		__WFHttp2ClientTask::batch_done(task, client, key, tasks);
+	});
+
+	*task->get_req() = std::move(first->req);
+	task->get_req()->clear_streams();
+	for (i = 1; i < tasks.size(); i++)
+		task->get_req()->add_stream(&tasks[i]->req, &tasks[i]->resp);
+
+	task->set_send_timeout(first->send_timeo);
+	task->set_receive_timeout(first->receive_timeo);
+	task->set_keep_alive(first->keep_alive_timeo);
+	task->start();
+}
+
+void __WFHttp2ClientTask::batch_done(WFHttp2Task *task, WFHttp2Client *client,
+						const std::string& key,
+						const std::vector<__WFHttp2ClientTask *>& tasks)
+{
+	int state = task->get_state();
+	int error = task->get_error();
+	int timeout_reason = task->get_timeout_reason();
+	std::vector<__WFHttp2ClientTask *> refused;
+	std::vector<__WFHttp2ClientTask *> next;
+	std::vector<bool> queued(tasks.size());
+	__Http2ClientQueue *queue;
+	size_t i;
+
+	tasks[0]->req = std::move(*task->get_req());
+	tasks[0]->resp = std::move(*task->get_resp());
+	for (i = 0; i < tasks.size() && state == WFT_STATE_SUCCESS; i++)
+	{
+		if (tasks[i]->resp.is_refused() &&
+			tasks[i]->refused++ < HTTP2_REFUSED_MAX)
+		{
+			refused.push_back(tasks[i]);
+			queued[i] = true;
+		}
+	}
+
+	/* Send the refused tasks and those that waited for this request before
+	 * running callbacks, which may start more tasks. */
+	{
+		std::lock_guard<std::mutex> lock(client->mutex);
+
+		queue = client->queues[key];
+		queue->tasks.insert(queue->tasks.begin(), refused.begin(),
+							refused.end());
+		if (!queue->tasks.empty())
+			next = take_batch(queue, client->max_streams);
+		else if (--queue->inflight == 0)
+		{
+			client->queues.erase(key);
+			delete queue;
+		}
+	}
+
+	client->refused += refused.size();
+	if (!next.empty())
+		start_batch(client, key, std::move(next));
+
+	for (i = 0; i < tasks.size(); i++)
+	{
+		if (queued[i])
+			continue;
+
+		if (state != WFT_STATE_SUCCESS)
+			tasks[i]->finish(state, error, timeout_reason);
+		else if (tasks[i]->resp.is_reset())
+			tasks[i]->finish(WFT_STATE_SYS_ERROR, ECONNRESET, TOR_NOT_TIMEOUT);
+		else
+			tasks[i]->finish(WFT_STATE_SUCCESS, 0, TOR_NOT_TIMEOUT);
+	}
+}
+
+int WFHttp2Client::init(size_t max_streams, int max_inflight)
+{
+	if (max_streams == 0 || max_inflight <= 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	this->max_streams = max_streams;
+	this->max_inflight = max_inflight;
+	return 0;
+}
+
+void WFHttp2Client::deinit()
+{
+	for (auto& kv : this->queues)
+		delete kv.second;
+
+	this->queues.clear();
+}
+
+WFHttp2Task *WFHttp2Client::create_http2_task(const std::string& url,
+											  int retry_max,
+											  http2_callback_t callback)
+{
+	return new __WFHttp2ClientTask(this, url, retry_max, std::move(callback));
+}
+
+WFHttp2ClientStats WFHttp2Client::get_stats() const
+{
+	WFHttp2ClientStats stats;
+
+	stats.requests = this->requests;
+	stats.batches = this->batches;
+	stats.streams = this->streams;
+	stats.refused = this->refused;
+	return stats;
+}
+
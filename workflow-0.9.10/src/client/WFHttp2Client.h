@@ -0,0 +1,89 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFHTTP2CLIENT_H_
+#define _WFHTTP2CLIENT_H_
+
+#include <stddef.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "WFTaskFactory.h"
+
+/**
+ * @file   WFHttp2Client.h
+ * @brief  HTTP/2 client multiplexing concurrent tasks
+ */
+
+/* Tasks started for a server while 'max_inflight' requests to it are in
+ * flight wait in a queue. When one of those returns, the waiting tasks are
+ * sent together as the streams of the next request, of at most
+ * 'max_streams' streams, and each task gets the response of its stream.
+ * So many concurrent tasks share a few connections.
+ *
+ * Only tasks with the same timeouts and retry_max share a request, so each
+ * task is sent with its own. A request completes when all of its streams
+ * have, so its tasks wait for the slowest one; 'max_streams' bounds that.
+ * Streams over the server's SETTINGS_MAX_CONCURRENT_STREAMS, or refused by
+ * it, are queued again. A stream reset otherwise fails with ECONNRESET.
+ * A multiplexed task has no connection and no peer address. */
+
+struct WFHttp2ClientStats
+{
+	size_t requests;	/* tasks started */
+	size_t batches;		/* requests sent */
+	size_t streams;		/* streams in requests */
+	size_t refused;		/* streams queued again */
+};
+
+struct __Http2ClientQueue;
+
+class WFHttp2Client
+{
+public:
+	/* max_streams: streams of one request.
+	 * max_inflight: requests in flight for each server. */
+	int init(size_t max_streams, int max_inflight);
+	void deinit();
+
+	WFHttp2Task *create_http2_task(const std::string& url,
+								   int retry_max,
+								   http2_callback_t callback);
+
+public:
+	WFHttp2ClientStats get_stats() const;
+
+public:
+	WFHttp2Client() : max_streams(0), max_inflight(0) { }
+	virtual ~WFHttp2Client() { }
+
+private:
+	size_t max_streams;
+	int max_inflight;
+	std::mutex mutex;
+	std::unordered_map<std::string, __Http2ClientQueue *> queues;
+
+	std::atomic<size_t> requests{0};
+	std::atomic<size_t> batches{0};
+	std::atomic<size_t> streams{0};
+	std::atomic<size_t> refused{0};
+
+	friend class __WFHttp2ClientTask;
+};
+
+#endif
+
@@ -0,0 +1,599 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <utility>
+#include "WFGlobal.h"
+#include "HttpUtil.h"
+#include "StringUtil.h"
+#include "URIParser.h"
+#include "WFHttpCacheClient.h"
+
+#define HTTP_KEEPALIVE_DEFAULT	(60 * 1000)
+#define HTTP_CACHE_HIT_DEPTH_MAX	64
+#define HTTP_CACHE_QUEUE_NAME		"__http_cache"
+#define HTTP_CACHE_MAX_AGE_MAX		(365 * 24 * 3600)
+#define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+using namespace protocol;
+
+struct __HttpCacheEntry
+{
+	std::string raw;
+	std::string etag;
+	std::string last_modified;
+	int64_t max_age;
+	std::atomic<int64_t> expire_time;
+};
+
+class __WFHttpCacheTask;
+
+struct __HttpCacheFlight
+{
+	std::vector<__WFHttpCacheTask *> tasks;
+	const HashLRUHandle<std::string, __HttpCacheEntry *> *stale;
+};
+
+void WFHttpCacheClient::EntryDeleter::operator() (__HttpCacheEntry *entry) const
+{
+	delete entry;
+}
+
+/* Reads a whole response from memory, as if it came from the network. */
+class __RawResponse : public HttpResponse
+{
+public:
+	bool load(const std::string& raw)
+	{
+		size_t size = raw.size();
+
+		return this->append(raw.data(), &size) > 0;
+	}
+};
+
+static bool __has_token(const std::string& list, const char *token)
+{
+	for (const auto& s : StringUtil::split(list, ','))
+	{
+		if (strcasecmp(StringUtil::strip(s).c_str(), token) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* Seconds of a delta-seconds value, clamped to [0, HTTP_CACHE_MAX_AGE_MAX]. */
+static int64_t __parse_seconds(const char *p)
+{
+	long long n = strtoll(p, NULL, 10);
+
+	if (n < 0)
+		return 0;
+
+	return n < HTTP_CACHE_MAX_AGE_MAX ? n : HTTP_CACHE_MAX_AGE_MAX;
+}
+
+/* An IMF-fixdate, as seconds since the epoch, or -1. */
+static int64_t __parse_http_date(const std::string& date)
+{
+	struct tm tm = { };
+	const char *end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+	if (!end || *end != '\0')
+		return -1;
+
+	return timegm(&tm);
+}
+
+/* Returns false if the response must not be stored in a shared cache.
+ * Otherwise 'max_age' is the freshness lifetime in seconds, from
+ * 's-maxage', 'max-age' or 'Expires' in that order, or -1 if none. */
+static bool __parse_cache_control(const HttpResponse *resp, int64_t& max_age)
+{
+	HttpHeaderCursor cursor(resp);
+	std::string name;
+	std::string value;
+	std::string expires;
+	std::string date;
+	int64_t s_maxage = -1;
+	int64_t t;
+	bool no_cache = false;
+
+	max_age = -1;
+	while (cursor.next(name, value))
+	{
+		if (strcasecmp(name.c_str(), "Vary") == 0)
+		{
+			/* The key holds every request header, any other Vary is met. */
+			if (StringUtil::strip(value) == "*")
+				return false;
+		}
+		else if (strcasecmp(name.c_str(), "Cache-Control") == 0)
+		{
+			for (const auto& s : StringUtil::split(value, ','))
+			{
+				std::string directive = StringUtil::strip(s);
+				const char *p = directive.c_str();
+
+				if (strcasecmp(p, "no-store") == 0 ||
+					strncasecmp(p, "private", 7) == 0)
+					return false;
+				else if (strcasecmp(p, "no-cache") == 0)
+					no_cache = true;
+				else if (strncasecmp(p, "s-maxage=", 9) == 0)
+					s_maxage = __parse_seconds(p + 9);
+				else if (strncasecmp(p, "max-age=", 8) == 0)
+					max_age = __parse_seconds(p + 8);
+			}
+		}
+		else if (strcasecmp(name.c_str(), "Expires") == 0)
+			expires = StringUtil::strip(value);
+		else if (strcasecmp(name.c_str(), "Date") == 0)
+			date = StringUtil::strip(value);
+	}
+
+	if (no_cache)
+		max_age = 0;
+	else if (s_maxage >= 0)
+		max_age = s_maxage;
+	else if (max_age < 0 && !expires.empty())
+	{
+		/* Relative to the server's Date, so clocks need not agree. An
+		 * invalid Expires means already expired. */
+		t = __parse_http_date(date);
+		if (t < 0)
+			t = time(NULL);
+
+		max_age = __parse_http_date(expires);
+		if (max_age >= 0)
+		{
+			max_age -= t;
+			if (max_age > HTTP_CACHE_MAX_AGE_MAX)
+				max_age = HTTP_CACHE_MAX_AGE_MAX;
+		}
+
+		if (max_age < 0)
+			max_age = 0;
+	}
+
+	return true;
+}
+
+/* Status line, headers and a Content-Length framed body. */
+static std::string __serialize_response(const HttpResponse *resp)
+{
+	HttpHeaderCursor cursor(resp);
+	std::string name;
+	std::string value;
+	std::string body;
+	const void *ptr;
+	size_t len;
+	std::string raw;
+
+	if (resp->is_chunked())
+		body = HttpUtil::decode_chunked_body(resp);
+	else if (resp->get_parsed_body(&ptr, &len))
+		body.assign((const char *)ptr, len);
+
+	raw.reserve(256 + body.size());
+	raw += resp->get_http_version();
+	raw += ' ';
+	raw += resp->get_status_code();
+	raw += ' ';
+	raw += resp->get_reason_phrase();
+	raw += "\r\n";
+	while (cursor.next(name, value))
+	{
+		if (strcasecmp(name.c_str(), "Content-Length") == 0 ||
+			strcasecmp(name.c_str(), "Transfer-Encoding") == 0 ||
+			strcasecmp(name.c_str(), "Connection") == 0 ||
+			strcasecmp(name.c_str(), "Keep-Alive") == 0)
+			continue;
+
+		raw += name;
+		raw += ": ";
+		raw += value;
+		raw += "\r\n";
+	}
+
+	raw += "Content-Length: ";
+	raw += std::to_string(body.size());
+	raw += "\r\n\r\n";
+	raw += body;
+	return raw;
+}
+
+class __WFHttpCacheTask : public WFClientTask<HttpRequest, HttpResponse>
+{
+public:
+	__WFHttpCacheTask(WFHttpCacheClient *client, const std::string& url,
+					  int redirect_max, int retry_max,
+					  http_callback_t&& callback);
+
+protected:
+	virtual void dispatch();
+
+private:
+	bool cacheable();
+	std::string cache_key();
+	WFHttpTask *create_upstream_task(http_callback_t&& callback);
+	void finish(int state, int error, int timeout_reason);
+	void finish_hit();
+
+	static void flight_done(WFHttpTask *task, WFHttpCacheClient *client,
+							const std::string& key);
+
+private:
+	WFHttpCacheClient *client;
+	std::string url;
+	int redirect_max;
+	int retry_max;
+};
+
+/* The request a task of WFTaskFactory::create_http_task() starts with. The
+ * upstream task is created only when the request is sent. */
+__WFHttpCacheTask::__WFHttpCacheTask(WFHttpCacheClient *client,
+									 const std::string& url,
+									 int redirect_max, int retry_max,
+									 http_callback_t&& callback) :
+	WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback)),
+	url(url)
+{
+	std::string request_uri = "/";
+	std::string header_host;
+	ParsedURI uri;
+
+	this->keep_alive_timeo = HTTP_KEEPALIVE_DEFAULT;
+	this->client = client;
+	this->redirect_max = redirect_max;
+	this->retry_max = retry_max;
+	this->req.set_method(HttpMethodGet);
+	this->req.set_http_version("HTTP/1.1");
+	if (URIParser::parse(url, uri) >= 0 && uri.scheme)
+	{
+		bool https = (strcasecmp(uri.scheme, "https") == 0);
+
+		if (uri.path && uri.path[0])
+			request_uri = uri.path;
+
+		if (uri.query && uri.query[0])
+		{
+			request_uri += "?";
+			request_uri += uri.query;
+		}
+
+		if (uri.host && uri.host[0])
+		{
+			header_host = uri.host;
+			if (uri.host[0] != '/' && uri.port && uri.port[0] &&
+				atoi(uri.port) != (https ? 443 : 80))
+			{
+				header_host += ":";
+				header_host += uri.port;
+			}
+		}
+	}
+
+	this->req.set_request_uri(request_uri);
+	this->req.set_header_pair("Host", header_host);
+}
+
+bool __WFHttpCacheTask::cacheable()
+{
+	HttpHeaderCursor cursor(&this->req);
+	std::string name;
+	std::string value;
+
+	if (strcmp(this->req.get_method(), HttpMethodGet) != 0)
+		return false;
+
+	while (cursor.next(name, value))
+	{
+		if (strcasecmp(name.c_str(), "Range") == 0 ||
+			strncasecmp(name.c_str(), "If-", 3) == 0)
+			return false;
+
+		if (strcasecmp(name.c_str(), "Cache-Control") == 0 &&
+			(__has_token(value, "no-store") || __has_token(value, "no-cache")))
+			return false;
+	}
+
+	return true;
+}
+
+std::string __WFHttpCacheTask::cache_key()
+{
+	HttpHeaderCursor cursor(&this->req);
+	std::string name;
+	std::string value;
+	std::string key = this->url;
+
+	key += "\r\n";
+	while (cursor.next(name, value))
+	{
+		key += name;
+		key += ": ";
+		key += value;
+		key += "\r\n";
+	}
+
+	return key;
+}
+
+WFHttpTask *__WFHttpCacheTask::create_upstream_task(http_callback_t&& callback)
+{
+	WFHttpTask *task = WFTaskFactory::create_http_task(this->url,
+													   this->redirect_max,
+													   this->retry_max,
+													   std::move(callback));
+
+	*task->get_req() = std::move(this->req);
+	task->set_send_timeout(this->send_timeo);
+	task->set_receive_timeout(this->receive_timeo);
+	task->set_keep_alive(this->keep_alive_timeo);
+	if (this->prepare)
+		static_cast<WFClientTask *>(task)->set_prepare(std::move(this->prepare));
+
+	return task;
+}
+
+void __WFHttpCacheTask::finish(int state, int error, int timeout_reason)
+{
+	this->state = state;
+	this->error = error;
+	this->timeout_reason = timeout_reason;
+	this->subtask_done();
+}
+
+/* A hit completes inside dispatch(), and the next task of the series is
+ * dispatched before it returns. Long runs of hits would grow the stack
+ * without bound, so past a depth the rest is handed to a compute thread. */
+static thread_local int __hit_depth;
+
+void __WFHttpCacheTask::finish_hit()
+{
+	if (__hit_depth < HTTP_CACHE_HIT_DEPTH_MAX)
+	{
+		__hit_depth++;
+		this->finish(WFT_STATE_SUCCESS, 0, TOR_NOT_TIMEOUT);
+		__hit_depth--;
+	}
+	else
+	{
+		WFTaskFactory::create_go_task(HTTP_CACHE_QUEUE_NAME, [this]() {
+			this->finish(WFT_STATE_SUCCESS, 0, TOR_NOT_TIMEOUT);
+		})->start();
+	}
+}
+
+void __WFHttpCacheTask::dispatch()
+{
+	WFHttpCacheClient *client = this->client;
+	WFHttpTask *task;
+
+	client->requests++;
+	if (!this->cacheable())
+	{
+		client->bypassed++;
+		client->upstream++;
+		task = this->create_upstream_task([this](WFHttpTask *task) {
+			this->resp = std::move(*task->get_resp());
+			this->finish(task->get_state(), task->get_error(),
+						 task->get_timeout_reason());
+		});
+		task->start();
+		return;
+	}
+
+	std::string key = this->cache_key();
+	const WFHttpCacheClient::Cache::Handle *handle = client->cache.get(key);
+
+	if (handle)
+	{
+		__HttpCacheEntry *entry = handle->value;
+
+		if (GET_CURRENT_SECOND < entry->expire_time.load())
+		{
+			__RawResponse resp;
+
+			resp.load(entry->raw);
+			client->cache.release(handle);
+			client->hits++;
+			this->resp = std::move(resp);
+			this->finish_hit();
+			return;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(client->mutex);
+	auto it = client->flights.find(key);
+
+	if (it != client->flights.end())
+	{
+		it->second->tasks.push_back(this);
+		lock.unlock();
+		client->coalesced++;
+		if (handle)
+			client->cache.release(handle);
+
+		return;
+	}
+
+	__HttpCacheFlight *flight = new __HttpCacheFlight;
+
+	flight->tasks.push_back(this);
+	flight->stale = NULL;
+	client->flights.emplace(key, flight);
+	lock.unlock();
+
+	if (handle)
+	{
+		__HttpCacheEntry *entry = handle->value;
+
+		if (!entry->etag.empty())
+			this->req.add_header_pair("If-None-Match", entry->etag);
+
+		if (!entry->last_modified.empty())
+			this->req.add_header_pair("If-Modified-Since", entry->last_modified);
+
+		if (entry->etag.empty() && entry->last_modified.empty())
+			client->cache.release(handle);
+		else
+			flight->stale = handle;
+	}
+
+	client->upstream++;
+	task = this->create_upstream_task([client, key](WFHttpTask *task) {
+		__WFHttpCacheTask::flight_done(task, client, key);
+	});
+	task->start();
+}
+
+void __WFHttpCacheTask::flight_done(WFHttpTask *task, WFHttpCacheClient *client,
+									const std::string& key)
+{
+	HttpResponse *resp = task->get_resp();
+	int state = task->get_state();
+	int error = task->get_error();
+	int timeout_reason = task->get_timeout_reason();
+	__HttpCacheFlight *flight;
+	bool revalidated = false;
+	std::string raw;
+	int64_t max_age;
+
+	/* The flight is still registered, so no new request for this key
+	 * is sent until the cache is updated. */
+	{
+		std::lock_guard<std::mutex> lock(client->mutex);
+		flight = client->flights[key];
+	}
+
+	if (state == WFT_STATE_SUCCESS)
+	{
+		const char *code = resp->get_status_code();
+
+		if (flight->stale && strcmp(code, "304") == 0)
+		{
+			__HttpCacheEntry *entry = flight->stale->value;
+
+			if (!__parse_cache_control(resp, max_age) || max_age < 0)
+				max_age = entry->max_age;
+
+			entry->expire_time = GET_CURRENT_SECOND + max_age;
+			raw = entry->raw;
+			revalidated = true;
+			client->revalidated++;
+		}
+		else if (strcmp(code, "200") == 0 && __parse_cache_control(resp, max_age))
+		{
+			HttpHeaderCursor cursor(resp);
+			std::string etag;
+			std::string last_modified;
+
+			cursor.find("ETag", etag);
+			cursor.rewind();
+			cursor.find("Last-Modified", last_modified);
+			/* Without a lifetime, keep it only if it can be revalidated. */
+			if (max_age <= 0 && etag.empty() && last_modified.empty())
+				max_age = -1;
+			else
+			{
+				__HttpCacheEntry *entry = new __HttpCacheEntry;
+
+				raw = __serialize_response(resp);
+				entry->raw = raw;
+				entry->etag = std::move(etag);
+				entry->last_modified = std::move(last_modified);
+				entry->max_age = max_age < 0 ? 0 : max_age;
+				entry->expire_time = GET_CURRENT_SECOND + entry->max_age;
+				client->cache.release(client->cache.put(key, entry,
+														raw.size() + key.size()));
+			}
+		}
+	}
+
+	/* No task can join the flight after this. */
+	{
+		std::lock_guard<std::mutex> lock(client->mutex);
+		client->flights.erase(key);
+	}
+
+	if (flight->stale)
+		client->cache.release(flight->stale);
+
+	if (state == WFT_STATE_SUCCESS && raw.empty() && flight->tasks.size() > 1)
+		raw = __serialize_response(resp);
+
+	for (__WFHttpCacheTask *t : flight->tasks)
+	{
+		if (t == flight->tasks[0] && !revalidated)
+			t->resp = std::move(*resp);
+		else if (state == WFT_STATE_SUCCESS)
+		{
+			__RawResponse r;
+
+			r.load(raw);
+			t->resp = std::move(r);
+		}
+
+		t->finish(state, error, timeout_reason);
+	}
+
+	delete flight;
+}
+
+int WFHttpCacheClient::init(size_t max_memory)
+{
+	this->cache.set_max_memory(max_memory);
+	return 0;
+}
+
+void WFHttpCacheClient::deinit()
+{
+	this->cache.prune();
+}
+
+WFHttpTask *WFHttpCacheClient::create_http_task(const std::string& url,
+												int redirect_max,
+												int retry_max,
+												http_callback_t callback)
+{
+	return new __WFHttpCacheTask(this, url, redirect_max, retry_max,
+								 std::move(callback));
+}
+
+WFHttpCacheStats WFHttpCacheClient::get_stats() const
+{
+	WFHttpCacheStats stats;
+
+	stats.requests = this->requests;
+	stats.hits = this->hits;
+	stats.revalidated = this->revalidated;
+	stats.upstream = this->upstream;
+	stats.coalesced = this->coalesced;
+	stats.bypassed = this->bypassed;
+	return stats;
+}
+
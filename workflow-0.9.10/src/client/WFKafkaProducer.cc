@@ -0,0 +1,279 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "WFTaskFactory.h"
+#include "WFKafkaProducer.h"
+
+#define GET_CURRENT_MICRO	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+using namespace protocol;
+
+WFKafkaProducer::WFKafkaProducer(const struct WFKafkaProducerParams *params) :
+	params(*params)
+{
+	this->inflight_bytes = 0;
+	this->pending = 0;
+}
+
+WFKafkaProducer::~WFKafkaProducer()
+{
+}
+
+int WFKafkaProducer::init(const std::string& broker_url)
+{
+	return this->client.init(broker_url);
+}
+
+void WFKafkaProducer::deinit()
+{
+	this->flush();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (this->pending > 0)
+		this->cond.wait(lock);
+
+	lock.unlock();
+	this->client.deinit();
+}
+
+int WFKafkaProducer::send(const std::string& topic, int partition,
+						  KafkaRecord record)
+{
+	size_t bytes = record.get_key_len() + record.get_value_len();
+	long long cur_time = GET_CURRENT_MICRO;
+	PartitionKey key(topic, partition >= 0 ? partition : -1);
+	WFTimerTask *timer = NULL;
+	unsigned long long seq;
+	Batch full = Batch();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	if (this->inflight_bytes > 0 &&
+		this->inflight_bytes + bytes > this->params.max_inflight_bytes)
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	Partition& part = this->partitions[key];
+	Batch& batch = part.batch;
+
+	if (!batch.task)
+	{
+		KafkaConfig conf;
+
+		conf = this->config;
+		batch.task = this->client.create_kafka_task(this->params.retry_max,
+													nullptr);
+		batch.task->set_api_type(Kafka_Produce);
+		batch.task->set_config(std::move(conf));
+		if (this->partitioner)
+			batch.task->set_partitioner(this->partitioner);
+
+		batch.first_time = cur_time;
+		if (this->params.linger_ms > 0)
+		{
+			seq = part.batch_seq;
+			timer = WFTaskFactory::create_timer_task(this->params.linger_ms * 1000,
+				[this, key, seq](WFTimerTask *) {
+					this->linger_callback(key, seq);
+				});
+			this->pending++;
+		}
+	}
+
+	batch.task->add_produce_record(key.first, key.second, std::move(record));
+	batch.records++;
+	batch.bytes += bytes;
+	batch.total_time += cur_time;
+	this->inflight_bytes += bytes;
+
+	if (batch.bytes >= this->params.batch_size || this->params.linger_ms <= 0)
+	{
+		full = batch;
+		batch = Batch();
+		part.batch_seq++;
+	}
+
+	lock.unlock();
+
+	if (timer)
+		timer->start();
+
+	if (full.task)
+		this->send_batch(key, full);
+
+	return 0;
+}
+
+void WFKafkaProducer::flush()
+{
+	std::vector<std::pair<PartitionKey, Batch>> batches;
+
+	this->mutex.lock();
+	for (auto& kv : this->partitions)
+	{
+		if (kv.second.batch.task)
+		{
+			batches.emplace_back(kv.first, kv.second.batch);
+			kv.second.batch = Batch();
+			kv.second.batch_seq++;
+		}
+	}
+
+	this->mutex.unlock();
+	for (const auto& kv : batches)
+		this->send_batch(kv.first, kv.second);
+}
+
+bool WFKafkaProducer::get_partition_stats(const std::string& topic,
+										  int partition,
+										  struct WFKafkaPartitionStats *stats)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto it = this->partitions.find(PartitionKey(topic, partition));
+
+	if (it == this->partitions.end())
+		return false;
+
+	*stats = it->second.stats;
+	return true;
+}
+
+size_t WFKafkaProducer::get_inflight_bytes()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	return this->inflight_bytes;
+}
+
+void WFKafkaProducer::send_batch(const PartitionKey& key, const Batch& batch)
+{
+	this->mutex.lock();
+	this->pending++;
+	this->mutex.unlock();
+
+	batch.task->set_callback([this, key, batch](WFKafkaTask *task) {
+		this->produce_callback(task, key, batch);
+	});
+	batch.task->start();
+}
+
+void WFKafkaProducer::produce_callback(WFKafkaTask *task,
+									   const PartitionKey& key,
+									   const Batch& batch)
+{
+	long long cur_time = GET_CURRENT_MICRO;
+	long long total_latency = (long long)batch.records * cur_time - batch.total_time;
+	std::map<int, struct WFKafkaPartitionStats> parts;
+	size_t n = 0;
+
+	/* Counted by the partitions the records were sent to, which for
+	 * partition -1 are chosen by the task. */
+	if (task->get_state() == WFT_STATE_SUCCESS)
+	{
+		std::vector<std::vector<KafkaRecord *>> records;
+
+		task->get_result()->fetch_records(records);
+		for (const auto& v : records)
+		{
+			struct WFKafkaPartitionStats& part = parts[v[0]->get_partition()];
+
+			for (KafkaRecord *record : v)
+			{
+				if (record->get_status() != KAFKA_NONE)
+					part.failed++;
+				else
+					part.records++;
+
+				part.bytes += record->get_key_len() + record->get_value_len();
+			}
+
+			n += v.size();
+		}
+	}
+
+	/* Records not all in the result count as failed where they were sent. */
+	if (n != batch.records)
+	{
+		parts.clear();
+		parts[key.second].failed = batch.records;
+		parts[key.second].bytes = batch.bytes;
+	}
+
+	this->mutex.lock();
+	for (const auto& kv : parts)
+	{
+		const struct WFKafkaPartitionStats& part = kv.second;
+		struct WFKafkaPartitionStats& stats =
+				this->partitions[PartitionKey(key.first, kv.first)].stats;
+
+		n = part.records + part.failed;
+		stats.records += part.records;
+		stats.failed += part.failed;
+		stats.batches++;
+		stats.bytes += part.bytes;
+		/* Send times are kept by batch, so the latency is shared by count. */
+		stats.total_latency += total_latency * (long long)n / (long long)batch.records;
+		if (stats.max_latency < cur_time - batch.first_time)
+			stats.max_latency = cur_time - batch.first_time;
+	}
+
+	this->mutex.unlock();
+
+	if (this->callback)
+		this->callback(task);
+
+	this->done(batch.bytes);
+}
+
+void WFKafkaProducer::linger_callback(const PartitionKey& key,
+									  unsigned long long seq)
+{
+	Batch batch = Batch();
+
+	this->mutex.lock();
+	Partition& part = this->partitions[key];
+
+	if (part.batch_seq == seq && part.batch.task)
+	{
+		batch = part.batch;
+		part.batch = Batch();
+		part.batch_seq++;
+	}
+
+	this->mutex.unlock();
+
+	if (batch.task)
+		this->send_batch(key, batch);
+
+	this->done(0);
+}
+
+void WFKafkaProducer::done(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->inflight_bytes -= bytes;
+	if (--this->pending == 0)
+		this->cond.notify_all();
+}
+
@@ -0,0 +1,465 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include "WFGlobal.h"
+#include "WFTaskError.h"
+#include "WFRedisPipelineClient.h"
+
+#define REDIS_KEEPALIVE_DEFAULT		(60 * 1000)
+#define REDIS_PIPELINE_KEYS_MAX		256
+
+using namespace protocol;
+
+class __WFRedisPipelineTask;
+
+struct __RedisPipelineQueue
+{
+	std::deque<__WFRedisPipelineTask *> tasks;
+	int inflight;
+};
+
+enum
+{
+	REDIS_MERGE_NONE,
+	REDIS_MERGE_ARRAY,
+	REDIS_MERGE_STATUS,
+};
+
+/* Commands that must not share a connection with other tasks' commands. */
+static bool __bypass_pipeline(const std::string& command)
+{
+	static const char *const commands[] = {
+		"MULTI", "EXEC", "DISCARD", "WATCH", "UNWATCH",
+		"BLPOP", "BRPOP", "BRPOPLPUSH", "BLMOVE", "BLMPOP",
+		"BZPOPMIN", "BZPOPMAX", "BZMPOP", "WAIT",
+		"SUBSCRIBE", "PSUBSCRIBE", "SSUBSCRIBE", "MONITOR",
+	};
+
+	for (const char *cmd : commands)
+	{
+		if (strcasecmp(command.c_str(), cmd) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static bool __command_disallowed(const std::string& command)
+{
+	return strcasecmp(command.c_str(), "AUTH") == 0 ||
+		   strcasecmp(command.c_str(), "SELECT") == 0 ||
+		   strcasecmp(command.c_str(), "ASKING") == 0;
+}
+
+class __WFRedisPipelineTask : public WFClientTask<RedisRequest, RedisResponse>
+{
+public:
+	__WFRedisPipelineTask(WFRedisPipelineClient *client, const std::string& url,
+						  int retry_max, redis_callback_t&& callback) :
+		WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback)),
+		url(url)
+	{
+		this->keep_alive_timeo = REDIS_KEEPALIVE_DEFAULT;
+		this->client = client;
+		this->retry_max = retry_max;
+		this->merge = REDIS_MERGE_NONE;
+	}
+
+	/* Commands sent for this task, set now for MGET and MSET. */
+	std::vector<std::vector<std::string>> commands;
+	int merge;
+
+protected:
+	virtual void dispatch();
+
+private:
+	void bypass();
+	void finish(int state, int error, int timeout_reason);
+	void set_result(const redis_reply_t *reply, size_t pos);
+
+	static std::vector<__WFRedisPipelineTask *>
+	take_batch(__RedisPipelineQueue *queue, size_t max_batch);
+	static void start_batch(WFRedisPipelineClient *client,
+							const std::string& url,
+							std::vector<__WFRedisPipelineTask *>&& tasks);
+	static void batch_done(WFRedisTask *task, WFRedisPipelineClient *client,
+						   const std::string& url,
+						   const std::vector<__WFRedisPipelineTask *>& tasks);
+
+private:
+	WFRedisPipelineClient *client;
+	std::string url;
+	int retry_max;
+};
+
+void __WFRedisPipelineTask::finish(int state, int error, int timeout_reason)
+{
+	this->state = state;
+	this->error = error;
+	this->timeout_reason = timeout_reason;
+	this->subtask_done();
+}
+
+void __WFRedisPipelineTask::bypass()
+{
+	WFRedisTask *task;
+
+	this->client->bypassed++;
+	task = WFTaskFactory::create_redis_task(this->url, this->retry_max,
+											[this](WFRedisTask *task) {
+		this->resp = std::move(*task->get_resp());
+		this->finish(task->get_state(), task->get_error(),
+					 task->get_timeout_reason());
+	});
+
+	*task->get_req() = std::move(this->req);
+	task->set_send_timeout(this->send_timeo);
+	task->set_receive_timeout(this->receive_timeo);
+	task->set_keep_alive(this->keep_alive_timeo);
+	task->start();
+}
+
+void __WFRedisPipelineTask::dispatch()
+{
+	WFRedisPipelineClient *client = this->client;
+	std::vector<__WFRedisPipelineTask *> tasks;
+	__RedisPipelineQueue *queue;
+	std::string command;
+	std::vector<std::string> params;
+
+	client->requests++;
+	if (this->merge != REDIS_MERGE_NONE && this->commands.empty())
+	{
+		RedisValue value;
+
+		/* MGET or MSET of no keys, replied without sending. */
+		if (this->merge == REDIS_MERGE_ARRAY)
+			value.set_array(0);
+		else
+			value.set_status("OK");
+
+		this->resp.set_result(value);
+		this->finish(WFT_STATE_SUCCESS, 0, TOR_NOT_TIMEOUT);
+		return;
+	}
+
+	if (this->commands.empty())
+	{
+		if (this->req.pipeline_size() != 0 ||
+			!this->req.get_command(command) ||
+			!this->req.get_params(params) ||
+			__bypass_pipeline(command))
+		{
+			this->bypass();
+			return;
+		}
+
+		if (__command_disallowed(command))
+		{
+			this->finish(WFT_STATE_TASK_ERROR, WFT_ERR_REDIS_COMMAND_DISALLOWED,
+						 TOR_NOT_TIMEOUT);
+			return;
+		}
+
+		params.insert(params.begin(), std::move(command));
+		this->commands.emplace_back(std::move(params));
+	}
+
+	std::unique_lock<std::mutex> lock(client->mutex);
+	auto it = client->queues.find(this->url);
+
+	if (it != client->queues.end())
+		queue = it->second;
+	else
+	{
+		queue = new __RedisPipelineQueue;
+		queue->inflight = 0;
+		client->queues.emplace(this->url, queue);
+	}
+
+	queue->tasks.push_back(this);
+	if (queue->inflight < client->max_inflight)
+	{
+		tasks = take_batch(queue, client->max_batch);
+		queue->inflight++;
+	}
+
+	lock.unlock();
+	if (!tasks.empty())
+		start_batch(client, this->url, std::move(tasks));
+}
+
+/* At least one task, and more while their commands fit in the batch. */
+std::vector<__WFRedisPipelineTask *>
+__WFRedisPipelineTask::take_batch(__RedisPipelineQueue *queue,
+								  size_t max_batch)
+{
+	std::vector<__WFRedisPipelineTask *> tasks;
+	size_t n = 0;
+
+	while (!queue->tasks.empty())
+	{
+		__WFRedisPipelineTask *task = queue->tasks.front();
+
+		if (n != 0 && n + task->commands.size() > max_batch)
+			break;
+
+		n += task->commands.size();
+		tasks.push_back(task);
+		queue->tasks.pop_front();
+	}
+
+	return tasks;
+}
+
+void __WFRedisPipelineTask::start_batch(WFRedisPipelineClient *client,
+								const std::string& url,
+								std::vector<__WFRedisPipelineTask *>&& tasks)
+{
+	__WFRedisPipelineTask *first = tasks[0];
+	std::vector<std::vector<std::string>> requests;
+	WFRedisTask *task;
+
+	for (__WFRedisPipelineTask *t : tasks)
+	{
+		for (auto& command : t->commands)
+			requests.emplace_back(std::move(command));
+	}
+
+	client->batches++;
+	client->commands += requests.size();
+	task = WFTaskFactory::create_redis_task(url, first->retry_max,
+		[client, url, tasks](WFRedisTask *task) {
+		__WFRedisPipelineTask::batch_done(task, client, url, tasks);
+	});
+
+	task->get_req()->set_pipeline(requests);
+	task->set_send_timeout(first->send_timeo);
+	task->set_receive_timeout(first->receive_timeo);
+	task->set_keep_alive(first->keep_alive_timeo);
+	task->start();
+}
+
+/* The replies of this task's commands, from 'pos' of the pipelined result. */
+void __WFRedisPipelineTask::set_result(const redis_reply_t *reply, size_t pos)
+{
+	size_t n = this->commands.size();
+	const redis_reply_t *error = NULL;
+	RedisValue value;
+	size_t count = 0;
+	size_t i, j;
+
+	for (i = pos; i < pos + n; i++)
+	{
+		if (reply->element[i]->type == REDIS_REPLY_TYPE_ERROR)
+		{
+			error = reply->element[i];
+			break;
+		}
+
+		if (reply->element[i]->type == REDIS_REPLY_TYPE_ARRAY)
+			count += reply->element[i]->elements;
+	}
+
+	if (this->merge == REDIS_MERGE_NONE || error)
+		value.set(error ? error : reply->element[pos]);
+	else if (this->merge == REDIS_MERGE_STATUS)
+		value.set_status("OK");
+	else
+	{
+		value.set_array(count);
+		count = 0;
+		for (i = pos; i < pos + n; i++)
+		{
+			const redis_reply_t *values = reply->element[i];
+
+			if (values->type != REDIS_REPLY_TYPE_ARRAY)
+				continue;
+
+			for (j = 0; j < values->elements; j++)
+				value[count++].set(values->element[j]);
+		}
+	}
+
+	this->resp.set_result(value);
+}
+
+void __WFRedisPipelineTask::batch_done(WFRedisTask *task,
+						WFRedisPipelineClient *client, const std::string& url,
+						const std::vector<__WFRedisPipelineTask *>& tasks)
+{
+	const redis_reply_t *reply = task->get_resp()->result_ptr();
+	int state = task->get_state();
+	int error = task->get_error();
+	int timeout_reason = task->get_timeout_reason();
+	std::vector<__WFRedisPipelineTask *> next;
+	__RedisPipelineQueue *queue;
+	size_t pos = 0;
+
+	/* Send the tasks that waited for this request before running callbacks,
+	 * which may start more tasks. */
+	{
+		std::lock_guard<std::mutex> lock(client->mutex);
+
+		queue = client->queues[url];
+		if (!queue->tasks.empty())
+			next = take_batch(queue, client->max_batch);
+		else if (--queue->inflight == 0)
+		{
+			client->queues.erase(url);
+			delete queue;
+		}
+	}
+
+	if (!next.empty())
+		start_batch(client, url, std::move(next));
+
+	if (state == WFT_STATE_SUCCESS)
+	{
+		size_t n = 0;
+
+		for (__WFRedisPipelineTask *t : tasks)
+			n += t->commands.size();
+
+		if (!task->get_resp()->parse_success() ||
+			reply->type != REDIS_REPLY_TYPE_ARRAY || reply->elements != n)
+		{
+			state = WFT_STATE_SYS_ERROR;
+			error = EBADMSG;
+		}
+	}
+
+	for (__WFRedisPipelineTask *t : tasks)
+	{
+		if (state == WFT_STATE_SUCCESS)
+		{
+			t->set_result(reply, pos);
+			pos += t->commands.size();
+		}
+
+		t->finish(state, error, timeout_reason);
+	}
+}
+
+int WFRedisPipelineClient::init(size_t max_batch, int max_inflight)
+{
+	if (max_batch == 0 || max_inflight <= 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	this->max_batch = max_batch;
+	this->max_inflight = max_inflight;
+	return 0;
+}
+
+void WFRedisPipelineClient::deinit()
+{
+	for (auto& kv : this->queues)
+		delete kv.second;
+
+	this->queues.clear();
+}
+
+WFRedisTask *WFRedisPipelineClient::create_redis_task(const std::string& url,
+													  int retry_max,
+													  redis_callback_t callback)
+{
+	return new __WFRedisPipelineTask(this, url, retry_max, std::move(callback));
+}
+
+WFRedisTask *WFRedisPipelineClient::create_mget_task(const std::string& url,
+								const std::vector<std::string>& keys,
+								int retry_max,
+								redis_callback_t callback)
+{
+	auto *task = new __WFRedisPipelineTask(this, url, retry_max,
+										   std::move(callback));
+	size_t i = 0;
+
+	task->get_req()->set_request("MGET", keys);
+	task->merge = REDIS_MERGE_ARRAY;
+	while (i < keys.size())
+	{
+		size_t n = std::min(keys.size() - i, (size_t)REDIS_PIPELINE_KEYS_MAX);
+		std::vector<std::string> command;
+
+		command.reserve(n + 1);
+		command.emplace_back("MGET");
+		command.insert(command.end(), keys.begin() + i, keys.begin() + i + n);
+		task->commands.emplace_back(std::move(command));
+		i += n;
+	}
+
+	return task;
+}
+
+WFRedisTask *WFRedisPipelineClient::create_mset_task(const std::string& url,
+				const std::vector<std::pair<std::string, std::string>>& pairs,
+				int retry_max,
+				redis_callback_t callback)
+{
+	auto *task = new __WFRedisPipelineTask(this, url, retry_max,
+										   std::move(callback));
+	std::vector<std::string> params;
+	size_t i = 0;
+
+	params.reserve(2 * pairs.size());
+	for (const auto& kv : pairs)
+	{
+		params.push_back(kv.first);
+		params.push_back(kv.second);
+	}
+
+	task->get_req()->set_request("MSET", params);
+	task->merge = REDIS_MERGE_STATUS;
+	while (i < pairs.size())
+	{
+		size_t n = std::min(pairs.size() - i, (size_t)REDIS_PIPELINE_KEYS_MAX);
+		std::vector<std::string> command;
+
+		command.reserve(2 * n + 1);
+		command.emplace_back("MSET");
+		command.insert(command.end(), params.begin() + 2 * i,
+					   params.begin() + 2 * (i + n));
+		task->commands.emplace_back(std::move(command));
+		i += n;
+	}
+
+	return task;
+}
+
+WFRedisPipelineStats WFRedisPipelineClient::get_stats() const
+{
+	WFRedisPipelineStats stats;
+
+	stats.requests = this->requests;
+	stats.batches = this->batches;
+	stats.commands = this->commands;
+	stats.bypassed = this->bypassed;
+	return stats;
+}
+
@@ -0,0 +1,106 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFREDISPIPELINECLIENT_H_
+#define _WFREDISPIPELINECLIENT_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "WFTaskFactory.h"
+
+/**
+ * @file   WFRedisPipelineClient.h
+ * @brief  Redis client pipelining concurrent tasks
+ */
+
+/* Tasks started for a url while 'max_inflight' pipelined requests to it are
+ * in flight wait in a queue. When one of those returns, the waiting tasks
+ * are written back to back as the next pipelined request, of at most
+ * 'max_batch' commands, and the replies are matched to them in order.
+ * So many concurrent tasks share a few connections.
+ *
+ * Transactions and blocking commands bypass the pipeline, as they would
+ * take in or hold up the commands of other tasks. MOVED and ASK replies
+ * are returned to the task and not followed.
+ * The timeouts and retry_max of the first task of a pipelined request are
+ * used for it. A pipelined task has no connection and no peer address. */
+
+struct WFRedisPipelineStats
+{
+	size_t requests;	/* tasks started */
+	size_t batches;		/* pipelined requests sent */
+	size_t commands;	/* commands in pipelined requests */
+	size_t bypassed;	/* tasks sent on their own */
+};
+
+struct __RedisPipelineQueue;
+
+class WFRedisPipelineClient
+{
+public:
+	/* max_batch: commands of one pipelined request.
+	 * max_inflight: pipelined requests in flight for each url. */
+	int init(size_t max_batch, int max_inflight);
+	void deinit();
+
+	WFRedisTask *create_redis_task(const std::string& url,
+								   int retry_max,
+								   redis_callback_t callback);
+
+	/* Any number of keys, sent as MGET commands of a bounded number of keys
+	 * in one pipelined request. The result is one array of all values, or
+	 * the first error. No keys get an empty array, and nothing is sent. */
+	WFRedisTask *create_mget_task(const std::string& url,
+								  const std::vector<std::string>& keys,
+								  int retry_max,
+								  redis_callback_t callback);
+
+	/* Likewise with MSET. The result is 'OK', or the first error, and the
+	 * pairs are not set atomically if there are more than one command. No
+	 * pairs get 'OK' without sending. */
+	WFRedisTask *create_mset_task(const std::string& url,
+				const std::vector<std::pair<std::string, std::string>>& pairs,
+				int retry_max,
+				redis_callback_t callback);
+
+public:
+	WFRedisPipelineStats get_stats() const;
+
+public:
+	WFRedisPipelineClient() : max_batch(0), max_inflight(0) { }
+	virtual ~WFRedisPipelineClient() { }
+
+private:
+	size_t max_batch;
+	int max_inflight;
+	std::mutex mutex;
+	std::unordered_map<std::string, __RedisPipelineQueue *> queues;
+
+	std::atomic<size_t> requests{0};
+	std::atomic<size_t> batches{0};
+	std::atomic<size_t> commands{0};
+	std::atomic<size_t> bypassed{0};
+
+	friend class __WFRedisPipelineTask;
+};
+
+#endif
+
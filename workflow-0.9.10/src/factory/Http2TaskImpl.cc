@@ -0,0 +1,441 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include <list>
+#include "Workflow.h"
+#include "WFTaskError.h"
+#include "WFTaskFactory.h"
+#include "WFGlobal.h"
+#include "HttpUtil.h"
+
+using namespace protocol;
+
+#define HTTP2_KEEPALIVE_DEFAULT	(60 * 1000)
+
+/* The HTTP/2 state of a connection lives in its context, created by the
+ * first message on it and deleted with the connection. */
+static Http2Session *__get_session(WFConnection *conn, bool server)
+{
+	Http2Session *session = (Http2Session *)conn->get_context();
+
+	if (!session)
+	{
+		session = new Http2Session(server);
+		conn->set_context(session, [](void *ctx) {
+			delete (Http2Session *)ctx;
+		});
+	}
+
+	return session;
+}
+
+/**********Client**********/
+
+class ComplexHttp2Task : public WFComplexClientTask<Http2Request,
+													 Http2Response>
+{
+public:
+	ComplexHttp2Task(int retry_max, http2_callback_t&& callback):
+		WFComplexClientTask(retry_max, std::move(callback)),
+		is_user_request_(true),
+		is_ssl_(false)
+	{
+		Http2Request *client_req = this->get_req();
+
+		client_req->set_method(HttpMethodGet);
+		client_req->set_http_version("HTTP/2");
+	}
+
+protected:
+	virtual CommMessageOut *message_out();
+	virtual CommMessageIn *message_in();
+	virtual int keep_alive_timeout();
+	virtual bool init_success();
+	virtual void init_failed();
+	virtual bool finish_once();
+
+private:
+	void set_empty_request();
+
+	bool is_user_request_;
+	bool is_ssl_;
+};
+
+CommMessageOut *ComplexHttp2Task::message_out()
+{
+	WFConnection *conn = this->WFComplexClientTask::get_connection();
+	Http2Session *session;
+
+	if (!conn)
+		return NULL;
+
+	session = __get_session(conn, false);
+	is_user_request_ = (this->get_seq() != 0);
+	if (!is_user_request_)
+		return new Http2Handshake(session);
+
+	this->get_req()->set_session(session, is_ssl_);
+	return this->WFComplexClientTask::message_out();
+}
+
+CommMessageIn *ComplexHttp2Task::message_in()
+{
+	WFConnection *conn = this->WFComplexClientTask::get_connection();
+	Http2Session *session;
+
+	if (!conn)
+		return NULL;
+
+	session = __get_session(conn, false);
+	if (!is_user_request_)
+		return new Http2Handshake(session);
+
+	this->get_resp()->set_session(session, this->get_req());
+	return this->WFComplexClientTask::message_in();
+}
+
+int ComplexHttp2Task::keep_alive_timeout()
+{
+	WFConnection *conn = this->WFComplexClientTask::get_connection();
+	Http2Session *session;
+
+	if (!conn)
+		return 0;
+
+	/* No new streams after GOAWAY, and ids are 31 bits. */
+	session = (Http2Session *)conn->get_context();
+	if (!session || session->goaway || session->last_stream_id >= 0x7ffffffd)
+		return 0;
+
+	if (!is_user_request_)
+		return HTTP2_KEEPALIVE_DEFAULT;
+
+	return this->resp.is_keep_alive() ? this->keep_alive_timeo : 0;
+}
+
+bool ComplexHttp2Task::finish_once()
+{
+	if (!is_user_request_)
+	{
+		delete this->get_message_out();
+		delete this->get_message_in();
+		is_user_request_ = true;
+		return false;
+	}
+
+	return true;
+}
+
+void ComplexHttp2Task::set_empty_request()
+{
+	Http2Request *client_req = this->get_req();
+
+	client_req->set_request_uri("/");
+	client_req->set_header_pair("Host", "");
+}
+
+void ComplexHttp2Task::init_failed()
+{
+	this->set_empty_request();
+}
+
+bool ComplexHttp2Task::init_success()
+{
+	Http2Request *client_req = this->get_req();
+	std::string request_uri;
+	std::string header_host;
+
+	if (uri_.scheme && strcasecmp(uri_.scheme, "http") == 0)
+		is_ssl_ = false;
+	else if (uri_.scheme && strcasecmp(uri_.scheme, "https") == 0)
+		is_ssl_ = true;
+	else
+	{
+		this->state = WFT_STATE_TASK_ERROR;
+		this->error = WFT_ERR_URI_SCHEME_INVALID;
+		this->set_empty_request();
+		return false;
+	}
+
+	if (uri_.path && uri_.path[0])
+		request_uri = uri_.path;
+	else
+		request_uri = "/";
+
+	if (uri_.query && uri_.query[0])
+	{
+		request_uri += "?";
+		request_uri += uri_.query;
+	}
+
+	if (uri_.host && uri_.host[0])
+		header_host = uri_.host;
+
+	if (uri_.port && uri_.port[0])
+	{
+		int port = atoi(uri_.port);
+
+		if (port != (is_ssl_ ? 443 : 80))
+		{
+			header_host += ":";
+			header_host += uri_.port;
+		}
+	}
+
+	/* Keep HTTP/2 connections apart from HTTP/1 ones to the same address. */
+	this->WFComplexClientTask::set_info("h2");
+	this->WFComplexClientTask::set_transport_type(is_ssl_ ? TT_TCP_SSL : TT_TCP);
+	client_req->set_request_uri(request_uri.c_str());
+	client_req->set_header_pair("Host", header_host.c_str());
+
+	return true;
+}
+
+/**********Client Factory**********/
+
+WFHttp2Task *WFTaskFactory::create_http2_task(const std::string& url,
+											  int retry_max,
+											  http2_callback_t callback)
+{
+	auto *task = new ComplexHttp2Task(retry_max, std::move(callback));
+	ParsedURI uri;
+
+	URIParser::parse(url, uri);
+	task->init(std::move(uri));
+	task->set_keep_alive(HTTP2_KEEPALIVE_DEFAULT);
+	return task;
+}
+
+WFHttp2Task *WFTaskFactory::create_http2_task(const ParsedURI& uri,
+											  int retry_max,
+											  http2_callback_t callback)
+{
+	auto *task = new ComplexHttp2Task(retry_max, std::move(callback));
+
+	task->init(uri);
+	task->set_keep_alive(HTTP2_KEEPALIVE_DEFAULT);
+	return task;
+}
+
+/**********Server**********/
+
+/* A stream received with others. It is processed in a series of its own,
+ * and replied by the task of the message. */
+class WFHttp2StreamTask : public WFNetworkTask<Http2Request, Http2Response>
+{
+public:
+	WFHttp2StreamTask(CommTarget *target,
+					  std::function<void (WFHttp2Task *)>& process):
+		WFNetworkTask(NULL, WFGlobal::get_scheduler(), nullptr),
+		process(process)
+	{
+		this->target = target;
+		this->state = WFT_STATE_TOREPLY;
+	}
+
+	void finish(int state, int error)
+	{
+		if (this->state == WFT_STATE_TOREPLY)
+		{
+			this->state = state;
+			this->error = error;
+		}
+
+		if (this->callback)
+			this->callback(this);
+	}
+
+protected:
+	virtual CommMessageOut *message_out() { return NULL; }
+	virtual CommMessageIn *message_in() { return NULL; }
+	virtual void handle(int state, int error) { }
+
+	virtual WFConnection *get_connection() const
+	{
+		errno = EPERM;
+		return NULL;
+	}
+
+	virtual void dispatch()
+	{
+		this->process(this);
+		this->subtask_done();
+	}
+
+	virtual SubTask *done()
+	{
+		return series_of(this)->pop();
+	}
+
+private:
+	std::function<void (WFHttp2Task *)>& process;
+};
+
+class WFHttp2ServerTask : public WFServerTask<Http2Request, Http2Response>
+{
+public:
+	WFHttp2ServerTask(CommService *service,
+					  std::function<void (WFHttp2Task *)>& process):
+		WFServerTask(service, WFGlobal::get_scheduler(), process),
+		noreply_(false)
+	{}
+
+protected:
+	virtual CommMessageOut *message_out();
+	virtual CommMessageIn *message_in();
+	virtual void handle(int state, int error);
+	virtual void dispatch();
+	virtual SubTask *done();
+
+	virtual ~WFHttp2ServerTask()
+	{
+		for (WFHttp2StreamTask *task : streams_)
+			delete task;
+	}
+
+	/* Replies a request with no stream, without processing it. */
+	class FlushSeries : public SeriesWork
+	{
+	public:
+		FlushSeries(WFHttp2ServerTask *task) :
+			SeriesWork(task, nullptr)
+		{
+			this->task = task;
+		}
+
+		virtual ~FlushSeries()
+		{
+			delete this->task;
+		}
+
+		WFHttp2ServerTask *task;
+	};
+
+private:
+	std::vector<WFHttp2StreamTask *> streams_;
+	bool noreply_;
+};
+
+CommMessageIn *WFHttp2ServerTask::message_in()
+{
+	WFConnection *conn = (WFConnection *)this->CommSession::get_connection();
+
+	this->req.set_session(__get_session(conn, true), false);
+	return this->WFServerTask::message_in();
+}
+
+CommMessageOut *WFHttp2ServerTask::message_out()
+{
+	WFConnection *conn = (WFConnection *)this->CommSession::get_connection();
+	Http2Session *session = __get_session(conn, true);
+
+	if (session->goaway)
+		this->keep_alive_timeo = 0;
+
+	this->resp.set_session(session, this->req.get_stream_id());
+	for (WFHttp2StreamTask *task : streams_)
+	{
+		Http2Response *resp = task->get_resp();
+
+		resp->set_session(session, task->get_req()->get_stream_id());
+		if (task->get_state() != WFT_STATE_TOREPLY)
+			resp->set_reset();
+
+		this->resp.add_stream(resp);
+	}
+
+	return this->WFServerTask::message_out();
+}
+
+/* Other streams of the request are processed in parallel, after this one
+ * and before the reply. */
+void WFHttp2ServerTask::handle(int state, int error)
+{
+	std::list<Http2Request> *reqs = this->req.get_streams();
+	ParallelWork *parallel;
+	SeriesWork *series;
+
+	if (state == WFT_STATE_TOREPLY && this->req.get_stream_id() == 0)
+	{
+		this->state = WFT_STATE_TOREPLY;
+		this->target = this->get_target();
+		new FlushSeries(this);
+		this->dispatch();
+		return;
+	}
+
+	if (state != WFT_STATE_TOREPLY || reqs->empty())
+	{
+		this->WFServerTask::handle(state, error);
+		return;
+	}
+
+	this->state = WFT_STATE_TOREPLY;
+	this->target = this->get_target();
+	parallel = Workflow::create_parallel_work(nullptr);
+	for (Http2Request& req : *reqs)
+	{
+		auto *task = new WFHttp2StreamTask(this->target,
+										   this->processor.process);
+
+		*task->get_req() = std::move(req);
+		streams_.push_back(task);
+		parallel->add_series(Workflow::create_series_work(task, nullptr));
+	}
+
+	reqs->clear();
+	series = new Series(this);
+	series->push_back(parallel);
+	this->processor.dispatch();
+}
+
+/* The other streams are replied even if this one is not. */
+void WFHttp2ServerTask::dispatch()
+{
+	if (this->state == WFT_STATE_NOREPLY && !streams_.empty())
+	{
+		this->resp.set_reset();
+		this->state = WFT_STATE_TOREPLY;
+		noreply_ = true;
+	}
+
+	this->WFServerTask::dispatch();
+}
+
+SubTask *WFHttp2ServerTask::done()
+{
+	if (noreply_ && this->state == WFT_STATE_SUCCESS)
+		this->state = WFT_STATE_NOREPLY;
+
+	for (WFHttp2StreamTask *task : streams_)
+		task->finish(this->state, this->error);
+
+	return this->WFServerTask::done();
+}
+
+/**********Server Factory**********/
+
+WFHttp2Task *WFServerTaskFactory::create_http2_task(CommService *service,
+							std::function<void (WFHttp2Task *)>& process)
+{
+	return new WFHttp2ServerTask(service, process);
+}
+
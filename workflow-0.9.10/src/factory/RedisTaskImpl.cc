@@ -59,20 +59,36 @@ private:
 	int redirect_count_;
 };
 
+static bool __command_disallowed(const std::string& command)
+{
+	return strcasecmp(command.c_str(), "AUTH") == 0 ||
+		   strcasecmp(command.c_str(), "SELECT") == 0 ||
+		   strcasecmp(command.c_str(), "ASKING") == 0;
+}
+
 bool ComplexRedisTask::check_request()
 {
 	std::string command;
+	size_t n = this->req.pipeline_size();
 
-	if (this->req.get_command(command) &&
-		(strcasecmp(command.c_str(), "AUTH") == 0 ||
-		 strcasecmp(command.c_str(), "SELECT") == 0 ||
-		 strcasecmp(command.c_str(), "ASKING") == 0))
+	if (this->req.get_command(command) && __command_disallowed(command))
 	{
 		this->state = WFT_STATE_TASK_ERROR;
 		this->error = WFT_ERR_REDIS_COMMAND_DISALLOWED;
 		return false;
 	}
 
+	for (size_t i = 0; i < n; i++)
+	{
+		if (this->req.get_pipeline_command(i, command) &&
+			__command_disallowed(command))
+		{
+			this->state = WFT_STATE_TASK_ERROR;
+			this->error = WFT_ERR_REDIS_COMMAND_DISALLOWED;
+			return false;
+		}
+	}
+
 	return true;
 }
 
@@ -114,7 +130,11 @@ CommMessageIn *ComplexRedisTask::message_in()
 	RedisResponse *resp = this->get_resp();
 
 	if (is_user_request_)
+	{
 		resp->set_asking(req->is_asking());
+		if (req->pipeline_size() != 0)
+			resp->expect_pipeline(req->pipeline_size());
+	}
 	else
 		resp->set_asking(false);
 
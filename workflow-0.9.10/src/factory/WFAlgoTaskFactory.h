@@ -114,6 +114,8 @@ public:
 											 CMP compare,
 											 CB callback);
 
+	/* Sample sort on the compute threads. A buffer as large as the input is
+	 * used. */
 	template<typename T, class CB = sort_callback_t<T>>
 	static WFSortTask<T> *create_psort_task(const std::string& queue_name,
 											T *first, T *last,
@@ -125,6 +127,13 @@ public:
 											CMP compare,
 											CB callback);
 
+	/* Radix sort of integral or floating point types. A buffer as large as
+	 * the input is used. */
+	template<typename T, class CB = sort_callback_t<T>>
+	static WFSortTask<T> *create_radix_sort_task(const std::string& queue_name,
+												 T *first, T *last,
+												 CB callback);
+
 	template<typename KEY = std::string, typename VAL = std::string,
 			 class RED = algorithm::reduce_function_t<KEY, VAL>,
 			 class CB = reduce_callback_t<KEY, VAL>>
@@ -141,6 +150,26 @@ public:
 					   algorithm::ReduceInput<KEY, VAL> input,
 					   RED reduce,
 					   CB callback);
+
+	/* Reduce of hash partitions on the compute threads. KEY must have
+	 * std::hash and operator== besides operator<, and 'reduce' is called
+	 * from several threads at once. The output is the same as above. */
+	template<typename KEY = std::string, typename VAL = std::string,
+			 class RED = algorithm::reduce_function_t<KEY, VAL>,
+			 class CB = reduce_callback_t<KEY, VAL>>
+	static WFReduceTask<KEY, VAL> *
+	create_preduce_task(const std::string& queue_name,
+						RED reduce,
+						CB callback);
+
+	template<typename KEY = std::string, typename VAL = std::string,
+			 class RED = algorithm::reduce_function_t<KEY, VAL>,
+			 class CB = reduce_callback_t<KEY, VAL>>
+	static WFReduceTask<KEY, VAL> *
+	create_preduce_task(const std::string& queue_name,
+						algorithm::ReduceInput<KEY, VAL> input,
+						RED reduce,
+						CB callback);
 };
 
 #include "WFAlgoTaskFactory.inl"
@@ -28,6 +28,7 @@
 #include "URIParser.h"
 #include "RedisMessage.h"
 #include "HttpMessage.h"
+#include "Http2Message.h"
 #include "MySQLMessage.h"
 #include "DnsMessage.h"
 #include "Workflow.h"
@@ -42,6 +43,10 @@ using WFHttpTask = WFNetworkTask<protocol::HttpRequest,
 								 protocol::HttpResponse>;
 using http_callback_t = std::function<void (WFHttpTask *)>;
 
+using WFHttp2Task = WFNetworkTask<protocol::Http2Request,
+								  protocol::Http2Response>;
+using http2_callback_t = std::function<void (WFHttp2Task *)>;
+
 using WFRedisTask = WFNetworkTask<protocol::RedisRequest,
 								  protocol::RedisResponse>;
 using redis_callback_t = std::function<void (WFRedisTask *)>;
@@ -126,6 +131,16 @@ public:
 										int retry_max,
 										http_callback_t callback);
 
+	/* HTTP/2 with prior knowledge, over "http://" or "https://" urls.
+	 * Requests to the same address share keep-alive connections. */
+	static WFHttp2Task *create_http2_task(const std::string& url,
+										  int retry_max,
+										  http2_callback_t callback);
+
+	static WFHttp2Task *create_http2_task(const ParsedURI& uri,
+										  int retry_max,
+										  http2_callback_t callback);
+
 	static WFRedisTask *create_redis_task(const std::string& url,
 										  int retry_max,
 										  redis_callback_t callback);
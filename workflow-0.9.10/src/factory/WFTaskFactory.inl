@@ -568,6 +568,8 @@ class WFServerTaskFactory
 public:
 	static WFHttpTask *create_http_task(CommService *service,
 					std::function<void (WFHttpTask *)>& process);
+	static WFHttp2Task *create_http2_task(CommService *service,
+					std::function<void (WFHttp2Task *)>& process);
 	static WFMySQLTask *create_mysql_task(CommService *service,
 					std::function<void (WFMySQLTask *)>& process);
 };
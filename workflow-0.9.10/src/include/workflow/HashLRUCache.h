@@ -0,0 +1 @@
+#include "../../util/HashLRUCache.h"
@@ -0,0 +1 @@
+#include "../../protocol/Http2Message.h"
@@ -0,0 +1 @@
+../../server/WFConcurrencyLimiter.h
\ No newline at end of file
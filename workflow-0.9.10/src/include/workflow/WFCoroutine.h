@@ -0,0 +1 @@
+#include "../../manager/WFCoroutine.h"
@@ -0,0 +1 @@
+#include "../../client/WFHttp2Client.h"
@@ -0,0 +1 @@
+#include "../../server/WFHttp2Server.h"
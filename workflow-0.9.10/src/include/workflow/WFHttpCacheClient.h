@@ -0,0 +1 @@
+#include "../../client/WFHttpCacheClient.h"
@@ -0,0 +1 @@
+#include "../../client/WFKafkaProducer.h"
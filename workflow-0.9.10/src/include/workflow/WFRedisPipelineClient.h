@@ -0,0 +1 @@
+#include "../../client/WFRedisPipelineClient.h"
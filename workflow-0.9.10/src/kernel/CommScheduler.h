@@ -111,9 +111,12 @@ private:
 class CommScheduler
 {
 public:
-	int init(size_t poller_threads, size_t handler_threads)
+	int init(size_t poller_threads, size_t handler_threads,
+			 int poller_backend = POLLER_BACKEND_DEFAULT,
+			 int queue_type = COMM_QUEUE_DEFAULT)
 	{
-		return this->comm.init(poller_threads, handler_threads);
+		return this->comm.init(poller_threads, handler_threads,
+							   poller_backend, queue_type);
 	}
 
 	void deinit()
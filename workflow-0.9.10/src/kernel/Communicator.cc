@@ -1177,6 +1177,11 @@ int Communicator::append(const void *buf, size_t *size, poller_message_t *msg)
 	return ret;
 }
 
+void *Communicator::get_buffer(size_t *size, poller_message_t *msg)
+{
+	return ((CommMessageIn *)msg)->get_buffer(size);
+}
+
 int Communicator::create_service_session(struct CommConnEntry *entry)
 {
 	CommService *service = entry->service;
@@ -1255,6 +1260,7 @@ poller_message_t *Communicator::create_message(void *context)
 	if (session->in)
 	{
 		session->in->poller_message_t::append = Communicator::append;
+		session->in->poller_message_t::get_buffer = Communicator::get_buffer;
 		session->in->entry = entry;
 	}
 
@@ -1329,17 +1335,24 @@ int Communicator::create_handler_threads(size_t handler_threads)
 	return -1;
 }
 
-int Communicator::create_poller(size_t poller_threads)
+int Communicator::create_poller(size_t poller_threads, int poller_backend,
+								int queue_type)
 {
 	struct poller_params params = {
 		.max_open_files		=	65536,
 		.create_message		=	Communicator::create_message,
 		.partial_written	=	Communicator::partial_written,
 		.callback			=	Communicator::callback,
-		.context			=	this
+		.context			=	this,
+		.backend			=	poller_backend
 	};
+	int linkoff = sizeof (struct poller_result);
+
+	if (queue_type == COMM_QUEUE_LOCKFREE)
+		this->queue = msgqueue_create_lockfree(4096, linkoff);
+	else
+		this->queue = msgqueue_create(4096, linkoff);
 
-	this->queue = msgqueue_create(4096, sizeof (struct poller_result));
 	if (this->queue)
 	{
 		this->mpoller = mpoller_create(&params, poller_threads);
@@ -1357,7 +1370,8 @@ int Communicator::create_poller(size_t poller_threads)
 	return -1;
 }
 
-int Communicator::init(size_t poller_threads, size_t handler_threads)
+int Communicator::init(size_t poller_threads, size_t handler_threads,
+					   int poller_backend, int queue_type)
 {
 	if (poller_threads == 0)
 	{
@@ -1365,7 +1379,7 @@ int Communicator::init(size_t poller_threads, size_t handler_threads)
 		return -1;
 	}
 
-	if (this->create_poller(poller_threads) >= 0)
+	if (this->create_poller(poller_threads, poller_backend, queue_type) >= 0)
 	{
 		if (this->create_handler_threads(handler_threads) >= 0)
 		{
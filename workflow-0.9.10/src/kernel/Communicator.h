@@ -108,6 +108,10 @@ class CommMessageIn : private poller_message_t
 private:
 	virtual int append(const void *buf, size_t *size) = 0;
 
+	/* Optionally return storage for the next '*size' bytes. They are read
+	 * into it directly and then passed to append() at the same address. */
+	virtual void *get_buffer(size_t *size) { return NULL; }
+
 protected:
 	/* Send small packet while receiving. Call only in append(). */
 	virtual int feedback(const void *buf, size_t size);
@@ -251,10 +255,18 @@ public:
 # include "IOService_thread.h"
 #endif
 
+#define COMM_QUEUE_DEFAULT		0
+#define COMM_QUEUE_LOCKFREE		1
+
 class Communicator
 {
 public:
-	int init(size_t poller_threads, size_t handler_threads);
+	/* 'poller_backend' is POLLER_BACKEND_DEFAULT or POLLER_BACKEND_URING_POLL.
+	 * 'queue_type' selects the queue from pollers to handler threads,
+	 * COMM_QUEUE_DEFAULT or COMM_QUEUE_LOCKFREE. */
+	int init(size_t poller_threads, size_t handler_threads,
+			 int poller_backend = POLLER_BACKEND_DEFAULT,
+			 int queue_type = COMM_QUEUE_DEFAULT);
 	void deinit();
 
 	int request(CommSession *session, CommTarget *target);
@@ -281,7 +293,8 @@ private:
 	int stop_flag;
 
 private:
-	int create_poller(size_t poller_threads);
+	int create_poller(size_t poller_threads, int poller_backend,
+					  int queue_type);
 
 	int create_handler_threads(size_t handler_threads);
 
@@ -339,6 +352,8 @@ private:
 
 	static int append(const void *buf, size_t *size, poller_message_t *msg);
 
+	static void *get_buffer(size_t *size, poller_message_t *msg);
+
 	static int create_service_session(struct CommConnEntry *entry);
 
 	static poller_message_t *create_message(void *context);
@@ -21,13 +21,14 @@
 #include <pthread.h>
 #include "list.h"
 #include "thrdpool.h"
+#include "wspool.h"
 #include "Executor.h"
 
 struct ExecTaskEntry
 {
 	struct list_head list;
 	ExecSession *session;
-	thrdpool_t *thrdpool;
+	Executor *executor;
 };
 
 int ExecQueue::init()
@@ -50,7 +51,7 @@ void ExecQueue::deinit()
 	pthread_mutex_destroy(&this->mutex);
 }
 
-int Executor::init(size_t nthreads)
+int Executor::init(size_t nthreads, int type)
 {
 	if (nthreads == 0)
 	{
@@ -58,20 +59,36 @@ int Executor::init(size_t nthreads)
 		return -1;
 	}
 
-	this->thrdpool = thrdpool_create(nthreads, 0);
-	if (this->thrdpool)
-		return 0;
+	this->thrdpool = NULL;
+	this->wspool = NULL;
+	if (type == EXECUTOR_WORK_STEALING)
+	{
+		this->wspool = wspool_create(nthreads, 0);
+		if (this->wspool)
+			return 0;
+	}
+	else
+	{
+		this->thrdpool = thrdpool_create(nthreads, 0);
+		if (this->thrdpool)
+			return 0;
+	}
 
 	return -1;
 }
 
 void Executor::deinit()
 {
-	thrdpool_destroy(Executor::executor_cancel_tasks, this->thrdpool);
+	if (this->wspool)
+		wspool_destroy(Executor::executor_cancel_tasks, this->wspool);
+	else
+		thrdpool_destroy(Executor::executor_cancel_tasks, this->thrdpool);
 }
 
 extern "C" void __thrdpool_schedule(const struct thrdpool_task *, void *,
 									thrdpool_t *);
+extern "C" void __wspool_schedule(const struct thrdpool_task *, void *,
+								  wspool_t *);
 
 void Executor::executor_thread_routine(void *context)
 {
@@ -89,7 +106,13 @@ void Executor::executor_thread_routine(void *context)
 			.routine	=	Executor::executor_thread_routine,
 			.context	=	queue
 		};
-		__thrdpool_schedule(&task, entry, entry->thrdpool);
+		Executor *executor = entry->executor;
+
+		/* The queue goes to the tail again, so that queues take turns. */
+		if (executor->wspool)
+			__wspool_schedule(&task, entry, executor->wspool);
+		else
+			__thrdpool_schedule(&task, entry, executor->thrdpool);
 	}
 	else
 		free(entry);
@@ -126,7 +149,7 @@ int Executor::request(ExecSession *session, ExecQueue *queue)
 	if (entry)
 	{
 		entry->session = session;
-		entry->thrdpool = this->thrdpool;
+		entry->executor = this;
 		pthread_mutex_lock(&queue->mutex);
 		list_add_tail(&entry->list, &queue->task_list);
 		if (queue->task_list.next == &entry->list)
@@ -135,7 +158,14 @@ int Executor::request(ExecSession *session, ExecQueue *queue)
 				.routine	=	Executor::executor_thread_routine,
 				.context	=	queue
 			};
-			if (thrdpool_schedule(&task, this->thrdpool) < 0)
+			int ret;
+
+			if (this->wspool)
+				ret = wspool_schedule(&task, this->wspool);
+			else
+				ret = thrdpool_schedule(&task, this->thrdpool);
+
+			if (ret < 0)
 			{
 				list_del(&entry->list);
 				free(entry);
@@ -59,16 +59,23 @@ public:
 	friend class Executor;
 };
 
+#define EXECUTOR_SHARED_QUEUE		0
+#define EXECUTOR_WORK_STEALING		1
+
 class Executor
 {
 public:
-	int init(size_t nthreads);
+	/* With EXECUTOR_WORK_STEALING, each thread has its own run queue and
+	 * idle threads steal from busy ones. Either way, the sessions of one
+	 * ExecQueue start in FIFO order, and queues take turns. */
+	int init(size_t nthreads, int type = EXECUTOR_SHARED_QUEUE);
 	void deinit();
 
 	int request(ExecSession *session, ExecQueue *queue);
 
 private:
 	struct __thrdpool *thrdpool;
+	struct __wspool *wspool;
 
 private:
 	static void executor_thread_routine(void *context);
@@ -25,6 +25,9 @@
 #include <pthread.h>
 #include "list.h"
 #include "IOService_linux.h"
+#ifdef HAVE_LINUX_IO_URING_H
+# include "uring.h"
+#endif
 
 /* Linux async I/O interface from libaio.h */
 
@@ -244,7 +247,129 @@ void IOSession::prep_fdsync(int fd)
 	iocb->aio_lio_opcode = IO_CMD_FDSYNC;
 }
 
-int IOService::init(int maxevents)
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* With io_uring every request is linked to an 8 bytes write of 1 to the
+ * event fd, so the event count matches the number of completions exactly,
+ * the same as aio with IOCB_FLAG_RESFD. Completions of the eventfd writes
+ * carry a zero user_data and are skipped. */
+
+static const unsigned long long __uring_one = 1;
+
+static int __uring_prep(const struct iocb *iocb, struct io_uring_sqe *sqe)
+{
+	switch (iocb->aio_lio_opcode)
+	{
+	case IO_CMD_PREAD:
+		sqe->opcode = IORING_OP_READ;
+		break;
+	case IO_CMD_PWRITE:
+		sqe->opcode = IORING_OP_WRITE;
+		break;
+	case IO_CMD_PREADV:
+		sqe->opcode = IORING_OP_READV;
+		break;
+	case IO_CMD_PWRITEV:
+		sqe->opcode = IORING_OP_WRITEV;
+		break;
+	case IO_CMD_FDSYNC:
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		/* fall through */
+	case IO_CMD_FSYNC:
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = iocb->aio_fildes;
+		return 0;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+
+	sqe->fd = iocb->aio_fildes;
+	sqe->addr = (unsigned long)iocb->u.c.buf;
+	sqe->len = iocb->u.c.nbytes;
+	sqe->off = iocb->u.c.offset;
+	return 0;
+}
+
+static int __uring_request(struct iocb *iocb, int event_fd, uring_t *ring)
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_sqe *efd;
+
+	/* Submitted right away, so the queue has room unless a previous
+	 * submit failed. */
+	sqe = uring_get_sqe(ring);
+	if (!sqe)
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	efd = uring_get_sqe(ring);
+	if (efd)
+	{
+		if (__uring_prep(iocb, sqe) >= 0)
+		{
+			sqe->flags = IOSQE_IO_HARDLINK;
+			sqe->user_data = (unsigned long)iocb->data;
+			efd->opcode = IORING_OP_WRITE;
+			efd->fd = event_fd;
+			efd->addr = (unsigned long)&__uring_one;
+			efd->len = sizeof (unsigned long long);
+#ifdef IOSQE_CQE_SKIP_SUCCESS
+			if (uring_features(ring) & IORING_FEAT_CQE_SKIP)
+				efd->flags = IOSQE_CQE_SKIP_SUCCESS;
+#endif
+			if (uring_submit(0, ring) > 0)
+				return 0;
+		}
+	}
+	else
+		errno = EAGAIN;
+
+	/* Whatever is left in the queue completes harmlessly. */
+	sqe->opcode = IORING_OP_NOP;
+	sqe->flags = 0;
+	sqe->user_data = 0;
+	if (efd)
+	{
+		efd->opcode = IORING_OP_NOP;
+		efd->flags = 0;
+	}
+
+	return -1;
+}
+
+static IOSession *__uring_reap(int wait, uring_t *ring, long *res)
+{
+	struct io_uring_cqe *cqe;
+	IOSession *session;
+
+	while (1)
+	{
+		cqe = uring_peek_cqe(ring);
+		if (!cqe)
+		{
+			if (!wait)
+				break;
+
+			uring_wait(1, ring);
+			continue;
+		}
+
+		session = (IOSession *)cqe->user_data;
+		*res = cqe->res;
+		uring_cqe_seen(ring);
+		if (session)
+			return session;
+	}
+
+	return NULL;
+}
+
+#endif
+
+int IOService::init(int maxevents, int backend)
 {
 	int ret;
 
@@ -255,7 +380,15 @@ int IOService::init(int maxevents)
 	}
 
 	this->io_ctx = NULL;
+	this->ring = NULL;
+#ifdef HAVE_LINUX_IO_URING_H
+	if (backend == IOS_BACKEND_IO_URING)
+		this->ring = uring_create(maxevents);
+
+	if (this->ring || io_setup(maxevents, &this->io_ctx) >= 0)
+#else
 	if (io_setup(maxevents, &this->io_ctx) >= 0)
+#endif
 	{
 		ret = pthread_mutex_init(&this->mutex, NULL);
 		if (ret == 0)
@@ -266,6 +399,11 @@ int IOService::init(int maxevents)
 		}
 
 		errno = ret;
+#ifdef HAVE_LINUX_IO_URING_H
+		if (this->ring)
+			uring_destroy(this->ring);
+		else
+#endif
 		io_destroy(this->io_ctx);
 	}
 
@@ -275,6 +413,13 @@ int IOService::init(int maxevents)
 void IOService::deinit()
 {
 	pthread_mutex_destroy(&this->mutex);
+#ifdef HAVE_LINUX_IO_URING_H
+	if (this->ring)
+	{
+		uring_destroy(this->ring);
+		return;
+	}
+#endif
 	io_destroy(this->io_ctx);
 }
 
@@ -288,29 +433,43 @@ void IOService::decref()
 	IOSession *session;
 	struct io_event event;
 	int state, error;
+#ifdef HAVE_LINUX_IO_URING_H
+	long res;
+#endif
 
 	if (__sync_sub_and_fetch(&this->ref, 1) == 0)
 	{
 		while (!list_empty(&this->session_list))
 		{
+#ifdef HAVE_LINUX_IO_URING_H
+			if (this->ring)
+			{
+				session = __uring_reap(1, this->ring, &res);
+				session->res = res;
+			}
+			else
+#endif
 			if (io_getevents(this->io_ctx, 1, 1, &event, NULL) > 0)
 			{
 				session = (IOSession *)event.data;
-				list_del(&session->list);
 				session->res = event.res;
-				if (session->res >= 0)
-				{
-					state = IOS_STATE_SUCCESS;
-					error = 0;
-				}
-				else
-				{
-					state = IOS_STATE_ERROR;
-					error = -session->res;
-				}
-
-				session->handle(state, error);
 			}
+			else
+				continue;
+
+			list_del(&session->list);
+			if (session->res >= 0)
+			{
+				state = IOS_STATE_SUCCESS;
+				error = 0;
+			}
+			else
+			{
+				state = IOS_STATE_ERROR;
+				error = -session->res;
+			}
+
+			session->handle(state, error);
 		}
 
 		this->handle_unbound();
@@ -329,11 +488,16 @@ int IOService::request(IOSession *session)
 		{
 			io_set_eventfd(iocb, this->event_fd);
 			iocb->data = session;
+#ifdef HAVE_LINUX_IO_URING_H
+			if (this->ring)
+				ret = __uring_request(iocb, this->event_fd, this->ring);
+			else
+#endif
 			if (io_submit(this->io_ctx, 1, &iocb) > 0)
-			{
-				list_add_tail(&session->list, &this->session_list);
 				ret = 0;
-			}
+
+			if (ret == 0)
+				list_add_tail(&session->list, &this->session_list);
 		}
 	}
 	else
@@ -351,6 +515,26 @@ void *IOService::aio_finish(void *context)
 	IOService *service = (IOService *)context;
 	IOSession *session;
 	struct io_event event;
+#ifdef HAVE_LINUX_IO_URING_H
+	long res;
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+	if (service->ring)
+	{
+		/* The eventfd write of a request follows its completion. */
+		session = __uring_reap(0, service->ring, &res);
+		if (session)
+		{
+			service->incref();
+			session->res = res;
+		}
+		else
+			errno = EAGAIN;
+
+		return session;
+	}
+#endif
 
 	if (io_getevents(service->io_ctx, 1, 1, &event, NULL) > 0)
 	{
@@ -28,6 +28,9 @@
 #define IOS_STATE_SUCCESS	0
 #define IOS_STATE_ERROR		1
 
+#define IOS_BACKEND_DEFAULT		0
+#define IOS_BACKEND_IO_URING	1
+
 class IOSession
 {
 private:
@@ -64,7 +67,9 @@ public:
 class IOService
 {
 public:
-	int init(int maxevents);
+	/* 'backend' is IOS_BACKEND_DEFAULT (linux aio) or IOS_BACKEND_IO_URING.
+	 * Falls back to linux aio if io_uring is unavailable. */
+	int init(int maxevents, int backend = IOS_BACKEND_DEFAULT);
 	void deinit();
 
 	int request(IOSession *session);
@@ -81,6 +86,7 @@ private:
 
 private:
 	struct io_context *io_ctx;
+	struct __uring *ring;
 
 private:
 	void incref();
@@ -85,7 +85,7 @@ void IOSession::prep_fdsync(int fd)
 	this->op = IO_CMD_FDSYNC;
 }
 
-int IOService::init(int maxevents)
+int IOService::init(int maxevents, int backend)
 {
 	int ret = pthread_mutex_init(&this->mutex, NULL);
 
@@ -28,6 +28,9 @@
 #define IOS_STATE_SUCCESS	0
 #define IOS_STATE_ERROR		1
 
+#define IOS_BACKEND_DEFAULT		0
+#define IOS_BACKEND_IO_URING	1
+
 class IOSession
 {
 private:
@@ -70,7 +73,8 @@ public:
 class IOService
 {
 public:
-	int init(int maxevents);
+	/* 'backend' is ignored, all backends run on threads. */
+	int init(int maxevents, int backend = IOS_BACKEND_DEFAULT);
 	void deinit();
 
 	int request(IOSession *session);
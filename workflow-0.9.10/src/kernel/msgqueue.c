@@ -26,9 +26,23 @@
  * well when the queue is very busy, and the number of consumers is big.
  */
 
+/*
+ * The lock-free flavor keeps the same idea without the put_mutex. Producers
+ * push onto a stack with CAS. A consumer takes the whole stack at once and
+ * reverses it into the get_list. Sleeping consumers and blocked producers
+ * park on futexes, which are only woken when someone is known to be waiting,
+ * so a busy queue makes no syscalls.
+ */
+
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <pthread.h>
+#ifdef __linux__
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
 #include "msgqueue.h"
 
 struct __msgqueue
@@ -46,11 +60,55 @@ struct __msgqueue
 	pthread_mutex_t put_mutex;
 	pthread_cond_t get_cond;
 	pthread_cond_t put_cond;
+	int lockfree;
+	/* Lock-free mode only. Written by producers, kept off the line above. */
+	void *volatile stack __attribute__((aligned(64)));
+	volatile size_t stack_cnt;
+	volatile int get_waiting;
+	volatile int put_waiting;
 };
 
+#ifdef __linux__
+
+static inline void __futex_wait(volatile int *addr, int val)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void __futex_wake(volatile int *addr, int n)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* A waiter sets the flag and sleeps on it. Only the one who clears the flag
+ * makes the wake up call, and a waiter that has not slept yet won't. */
+static inline void __msgqueue_park(volatile int *waiting)
+{
+	__futex_wait(waiting, 1);
+}
+
+static inline void __msgqueue_unpark(volatile int *waiting, int n)
+{
+	if (*waiting && __sync_bool_compare_and_swap(waiting, 1, 0))
+		__futex_wake(waiting, n);
+}
+
+#endif
+
 void msgqueue_set_nonblock(msgqueue_t *queue)
 {
 	queue->nonblock = 1;
+#ifdef __linux__
+	if (queue->lockfree)
+	{
+		queue->get_waiting = 0;
+		__futex_wake(&queue->get_waiting, INT_MAX);
+		queue->put_waiting = 0;
+		__futex_wake(&queue->put_waiting, INT_MAX);
+		return;
+	}
+#endif
+
 	pthread_mutex_lock(&queue->put_mutex);
 	pthread_cond_signal(&queue->get_cond);
 	pthread_cond_broadcast(&queue->put_cond);
@@ -62,11 +120,82 @@ void msgqueue_set_block(msgqueue_t *queue)
 	queue->nonblock = 0;
 }
 
+#ifdef __linux__
+
+static size_t __msgqueue_swap_lockfree(msgqueue_t *queue)
+{
+	void **first = NULL;
+	void **link;
+	void **next;
+	size_t cnt = 0;
+
+	/* Consumers are serialized by get_mutex, only one can be waiting. */
+	while (1)
+	{
+		link = (void **)__sync_lock_test_and_set(&queue->stack, NULL);
+		if (link || queue->nonblock)
+			break;
+
+		__sync_val_compare_and_swap(&queue->get_waiting, 0, 1);
+		if (!queue->stack && !queue->nonblock)
+			__msgqueue_park(&queue->get_waiting);
+	}
+
+	/* The stack is newest first. Reverse it to keep messages in order. */
+	while (link)
+	{
+		next = (void **)*link;
+		*link = first;
+		first = link;
+		link = next;
+		cnt++;
+	}
+
+	*queue->get_head = first;
+	if (cnt > 0)
+	{
+		__sync_sub_and_fetch(&queue->stack_cnt, cnt);
+		__msgqueue_unpark(&queue->put_waiting, INT_MAX);
+	}
+
+	return cnt;
+}
+
+static void __msgqueue_put_lockfree(void **link, msgqueue_t *queue)
+{
+	void *head;
+
+	while (queue->stack_cnt > queue->msg_max - 1 && !queue->nonblock)
+	{
+		__sync_val_compare_and_swap(&queue->put_waiting, 0, 1);
+		if (queue->stack_cnt > queue->msg_max - 1 && !queue->nonblock)
+			__msgqueue_park(&queue->put_waiting);
+	}
+
+	/* Counted before pushed, so that a consumer never takes more than
+	 * the count. Only whole stacks are taken, so there is no ABA. */
+	__sync_add_and_fetch(&queue->stack_cnt, 1);
+	do
+	{
+		head = queue->stack;
+		*link = head;
+	} while (!__sync_bool_compare_and_swap(&queue->stack, head, link));
+
+	__msgqueue_unpark(&queue->get_waiting, 1);
+}
+
+#endif
+
 static size_t __msgqueue_swap(msgqueue_t *queue)
 {
 	void **get_head = queue->get_head;
 	size_t cnt;
 
+#ifdef __linux__
+	if (queue->lockfree)
+		return __msgqueue_swap_lockfree(queue);
+#endif
+
 	queue->get_head = queue->put_head;
 	pthread_mutex_lock(&queue->put_mutex);
 	while (queue->msg_cnt == 0 && !queue->nonblock)
@@ -87,6 +216,14 @@ void msgqueue_put(void *msg, msgqueue_t *queue)
 {
 	void **link = (void **)((char *)msg + queue->linkoff);
 
+#ifdef __linux__
+	if (queue->lockfree)
+	{
+		__msgqueue_put_lockfree(link, queue);
+		return;
+	}
+#endif
+
 	*link = NULL;
 	pthread_mutex_lock(&queue->put_mutex);
 	while (queue->msg_cnt > queue->msg_max - 1 && !queue->nonblock)
@@ -148,6 +285,11 @@ msgqueue_t *msgqueue_create(size_t maxlen, int linkoff)
 					queue->put_tail = &queue->head2;
 					queue->msg_cnt = 0;
 					queue->nonblock = 0;
+					queue->lockfree = 0;
+					queue->stack = NULL;
+					queue->stack_cnt = 0;
+					queue->get_waiting = 0;
+					queue->put_waiting = 0;
 					return queue;
 				}
 
@@ -165,6 +307,18 @@ msgqueue_t *msgqueue_create(size_t maxlen, int linkoff)
 	return NULL;
 }
 
+msgqueue_t *msgqueue_create_lockfree(size_t maxlen, int linkoff)
+{
+	msgqueue_t *queue = msgqueue_create(maxlen, linkoff);
+
+#ifdef __linux__
+	if (queue)
+		queue->lockfree = 1;
+#endif
+
+	return queue;
+}
+
 void msgqueue_destroy(msgqueue_t *queue)
 {
 	pthread_cond_destroy(&queue->put_cond);
@@ -35,6 +35,11 @@ extern "C"
  * 'linkoff' can be positive or negative or zero. */
 
 msgqueue_t *msgqueue_create(size_t maxlen, int linkoff);
+
+/* Same interface, but putting is lock-free and getting takes all pending
+ * messages in one batch. Consumers and blocked producers park on futexes.
+ * Falls back to the queue above on systems without futex. */
+msgqueue_t *msgqueue_create_lockfree(size_t maxlen, int linkoff);
 void msgqueue_put(void *msg, msgqueue_t *queue);
 void *msgqueue_get(msgqueue_t *queue);
 void msgqueue_set_nonblock(msgqueue_t *queue);
@@ -22,6 +22,9 @@
 #ifdef __linux__
 # include <sys/epoll.h>
 # include <sys/timerfd.h>
+# ifdef HAVE_LINUX_IO_URING_H
+#  include "uring.h"
+# endif
 #else
 # include <sys/event.h>
 # undef LIST_HEAD
@@ -61,6 +64,10 @@ struct __poller_node
 	int event;
 	struct timespec timeout;
 	struct __poller_node *res;
+#ifdef HAVE_LINUX_IO_URING_H
+	unsigned int gen;
+	unsigned int reaped;
+#endif
 };
 
 struct __poller
@@ -84,16 +91,278 @@ struct __poller
 	struct list_head no_timeo_list;
 	struct __poller_node **nodes;
 	pthread_mutex_t mutex;
+#ifdef HAVE_LINUX_IO_URING_H
+	uring_t *ring;
+	unsigned int gen;
+	unsigned int reaps;
+#endif
 	char buf[POLLER_BUFSIZE];
 };
 
 #ifdef __linux__
 
-static inline int __poller_create_pfd()
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* With io_uring, readiness of every fd is watched by a multishot poll SQE.
+ * Only readiness: reads, writes and accepts are still done by the handlers
+ * below with system calls, as with epoll. SQEs queued by the poller thread
+ * itself are batched and submitted together with the next wait, other
+ * threads submit at once. The user_data of a poll carries the fd and a
+ * generation number, so that completions of polls that have been removed or
+ * replaced are recognized and dropped. */
+
+#define POLLER_URING_ENTRIES	1024
+#define POLLER_URING_REMOVE		0ULL
+#define POLLER_URING_PIPE		1ULL
+#define POLLER_URING_TIMER		2ULL
+
+static inline void __poller_tree_erase(struct __poller_node *node,
+									   poller_t *poller);
+
+static inline unsigned long long __poller_uring_data(const void *data)
+{
+	const struct __poller_node *node = (const struct __poller_node *)data;
+
+	if (!node)
+		return POLLER_URING_TIMER;
+
+	if (node == (const struct __poller_node *)1)
+		return POLLER_URING_PIPE;
+
+	return ((unsigned long long)node->gen << 32) | (unsigned int)node->data.fd;
+}
+
+static struct io_uring_sqe *__poller_uring_sqe(poller_t *poller)
+{
+	struct io_uring_sqe *sqe;
+
+	while (!(sqe = uring_get_sqe(poller->ring)))
+	{
+		if (uring_submit(0, poller->ring) < 0 && errno != EAGAIN)
+			return NULL;
+	}
+
+	return sqe;
+}
+
+static int __poller_uring_commit(poller_t *poller)
+{
+	if (poller->stopped || !pthread_equal(pthread_self(), poller->tid))
+		return uring_submit(0, poller->ring) >= 0 ? 0 : -1;
+
+	return 0;
+}
+
+static int __poller_uring_poll(unsigned long long user_data, int fd, int event,
+							   poller_t *poller)
+{
+	struct io_uring_sqe *sqe = __poller_uring_sqe(poller);
+
+	if (!sqe)
+		return -1;
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = event;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = user_data;
+	return 0;
+}
+
+static int __poller_uring_remove(unsigned long long user_data,
+								 poller_t *poller)
+{
+	struct io_uring_sqe *sqe = __poller_uring_sqe(poller);
+
+	if (!sqe)
+		return -1;
+
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = user_data;
+	sqe->user_data = POLLER_URING_REMOVE;
+	return 0;
+}
+
+static int __poller_uring_add_fd(int fd, int event, void *data,
+								 poller_t *poller)
+{
+	struct __poller_node *node = (struct __poller_node *)data;
+
+	if (node > (struct __poller_node *)1)
+	{
+		if (++poller->gen == 0)
+			poller->gen = 1;
+
+		node->gen = poller->gen;
+		node->reaped = poller->reaps - 1;
+	}
+
+	if (__poller_uring_poll(__poller_uring_data(data), fd, event, poller) < 0)
+		return -1;
+
+	return __poller_uring_commit(poller);
+}
+
+/* The node being removed or replaced is still in poller->nodes[fd]. */
+static int __poller_uring_del_fd(int fd, poller_t *poller)
+{
+	const struct __poller_node *old = poller->nodes[fd];
+
+	if (__poller_uring_remove(__poller_uring_data(old), poller) < 0)
+		return -1;
+
+	return __poller_uring_commit(poller);
+}
+
+static int __poller_uring_mod_fd(int fd, int new_event, void *data,
+								 poller_t *poller)
+{
+	const struct __poller_node *old = poller->nodes[fd];
+
+	if (__poller_uring_remove(__poller_uring_data(old), poller) < 0)
+		return -1;
+
+	return __poller_uring_add_fd(fd, new_event, data, poller);
+}
+
+static int __poller_uring_wait(struct epoll_event *events, int maxevents,
+							   poller_t *poller)
+{
+	struct __poller_node *node;
+	struct io_uring_cqe *cqe;
+	struct list_head error_list;
+	unsigned long long data;
+	int nevents = 0;
+	int fd;
+
+	pthread_mutex_lock(&poller->mutex);
+	uring_submit(0, poller->ring);
+	pthread_mutex_unlock(&poller->mutex);
+
+	if (!uring_peek_cqe(poller->ring))
+	{
+		if (uring_wait(1, poller->ring) < 0 && errno != EINTR)
+			return -1;
+	}
+
+	INIT_LIST_HEAD(&error_list);
+	pthread_mutex_lock(&poller->mutex);
+	poller->reaps++;
+	while (nevents < maxevents && (cqe = uring_peek_cqe(poller->ring)))
+	{
+		data = cqe->user_data;
+		if (data == POLLER_URING_PIPE || data == POLLER_URING_TIMER)
+		{
+			node = data == POLLER_URING_PIPE ? (struct __poller_node *)1 : NULL;
+			fd = node ? poller->pipe_rd : poller->timerfd;
+		}
+		else if (data != POLLER_URING_REMOVE)
+		{
+			fd = (int)(unsigned int)data;
+			node = poller->nodes[fd];
+			if (!node || node->gen != (unsigned int)(data >> 32))
+				data = POLLER_URING_REMOVE;
+		}
+
+		/* A failed poll is over. Finish the node with the error, as a
+		 * timeout does, but not while it is among the events reported. */
+		if (data != POLLER_URING_REMOVE && cqe->res < 0 &&
+			cqe->res != -ECANCELED && node > (struct __poller_node *)1)
+		{
+			if (node->reaped == poller->reaps)
+				break;
+
+			poller->nodes[fd] = NULL;
+			if (node->in_rbtree)
+				__poller_tree_erase(node, poller);
+			else
+				list_del(&node->list);
+
+			node->error = -cqe->res;
+			list_add_tail(&node->list, &error_list);
+			data = POLLER_URING_REMOVE;
+		}
+
+		if (data != POLLER_URING_REMOVE && cqe->res != -ECANCELED)
+		{
+			/* A multishot poll may be terminated by the kernel. Arm it again. */
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+			{
+				__poller_uring_poll(data, fd, node > (struct __poller_node *)1 ?
+												node->event :
+												EPOLLIN | EPOLLET,
+									poller);
+			}
+
+			/* Like epoll, report a node at most once per wait. */
+			if (node > (struct __poller_node *)1)
+			{
+				if (node->reaped == poller->reaps)
+					data = POLLER_URING_REMOVE;
+				else
+					node->reaped = poller->reaps;
+			}
+
+			if (data != POLLER_URING_REMOVE)
+			{
+				events[nevents].events = cqe->res >= 0 ? cqe->res : EPOLLERR;
+				events[nevents].data.ptr = node;
+				nevents++;
+			}
+		}
+
+		uring_cqe_seen(poller->ring);
+	}
+
+	pthread_mutex_unlock(&poller->mutex);
+	while (!list_empty(&error_list))
+	{
+		node = list_entry(error_list.next, struct __poller_node, list);
+		list_del(&node->list);
+
+		node->state = PR_ST_ERROR;
+		free(node->res);
+		poller->cb((struct poller_result *)node, poller->ctx);
+	}
+
+	return nevents;
+}
+
+#endif
+
+static inline int __poller_create_pfd(const struct poller_params *params,
+									  poller_t *poller)
 {
+#ifdef HAVE_LINUX_IO_URING_H
+	poller->ring = NULL;
+	poller->gen = 0;
+	poller->reaps = 0;
+	if (params->backend == POLLER_BACKEND_URING_POLL)
+	{
+		/* Fall back to epoll if io_uring is not available. */
+		poller->ring = uring_create(POLLER_URING_ENTRIES);
+		if (poller->ring)
+			return uring_fd(poller->ring);
+	}
+#endif
+
 	return epoll_create(1);
 }
 
+static inline void __poller_close_pfd(poller_t *poller)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+	{
+		uring_destroy(poller->ring);
+		return;
+	}
+#endif
+
+	close(poller->pfd);
+}
+
 static inline int __poller_add_fd(int fd, int event, void *data,
 								  poller_t *poller)
 {
@@ -103,11 +372,22 @@ static inline int __poller_add_fd(int fd, int event, void *data,
 			.ptr	=	data
 		}
 	};
+
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+		return __poller_uring_add_fd(fd, event, data, poller);
+#endif
+
 	return epoll_ctl(poller->pfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
 static inline int __poller_del_fd(int fd, int event, poller_t *poller)
 {
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+		return __poller_uring_del_fd(fd, poller);
+#endif
+
 	return epoll_ctl(poller->pfd, EPOLL_CTL_DEL, fd, NULL);
 }
 
@@ -121,6 +401,12 @@ static inline int __poller_mod_fd(int fd, int old_event,
 			.ptr	=	data
 		}
 	};
+
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+		return __poller_uring_mod_fd(fd, new_event, data, poller);
+#endif
+
 	return epoll_ctl(poller->pfd, EPOLL_CTL_MOD, fd, &ev);
 }
 
@@ -137,6 +423,12 @@ static inline int __poller_add_timerfd(int fd, poller_t *poller)
 			.ptr	=	NULL
 		}
 	};
+
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+		return __poller_uring_add_fd(fd, EPOLLIN | EPOLLET, NULL, poller);
+#endif
+
 	return epoll_ctl(poller->pfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
@@ -155,6 +447,11 @@ typedef struct epoll_event __poller_event_t;
 static inline int __poller_wait(__poller_event_t *events, int maxevents,
 								poller_t *poller)
 {
+#ifdef HAVE_LINUX_IO_URING_H
+	if (poller->ring)
+		return __poller_uring_wait(events, maxevents, poller);
+#endif
+
 	return epoll_wait(poller->pfd, events, maxevents, -1);
 }
 
@@ -165,11 +462,17 @@ static inline void *__poller_event_data(const __poller_event_t *event)
 
 #else /* BSD, macOS */
 
-static inline int __poller_create_pfd()
+static inline int __poller_create_pfd(const struct poller_params *params,
+									  poller_t *poller)
 {
 	return kqueue();
 }
 
+static inline void __poller_close_pfd(poller_t *poller)
+{
+	close(poller->pfd);
+}
+
 static inline int __poller_add_fd(int fd, int event, void *data,
 								  poller_t *poller)
 {
@@ -320,14 +623,13 @@ static int __poller_remove_node(struct __poller_node *node, poller_t *poller)
 	removed = node->removed;
 	if (!removed)
 	{
+		__poller_del_fd(node->data.fd, node->event, poller);
 		poller->nodes[node->data.fd] = NULL;
 
 		if (node->in_rbtree)
 			__poller_tree_erase(node, poller);
 		else
 			list_del(&node->list);
-
-		__poller_del_fd(node->data.fd, node->event, poller);
 	}
 
 	pthread_mutex_unlock(&poller->mutex);
@@ -413,6 +715,29 @@ static int __poller_handle_ssl_error(struct __poller_node *node, int ret,
 	return ret;
 }
 
+static char *__poller_read_buffer(size_t *n, struct __poller_node *node,
+								  poller_t *poller)
+{
+	poller_message_t *msg = node->data.message;
+	char *p;
+
+	/* Let the message receive in place, saving a copy from poller->buf. */
+	if (msg && msg->get_buffer)
+	{
+		p = (char *)msg->get_buffer(n, msg);
+		if (p)
+		{
+			if (*n > INT_MAX)
+				*n = INT_MAX;
+
+			return p;
+		}
+	}
+
+	*n = POLLER_BUFSIZE;
+	return poller->buf;
+}
+
 static void __poller_handle_read(struct __poller_node *node,
 								 poller_t *poller)
 {
@@ -422,10 +747,10 @@ static void __poller_handle_read(struct __poller_node *node,
 
 	while (1)
 	{
-		p = poller->buf;
+		p = __poller_read_buffer(&n, node, poller);
 		if (!node->data.ssl)
 		{
-			nleft = read(node->data.fd, p, POLLER_BUFSIZE);
+			nleft = read(node->data.fd, p, n);
 			if (nleft < 0)
 			{
 				if (errno == EAGAIN)
@@ -434,7 +759,7 @@ static void __poller_handle_read(struct __poller_node *node,
 		}
 		else
 		{
-			nleft = SSL_read(node->data.ssl, p, POLLER_BUFSIZE);
+			nleft = SSL_read(node->data.ssl, p, n);
 			if (nleft < 0)
 			{
 				if (__poller_handle_ssl_error(node, nleft, poller) >= 0)
@@ -878,8 +1203,8 @@ static void __poller_handle_timeout(const struct __poller_node *time_node,
 		{
 			if (node->data.fd >= 0)
 			{
-				poller->nodes[node->data.fd] = NULL;
 				__poller_del_fd(node->data.fd, node->event, poller);
+				poller->nodes[node->data.fd] = NULL;
 			}
 
 			list_move_tail(pos, &timeo_list);
@@ -897,8 +1222,8 @@ static void __poller_handle_timeout(const struct __poller_node *time_node,
 			{
 				if (node->data.fd >= 0)
 				{
-					poller->nodes[node->data.fd] = NULL;
 					__poller_del_fd(node->data.fd, node->event, poller);
+					poller->nodes[node->data.fd] = NULL;
 				}
 
 				poller->tree_first = rb_next(poller->tree_first);
@@ -1037,6 +1362,11 @@ static int __poller_open_pipe(poller_t *poller)
 
 	if (pipe(pipefd) >= 0)
 	{
+#ifdef HAVE_LINUX_IO_URING_H
+		/* io_uring may report the pipe again after it has been drained. */
+		if (poller->ring)
+			fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+#endif
 		if (__poller_add_fd(pipefd[0], EPOLLIN, (void *)1, poller) >= 0)
 		{
 			poller->pipe_rd = pipefd[0];
@@ -1077,7 +1407,8 @@ poller_t *__poller_create(void **nodes_buf, const struct poller_params *params)
 	if (!poller)
 		return NULL;
 
-	poller->pfd = __poller_create_pfd();
+	poller->stopped = 1;
+	poller->pfd = __poller_create_pfd(params, poller);
 	if (poller->pfd >= 0)
 	{
 		if (__poller_create_timer(poller) >= 0)
@@ -1097,8 +1428,6 @@ poller_t *__poller_create(void **nodes_buf, const struct poller_params *params)
 				poller->tree_last = NULL;
 				INIT_LIST_HEAD(&poller->timeo_list);
 				INIT_LIST_HEAD(&poller->no_timeo_list);
-
-				poller->stopped = 1;
 				return poller;
 			}
 
@@ -1106,7 +1435,7 @@ poller_t *__poller_create(void **nodes_buf, const struct poller_params *params)
 			close(poller->timerfd);
 		}
 
-		close(poller->pfd);
+		__poller_close_pfd(poller);
 	}
 
 	free(poller);
@@ -1134,7 +1463,7 @@ void __poller_destroy(poller_t *poller)
 {
 	pthread_mutex_destroy(&poller->mutex);
 	close(poller->timerfd);
-	close(poller->pfd);
+	__poller_close_pfd(poller);
 	free(poller);
 }
 
@@ -1323,6 +1652,7 @@ int poller_del(int fd, poller_t *poller)
 	node = poller->nodes[fd];
 	if (node)
 	{
+		__poller_del_fd(fd, node->event, poller);
 		poller->nodes[fd] = NULL;
 
 		if (node->in_rbtree)
@@ -1330,8 +1660,6 @@ int poller_del(int fd, poller_t *poller)
 		else
 			list_del(&node->list);
 
-		__poller_del_fd(fd, node->event, poller);
-
 		node->error = 0;
 		node->state = PR_ST_DELETED;
 		if (poller->stopped)
@@ -1540,8 +1868,8 @@ void poller_stop(poller_t *poller)
 		list_del(&node->list);
 		if (node->data.fd >= 0)
 		{
-			poller->nodes[node->data.fd] = NULL;
 			__poller_del_fd(node->data.fd, node->event, poller);
+			poller->nodes[node->data.fd] = NULL;
 		}
 
 		node->error = 0;
@@ -30,6 +30,9 @@ typedef struct __poller_message poller_message_t;
 struct __poller_message
 {
 	int (*append)(const void *, size_t *, poller_message_t *);
+	/* Optional. Returns a buffer of '*size' bytes to read into directly, and
+	 * the bytes read are appended at that same address. NULL if none. */
+	void *(*get_buffer)(size_t *, poller_message_t *);
 	char data[0];
 };
 
@@ -87,6 +90,9 @@ struct poller_params
 	int (*partial_written)(size_t, void *);
 	void (*callback)(struct poller_result *, void *);
 	void *context;
+#define POLLER_BACKEND_DEFAULT		0
+#define POLLER_BACKEND_URING_POLL	1
+	int backend;
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,226 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/io_uring.h>
+#include "uring.h"
+
+struct __uring
+{
+	int fd;
+	int features;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_array;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+	unsigned int sqe_tail;
+	struct io_uring_sqe *sqes;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+};
+
+static inline int __sys_io_uring_setup(unsigned int entries,
+									   struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int __sys_io_uring_enter(int fd, unsigned int to_submit,
+									   unsigned int min_complete,
+									   unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+				   NULL, 0);
+}
+
+static int __uring_mmap(const struct io_uring_params *p, uring_t *ring)
+{
+	char *sq;
+	char *cq;
+
+	ring->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof (unsigned int);
+	ring->cq_ring_size = p->cq_off.cqes +
+						 p->cq_entries * sizeof (struct io_uring_cqe);
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+						 MAP_SHARED | MAP_POPULATE, ring->fd,
+						 IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED)
+		return -1;
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ring = ring->sq_ring;
+	else
+	{
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+							 MAP_SHARED | MAP_POPULATE, ring->fd,
+							 IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED)
+		{
+			munmap(ring->sq_ring, ring->sq_ring_size);
+			return -1;
+		}
+	}
+
+	ring->sqes_size = p->sq_entries * sizeof (struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size,
+											 PROT_READ | PROT_WRITE,
+											 MAP_SHARED | MAP_POPULATE,
+											 ring->fd, IORING_OFF_SQES);
+	if (ring->sqes != MAP_FAILED)
+	{
+		sq = (char *)ring->sq_ring;
+		cq = (char *)ring->cq_ring;
+		ring->sq_head = (unsigned int *)(sq + p->sq_off.head);
+		ring->sq_tail = (unsigned int *)(sq + p->sq_off.tail);
+		ring->sq_array = (unsigned int *)(sq + p->sq_off.array);
+		ring->sq_mask = *(unsigned int *)(sq + p->sq_off.ring_mask);
+		ring->sq_entries = *(unsigned int *)(sq + p->sq_off.ring_entries);
+		ring->sqe_tail = *ring->sq_tail;
+		ring->cq_head = (unsigned int *)(cq + p->cq_off.head);
+		ring->cq_tail = (unsigned int *)(cq + p->cq_off.tail);
+		ring->cq_mask = *(unsigned int *)(cq + p->cq_off.ring_mask);
+		ring->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+		return 0;
+	}
+
+	if (ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	return -1;
+}
+
+uring_t *uring_create(unsigned int entries)
+{
+	uring_t *ring = (uring_t *)malloc(sizeof (uring_t));
+	struct io_uring_params params;
+
+	if (!ring)
+		return NULL;
+
+	memset(&params, 0, sizeof (struct io_uring_params));
+	ring->fd = __sys_io_uring_setup(entries, &params);
+	if (ring->fd >= 0)
+	{
+		if (__uring_mmap(&params, ring) >= 0)
+		{
+			ring->features = params.features;
+			return ring;
+		}
+
+		close(ring->fd);
+	}
+
+	free(ring);
+	return NULL;
+}
+
+int uring_features(uring_t *ring)
+{
+	return ring->features;
+}
+
+int uring_fd(uring_t *ring)
+{
+	return ring->fd;
+}
+
+struct io_uring_sqe *uring_get_sqe(uring_t *ring)
+{
+	unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	struct io_uring_sqe *sqe;
+
+	if (ring->sqe_tail - head >= ring->sq_entries)
+		return NULL;
+
+	sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+	ring->sq_array[ring->sqe_tail & ring->sq_mask] = ring->sqe_tail & ring->sq_mask;
+	ring->sqe_tail++;
+	memset(sqe, 0, sizeof (struct io_uring_sqe));
+	return sqe;
+}
+
+int uring_submit(unsigned int wait_nr, uring_t *ring)
+{
+	unsigned int flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+	unsigned int to_submit;
+	int ret;
+
+	/* SQEs left unconsumed by a previous short submit are counted again. */
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+	to_submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	if (to_submit == 0 && wait_nr == 0)
+		return 0;
+
+	do
+	{
+		ret = __sys_io_uring_enter(ring->fd, to_submit, wait_nr, flags);
+	} while (ret < 0 && errno == EINTR && wait_nr == 0);
+
+	return ret;
+}
+
+int uring_wait(unsigned int wait_nr, uring_t *ring)
+{
+	return __sys_io_uring_enter(ring->fd, 0, wait_nr, IORING_ENTER_GETEVENTS);
+}
+
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring)
+{
+	unsigned int head = *ring->cq_head;
+
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_cqe_seen(uring_t *ring)
+{
+	__atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+void uring_destroy(uring_t *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+	free(ring);
+}
+
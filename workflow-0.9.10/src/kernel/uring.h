@@ -0,0 +1,60 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <linux/io_uring.h>
+
+typedef struct __uring uring_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A minimal io_uring ring over the raw system calls, no liburing needed.
+ * Submission side is not thread safe, callers serialize uring_get_sqe()
+ * and uring_submit() with their own lock. Completion side has to be
+ * consumed by one thread at a time. */
+
+uring_t *uring_create(unsigned int entries);
+int uring_features(uring_t *ring);
+int uring_fd(uring_t *ring);
+
+/* Returns NULL when the submission queue is full, uring_submit() then retry.
+ * The returned SQE is zeroed. */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+/* Submit all queued SQEs and wait for at least 'wait_nr' completions. */
+int uring_submit(unsigned int wait_nr, uring_t *ring);
+
+/* Wait for at least 'wait_nr' completions without touching the submission
+ * queue, so it may run concurrently with a locked uring_submit(). */
+int uring_wait(unsigned int wait_nr, uring_t *ring);
+
+/* Returns NULL when the completion queue is empty. */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+void uring_cqe_seen(uring_t *ring);
+
+void uring_destroy(uring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,486 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+#include "wspool.h"
+
+struct __wspool_worker
+{
+	struct list_head task_queue;
+	volatile size_t ntasks;
+	volatile int sleeping;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	wspool_t *pool;
+	char pad[64];
+};
+
+struct __wspool
+{
+	size_t nworkers;
+	size_t nthreads;
+	size_t stacksize;
+	pthread_t tid;
+	pthread_mutex_t mutex;
+	pthread_key_t key;
+	pthread_cond_t *volatile terminate;
+	volatile size_t idle;
+	size_t next;
+	struct __wspool_worker *workers;
+};
+
+/* Same as the entry of thrdpool, so that a buffer fits both. */
+struct __wspool_task_entry
+{
+	struct list_head list;
+	struct thrdpool_task task;
+};
+
+static pthread_t __zero_tid;
+
+static struct __wspool_task_entry *__wspool_pop(struct __wspool_worker *worker)
+{
+	struct __wspool_task_entry *entry = NULL;
+
+	pthread_mutex_lock(&worker->mutex);
+	if (!list_empty(&worker->task_queue))
+	{
+		entry = list_entry(worker->task_queue.next,
+						   struct __wspool_task_entry, list);
+		list_del(&entry->list);
+		worker->ntasks--;
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+	return entry;
+}
+
+static struct __wspool_task_entry *__wspool_steal(struct __wspool_worker *thief,
+												  wspool_t *pool)
+{
+	size_t n = pool->nworkers;
+	size_t i = thief - pool->workers;
+	struct __wspool_worker *victim;
+	struct __wspool_task_entry *entry;
+	struct list_head stolen;
+	size_t cnt;
+	size_t k;
+
+	INIT_LIST_HEAD(&stolen);
+	for (k = 1; k < n; k++)
+	{
+		victim = &pool->workers[(i + k) % n];
+		if (victim->ntasks == 0)
+			continue;
+
+		/* Take the older half, these are the next to run anyway. */
+		pthread_mutex_lock(&victim->mutex);
+		cnt = (victim->ntasks + 1) / 2;
+		victim->ntasks -= cnt;
+		while (cnt > 0)
+		{
+			list_move_tail(victim->task_queue.next, &stolen);
+			cnt--;
+		}
+
+		pthread_mutex_unlock(&victim->mutex);
+		if (!list_empty(&stolen))
+		{
+			entry = list_entry(stolen.next, struct __wspool_task_entry, list);
+			list_del(&entry->list);
+			if (!list_empty(&stolen))
+			{
+				pthread_mutex_lock(&thief->mutex);
+				for (cnt = 0; stolen.next != &stolen; cnt++)
+					list_move_tail(stolen.next, &thief->task_queue);
+
+				thief->ntasks += cnt;
+				pthread_mutex_unlock(&thief->mutex);
+			}
+
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void __wspool_wait(struct __wspool_worker *worker, wspool_t *pool)
+{
+	size_t i;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->sleeping = 1;
+	pthread_mutex_unlock(&worker->mutex);
+
+	/* Counted as idle before the last look, so that a scheduler either
+	 * sees us idle, or we see its task. */
+	__sync_add_and_fetch(&pool->idle, 1);
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		if (pool->workers[i].ntasks != 0)
+			break;
+	}
+
+	pthread_mutex_lock(&worker->mutex);
+	if (i == pool->nworkers)
+	{
+		while (worker->sleeping && !pool->terminate)
+			pthread_cond_wait(&worker->cond, &worker->mutex);
+	}
+
+	worker->sleeping = 0;
+	pthread_mutex_unlock(&worker->mutex);
+	__sync_sub_and_fetch(&pool->idle, 1);
+}
+
+static void __wspool_wake_one(struct __wspool_worker *from, wspool_t *pool)
+{
+	size_t n = pool->nworkers;
+	size_t i = from - pool->workers;
+	struct __wspool_worker *worker;
+	size_t k;
+
+	for (k = 1; k < n; k++)
+	{
+		worker = &pool->workers[(i + k) % n];
+		if (!worker->sleeping)
+			continue;
+
+		pthread_mutex_lock(&worker->mutex);
+		if (worker->sleeping)
+		{
+			worker->sleeping = 0;
+			pthread_cond_signal(&worker->cond);
+			pthread_mutex_unlock(&worker->mutex);
+			break;
+		}
+
+		pthread_mutex_unlock(&worker->mutex);
+	}
+}
+
+static void *__wspool_routine(void *arg)
+{
+	struct __wspool_worker *worker = (struct __wspool_worker *)arg;
+	wspool_t *pool = worker->pool;
+	struct __wspool_task_entry *entry;
+	void (*task_routine)(void *);
+	void *task_context;
+	pthread_t tid;
+
+	pthread_setspecific(pool->key, worker);
+	while (!pool->terminate)
+	{
+		entry = __wspool_pop(worker);
+		if (!entry)
+		{
+			entry = __wspool_steal(worker, pool);
+			if (!entry)
+			{
+				__wspool_wait(worker, pool);
+				continue;
+			}
+		}
+
+		task_routine = entry->task.routine;
+		task_context = entry->task.context;
+		free(entry);
+		task_routine(task_context);
+
+		if (pool->nthreads == 0)
+		{
+			/* Thread pool was destroyed by the task. */
+			free(pool->workers);
+			free(pool);
+			return NULL;
+		}
+	}
+
+	/* One thread joins another. Don't need to keep all thread IDs. */
+	pthread_mutex_lock(&pool->mutex);
+	tid = pool->tid;
+	pool->tid = pthread_self();
+	if (--pool->nthreads == 0)
+		pthread_cond_signal(pool->terminate);
+
+	pthread_mutex_unlock(&pool->mutex);
+	if (memcmp(&tid, &__zero_tid, sizeof (pthread_t)) != 0)
+		pthread_join(tid, NULL);
+
+	return NULL;
+}
+
+static void __wspool_terminate(int in_pool, wspool_t *pool)
+{
+	pthread_cond_t term = PTHREAD_COND_INITIALIZER;
+	struct __wspool_worker *worker;
+	size_t i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->terminate = &term;
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		worker = &pool->workers[i];
+		pthread_mutex_lock(&worker->mutex);
+		pthread_cond_signal(&worker->cond);
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	if (in_pool)
+	{
+		/* Thread pool destroyed in a pool thread is legal. */
+		pthread_detach(pthread_self());
+		pool->nthreads--;
+	}
+
+	while (pool->nthreads > 0)
+		pthread_cond_wait(&term, &pool->mutex);
+
+	pthread_mutex_unlock(&pool->mutex);
+	if (memcmp(&pool->tid, &__zero_tid, sizeof (pthread_t)) != 0)
+		pthread_join(pool->tid, NULL);
+}
+
+static int __wspool_create_threads(wspool_t *pool)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+	int ret;
+
+	ret = pthread_attr_init(&attr);
+	if (ret == 0)
+	{
+		if (pool->stacksize)
+			pthread_attr_setstacksize(&attr, pool->stacksize);
+
+		while (pool->nthreads < pool->nworkers)
+		{
+			ret = pthread_create(&tid, &attr, __wspool_routine,
+								 &pool->workers[pool->nthreads]);
+			if (ret == 0)
+				pool->nthreads++;
+			else
+				break;
+		}
+
+		pthread_attr_destroy(&attr);
+		if (pool->nthreads == pool->nworkers)
+			return 0;
+
+		__wspool_terminate(0, pool);
+	}
+
+	errno = ret;
+	return -1;
+}
+
+static int __wspool_init_workers(wspool_t *pool)
+{
+	struct __wspool_worker *worker;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		worker = &pool->workers[i];
+		ret = pthread_mutex_init(&worker->mutex, NULL);
+		if (ret == 0)
+		{
+			ret = pthread_cond_init(&worker->cond, NULL);
+			if (ret == 0)
+			{
+				INIT_LIST_HEAD(&worker->task_queue);
+				worker->ntasks = 0;
+				worker->sleeping = 0;
+				worker->pool = pool;
+				continue;
+			}
+
+			pthread_mutex_destroy(&worker->mutex);
+		}
+
+		break;
+	}
+
+	if (i == pool->nworkers)
+		return 0;
+
+	while (i > 0)
+	{
+		worker = &pool->workers[--i];
+		pthread_cond_destroy(&worker->cond);
+		pthread_mutex_destroy(&worker->mutex);
+	}
+
+	errno = ret;
+	return -1;
+}
+
+static void __wspool_deinit_workers(wspool_t *pool)
+{
+	size_t i;
+
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		pthread_cond_destroy(&pool->workers[i].cond);
+		pthread_mutex_destroy(&pool->workers[i].mutex);
+	}
+}
+
+wspool_t *wspool_create(size_t nthreads, size_t stacksize)
+{
+	wspool_t *pool;
+	int ret;
+
+	if (nthreads == 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pool = (wspool_t *)malloc(sizeof (wspool_t));
+	if (!pool)
+		return NULL;
+
+	pool->workers = (struct __wspool_worker *)
+					malloc(nthreads * sizeof (struct __wspool_worker));
+	if (pool->workers)
+	{
+		pool->nworkers = nthreads;
+		if (__wspool_init_workers(pool) >= 0)
+		{
+			ret = pthread_mutex_init(&pool->mutex, NULL);
+			if (ret == 0)
+			{
+				ret = pthread_key_create(&pool->key, NULL);
+				if (ret == 0)
+				{
+					pool->stacksize = stacksize;
+					pool->nthreads = 0;
+					memset(&pool->tid, 0, sizeof (pthread_t));
+					pool->terminate = NULL;
+					pool->idle = 0;
+					pool->next = 0;
+					if (__wspool_create_threads(pool) >= 0)
+						return pool;
+
+					pthread_key_delete(pool->key);
+				}
+				else
+					errno = ret;
+
+				pthread_mutex_destroy(&pool->mutex);
+			}
+			else
+				errno = ret;
+
+			__wspool_deinit_workers(pool);
+		}
+
+		free(pool->workers);
+	}
+
+	free(pool);
+	return NULL;
+}
+
+inline void __wspool_schedule(const struct thrdpool_task *task, void *buf,
+							  wspool_t *pool)
+{
+	struct __wspool_task_entry *entry = (struct __wspool_task_entry *)buf;
+	struct __wspool_worker *worker;
+	int woken = 0;
+
+	entry->task = *task;
+	worker = (struct __wspool_worker *)pthread_getspecific(pool->key);
+	if (!worker)
+	{
+		worker = &pool->workers[__sync_fetch_and_add(&pool->next, 1) %
+								pool->nworkers];
+	}
+
+	pthread_mutex_lock(&worker->mutex);
+	list_add_tail(&entry->list, &worker->task_queue);
+	worker->ntasks++;
+	if (worker->sleeping)
+	{
+		worker->sleeping = 0;
+		pthread_cond_signal(&worker->cond);
+		woken = 1;
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+
+	/* Someone idle may steal it, in case the owner is busy. */
+	if (!woken && __sync_add_and_fetch(&pool->idle, 0) != 0)
+		__wspool_wake_one(worker, pool);
+}
+
+int wspool_schedule(const struct thrdpool_task *task, wspool_t *pool)
+{
+	void *buf = malloc(sizeof (struct __wspool_task_entry));
+
+	if (buf)
+	{
+		__wspool_schedule(task, buf, pool);
+		return 0;
+	}
+
+	return -1;
+}
+
+inline int wspool_in_pool(wspool_t *pool)
+{
+	return pthread_getspecific(pool->key) != NULL;
+}
+
+void wspool_destroy(void (*pending)(const struct thrdpool_task *),
+					wspool_t *pool)
+{
+	int in_pool = wspool_in_pool(pool);
+	struct __wspool_task_entry *entry;
+	struct list_head *pos, *tmp;
+	size_t i;
+
+	__wspool_terminate(in_pool, pool);
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		list_for_each_safe(pos, tmp, &pool->workers[i].task_queue)
+		{
+			entry = list_entry(pos, struct __wspool_task_entry, list);
+			list_del(pos);
+			if (pending)
+				pending(&entry->task);
+
+			free(entry);
+		}
+	}
+
+	pthread_key_delete(pool->key);
+	pthread_mutex_destroy(&pool->mutex);
+	__wspool_deinit_workers(pool);
+	if (!in_pool)
+	{
+		free(pool->workers);
+		free(pool);
+	}
+}
+
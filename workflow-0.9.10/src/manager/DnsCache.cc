@@ -17,8 +17,11 @@
            Xie Han (xiehan@sogou-inc.com)
 */
 
+#include <assert.h>
+#include <sched.h>
 #include <stdint.h>
 #include <chrono>
+#include <functional>
 #include "DnsCache.h"
 
 #define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
@@ -26,38 +29,149 @@
 #define CONFIDENT_INC		10
 #define	TTL_INC				10
 
+static inline size_t __host_port_hash(const DnsCache::HostPort& host_port)
+{
+	return std::hash<std::string>()(host_port.first) * 31 + host_port.second;
+}
+
+DnsCache::Table *DnsCache::new_table(size_t size, int link)
+{
+	Table *table = new Table;
+	size_t i;
+
+	table->size = size;
+	table->link = link;
+	table->buckets = new std::atomic<DnsHandle *>[size];
+	for (i = 0; i < size; i++)
+		table->buckets[i].store(NULL, std::memory_order_relaxed);
+
+	return table;
+}
+
+void DnsCache::delete_table(Table *table)
+{
+	delete []table->buckets;
+	delete table;
+}
+
+DnsCache::DnsHandle *DnsCache::lookup(Table *table, const HostPort& key,
+									  size_t hash)
+{
+	DnsHandle *handle;
+
+	handle = get_bucket(table, hash)->load(std::memory_order_acquire);
+	while (handle)
+	{
+		if (handle->hash == hash && handle->key == key)
+			break;
+
+		handle = handle->next[table->link].load(std::memory_order_acquire);
+	}
+
+	return handle;
+}
+
+/* Relink every handle into a table of twice the buckets, through the other
+ * 'next', so readers still in the old table walk its chains unchanged. The
+ * old table is freed once they are gone. Called with the shard locked. */
+void DnsCache::grow(Shard *shard)
+{
+	Table *old = shard->table.load(std::memory_order_relaxed);
+	Table *table = new_table(old->size * 2, !old->link);
+	std::atomic<DnsHandle *> *bucket;
+	DnsHandle *handle;
+	size_t i;
+
+	for (i = 0; i < old->size; i++)
+	{
+		handle = old->buckets[i].load(std::memory_order_relaxed);
+		while (handle)
+		{
+			bucket = get_bucket(table, handle->hash);
+			handle->next[table->link].store(bucket->load(std::memory_order_relaxed),
+											std::memory_order_relaxed);
+			bucket->store(handle, std::memory_order_relaxed);
+			handle = handle->next[old->link].load(std::memory_order_relaxed);
+		}
+	}
+
+	shard->table.store(table, std::memory_order_release);
+	synchronize(shard);
+	delete_table(old);
+}
+
+/* Wait until every reader that may still see an unlinked handle is gone.
+ * Flip twice, so that a reader counted in either counter is waited for. */
+void DnsCache::synchronize(Shard *shard)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		int phase = shard->phase.fetch_add(1) & 1;
+
+		while (shard->readers[phase].load() != 0)
+			sched_yield();
+	}
+}
+
+void DnsCache::unref(DnsHandle *handle)
+{
+	if (handle->ref.fetch_sub(1) == 1)
+	{
+		value_deleter_(handle->value);
+		delete handle;
+	}
+}
+
+/* A handle in the cache holds one reference of the cache, which is dropped
+ * only after it is unlinked and no reader can find it anymore. */
 const DnsCache::DnsHandle *DnsCache::get_inner(const HostPort& host_port, int type)
 {
 	int64_t cur_time = GET_CURRENT_SECOND;
-	std::lock_guard<std::mutex> lock(mutex_);
-	const DnsHandle *handle = cache_pool_.get(host_port);
+	size_t hash = __host_port_hash(host_port);
+	Shard *shard = get_shard(hash);
+	int phase = shard->phase.load() & 1;
+	DnsHandle *handle;
+	int64_t *time;
+	int64_t inc;
 
+	shard->readers[phase]++;
+	handle = lookup(shard->table.load(std::memory_order_acquire),
+					host_port, hash);
 	if (handle)
-	{
-		switch (type)
-		{
-		case GET_TYPE_TTL:
-			if (cur_time > handle->value.expire_time)
-			{
-				const_cast<DnsHandle *>(handle)->value.expire_time += TTL_INC;
-				cache_pool_.release(handle);
-				return NULL;
-			}
+		handle->ref++;
 
-			break;
+	shard->readers[phase].fetch_sub(1, std::memory_order_release);
+	if (!handle)
+		return NULL;
 
-		case GET_TYPE_CONFIDENT:
-			if (cur_time > handle->value.confident_time)
-			{
-				const_cast<DnsHandle *>(handle)->value.confident_time += CONFIDENT_INC;
-				cache_pool_.release(handle);
-				return NULL;
-			}
+	switch (type)
+	{
+	case GET_TYPE_TTL:
+		time = &handle->value.expire_time;
+		inc = TTL_INC;
+		break;
 
-			break;
+	case GET_TYPE_CONFIDENT:
+		time = &handle->value.confident_time;
+		inc = CONFIDENT_INC;
+		break;
 
-		default:
-			break;
+	default:
+		return handle;
+	}
+
+	/* Only the one that pushes the time forward misses, and goes to
+	 * refresh. The others keep using the entry meanwhile. */
+	int64_t t = __atomic_load_n(time, __ATOMIC_RELAXED);
+	while (cur_time > t)
+	{
+		if (__atomic_compare_exchange_n(time, &t, t + inc, false,
+										__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			unref(handle);
+			return NULL;
 		}
 	}
 
@@ -72,6 +186,12 @@ const DnsCache::DnsHandle *DnsCache::put(const HostPort& host_port,
 	int64_t expire_time;
 	int64_t confident_time;
 	int64_t cur_time = GET_CURRENT_SECOND;
+	size_t hash = __host_port_hash(host_port);
+	Shard *shard = get_shard(hash);
+	std::atomic<DnsHandle *> *prev;
+	DnsHandle *handle;
+	DnsHandle *old;
+	Table *table;
 
 	if (dns_ttl_min > dns_ttl_default)
 		dns_ttl_min = dns_ttl_default;
@@ -86,33 +206,119 @@ const DnsCache::DnsHandle *DnsCache::put(const HostPort& host_port,
 	else
 		expire_time = cur_time + dns_ttl_default;
 
-	std::lock_guard<std::mutex> lock(mutex_);
-	return cache_pool_.put(host_port, {addrinfo, confident_time, expire_time});
+	handle = new DnsHandle(host_port, hash, {addrinfo, confident_time, expire_time});
+	std::lock_guard<std::mutex> lock(shard->mutex);
+
+	table = shard->table.load(std::memory_order_relaxed);
+	prev = get_bucket(table, hash);
+	old = prev->load(std::memory_order_relaxed);
+	while (old)
+	{
+		if (old->hash == hash && old->key == host_port)
+			break;
+
+		prev = &old->next[table->link];
+		old = old->next[table->link].load(std::memory_order_relaxed);
+	}
+
+	if (old)
+	{
+		handle->next[table->link].store(old->next[table->link].load(std::memory_order_relaxed),
+										std::memory_order_relaxed);
+		prev->store(handle, std::memory_order_release);
+		synchronize(shard);
+		unref(old);
+	}
+	else
+	{
+		prev = get_bucket(table, hash);
+		handle->next[table->link].store(prev->load(std::memory_order_relaxed),
+										std::memory_order_relaxed);
+		prev->store(handle, std::memory_order_release);
+		if (++shard->count > 2 * table->size)
+			grow(shard);
+	}
+
+	return handle;
 }
 
 const DnsCache::DnsHandle *DnsCache::get(const DnsCache::HostPort& host_port)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	return cache_pool_.get(host_port);
+	return get_inner(host_port, -1);
 }
 
 void DnsCache::release(const DnsCache::DnsHandle *handle)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	cache_pool_.release(handle);
+	unref(const_cast<DnsHandle *>(handle));
 }
 
 void DnsCache::del(const DnsCache::HostPort& key)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	cache_pool_.del(key);
+	size_t hash = __host_port_hash(key);
+	Shard *shard = get_shard(hash);
+	std::atomic<DnsHandle *> *prev;
+	DnsHandle *handle;
+	std::lock_guard<std::mutex> lock(shard->mutex);
+	Table *table = shard->table.load(std::memory_order_relaxed);
+
+	prev = get_bucket(table, hash);
+	handle = prev->load(std::memory_order_relaxed);
+	while (handle)
+	{
+		if (handle->hash == hash && handle->key == key)
+		{
+			prev->store(handle->next[table->link].load(std::memory_order_relaxed),
+						std::memory_order_release);
+			shard->count--;
+			synchronize(shard);
+			unref(handle);
+			break;
+		}
+
+		prev = &handle->next[table->link];
+		handle = handle->next[table->link].load(std::memory_order_relaxed);
+	}
 }
 
 DnsCache::DnsCache()
 {
+	int i;
+
+	for (i = 0; i < DNS_CACHE_SHARDS; i++)
+	{
+		shards_[i].phase = 0;
+		shards_[i].readers[0] = 0;
+		shards_[i].readers[1] = 0;
+		shards_[i].table = new_table(DNS_CACHE_BUCKETS, 0);
+		shards_[i].count = 0;
+	}
 }
 
 DnsCache::~DnsCache()
 {
+	DnsHandle *handle;
+	DnsHandle *next;
+	Table *table;
+	size_t j;
+	int i;
+
+	for (i = 0; i < DNS_CACHE_SHARDS; i++)
+	{
+		table = shards_[i].table;
+		for (j = 0; j < table->size; j++)
+		{
+			handle = table->buckets[j];
+			while (handle)
+			{
+				next = handle->next[table->link];
+				// Error if caller has an unreleased handle
+				assert(handle->ref == 1);
+				unref(handle);
+				handle = next;
+			}
+		}
+
+		delete_table(table);
+	}
 }
 
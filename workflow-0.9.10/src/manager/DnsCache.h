@@ -20,16 +20,22 @@
 #define _DNSCACHE_H_
 
 #include <netdb.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <utility>
-#include "LRUCache.h"
 #include "DnsUtil.h"
 
 #define GET_TYPE_TTL		0
 #define GET_TYPE_CONFIDENT	1
 
+#define DNS_CACHE_SHARDS	16
+/* Buckets of a shard at first. A shard doubles them when it holds more
+ * than two entries per bucket, and never shrinks. */
+#define DNS_CACHE_BUCKETS	64
+
 struct DnsCacheValue
 {
 	struct addrinfo *addrinfo;
@@ -40,11 +46,33 @@ struct DnsCacheValue
 // RAII: NO. Release handle by user
 // Thread safety: YES
 // MUST call release when handle no longer used
+// Lookups take no lock. Only put and del lock one of the shards.
 class DnsCache
 {
 public:
 	using HostPort = std::pair<std::string, unsigned short>;
-	using DnsHandle = LRUHandle<HostPort, DnsCacheValue>;
+
+	// DONOT change value by handle, use DnsCache::put instead
+	class DnsHandle
+	{
+	public:
+		DnsCacheValue value;
+
+	private:
+		DnsHandle(const HostPort& k, size_t h, const DnsCacheValue& v) :
+			value(v), key(k), hash(h), ref(2)
+		{
+		}
+
+		HostPort key;
+		size_t hash;
+		// Chains of a table use one of the two, and those of the table
+		// replacing it on a resize the other one.
+		std::atomic<DnsHandle *> next[2];
+		std::atomic<int> ref;
+
+		friend class DnsCache;
+	};
 
 public:
 	// get handler
@@ -134,7 +162,37 @@ public:
 private:
 	const DnsHandle *get_inner(const HostPort& host_port, int type);
 
-	std::mutex mutex_;
+	struct Table
+	{
+		size_t size;				// power of 2
+		int link;					// index of DnsHandle::next
+		std::atomic<DnsHandle *> *buckets;
+	};
+
+	// Readers count themselves in one of two counters, and a writer waits
+	// for both to drain before freeing what it has unlinked, or a table
+	// it has replaced.
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::atomic<int> phase;
+		std::atomic<int> readers[2];
+		std::atomic<Table *> table;
+		size_t count;
+	};
+
+	Shard *get_shard(size_t hash) { return &shards_[hash % DNS_CACHE_SHARDS]; }
+	static std::atomic<DnsHandle *> *get_bucket(Table *table, size_t hash)
+	{
+		return &table->buckets[hash / DNS_CACHE_SHARDS & (table->size - 1)];
+	}
+
+	static Table *new_table(size_t size, int link);
+	static void delete_table(Table *table);
+	DnsHandle *lookup(Table *table, const HostPort& key, size_t hash);
+	void grow(Shard *shard);
+	void synchronize(Shard *shard);
+	void unref(DnsHandle *handle);
 
 	class ValueDeleter
 	{
@@ -150,10 +208,10 @@ private:
 		}
 	};
 
-	LRUCache<HostPort, DnsCacheValue, ValueDeleter> cache_pool_;
+	Shard shards_[DNS_CACHE_SHARDS];
+	ValueDeleter value_deleter_;
 
 public:
-	// To prevent inline calling LRUCache's constructor and deconstructor.
 	DnsCache();
 	~DnsCache();
 };
@@ -21,6 +21,7 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <stdlib.h>
+#include <sched.h>
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
@@ -30,7 +31,6 @@
 #include <string>
 #include <algorithm>
 #include "list.h"
-#include "rbtree.h"
 #include "WFGlobal.h"
 #include "MD5Util.h"
 #include "CommScheduler.h"
@@ -118,7 +118,9 @@ struct RouteParams
 class RouteResultEntry
 {
 public:
-	struct rb_node rb;
+	/* Chains of a table use one of the two, and those of the table
+	 * replacing it on a resize the other one. */
+	std::atomic<RouteResultEntry *> next[2];
 	CommSchedObject *request_object;
 	CommSchedGroup *group;
 	std::mutex mutex;
@@ -430,98 +432,220 @@ static uint64_t __generate_key(TransportType type,
 	return MD5Util::md5_integer_16(str);
 }
 
-RouteManager::~RouteManager()
+static inline std::atomic<RouteResultEntry *> *
+__get_bucket(std::atomic<RouteResultEntry *> *buckets, size_t size,
+			 uint64_t md5_16)
 {
-	RouteResultEntry *entry;
+	return &buckets[md5_16 / ROUTE_MANAGER_SHARDS & (size - 1)];
+}
+
+static inline RouteResultEntry *
+__lookup_entry(std::atomic<RouteResultEntry *> *bucket, int link,
+			   uint64_t md5_16)
+{
+	RouteResultEntry *entry = bucket->load(std::memory_order_acquire);
+
+	while (entry && entry->md5_16 != md5_16)
+		entry = entry->next[link].load(std::memory_order_acquire);
+
+	return entry;
+}
+
+static RouteResultEntry *
+__create_entry(TransportType type,
+			   const struct addrinfo *addrinfo,
+			   const std::string& other_info,
+			   const struct EndpointParams *endpoint_params,
+			   const std::string& hostname,
+			   uint64_t md5_16)
+{
+	int ssl_connect_timeout = 0;
+	SSL_CTX *ssl_ctx = NULL;
 
-	while (cache_.rb_node)
+	if (type == TT_TCP_SSL || type == TT_SCTP_SSL)
 	{
-		entry = rb_entry(cache_.rb_node, RouteResultEntry, rb);
-		rb_erase(cache_.rb_node, &cache_);
-		entry->deinit();
-		delete entry;
+		static SSL_CTX *client_ssl_ctx = WFGlobal::get_ssl_client_ctx();
+
+		ssl_ctx = client_ssl_ctx;
+		ssl_connect_timeout = endpoint_params->ssl_connect_timeout;
 	}
+
+	struct RouteParams params = {
+		.transport_type			=	type,
+		.addrinfo 				= 	addrinfo,
+		.md5_16					=	md5_16,
+		.ssl_ctx 				=	ssl_ctx,
+		.connect_timeout		=	endpoint_params->connect_timeout,
+		.ssl_connect_timeout	=	ssl_connect_timeout,
+		.response_timeout		=	endpoint_params->response_timeout,
+		.max_connections		=	endpoint_params->max_connections,
+		.use_tls_sni			=	endpoint_params->use_tls_sni,
+		.hostname				=	hostname,
+	};
+
+	if (StringUtil::start_with(other_info, "?maxconn="))
+	{
+		int maxconn = atoi(other_info.c_str() + 9);
+		if (maxconn > 0)
+			params.max_connections = maxconn;
+	}
+
+	RouteResultEntry *entry = new RouteResultEntry;
+
+	if (entry->init(&params) >= 0)
+		return entry;
+
+	delete entry;
+	return NULL;
 }
 
-int RouteManager::get(TransportType type,
-					  const struct addrinfo *addrinfo,
-					  const std::string& other_info,
-					  const struct EndpointParams *endpoint_params,
-					  const std::string& hostname,
-					  RouteResult& result)
+RouteManager::Table *RouteManager::new_table(size_t size, int link)
 {
-	uint64_t md5_16 = __generate_key(type, addrinfo, other_info,
-									 endpoint_params, hostname);
-	struct rb_node **p = &cache_.rb_node;
-	struct rb_node *parent = NULL;
-	RouteResultEntry *bound = NULL;
+	Table *table = new Table;
+	size_t i;
+
+	table->size = size;
+	table->link = link;
+	table->buckets = new std::atomic<RouteResultEntry *>[size];
+	for (i = 0; i < size; i++)
+		table->buckets[i].store(NULL, std::memory_order_relaxed);
+
+	return table;
+}
+
+void RouteManager::delete_table(Table *table)
+{
+	delete []table->buckets;
+	delete table;
+}
+
+/* Wait until every reader that may still use a replaced table is gone. */
+void RouteManager::synchronize(Shard *shard)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		int phase = shard->phase.fetch_add(1) & 1;
+
+		while (shard->readers[phase].load() != 0)
+			sched_yield();
+	}
+}
+
+/* Relink every entry into a table of twice the buckets, through the other
+ * 'next', so readers still in the old table walk its chains unchanged.
+ * Called with the shard locked. */
+void RouteManager::grow(Shard *shard)
+{
+	Table *old = shard->table.load(std::memory_order_relaxed);
+	Table *table = new_table(old->size * 2, !old->link);
+	std::atomic<RouteResultEntry *> *bucket;
 	RouteResultEntry *entry;
-	std::lock_guard<std::mutex> lock(mutex_);
+	size_t i;
 
-	while (*p)
+	for (i = 0; i < old->size; i++)
 	{
-		parent = *p;
-		entry = rb_entry(*p, RouteResultEntry, rb);
-		if (md5_16 <= entry->md5_16)
+		entry = old->buckets[i].load(std::memory_order_relaxed);
+		while (entry)
 		{
-			bound = entry;
-			p = &(*p)->rb_left;
+			bucket = __get_bucket(table->buckets, table->size, entry->md5_16);
+			entry->next[table->link].store(bucket->load(std::memory_order_relaxed),
+										   std::memory_order_relaxed);
+			bucket->store(entry, std::memory_order_relaxed);
+			entry = entry->next[old->link].load(std::memory_order_relaxed);
 		}
-		else
-			p = &(*p)->rb_right;
 	}
 
-	if (bound && bound->md5_16 == md5_16)
+	shard->table.store(table, std::memory_order_release);
+	synchronize(shard);
+	delete_table(old);
+}
+
+RouteManager::RouteManager()
+{
+	int i;
+
+	for (i = 0; i < ROUTE_MANAGER_SHARDS; i++)
 	{
-		entry = bound;
-		entry->check_breaker();
+		shards_[i].phase = 0;
+		shards_[i].readers[0] = 0;
+		shards_[i].readers[1] = 0;
+		shards_[i].table = new_table(ROUTE_MANAGER_BUCKETS, 0);
+		shards_[i].count = 0;
 	}
-	else
-	{
-		int ssl_connect_timeout = 0;
-		SSL_CTX *ssl_ctx = NULL;
-
-		if (type == TT_TCP_SSL || type == TT_SCTP_SSL)
-		{
-			static SSL_CTX *client_ssl_ctx = WFGlobal::get_ssl_client_ctx();
+}
 
-			ssl_ctx = client_ssl_ctx;
-			ssl_connect_timeout = endpoint_params->ssl_connect_timeout;
-		}
+RouteManager::~RouteManager()
+{
+	RouteResultEntry *entry;
+	RouteResultEntry *next;
+	Table *table;
+	size_t j;
+	int i;
 
-		struct RouteParams params = {
-			.transport_type			=	type,
-			.addrinfo 				= 	addrinfo,
-			.md5_16					=	md5_16,
-			.ssl_ctx 				=	ssl_ctx,
-			.connect_timeout		=	endpoint_params->connect_timeout,
-			.ssl_connect_timeout	=	ssl_connect_timeout,
-			.response_timeout		=	endpoint_params->response_timeout,
-			.max_connections		=	endpoint_params->max_connections,
-			.use_tls_sni			=	endpoint_params->use_tls_sni,
-			.hostname				=	hostname,
-		};
-
-		if (StringUtil::start_with(other_info, "?maxconn="))
+	for (i = 0; i < ROUTE_MANAGER_SHARDS; i++)
+	{
+		table = shards_[i].table;
+		for (j = 0; j < table->size; j++)
 		{
-			int maxconn = atoi(other_info.c_str() + 9);
-			if (maxconn > 0)
-				params.max_connections = maxconn;
+			entry = table->buckets[j];
+			while (entry)
+			{
+				next = entry->next[table->link];
+				entry->deinit();
+				delete entry;
+				entry = next;
+			}
 		}
 
-		entry = new RouteResultEntry;
-		if (entry->init(&params) >= 0)
-		{
-			rb_link_node(&entry->rb, parent, p);
-			rb_insert_color(&entry->rb, &cache_);
-		}
-		else
+		delete_table(table);
+	}
+}
+
+int RouteManager::get(TransportType type,
+					  const struct addrinfo *addrinfo,
+					  const std::string& other_info,
+					  const struct EndpointParams *endpoint_params,
+					  const std::string& hostname,
+					  RouteResult& result)
+{
+	uint64_t md5_16 = __generate_key(type, addrinfo, other_info,
+									 endpoint_params, hostname);
+	Shard *shard = &shards_[md5_16 % ROUTE_MANAGER_SHARDS];
+	int phase = shard->phase.load() & 1;
+	std::atomic<RouteResultEntry *> *bucket;
+	RouteResultEntry *entry;
+	Table *table;
+
+	shard->readers[phase]++;
+	table = shard->table.load(std::memory_order_acquire);
+	bucket = __get_bucket(table->buckets, table->size, md5_16);
+	entry = __lookup_entry(bucket, table->link, md5_16);
+	shard->readers[phase].fetch_sub(1, std::memory_order_release);
+	if (!entry)
+	{
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		table = shard->table.load(std::memory_order_relaxed);
+		bucket = __get_bucket(table->buckets, table->size, md5_16);
+		entry = __lookup_entry(bucket, table->link, md5_16);
+		if (!entry)
 		{
-			delete entry;
-			return -1;
+			entry = __create_entry(type, addrinfo, other_info,
+								   endpoint_params, hostname, md5_16);
+			if (!entry)
+				return -1;
+
+			entry->next[table->link].store(bucket->load(std::memory_order_relaxed),
+										   std::memory_order_relaxed);
+			bucket->store(entry, std::memory_order_release);
+			if (++shard->count > 2 * table->size)
+				grow(shard);
 		}
 	}
 
+	entry->check_breaker();
 	result.cookie = entry;
 	result.request_object = entry->request_object;
 	return 0;
@@ -24,11 +24,18 @@
 #include <netdb.h>
 #include <string>
 #include <mutex>
-#include "rbtree.h"
+#include <atomic>
 #include "WFConnection.h"
 #include "EndpointParams.h"
 #include "CommScheduler.h"
 
+#define ROUTE_MANAGER_SHARDS	16
+/* Buckets of a shard at first. A shard doubles them when it holds more
+ * than two entries per bucket. */
+#define ROUTE_MANAGER_BUCKETS	64
+
+class RouteResultEntry;
+
 class RouteManager
 {
 public:
@@ -66,16 +73,36 @@ public:
 			const std::string& hostname,
 			RouteResult& result);
 
-	RouteManager()
-	{
-		cache_.rb_node = NULL;
-	}
-
+	RouteManager();
 	~RouteManager();
 
 private:
-	std::mutex mutex_;
-	struct rb_root cache_;
+	struct Table
+	{
+		size_t size;				// power of 2
+		int link;					// index of RouteResultEntry::next
+		std::atomic<RouteResultEntry *> *buckets;
+	};
+
+	// Entries are never removed before the manager is destroyed, so that a
+	// lookup takes no lock. Only creating an entry locks its shard. Readers
+	// count themselves in one of two counters, so that a table replaced by
+	// a larger one is freed after they are gone.
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::atomic<int> phase;
+		std::atomic<int> readers[2];
+		std::atomic<Table *> table;
+		size_t count;
+	};
+
+	static Table *new_table(size_t size, int link);
+	static void delete_table(Table *table);
+	void grow(Shard *shard);
+	void synchronize(Shard *shard);
+
+	Shard shards_[ROUTE_MANAGER_SHARDS];
 
 public:
 	static void notify_unavailable(void *cookie, CommTarget *target);
@@ -92,6 +92,46 @@ int UpstreamManager::upstream_create_consistent_hash(const std::string& name,
 	return -1;
 }
 
+int UpstreamManager::upstream_create_jump_hash(const std::string& name,
+											   upstream_route_t consistent_hash)
+{
+	auto *ns = WFGlobal::get_name_service();
+	UPSJumpHashPolicy *policy;
+
+	policy = new UPSJumpHashPolicy(
+						consistent_hash ? std::move(consistent_hash) :
+										  __default_consistent_hash);
+	if (ns->add_policy(name.c_str(), policy) >= 0)
+	{
+		__UpstreamManager::get_instance()->add_policy_name(name);
+		return 0;
+	}
+
+	delete policy;
+	return -1;
+}
+
+int UpstreamManager::upstream_create_bounded_load_hash(const std::string& name,
+													   upstream_route_t consistent_hash,
+													   double balance)
+{
+	auto *ns = WFGlobal::get_name_service();
+	UPSBoundedLoadHashPolicy *policy;
+
+	policy = new UPSBoundedLoadHashPolicy(
+						consistent_hash ? std::move(consistent_hash) :
+										  __default_consistent_hash,
+						balance);
+	if (ns->add_policy(name.c_str(), policy) >= 0)
+	{
+		__UpstreamManager::get_instance()->add_policy_name(name);
+		return 0;
+	}
+
+	delete policy;
+	return -1;
+}
+
 int UpstreamManager::upstream_create_weighted_random(const std::string& name,
 													 bool try_another)
 {
@@ -123,6 +163,21 @@ int UpstreamManager::upstream_create_vnswrr(const std::string& name)
 	return -1;
 }
 
+int UpstreamManager::upstream_create_p2c(const std::string& name)
+{
+	auto *ns = WFGlobal::get_name_service();
+	UPSP2CPolicy *policy = new UPSP2CPolicy();
+
+	if (ns->add_policy(name.c_str(), policy) >= 0)
+	{
+		__UpstreamManager::get_instance()->add_policy_name(name);
+		return 0;
+	}
+
+	delete policy;
+	return -1;
+}
+
 int UpstreamManager::upstream_create_manual(const std::string& name,
 											upstream_route_t select,
 											bool try_another,
@@ -135,6 +135,52 @@ public:
 	 */
 	static int upstream_create_vnswrr(const std::string& name);
 
+	/**
+	 * @brief      MODE 5: power of two choices select
+	 * @param[in]  name             upstream name
+	 * @return     success/fail
+	 * @retval     0                success
+	 * @retval     -1               fail, more info see errno
+	 * @note
+	 * two alive main servers are chosen at random, and the one with the lower
+	 * latency * (inflight + 1) / weight is selected. The latency is a peak EWMA
+	 * of each server's requests, and a failed request counts as slow.
+	 */
+	static int upstream_create_p2c(const std::string& name);
+
+	/**
+	 * @brief      MODE 6: jump consistent hash select
+	 * @param[in]  name             upstream name
+	 * @param[in]  consitent_hash   consistent-hash functional
+	 * @return     success/fail
+	 * @retval     0                success
+	 * @retval     -1               fail, more info see errno
+	 * @note       as MODE 1, with no virtual nodes and O(ln n) per select.
+	 * a removed main server leaves its slot to the next one added. A key on
+	 * a fused server, or turned down by weight / max weight, jumps again.
+	 * @note       if consitent_hash==nullptr, upstream will use std::hash with request uri
+	 */
+	static int upstream_create_jump_hash(const std::string& name,
+										 upstream_route_t consitent_hash);
+
+	/**
+	 * @brief      MODE 7: consistent hash with bounded loads select
+	 * @param[in]  name             upstream name
+	 * @param[in]  consitent_hash   consistent-hash functional
+	 * @param[in]  balance          no server takes more than balance times its
+	 *                              weighted share of the requests in process
+	 * @return     success/fail
+	 * @retval     0                success
+	 * @retval     -1               fail, more info see errno
+	 * @note       as MODE 1, but a server at its bound passes the key on to the
+	 * next on the ring. balance less than 1.0 is taken as 1.0, and
+	 * BOUNDED_LOAD_BALANCE_DEFAULT is 1.25
+	 * @note       if consitent_hash==nullptr, upstream will use std::hash with request uri
+	 */
+	static int upstream_create_bounded_load_hash(const std::string& name,
+												 upstream_route_t consitent_hash,
+												 double balance);
+
 	/**
 	 * @brief      Delete one upstream
 	 * @param[in]  name             upstream name
@@ -336,9 +336,15 @@ public:
 			fio_mutex_.lock();
 			if (!fio_flag_)
 			{
+				const auto *settings = WFGlobal::get_global_settings();
+				int backend = IOS_BACKEND_DEFAULT;
+
+				if (settings->io_backend == IO_BACKEND_URING_POLL)
+					backend = IOS_BACKEND_IO_URING;
+
 				fio_service_ = new __FileIOService(&scheduler_);
 				//todo EAGAIN 65536->2
-				if (fio_service_->init(8192) < 0)
+				if (fio_service_->init(8192, backend) < 0)
 					abort();
 
 				if (fio_service_->bind() < 0)
@@ -359,8 +365,13 @@ private:
 		fio_flag_(false)
 	{
 		const auto *settings = WFGlobal::get_global_settings();
+		int backend = POLLER_BACKEND_DEFAULT;
+
+		if (settings->io_backend == IO_BACKEND_URING_POLL)
+			backend = POLLER_BACKEND_URING_POLL;
+
 		if (scheduler_.init(settings->poller_threads,
-							settings->handler_threads) < 0)
+							settings->handler_threads, backend) < 0)
 			abort();
 
 		signal(SIGPIPE, SIG_IGN);
@@ -436,12 +447,13 @@ private:
 	__ExecManager():
 		rwlock_(PTHREAD_RWLOCK_INITIALIZER)
 	{
-		int compute_threads = WFGlobal::get_global_settings()->compute_threads;
+		const struct WFGlobalSettings *settings = WFGlobal::get_global_settings();
+		int compute_threads = settings->compute_threads;
 
 		if (compute_threads <= 0)
 			compute_threads = sysconf(_SC_NPROCESSORS_ONLN);
 
-		if (compute_executor_.init(compute_threads) < 0)
+		if (compute_executor_.init(compute_threads, settings->executor_type) < 0)
 			abort();
 	}
 
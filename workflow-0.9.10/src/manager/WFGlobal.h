@@ -58,8 +58,21 @@ struct WFGlobalSettings
 	int compute_threads;			///< auto-set by system CPU number if value<=0
 	const char *resolv_conf_path;
 	const char *hosts_path;
+	int io_backend;					///< IO_BACKEND_DEFAULT or IO_BACKEND_URING_POLL
+	int executor_type;				///< EXECUTOR_SHARED_QUEUE or EXECUTOR_WORK_STEALING
 };
 
+/**
+ * @brief   I/O backends of the pollers and the file I/O service
+ * @details
+ * IO_BACKEND_URING_POLL waits for network readiness with io_uring poll
+ * requests instead of epoll, and runs file I/O through io_uring instead of
+ * linux aio, falling back to the default when the kernel does not support
+ * it. Network reads, writes and accepts are system calls with either one.
+ */
+#define IO_BACKEND_DEFAULT		0
+#define IO_BACKEND_URING_POLL		1
+
 /**
  * @brief   Default Workflow Library Global Settings
  */
@@ -75,6 +88,8 @@ static constexpr struct WFGlobalSettings GLOBAL_SETTINGS_DEFAULT =
 	.compute_threads	=	-1,
 	.resolv_conf_path	=	"/etc/resolv.conf",
 	.hosts_path			=	"/etc/hosts",
+	.io_backend			=	IO_BACKEND_DEFAULT,
+	.executor_type		=	EXECUTOR_SHARED_QUEUE,
 };
 
 /**
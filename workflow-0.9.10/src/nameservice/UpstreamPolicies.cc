@@ -17,12 +17,18 @@
 */
 
 #include <pthread.h>
+#include <math.h>
 #include <algorithm>
+#include <chrono>
 #include <random>
 #include "rbtree.h"
 #include "URIParser.h"
 #include "UpstreamPolicies.h"
 
+#define JUMP_HASH_MAX_JUMPS	64
+
+#define GET_CURRENT_MICRO	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
 class EndpointGroup
 {
 public:
@@ -632,11 +638,189 @@ int UPSVNSWRRPolicy::remove_server_locked(const std::string& address)
 EndpointAddress *UPSConsistentHashPolicy::first_strategy(const ParsedURI& uri,
 														 WFNSTracing *tracing)
 {
-	unsigned int hash_value = this->consistent_hash(
-										uri.path ? uri.path : "",
-										uri.query ? uri.query : "",
-										uri.fragment ? uri.fragment : "");
-	return this->consistent_hash_with_group(hash_value);
+	return this->consistent_hash_with_group(this->hash_uri(uri));
+}
+
+/* splitmix64, to spread the 32-bit hash and to draw the next jumps. */
+static inline unsigned long long __rehash(unsigned long long key)
+{
+	key += 0x9e3779b97f4a7c15ULL;
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+	return key ^ (key >> 31);
+}
+
+/* Lamping & Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm". */
+static size_t __jump_hash(unsigned long long key, size_t n)
+{
+	long long b = -1;
+	long long j = 0;
+
+	while (j < (long long)n)
+	{
+		b = j;
+		key = key * 2862933555777941757ULL + 1;
+		j = (long long)((b + 1) * ((double)(1LL << 31) /
+								   (double)((key >> 33) + 1)));
+	}
+
+	return (size_t)b;
+}
+
+EndpointAddress *UPSJumpHashPolicy::first_strategy(const ParsedURI& uri,
+												   WFNSTracing *tracing)
+{
+	unsigned long long key = this->hash_uri(uri);
+	size_t n = this->slots.size();
+	const UPSAddrParams *params;
+	EndpointAddress *server;
+	size_t idx = 0;
+
+	for (int i = 0; i < JUMP_HASH_MAX_JUMPS && n > 0; i++)
+	{
+		key = __rehash(key);
+		idx = __jump_hash(key, n);
+		server = this->slots[idx];
+		if (server && this->is_alive(server))
+		{
+			params = static_cast<UPSAddrParams *>(server->params);
+			if ((key & 0xffffffff) % this->max_weight < params->weight)
+				return this->check_and_get(server, false, NULL);
+		}
+	}
+
+	/* Too many fused. The first alive slot after the last jump. */
+	for (size_t i = 0; i < n; i++)
+	{
+		server = this->slots[(idx + i) % n];
+		if (server && this->is_alive(server))
+			return this->check_and_get(server, false, NULL);
+	}
+
+	return NULL;
+}
+
+void UPSJumpHashPolicy::add_server_locked(EndpointAddress *addr)
+{
+	UPSAddrParams *params = static_cast<UPSAddrParams *>(addr->params);
+
+	UPSGroupPolicy::add_server_locked(addr);
+	if (params->server_type == 0)
+	{
+		auto it = std::find(this->slots.begin(), this->slots.end(),
+							(EndpointAddress *)NULL);
+
+		if (it != this->slots.end())
+			*it = addr;
+		else
+			this->slots.push_back(addr);
+
+		if (params->weight > this->max_weight)
+			this->max_weight = params->weight;
+	}
+}
+
+int UPSJumpHashPolicy::remove_server_locked(const std::string& address)
+{
+	const UPSAddrParams *params;
+	int ret;
+
+	for (EndpointAddress *& server : this->slots)
+	{
+		if (server && server->address == address)
+			server = NULL;
+	}
+
+	while (!this->slots.empty() && !this->slots.back())
+		this->slots.pop_back();
+
+	ret = UPSGroupPolicy::remove_server_locked(address);
+	this->max_weight = 1;
+	for (const EndpointAddress *server : this->servers)
+	{
+		params = static_cast<UPSAddrParams *>(server->params);
+		if (params->weight > this->max_weight)
+			this->max_weight = params->weight;
+	}
+
+	return ret;
+}
+
+EndpointAddress *UPSBoundedLoadHashPolicy::first_strategy(const ParsedURI& uri,
+														  WFNSTracing *tracing)
+{
+	unsigned int hash_value = this->hash_uri(uri);
+	size_t n = this->ring.size();
+	double load;
+	const UPSAddrParams *params;
+	EndpointAddress *first = NULL;
+	EndpointAddress *server;
+	size_t pos;
+
+	if (n == 0)
+		return NULL;
+
+	load = this->balance * (this->ninflight + 1) / this->total_weight;
+	pos = std::lower_bound(this->ring.begin(), this->ring.end(), hash_value,
+			[](const std::pair<unsigned int, EndpointAddress *>& node,
+			   unsigned int hash) { return node.first < hash; }) -
+		  this->ring.begin();
+
+	for (size_t i = 0; i < n; i++)
+	{
+		server = this->ring[(pos + i) % n].second;
+		if (!this->is_alive(server))
+			continue;
+
+		params = static_cast<UPSAddrParams *>(server->params);
+		if (server->inflight < ceil(load * params->weight))
+			return this->check_and_get(server, false, NULL);
+
+		if (!first)
+			first = server;
+	}
+
+	/* The fused count in the total weight, so all may be full. */
+	if (!first)
+		return NULL;
+
+	return this->check_and_get(first, false, NULL);
+}
+
+void UPSBoundedLoadHashPolicy::init_ring()
+{
+	const UPSAddrParams *params;
+
+	this->ring.clear();
+	this->total_weight = 0;
+	for (EndpointAddress *server : this->servers)
+	{
+		params = static_cast<UPSAddrParams *>(server->params);
+		for (int i = 0; i < VIRTUAL_GROUP_SIZE; i++)
+			this->ring.emplace_back(params->consistent_hash[i], server);
+
+		this->total_weight += params->weight;
+	}
+
+	std::sort(this->ring.begin(), this->ring.end(),
+			  [](const std::pair<unsigned int, EndpointAddress *>& a,
+				 const std::pair<unsigned int, EndpointAddress *>& b) {
+				return a.first < b.first;
+			  });
+}
+
+void UPSBoundedLoadHashPolicy::add_server_locked(EndpointAddress *addr)
+{
+	UPSGroupPolicy::add_server_locked(addr);
+	this->init_ring();
+}
+
+int UPSBoundedLoadHashPolicy::remove_server_locked(const std::string& address)
+{
+	int ret = UPSGroupPolicy::remove_server_locked(address);
+
+	this->init_ring();
+	return ret;
 }
 
 EndpointAddress *UPSManualPolicy::first_strategy(const ParsedURI& uri,
@@ -662,3 +846,73 @@ EndpointAddress *UPSManualPolicy::another_strategy(const ParsedURI& uri,
 	return this->consistent_hash_with_group(hash_value);
 }
 
+
+/* The first available from '*idx' on. Its index is stored in '*idx'. */
+EndpointAddress *UPSP2CPolicy::get_one(size_t *idx, EndpointAddress *except,
+									   WFNSTracing *tracing)
+{
+	size_t n = this->servers.size();
+	EndpointAddress *server;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		server = this->servers[(*idx + i) % n];
+		if (server != except &&
+			server->fail_count < server->params->max_fails &&
+			!WFServiceGovernance::in_select_history(tracing, server))
+		{
+			*idx = (*idx + i) % n;
+			return server;
+		}
+	}
+
+	return NULL;
+}
+
+/* The latency decays as if zero were measured now, so that a server that
+ * was slow gets tried again after a while. */
+double UPSP2CPolicy::cost(const EndpointAddress *addr,
+						  long long cur_time) const
+{
+	const UPSAddrParams *params = static_cast<UPSAddrParams *>(addr->params);
+	double latency = addr->latency;
+
+	if (latency > 0)
+	{
+		latency *= exp(-(double)(cur_time - addr->latency_time) /
+					   (this->latency_decay * 1000.0));
+	}
+
+	return latency * (addr->inflight + 1) / params->weight;
+}
+
+EndpointAddress *UPSP2CPolicy::first_strategy(const ParsedURI& uri,
+											  WFNSTracing *tracing)
+{
+	size_t n = this->servers.size();
+	size_t idx = rand() % n;
+	EndpointAddress *a = this->get_one(&idx, NULL, tracing);
+	EndpointAddress *b;
+	long long cur_time;
+
+	if (!a || n == 1)
+		return a;
+
+	/* Uniform over the servers other than 'a'. */
+	idx = (idx + 1 + rand() % (n - 1)) % n;
+	b = this->get_one(&idx, a, tracing);
+	if (!b)
+		return a;
+
+	cur_time = GET_CURRENT_MICRO;
+	return this->cost(a, cur_time) <= this->cost(b, cur_time) ? a : b;
+}
+
+EndpointAddress *UPSP2CPolicy::another_strategy(const ParsedURI& uri,
+												WFNSTracing *tracing)
+{
+	/* No main server is alive. Recover them all if any reaches the fusing
+	 * timeout, as the weighted random policy does. */
+	this->try_clear_breaker();
+	return this->first_strategy(uri, tracing);
+}
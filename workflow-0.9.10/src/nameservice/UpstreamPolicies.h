@@ -27,6 +27,9 @@
 #include "WFNameService.h"
 #include "WFServiceGovernance.h"
 
+#define P2C_LATENCY_DECAY_DEFAULT	10000
+#define BOUNDED_LOAD_BALANCE_DEFAULT	1.25
+
 using upstream_route_t = std::function<unsigned int (const char *, const char *, const char *)>;
 
 class EndpointGroup;
@@ -137,10 +140,109 @@ protected:
 	EndpointAddress *first_strategy(const ParsedURI& uri,
 									WFNSTracing *tracing);
 
+protected:
+	unsigned int hash_uri(const ParsedURI& uri) const
+	{
+		return this->consistent_hash(uri.path ? uri.path : "",
+									 uri.query ? uri.query : "",
+									 uri.fragment ? uri.fragment : "");
+	}
+
 private:
 	upstream_route_t consistent_hash;
 };
 
+/* Jump consistent hash over slots of the main servers, with no ring to keep
+ * and O(ln n) jumps per lookup. A removed server leaves its slot empty for
+ * the next one added, so that the keys of the others do not move. A key on
+ * an empty slot or a fused server, or turned down in proportion to
+ * weight / max weight, jumps again with the key rehashed. */
+class UPSJumpHashPolicy : public UPSConsistentHashPolicy
+{
+public:
+	UPSJumpHashPolicy(upstream_route_t consistent_hash) :
+		UPSConsistentHashPolicy(std::move(consistent_hash))
+	{
+		this->max_weight = 1;
+	}
+
+protected:
+	EndpointAddress *first_strategy(const ParsedURI& uri,
+									WFNSTracing *tracing);
+
+protected:
+	virtual void add_server_locked(EndpointAddress *addr);
+	virtual int remove_server_locked(const std::string& address);
+
+private:
+	std::vector<EndpointAddress *> slots;
+	unsigned short max_weight;
+};
+
+/* Consistent hashing with bounded loads: the ring is walked from the key to
+ * the first alive server with fewer requests in process than
+ * ceil(balance * (all in process + 1) * weight / total weight), so that a
+ * hot key spills over to the next servers instead of overloading one. */
+class UPSBoundedLoadHashPolicy : public UPSConsistentHashPolicy
+{
+public:
+	UPSBoundedLoadHashPolicy(upstream_route_t consistent_hash,
+							 double balance) :
+		UPSConsistentHashPolicy(std::move(consistent_hash))
+	{
+		this->balance = balance > 1.0 ? balance : 1.0;
+		this->total_weight = 0;
+		/* Requests in process are traced as for the P2C policy. */
+		this->latency_decay = P2C_LATENCY_DECAY_DEFAULT;
+	}
+
+	UPSBoundedLoadHashPolicy(upstream_route_t consistent_hash) :
+		UPSBoundedLoadHashPolicy(std::move(consistent_hash),
+								 BOUNDED_LOAD_BALANCE_DEFAULT)
+	{
+	}
+
+protected:
+	EndpointAddress *first_strategy(const ParsedURI& uri,
+									WFNSTracing *tracing);
+
+protected:
+	virtual void add_server_locked(EndpointAddress *addr);
+	virtual int remove_server_locked(const std::string& address);
+
+private:
+	void init_ring();
+
+private:
+	std::vector<std::pair<unsigned int, EndpointAddress *>> ring;
+	double balance;
+	int total_weight;
+};
+
+/* Picks two alive main servers at random, and takes the one with the lower
+ * latency * (inflight + 1) / weight. */
+class UPSP2CPolicy : public UPSGroupPolicy
+{
+public:
+	UPSP2CPolicy(unsigned int latency_decay)
+	{
+		this->latency_decay = latency_decay;
+		this->try_another = true;
+	}
+
+	UPSP2CPolicy() : UPSP2CPolicy(P2C_LATENCY_DECAY_DEFAULT) { }
+
+	EndpointAddress *first_strategy(const ParsedURI& uri,
+									WFNSTracing *tracing);
+	EndpointAddress *another_strategy(const ParsedURI& uri,
+									  WFNSTracing *tracing);
+
+private:
+	EndpointAddress *get_one(size_t *idx, EndpointAddress *except,
+							 WFNSTracing *tracing);
+	double cost(const EndpointAddress *addr, long long cur_time) const;
+};
+
 class UPSManualPolicy : public UPSGroupPolicy
 {
 public:
@@ -18,6 +18,7 @@
 */
 
 #include <stdint.h>
+#include <math.h>
 #include <vector>
 #include <chrono>
 #include "URIParser.h"
@@ -29,10 +30,15 @@
 #include "WFServiceGovernance.h"
 
 #define GET_CURRENT_SECOND  std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+#define GET_CURRENT_MICRO	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
 
 #define DNS_CACHE_LEVEL_1		1
 #define DNS_CACHE_LEVEL_2		2
 
+/* A failure counts as at least this latency, in microseconds. Otherwise
+ * a server that fails fast would look like the fastest. */
+#define FAILED_LATENCY_MIN		(1000 * 1000)
+
 PolicyAddrParams::PolicyAddrParams()
 {
 	const struct AddressParams *params = &ADDRESS_PARAMS_DEFAULT;
@@ -94,6 +100,9 @@ EndpointAddress::EndpointAddress(const std::string& address,
 	this->address = address;
 	this->fail_count = 0;
 	this->ref = 1;
+	this->inflight = 0;
+	this->latency = 0;
+	this->latency_time = 0;
 	this->entry.list.next = NULL;
 	this->entry.ptr = this;
 
@@ -133,11 +142,25 @@ WFRouterTask *WFServiceGovernance::create_router_task(const struct WFNSParams *p
 		{
 			tracing_data = new TracingData;
 			tracing_data->sg = this;
+			tracing_data->inflight = NULL;
 			tracing->data = tracing_data;
 			tracing->deleter = WFServiceGovernance::tracing_deleter;
 		}
 
 		tracing_data->history.push_back(addr);
+		if (this->latency_decay)
+		{
+			if (tracing_data->inflight)
+			{
+				tracing_data->inflight->inflight--;
+				this->ninflight--;
+			}
+
+			tracing_data->inflight = addr;
+			tracing_data->select_time = GET_CURRENT_MICRO;
+			addr->inflight++;
+			this->ninflight++;
+		}
 	}
 	else
 		task = new WFSelectorFailTask(std::move(callback));
@@ -149,6 +172,12 @@ void WFServiceGovernance::tracing_deleter(void *data)
 {
 	struct TracingData *tracing_data = (struct TracingData *)data;
 
+	if (tracing_data->inflight)
+	{
+		tracing_data->inflight->inflight--;
+		tracing_data->sg->ninflight--;
+	}
+
 	for (EndpointAddress *addr : tracing_data->history)
 	{
 		if (--addr->ref == 0)
@@ -232,6 +261,9 @@ void WFServiceGovernance::success(RouteManager::RouteResult *result,
 	auto *v = &tracing_data->history;
 	EndpointAddress *server = (*v)[v->size() - 1];
 
+	if (this->latency_decay)
+		this->finish_tracing(tracing, true);
+
 	pthread_rwlock_wrlock(&this->rwlock);
 	this->recover_server_from_breaker(server);
 	pthread_rwlock_unlock(&this->rwlock);
@@ -247,6 +279,9 @@ void WFServiceGovernance::failed(RouteManager::RouteResult *result,
 	auto *v = &tracing_data->history;
 	EndpointAddress *server = (*v)[v->size() - 1];
 
+	if (this->latency_decay)
+		this->finish_tracing(tracing, false);
+
 	pthread_rwlock_wrlock(&this->rwlock);
 	if (++server->fail_count == server->params->max_fails)
 		this->fuse_server_to_breaker(server);
@@ -255,6 +290,44 @@ void WFServiceGovernance::failed(RouteManager::RouteResult *result,
 	this->WFNSPolicy::failed(result, tracing, target);
 }
 
+void WFServiceGovernance::finish_tracing(WFNSTracing *tracing, bool success)
+{
+	struct TracingData *tracing_data = (struct TracingData *)tracing->data;
+	EndpointAddress *addr = tracing_data->inflight;
+	long long cur_time;
+	long long latency;
+	double ewma;
+	double w;
+
+	/* Finished already, as success() may come again on the same address. */
+	if (!addr)
+		return;
+
+	tracing_data->inflight = NULL;
+	addr->inflight--;
+	this->ninflight--;
+
+	cur_time = GET_CURRENT_MICRO;
+	latency = cur_time - tracing_data->select_time;
+	if (!success && latency < FAILED_LATENCY_MIN)
+		latency = FAILED_LATENCY_MIN;
+
+	/* Peak EWMA: a slower sample is taken at once, a faster one is weighted
+	 * by the time since the last. */
+	ewma = addr->latency;
+	if (latency > ewma)
+		ewma = latency;
+	else
+	{
+		w = exp(-(double)(cur_time - addr->latency_time) /
+				(this->latency_decay * 1000.0));
+		ewma = ewma * w + latency * (1 - w);
+	}
+
+	addr->latency = (long long)ewma;
+	addr->latency_time = cur_time;
+}
+
 void WFServiceGovernance::check_breaker_locked(int64_t cur_time)
 {
 	struct list_head *pos, *tmp;
@@ -91,6 +91,12 @@ public:
 	long long broken_timeout;
 	PolicyAddrParams *params;
 
+	/* Traced only if the policy has a 'latency_decay'. The latency is a
+	 * peak EWMA in microseconds, updated without a lock. */
+	std::atomic<int> inflight;
+	std::atomic<long long> latency;
+	std::atomic<long long> latency_time;
+
 	struct address_entry
 	{
 		struct list_head list;
@@ -134,8 +140,10 @@ public:
 		rwlock(PTHREAD_RWLOCK_INITIALIZER)
 	{
 		this->nalives = 0;
+		this->ninflight = 0;
 		this->try_another = false;
 		this->mttr_second = MTTR_SECOND_DEFAULT;
+		this->latency_decay = 0;
 		INIT_LIST_HEAD(&this->breaker_list);
 	}
 
@@ -165,6 +173,7 @@ private:
 	void recover_server_from_breaker(EndpointAddress *addr);
 	void fuse_server_to_breaker(EndpointAddress *addr);
 	void check_breaker_locked(int64_t cur_time);
+	void finish_tracing(WFNSTracing *tracing, bool success);
 
 	struct list_head breaker_list;
 	pthread_mutex_t breaker_lock;
@@ -183,6 +192,8 @@ protected:
 	{
 		std::vector<EndpointAddress *> history;
 		WFServiceGovernance *sg;
+		EndpointAddress *inflight;	/* the last in history, until it finishes */
+		long long select_time;
 	};
 
 	static void tracing_deleter(void *data);
@@ -192,7 +203,13 @@ protected:
 					   std::vector<EndpointAddress *>> server_map;
 	pthread_rwlock_t rwlock;
 	std::atomic<int> nalives;
+	std::atomic<int> ninflight;
 	bool try_another;
+
+	/* In milliseconds. Non-zero to trace the latency and the requests in
+	 * flight of each address. The latency decays to zero in about this
+	 * time if the address is not selected. */
+	unsigned int latency_decay;
 };
 
 #endif
@@ -0,0 +1,474 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include "Http2Hpack.h"
+
+#define HPACK_ENTRY_OVERHEAD		32
+#define HPACK_STATIC_TABLE_SIZE		61
+#define HPACK_INDEX_VALUE_MAX		256
+
+namespace protocol
+{
+
+static const std::pair<std::string, std::string> __static_table[] =
+{
+	{ ":authority", "" },
+	{ ":method", "GET" },
+	{ ":method", "POST" },
+	{ ":path", "/" },
+	{ ":path", "/index.html" },
+	{ ":scheme", "http" },
+	{ ":scheme", "https" },
+	{ ":status", "200" },
+	{ ":status", "204" },
+	{ ":status", "206" },
+	{ ":status", "304" },
+	{ ":status", "400" },
+	{ ":status", "404" },
+	{ ":status", "500" },
+	{ "accept-charset", "" },
+	{ "accept-encoding", "gzip, deflate" },
+	{ "accept-language", "" },
+	{ "accept-ranges", "" },
+	{ "accept", "" },
+	{ "access-control-allow-origin", "" },
+	{ "age", "" },
+	{ "allow", "" },
+	{ "authorization", "" },
+	{ "cache-control", "" },
+	{ "content-disposition", "" },
+	{ "content-encoding", "" },
+	{ "content-language", "" },
+	{ "content-length", "" },
+	{ "content-location", "" },
+	{ "content-range", "" },
+	{ "content-type", "" },
+	{ "cookie", "" },
+	{ "date", "" },
+	{ "etag", "" },
+	{ "expect", "" },
+	{ "expires", "" },
+	{ "from", "" },
+	{ "host", "" },
+	{ "if-match", "" },
+	{ "if-modified-since", "" },
+	{ "if-none-match", "" },
+	{ "if-range", "" },
+	{ "if-unmodified-since", "" },
+	{ "last-modified", "" },
+	{ "link", "" },
+	{ "location", "" },
+	{ "max-forwards", "" },
+	{ "proxy-authenticate", "" },
+	{ "proxy-authorization", "" },
+	{ "range", "" },
+	{ "referer", "" },
+	{ "refresh", "" },
+	{ "retry-after", "" },
+	{ "server", "" },
+	{ "set-cookie", "" },
+	{ "strict-transport-security", "" },
+	{ "transfer-encoding", "" },
+	{ "user-agent", "" },
+	{ "vary", "" },
+	{ "via", "" },
+	{ "www-authenticate", "" },
+};
+
+/* Code lengths of the canonical Huffman code, symbols 0 to 256 (EOS). */
+static const uint8_t __huffman_length[257] =
+{
+	13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+	28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+	6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+	5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+	13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+	15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+	6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+	20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+	24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+	22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+	21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+	26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+	19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+	20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+	26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+	30,
+};
+
+class HuffmanDecodeTable
+{
+public:
+	/* Codes of one length are consecutive, starting at first[len]. */
+	uint32_t first[32];
+	uint16_t count[32];
+	uint16_t offset[32];
+	uint16_t symbols[257];
+
+	HuffmanDecodeTable()
+	{
+		uint32_t code = 0;
+		int n = 0;
+		int len;
+		int i;
+
+		for (len = 1; len < 32; len++)
+		{
+			this->first[len] = code;
+			this->offset[len] = n;
+			this->count[len] = 0;
+			for (i = 0; i < 257; i++)
+			{
+				if (__huffman_length[i] == len)
+				{
+					this->symbols[n++] = i;
+					this->count[len]++;
+				}
+			}
+
+			code = (code + this->count[len]) << 1;
+		}
+	}
+};
+
+static int __huffman_decode(const uint8_t *p, size_t len, std::string& out)
+{
+	static const HuffmanDecodeTable table;
+	uint32_t code = 0;
+	int bits = 0;
+	size_t i;
+	int j;
+
+	for (i = 0; i < len; i++)
+	{
+		for (j = 7; j >= 0; j--)
+		{
+			code = (code << 1) | ((p[i] >> j) & 1);
+			bits++;
+			if (code - table.first[bits] < table.count[bits])
+			{
+				int sym = table.symbols[table.offset[bits] + code - table.first[bits]];
+
+				if (sym == 256)
+					return -1;
+
+				out.push_back((char)sym);
+				code = 0;
+				bits = 0;
+			}
+			else if (bits == 30)
+				return -1;
+		}
+	}
+
+	/* Padding is the most significant bits of EOS, all ones. */
+	if (bits > 7 || code != (1U << bits) - 1)
+		return -1;
+
+	return 0;
+}
+
+static void __encode_integer(size_t value, int prefix, uint8_t first,
+							 std::string& out)
+{
+	size_t max = (1U << prefix) - 1;
+
+	if (value < max)
+	{
+		out.push_back((char)(first | value));
+		return;
+	}
+
+	out.push_back((char)(first | max));
+	value -= max;
+	while (value >= 128)
+	{
+		out.push_back((char)(value % 128 + 128));
+		value /= 128;
+	}
+
+	out.push_back((char)value);
+}
+
+static int __decode_integer(const uint8_t **pos, const uint8_t *end,
+							int prefix, size_t *value)
+{
+	size_t max = (1U << prefix) - 1;
+	const uint8_t *p = *pos;
+	int shift = 0;
+
+	*value = *p++ & max;
+	if (*value == max)
+	{
+		do
+		{
+			if (p == end || shift > 28)
+				return -1;
+
+			*value += (size_t)(*p & 127) << shift;
+			shift += 7;
+		} while (*p++ & 128);
+	}
+
+	*pos = p;
+	return 0;
+}
+
+static void __encode_string(const std::string& str, std::string& out)
+{
+	__encode_integer(str.size(), 7, 0, out);
+	out += str;
+}
+
+static int __decode_string(const uint8_t **pos, const uint8_t *end,
+						   std::string& str)
+{
+	bool huffman = (**pos & 0x80) != 0;
+	size_t len;
+
+	if (__decode_integer(pos, end, 7, &len) < 0 ||
+		len > (size_t)(end - *pos))
+		return -1;
+
+	str.clear();
+	if (huffman)
+	{
+		if (__huffman_decode(*pos, len, str) < 0)
+			return -1;
+	}
+	else
+		str.assign((const char *)*pos, len);
+
+	*pos += len;
+	return 0;
+}
+
+size_t HpackTable::find(const std::string& name, const std::string& value,
+						size_t *name_index) const
+{
+	size_t i;
+
+	*name_index = 0;
+	for (i = 0; i < HPACK_STATIC_TABLE_SIZE; i++)
+	{
+		if (__static_table[i].first == name)
+		{
+			if (__static_table[i].second == value)
+				return i + 1;
+
+			if (*name_index == 0)
+				*name_index = i + 1;
+		}
+	}
+
+	for (i = 0; i < this->entries.size(); i++)
+	{
+		if (this->entries[i].first == name)
+		{
+			if (this->entries[i].second == value)
+				return HPACK_STATIC_TABLE_SIZE + i + 1;
+
+			if (*name_index == 0)
+				*name_index = HPACK_STATIC_TABLE_SIZE + i + 1;
+		}
+	}
+
+	return 0;
+}
+
+const std::pair<std::string, std::string> *HpackTable::get(size_t index) const
+{
+	if (index == 0)
+		return NULL;
+
+	if (index <= HPACK_STATIC_TABLE_SIZE)
+		return &__static_table[index - 1];
+
+	index -= HPACK_STATIC_TABLE_SIZE + 1;
+	if (index < this->entries.size())
+		return &this->entries[index];
+
+	return NULL;
+}
+
+void HpackTable::evict(size_t limit)
+{
+	while (this->size > limit)
+	{
+		const auto& e = this->entries.back();
+
+		this->size -= e.first.size() + e.second.size() + HPACK_ENTRY_OVERHEAD;
+		this->entries.pop_back();
+	}
+}
+
+void HpackTable::add(const std::string& name, const std::string& value)
+{
+	size_t n = name.size() + value.size() + HPACK_ENTRY_OVERHEAD;
+
+	/* An entry larger than the table empties it and is not added. */
+	if (n > this->max_size)
+	{
+		this->evict(0);
+		return;
+	}
+
+	this->evict(this->max_size - n);
+	this->entries.emplace_front(name, value);
+	this->size += n;
+}
+
+void HpackTable::set_max_size(size_t max_size)
+{
+	this->max_size = max_size;
+	this->evict(max_size);
+}
+
+void HpackEncoder::set_max_table_size(size_t size)
+{
+	/* Never grow beyond the default, only follow a smaller limit. */
+	if (size > 4096)
+		size = 4096;
+
+	if (size != this->table.get_max_size())
+	{
+		this->pending_size = size;
+		this->size_changed = true;
+	}
+}
+
+void HpackEncoder::begin_block(std::string& out)
+{
+	if (this->size_changed)
+	{
+		this->table.set_max_size(this->pending_size);
+		__encode_integer(this->pending_size, 5, 0x20, out);
+		this->size_changed = false;
+	}
+}
+
+void HpackEncoder::encode(const std::string& name, const std::string& value,
+						  std::string& out)
+{
+	size_t name_index;
+	size_t index = this->table.find(name, value, &name_index);
+
+	if (index != 0)
+	{
+		__encode_integer(index, 7, 0x80, out);
+		return;
+	}
+
+	/* Values that rarely repeat would only push others out of the table. */
+	if (name == ":path" || name == "content-length" ||
+		name == "authorization" || name == "cookie" ||
+		value.size() > HPACK_INDEX_VALUE_MAX)
+	{
+		__encode_integer(name_index, 4, 0x00, out);
+	}
+	else
+	{
+		__encode_integer(name_index, 6, 0x40, out);
+		this->table.add(name, value);
+	}
+
+	if (name_index == 0)
+		__encode_string(name, out);
+
+	__encode_string(value, out);
+}
+
+int HpackDecoder::decode(const void *buf, size_t size,
+						 Http2HeaderList& headers)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	const uint8_t *end = p + size;
+	const std::pair<std::string, std::string> *entry;
+	std::string name;
+	std::string value;
+	size_t index;
+	int prefix;
+
+	while (p < end)
+	{
+		if (*p & 0x80)
+		{
+			/* Indexed header field. */
+			if (__decode_integer(&p, end, 7, &index) < 0)
+				break;
+
+			entry = this->table.get(index);
+			if (!entry)
+				break;
+
+			headers.emplace_back(*entry);
+			continue;
+		}
+
+		if ((*p & 0xe0) == 0x20)
+		{
+			/* Dynamic table size update, within our default SETTINGS. */
+			if (__decode_integer(&p, end, 5, &index) < 0 || index > 4096)
+				break;
+
+			this->table.set_max_size(index);
+			continue;
+		}
+
+		/* Literals: with incremental indexing, without, or never indexed. */
+		prefix = (*p & 0x40) ? 6 : 4;
+		bool indexing = (prefix == 6);
+
+		if (__decode_integer(&p, end, prefix, &index) < 0)
+			break;
+
+		if (index != 0)
+		{
+			entry = this->table.get(index);
+			if (!entry)
+				break;
+
+			name = entry->first;
+		}
+		else if (p == end || __decode_string(&p, end, name) < 0)
+			break;
+
+		if (p == end || __decode_string(&p, end, value) < 0)
+			break;
+
+		if (indexing)
+			this->table.add(name, value);
+
+		headers.emplace_back(std::move(name), std::move(value));
+	}
+
+	if (p != end)
+	{
+		errno = EBADMSG;
+		return -1;
+	}
+
+	return 0;
+}
+
+}
+
@@ -0,0 +1,1443 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <functional>
+#include <utility>
+#include "HttpUtil.h"
+#include "Http2Message.h"
+
+#define HTTP2_PREFACE			"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define HTTP2_PREFACE_LEN		24
+#define HTTP2_FRAME_HEADER_LEN	9
+#define HTTP2_FRAME_SIZE		16384
+#define HTTP2_WINDOW_DEFAULT	65535
+#define HTTP2_WINDOW_MAX		0x7fffffff
+#define HTTP2_MAX_STREAMS		100
+#define HTTP2_FLUSH_SIZE		65536
+
+/* Frames we take, so that the streams of a message are written in its
+ * vectors. */
+#define HTTP2_MAX_FRAME_SIZE	(1 << 20)
+
+#define HTTP2_DATA				0x0
+#define HTTP2_HEADERS			0x1
+#define HTTP2_PRIORITY			0x2
+#define HTTP2_RST_STREAM		0x3
+#define HTTP2_SETTINGS			0x4
+#define HTTP2_PUSH_PROMISE		0x5
+#define HTTP2_PING				0x6
+#define HTTP2_GOAWAY			0x7
+#define HTTP2_WINDOW_UPDATE		0x8
+#define HTTP2_CONTINUATION		0x9
+
+#define HTTP2_FLAG_END_STREAM	0x1
+#define HTTP2_FLAG_ACK			0x1
+#define HTTP2_FLAG_END_HEADERS	0x4
+#define HTTP2_FLAG_PADDED		0x8
+#define HTTP2_FLAG_PRIORITY		0x20
+
+#define HTTP2_SETTINGS_HEADER_TABLE_SIZE		0x1
+#define HTTP2_SETTINGS_ENABLE_PUSH				0x2
+#define HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS	0x3
+#define HTTP2_SETTINGS_INITIAL_WINDOW_SIZE		0x4
+#define HTTP2_SETTINGS_MAX_FRAME_SIZE			0x5
+
+#define HTTP2_REFUSED_STREAM	0x7
+#define HTTP2_CANCEL			0x8
+
+namespace protocol
+{
+
+static inline uint32_t __get_uint32(const char *p)
+{
+	const uint8_t *q = (const uint8_t *)p;
+
+	return ((uint32_t)q[0] << 24) | ((uint32_t)q[1] << 16) |
+		   ((uint32_t)q[2] << 8) | q[3];
+}
+
+static inline void __put_uint32(uint32_t n, std::string& out)
+{
+	out.push_back((char)(n >> 24));
+	out.push_back((char)(n >> 16));
+	out.push_back((char)(n >> 8));
+	out.push_back((char)n);
+}
+
+static void __frame_header(size_t len, uint8_t type, uint8_t flags,
+						   uint32_t stream_id, std::string& out)
+{
+	out.push_back((char)(len >> 16));
+	out.push_back((char)(len >> 8));
+	out.push_back((char)len);
+	out.push_back((char)type);
+	out.push_back((char)flags);
+	__put_uint32(stream_id & HTTP2_WINDOW_MAX, out);
+}
+
+static void __setting(uint16_t id, uint32_t value, std::string& out)
+{
+	out.push_back((char)(id >> 8));
+	out.push_back((char)id);
+	__put_uint32(value, out);
+}
+
+static void __window_update(uint32_t stream_id, uint32_t increment,
+							std::string& out)
+{
+	__frame_header(4, HTTP2_WINDOW_UPDATE, 0, stream_id, out);
+	__put_uint32(increment, out);
+}
+
+/* Our SETTINGS and a connection WINDOW_UPDATE to the largest windows. A
+ * peer of ours then never holds back DATA, which it would write only while
+ * receiving. */
+static void __local_settings(bool server, std::string& out)
+{
+	__frame_header(18, HTTP2_SETTINGS, 0, 0, out);
+	if (server)
+		__setting(HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, HTTP2_MAX_STREAMS, out);
+	else
+		__setting(HTTP2_SETTINGS_ENABLE_PUSH, 0, out);
+
+	__setting(HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, HTTP2_WINDOW_MAX, out);
+	__setting(HTTP2_SETTINGS_MAX_FRAME_SIZE, HTTP2_MAX_FRAME_SIZE, out);
+	__window_update(0, HTTP2_WINDOW_MAX - HTTP2_WINDOW_DEFAULT, out);
+}
+
+void Http2Session::client_preface(std::string& out)
+{
+	out.append(HTTP2_PREFACE, HTTP2_PREFACE_LEN);
+	__local_settings(false, out);
+}
+
+void Http2Session::server_preface(std::string& out)
+{
+	__local_settings(true, out);
+}
+
+Http2Session::Http2Session(bool server)
+{
+	this->server = server;
+	this->preface_done = false;
+	this->settings_received = false;
+	this->settings_acked = false;
+	this->goaway = false;
+	this->last_stream_id = 0;
+	this->peer_max_frame_size = HTTP2_FRAME_SIZE;
+	this->peer_max_streams = (uint32_t)-1;
+	this->peer_initial_window = HTTP2_WINDOW_DEFAULT;
+	this->peer_window = HTTP2_WINDOW_DEFAULT;
+	this->recv_window = HTTP2_WINDOW_MAX;
+	this->flush_ping = false;
+	this->continuation_id = 0;
+}
+
+/* Connection specific headers have no meaning in HTTP/2. */
+static bool __is_connection_header(const std::string& name,
+								   const std::string& value)
+{
+	static const char *const names[] = {
+		"connection", "keep-alive", "proxy-connection", "transfer-encoding",
+		"upgrade", "host", "content-length", "expect"
+	};
+
+	for (const char *n : names)
+	{
+		if (name == n)
+			return true;
+	}
+
+	return name == "te" && strcasecmp(value.c_str(), "trailers") != 0;
+}
+
+static void __encode_headers(const HttpMessage *msg, HpackEncoder& encoder,
+							 std::string& block)
+{
+	HttpHeaderCursor cursor(msg);
+	std::string name;
+	std::string value;
+
+	while (cursor.next(name, value))
+	{
+		for (char& c : name)
+			c = tolower((unsigned char)c);
+
+		if (!__is_connection_header(name, value))
+			encoder.encode(name, value, block);
+	}
+}
+
+/* DATA frames of 'len' bytes, the last one ending the stream if all of
+ * the body is in them. */
+static void __data_frames(uint32_t stream_id, const char *data, size_t len,
+						  bool end_stream, size_t frame_size, std::string& out)
+{
+	size_t pos = 0;
+	size_t n;
+
+	do
+	{
+		n = len - pos;
+		if (n > frame_size)
+			n = frame_size;
+
+		__frame_header(n, HTTP2_DATA,
+					   end_stream && pos + n == len ? HTTP2_FLAG_END_STREAM : 0,
+					   stream_id, out);
+		out.append(data + pos, n);
+		pos += n;
+	} while (pos < len);
+}
+
+/* DATA of blocked streams, as much as the windows and 'room' take now.
+ * Returns true if stopped by 'room'. */
+static bool __blocked_frames(Http2Session *session, int64_t room,
+							 std::string& out)
+{
+	size_t frame_size = session->peer_max_frame_size;
+	auto it = session->blocked.begin();
+	bool full = false;
+	int64_t n;
+
+	while (it != session->blocked.end() && session->peer_window > 0 && !full)
+	{
+		n = it->data.size() - it->pos;
+		if (n > it->window)
+			n = it->window;
+
+		if (n > session->peer_window)
+			n = session->peer_window;
+
+		if (n > room)
+		{
+			n = room > 0 ? room : 0;
+			full = true;
+		}
+
+		if (n > 0)
+		{
+			__data_frames(it->stream_id, it->data.data() + it->pos, n,
+						  it->pos + n == it->data.size(), frame_size, out);
+			it->pos += n;
+			it->window -= n;
+			session->peer_window -= n;
+			room -= n;
+		}
+
+		if (it->pos == it->data.size())
+			it = session->blocked.erase(it);
+		else
+			++it;
+	}
+
+	return full;
+}
+
+/* A client writes DATA of blocked streams in reply while receiving, up to
+ * HTTP2_FLUSH_SIZE of reply at a time. A PING then asks for more to be
+ * written when its ack arrives, that is when the peer has read all before
+ * it, so a reply finds the socket drained. A server writes them only in
+ * messages out, see __input_complete(). */
+static void __send_blocked(Http2Session *session, std::string& reply)
+{
+	if (session->is_server() || session->flush_ping)
+		return;
+
+	if (__blocked_frames(session, HTTP2_FLUSH_SIZE - (int64_t)reply.size(),
+						 reply))
+	{
+		__frame_header(8, HTTP2_PING, 0, 0, reply);
+		reply.append(8, '\0');
+		session->flush_ping = true;
+	}
+}
+
+/* DATA of blocked streams that the windows take now. */
+static bool __blocked_sendable(const Http2Session *session)
+{
+	if (session->peer_window <= 0)
+		return false;
+
+	for (const Http2Blocked& blocked : session->blocked)
+	{
+		if (blocked.window > 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* Writes 'reply' after the frames left unsent before. What the socket does
+ * not take now is kept in the session, and written first by the next
+ * append or message out of the connection. */
+static int __write_reply(Http2Session *session, std::string& reply,
+						 const std::function<int (const void *, size_t)>& write)
+{
+	std::string& unsent = session->unsent;
+	int ret;
+
+	if (!unsent.empty())
+	{
+		unsent.append(reply);
+		reply.clear();
+		reply.swap(unsent);
+	}
+
+	if (reply.empty())
+		return 0;
+
+	ret = write(reply.data(), reply.size());
+	if (ret < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return -1;
+
+		ret = 0;
+	}
+
+	unsent.assign(reply, ret, std::string::npos);
+	return 0;
+}
+
+static bool __drop_blocked(Http2Session *session, uint32_t stream_id)
+{
+	for (auto it = session->blocked.begin(); it != session->blocked.end(); ++it)
+	{
+		if (it->stream_id == stream_id)
+		{
+			session->blocked.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int __add_vector(struct iovec vectors[], int i,
+						const void *base, size_t len)
+{
+	if (i > 0 &&
+		(const char *)vectors[i - 1].iov_base + vectors[i - 1].iov_len == base)
+	{
+		vectors[i - 1].iov_len += len;
+		return i;
+	}
+
+	vectors[i].iov_base = (void *)base;
+	vectors[i].iov_len = len;
+	return i + 1;
+}
+
+/* Room in 'output' for the frames of 'n' streams, so that the vectors into
+ * it stay valid. Also for RST_STREAM frames, and for frames ending the
+ * streams. */
+static void __reserve_frames(const Http2Session *session, size_t block_size,
+							 size_t body_size, size_t n, std::string& output)
+{
+	size_t frame_size = session->peer_max_frame_size;
+	size_t data = session->peer_window > 0 ? session->peer_window : 0;
+
+	if (data > body_size)
+		data = body_size;
+
+	output.reserve(output.size() + block_size + HTTP2_FRAME_HEADER_LEN *
+				   ((block_size + data) / frame_size + 4 * n + 2));
+}
+
+/* HEADERS and CONTINUATION frames of 'block', then DATA frames of the
+ * output body as far as the windows and vectors take. Frame headers are
+ * kept in 'output', and the rest of the body in the session. Vectors are
+ * added from 'i' up to 'max'. If not 'end_stream', a body sent in full
+ * does not end the stream. '*ended' tells if it is sent in full. */
+static int __encode_frames(Http2Session *session, uint32_t stream_id,
+						   const std::string& block,
+						   struct iovec body[], int nbody, size_t body_size,
+						   bool end_stream, bool *ended,
+						   std::string& output,
+						   struct iovec vectors[], int i, int max)
+{
+	size_t frame_size = session->peer_max_frame_size;
+	int64_t window = session->peer_window;
+	Http2Blocked blocked;
+	size_t head;
+	size_t pos;
+	size_t len;
+	size_t n;
+	uint8_t flags;
+	int j;
+	int k;
+
+	if (window > session->peer_initial_window)
+		window = session->peer_initial_window;
+
+	if (window < 0)
+		window = 0;
+
+	if ((size_t)window > body_size)
+		window = body_size;
+
+	head = output.size();
+	pos = 0;
+	do
+	{
+		len = block.size() - pos;
+		if (len > frame_size)
+			len = frame_size;
+
+		flags = (pos + len == block.size()) ? HTTP2_FLAG_END_HEADERS : 0;
+		if (pos == 0 && body_size == 0 && end_stream)
+			flags |= HTTP2_FLAG_END_STREAM;
+
+		__frame_header(len, pos == 0 ? HTTP2_HEADERS : HTTP2_CONTINUATION,
+					   flags, stream_id, output);
+		output.append(block, pos, len);
+		pos += len;
+	} while (pos < block.size());
+
+	i = __add_vector(vectors, i, output.data() + head, output.size() - head);
+	j = 0;
+	pos = 0;
+	while (pos < (size_t)window && i < max - 1)
+	{
+		len = window - pos;
+		if (len > frame_size)
+			len = frame_size;
+
+		/* Shorter if the body vectors of the frame do not fit. */
+		n = 0;
+		for (k = j; k < nbody && n < len && k - j < max - i - 1; k++)
+			n += body[k].iov_len;
+
+		if (n == 0)
+			break;
+
+		if (n < len)
+			len = n;
+
+		flags = (pos + len == body_size && end_stream) ?
+				HTTP2_FLAG_END_STREAM : 0;
+		head = output.size();
+		__frame_header(len, HTTP2_DATA, flags, stream_id, output);
+		i = __add_vector(vectors, i, output.data() + head,
+						 HTTP2_FRAME_HEADER_LEN);
+		pos += len;
+
+		/* Body vectors, split at the frame boundary. */
+		while (len > 0)
+		{
+			n = body[j].iov_len;
+			if (n > len)
+				n = len;
+
+			i = __add_vector(vectors, i, body[j].iov_base, n);
+			body[j].iov_base = (char *)body[j].iov_base + n;
+			body[j].iov_len -= n;
+			if (body[j].iov_len == 0)
+				j++;
+
+			len -= n;
+		}
+	}
+
+	session->peer_window -= pos;
+	*ended = (pos == body_size);
+	if (pos < body_size)
+	{
+		blocked.stream_id = stream_id;
+		blocked.window = session->peer_initial_window - pos;
+		blocked.data.reserve(body_size - pos);
+		blocked.pos = 0;
+		for (; j < nbody; j++)
+		{
+			blocked.data.append((const char *)body[j].iov_base,
+								body[j].iov_len);
+		}
+
+		session->blocked.emplace_back(std::move(blocked));
+	}
+
+	return i;
+}
+
+static void __rst_stream(uint32_t stream_id, uint32_t code, std::string& out)
+{
+	__frame_header(4, HTTP2_RST_STREAM, 0, stream_id, out);
+	__put_uint32(code, out);
+}
+
+static int __reply_settings(const char *p, size_t len, Http2Session *session,
+							std::string& reply)
+{
+	uint32_t value;
+	size_t i;
+
+	if (len % 6 != 0)
+		return -1;
+
+	for (i = 0; i < len; i += 6)
+	{
+		value = __get_uint32(p + i + 2);
+		switch (((uint8_t)p[i] << 8) | (uint8_t)p[i + 1])
+		{
+		case HTTP2_SETTINGS_HEADER_TABLE_SIZE:
+			session->encoder.set_max_table_size(value);
+			break;
+		case HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS:
+			session->peer_max_streams = value;
+			break;
+		case HTTP2_SETTINGS_INITIAL_WINDOW_SIZE:
+			if (value > HTTP2_WINDOW_MAX)
+				return -1;
+
+			/* Applies to the windows of open streams. */
+			for (Http2Blocked& blocked : session->blocked)
+				blocked.window += (int64_t)value - session->peer_initial_window;
+
+			session->peer_initial_window = value;
+			break;
+		case HTTP2_SETTINGS_MAX_FRAME_SIZE:
+			if (value < HTTP2_FRAME_SIZE || value > 0xffffff)
+				return -1;
+
+			session->peer_max_frame_size = value;
+			break;
+		}
+	}
+
+	session->settings_received = true;
+	__frame_header(0, HTTP2_SETTINGS, HTTP2_FLAG_ACK, 0, reply);
+	__send_blocked(session, reply);
+	return 0;
+}
+
+/* The streams a message receives. A server request takes in new ones by
+ * 'accept', which returns NULL past the limit of a request. */
+struct __Http2Input
+{
+	Http2Session *session;
+	std::vector<Http2Stream *> streams;
+	std::function<Http2Stream *()> accept;
+	bool handshake;
+	std::string reply;
+};
+
+static Http2Stream *__find_stream(__Http2Input *in, uint32_t id)
+{
+	for (Http2Stream *stream : in->streams)
+	{
+		if (stream->stream_id == id && id != 0)
+			return stream->reset ? NULL : stream;
+	}
+
+	return NULL;
+}
+
+/* A new stream of the peer, or NULL if refused. */
+static Http2Stream *__accept_stream(__Http2Input *in, uint32_t id)
+{
+	Http2Session *session = in->session;
+	Http2Stream *stream;
+
+	session->last_stream_id = id;
+	stream = in->accept();
+	if (!stream)
+	{
+		__rst_stream(id, HTTP2_REFUSED_STREAM, in->reply);
+		return NULL;
+	}
+
+	stream->stream_id = id;
+	in->streams.push_back(stream);
+	return stream;
+}
+
+/* Decodes the header block of the session. A block of no stream of ours
+ * is decoded only for the state of the decoder. */
+static int __decode_block(Http2Session *session, Http2Stream *stream)
+{
+	Http2HeaderList headers;
+
+	if (session->decoder.decode(session->header_block.data(),
+								session->header_block.size(), headers) < 0)
+		return -1;
+
+	session->header_block.clear();
+	if (!stream)
+		return 0;
+
+	/* Interim 1xx responses are dropped, the final one follows. */
+	if (!stream->headers_done && !headers.empty() &&
+		headers[0].first == ":status" && headers[0].second[0] == '1')
+		return 0;
+
+	for (auto& header : headers)
+		stream->headers.emplace_back(std::move(header));
+
+	stream->headers_done = true;
+	return 0;
+}
+
+/* Handles one frame. Frames of other streams are decoded and dropped. */
+static int __input_frame(const char *p, size_t len, uint8_t type,
+						 uint8_t flags, uint32_t id, __Http2Input *in)
+{
+	Http2Session *session = in->session;
+	bool server = session->is_server();
+	Http2Stream *stream;
+	uint32_t last_id;
+	size_t off = 0;
+	size_t pad = 0;
+
+	if (session->continuation_id != 0 &&
+		(type != HTTP2_CONTINUATION || id != session->continuation_id))
+	{
+		errno = EBADMSG;
+		return -1;
+	}
+
+	switch (type)
+	{
+	case HTTP2_HEADERS:
+		if (id == 0)
+			break;
+
+		if (flags & HTTP2_FLAG_PADDED)
+		{
+			if (len == 0)
+				break;
+
+			pad = (uint8_t)*p;
+			off = 1;
+		}
+
+		if (flags & HTTP2_FLAG_PRIORITY)
+			off += 5;
+
+		if (off + pad > len)
+			break;
+
+		stream = __find_stream(in, id);
+		if (!stream && in->accept && (id & 1) && id > session->last_stream_id)
+			stream = __accept_stream(in, id);
+
+		session->header_block.append(p + off, len - off - pad);
+		if (stream && (flags & HTTP2_FLAG_END_STREAM))
+			stream->end_stream = true;
+
+		if (flags & HTTP2_FLAG_END_HEADERS)
+			return __decode_block(session, stream);
+
+		session->continuation_id = id;
+		return 0;
+
+	case HTTP2_CONTINUATION:
+		if (id != session->continuation_id)
+			break;
+
+		session->header_block.append(p, len);
+		if (flags & HTTP2_FLAG_END_HEADERS)
+		{
+			session->continuation_id = 0;
+			return __decode_block(session, __find_stream(in, id));
+		}
+
+		return 0;
+
+	case HTTP2_DATA:
+		if ((int64_t)len > session->recv_window)
+			break;
+
+		session->recv_window -= len;
+		if (session->recv_window < HTTP2_WINDOW_MAX / 2)
+		{
+			__window_update(0, HTTP2_WINDOW_MAX - session->recv_window,
+							in->reply);
+			session->recv_window = HTTP2_WINDOW_MAX;
+		}
+
+		stream = __find_stream(in, id);
+		if (!stream)
+			return 0;
+
+		if (stream->recv_unacked + len > HTTP2_WINDOW_MAX)
+			break;
+
+		stream->recv_unacked += len;
+		if (flags & HTTP2_FLAG_PADDED)
+		{
+			if (len == 0 || (size_t)(uint8_t)*p + 1 > len)
+				break;
+
+			len -= (uint8_t)*p + 1;
+			p++;
+		}
+
+		if (stream->body.size() + len > stream->size_limit)
+		{
+			errno = EMSGSIZE;
+			return -1;
+		}
+
+		stream->body.append(p, len);
+		if (flags & HTTP2_FLAG_END_STREAM)
+			stream->end_stream = true;
+		else if (stream->recv_unacked >= HTTP2_WINDOW_MAX / 2)
+		{
+			__window_update(id, stream->recv_unacked, in->reply);
+			stream->recv_unacked = 0;
+		}
+
+		return 0;
+
+	case HTTP2_SETTINGS:
+		if (id != 0)
+			break;
+
+		if (flags & HTTP2_FLAG_ACK)
+		{
+			session->settings_acked = true;
+			return 0;
+		}
+
+		if (__reply_settings(p, len, session, in->reply) < 0)
+			break;
+
+		return 0;
+
+	case HTTP2_PING:
+		if (len != 8 || id != 0)
+			break;
+
+		if (flags & HTTP2_FLAG_ACK)
+		{
+			session->flush_ping = false;
+			__send_blocked(session, in->reply);
+		}
+		else
+		{
+			__frame_header(8, HTTP2_PING, HTTP2_FLAG_ACK, 0, in->reply);
+			in->reply.append(p, 8);
+		}
+
+		return 0;
+
+	case HTTP2_WINDOW_UPDATE:
+		if (len != 4)
+			break;
+
+		if (id == 0)
+			session->peer_window += __get_uint32(p) & HTTP2_WINDOW_MAX;
+		else
+		{
+			for (Http2Blocked& blocked : session->blocked)
+			{
+				if (blocked.stream_id == id)
+					blocked.window += __get_uint32(p) & HTTP2_WINDOW_MAX;
+			}
+		}
+
+		__send_blocked(session, in->reply);
+		return 0;
+
+	case HTTP2_RST_STREAM:
+		if (len != 4 || id == 0)
+			break;
+
+		__drop_blocked(session, id);
+		stream = __find_stream(in, id);
+		if (stream)
+		{
+			stream->reset = true;
+			stream->refused = (__get_uint32(p) == HTTP2_REFUSED_STREAM);
+		}
+
+		return 0;
+
+	case HTTP2_GOAWAY:
+		if (len < 8)
+			break;
+
+		/* Streams after the last one are not processed by the server. */
+		session->goaway = true;
+		last_id = __get_uint32(p) & HTTP2_WINDOW_MAX;
+		for (size_t i = 0; i < in->streams.size() && !server; i++)
+		{
+			stream = in->streams[i];
+			if (stream->stream_id > last_id)
+			{
+				stream->reset = true;
+				stream->refused = true;
+			}
+		}
+
+		return 0;
+
+	case HTTP2_PUSH_PROMISE:
+		break;
+
+	default:
+		/* PRIORITY and unknown frames. */
+		return 0;
+	}
+
+	errno = EBADMSG;
+	return -1;
+}
+
+/* All the streams ended or reset. A server request also needs a stream at
+ * least, or without any, it ends to write the frames held back, see
+ * Http2Response::encode(). The first message also waits for our SETTINGS
+ * to be acked, so the ack does not arrive while the connection is not
+ * reading. */
+static bool __input_complete(const __Http2Input *in)
+{
+	const Http2Session *session = in->session;
+	size_t live = 0;
+
+	if (!session->settings_acked)
+		return false;
+
+	if (in->handshake)
+		return session->settings_received;
+
+	for (const Http2Stream *stream : in->streams)
+	{
+		if (stream->reset)
+			continue;
+
+		if (!stream->headers_done || !stream->end_stream)
+			return false;
+
+		live++;
+	}
+
+	if (!session->is_server() || live != 0)
+		return true;
+
+	return in->streams.empty() &&
+		   (!session->unsent.empty() || __blocked_sendable(session));
+}
+
+/* Consumes all of 'buf', and returns 1 when the message is complete. Only
+ * a partial frame is kept in the session, for the next append. */
+static int __input(const void *buf, size_t size, __Http2Input *in)
+{
+	Http2Session *session = in->session;
+	const uint8_t *h;
+	const char *p;
+	size_t n;
+	size_t len;
+
+	if (!session)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	std::string& frame = session->pending;
+
+	/* Whole frames are read in place. */
+	if (frame.empty())
+	{
+		p = (const char *)buf;
+		n = size;
+	}
+	else
+	{
+		frame.append((const char *)buf, size);
+		p = frame.data();
+		n = frame.size();
+	}
+
+	if (session->is_server() && !session->preface_done)
+	{
+		len = n < HTTP2_PREFACE_LEN ? n : HTTP2_PREFACE_LEN;
+		if (memcmp(p, HTTP2_PREFACE, len) != 0)
+		{
+			errno = EBADMSG;
+			return -1;
+		}
+
+		if (len < HTTP2_PREFACE_LEN)
+		{
+			if (frame.empty())
+				frame.assign(p, n);
+
+			return 0;
+		}
+
+		Http2Session::server_preface(in->reply);
+		session->preface_done = true;
+		p += HTTP2_PREFACE_LEN;
+		n -= HTTP2_PREFACE_LEN;
+	}
+
+	while (n >= HTTP2_FRAME_HEADER_LEN)
+	{
+		h = (const uint8_t *)p;
+		len = ((size_t)h[0] << 16) | ((size_t)h[1] << 8) | h[2];
+		if (len > HTTP2_MAX_FRAME_SIZE)
+		{
+			errno = EBADMSG;
+			return -1;
+		}
+
+		if (n < HTTP2_FRAME_HEADER_LEN + len)
+			break;
+
+		if (__input_frame(p + HTTP2_FRAME_HEADER_LEN, len, h[3], h[4],
+						  __get_uint32(p + 5) & HTTP2_WINDOW_MAX, in) < 0)
+			return -1;
+
+		p += HTTP2_FRAME_HEADER_LEN + len;
+		n -= HTTP2_FRAME_HEADER_LEN + len;
+	}
+
+	if (frame.empty())
+		frame.assign(p, n);
+	else
+		frame.erase(0, frame.size() - n);
+
+	if (!__input_complete(in))
+		return 0;
+
+	/* A response may end before all of the request is sent. */
+	if (!in->handshake && !session->is_server())
+	{
+		for (const Http2Stream *stream : in->streams)
+		{
+			if (__drop_blocked(session, stream->stream_id))
+				__rst_stream(stream->stream_id, HTTP2_CANCEL, in->reply);
+		}
+	}
+
+	return 1;
+}
+
+static bool __find_pseudo(const Http2HeaderList& headers, const char *name,
+						  std::string& value)
+{
+	for (const auto& header : headers)
+	{
+		if (header.first[0] != ':')
+			break;
+
+		if (header.first == name)
+		{
+			value = header.second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Headers after the start line in the HTTP/1 form that the http parser
+ * reads. The body follows with a Content-Length of the received size. */
+static void __to_http1(Http2Stream *stream, std::string& text)
+{
+	for (const auto& header : stream->headers)
+	{
+		if (header.first[0] == ':' || header.first == "content-length")
+			continue;
+
+		text += header.first;
+		text += ": ";
+		text += header.second;
+		text += "\r\n";
+	}
+
+	text += "content-length: ";
+	text += std::to_string(stream->body.size());
+	text += "\r\n\r\n";
+	stream->headers.clear();
+}
+
+static void __request_block(const HttpRequest *req, bool https,
+							HpackEncoder& encoder, std::string& block)
+{
+	const char *method = req->get_method();
+	const char *uri = req->get_request_uri();
+	std::string host;
+
+	HttpHeaderCursor(req).find("Host", host);
+	encoder.begin_block(block);
+	encoder.encode(":method", method ? method : "GET", block);
+	encoder.encode(":scheme", https ? "https" : "http", block);
+	encoder.encode(":authority", host, block);
+	encoder.encode(":path", uri ? uri : "/", block);
+	__encode_headers(req, encoder, block);
+}
+
+static void __response_block(const HttpResponse *resp,
+							 HpackEncoder& encoder, std::string& block)
+{
+	const char *status = resp->get_status_code();
+
+	encoder.begin_block(block);
+	encoder.encode(":status", status ? status : "200", block);
+	__encode_headers(resp, encoder, block);
+}
+
+int Http2Handshake::encode(struct iovec vectors[], int max)
+{
+	if (!this->session || max < 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	this->output.clear();
+	Http2Session::client_preface(this->output);
+	this->session->preface_done = true;
+	vectors[0].iov_base = (void *)this->output.data();
+	vectors[0].iov_len = this->output.size();
+	return 1;
+}
+
+int Http2Handshake::append(const void *buf, size_t *size)
+{
+	__Http2Input in;
+	int ret;
+
+	in.session = this->session;
+	in.handshake = true;
+	ret = __input(buf, *size, &in);
+	if (ret >= 0 && __write_reply(in.session, in.reply,
+								  [this](const void *data, size_t n) {
+		return this->feedback(data, n);
+	}) < 0)
+		return -1;
+
+	return ret;
+}
+
+/* The streams that the peer takes, of the ids left, and of the vectors
+ * with one at least for each. Others are not sent. */
+static size_t __sendable_streams(const Http2Session *session, size_t n,
+								 int max)
+{
+	uint32_t id = session->last_stream_id == 0 ? 1 :
+				  session->last_stream_id + 2;
+
+	if (n > session->peer_max_streams)
+		n = session->peer_max_streams;
+
+	if (n > (HTTP2_WINDOW_MAX - id) / 2 + 1)
+		n = (HTTP2_WINDOW_MAX - id) / 2 + 1;
+
+	if (n > (size_t)max / 2)
+		n = max / 2;
+
+	return n != 0 ? n : 1;
+}
+
+int Http2Request::encode(struct iovec vectors[], int max)
+{
+	Http2Session *session = this->session;
+	struct iovec body[max];
+	std::vector<Http2Request *> reqs(1, this);
+	std::vector<std::string> blocks;
+	std::vector<uint32_t> ends;
+	size_t block_size = 0;
+	size_t body_size = 0;
+	size_t prefix;
+	size_t head;
+	size_t n;
+	size_t k;
+	bool ended;
+	int nbody;
+	int i = 0;
+
+	if (!session || max < 5)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* A partial frame left unsent goes on first, and the rest of the held
+	 * back DATA last. */
+	this->output.clear();
+	this->output.swap(session->unsent);
+	this->tail.clear();
+	prefix = this->output.size();
+	n = __sendable_streams(session, 1 + this->streams.size(), max - 3);
+	for (const auto& stream : this->streams)
+	{
+		stream.first->stream.stream_id = 0;
+		if (reqs.size() < n)
+			reqs.push_back(stream.first);
+	}
+
+	blocks.resize(n);
+	for (k = 0; k < n; k++)
+	{
+		Http2Request *req = reqs[k];
+
+		if (session->last_stream_id == 0)
+			req->stream.stream_id = 1;
+		else
+			req->stream.stream_id = session->last_stream_id + 2;
+
+		session->last_stream_id = req->stream.stream_id;
+		__request_block(req, this->https, session->encoder, blocks[k]);
+		block_size += blocks[k].size();
+		body_size += req->get_output_body_size();
+	}
+
+	__reserve_frames(session, block_size, body_size, n, this->output);
+	if (prefix != 0)
+		i = __add_vector(vectors, i, this->output.data(), prefix);
+
+	for (k = 0; k < n; k++)
+	{
+		nbody = reqs[k]->encode_output_body(body, max - 1);
+		if (nbody < 0)
+			return -1;
+
+		i = __encode_frames(session, reqs[k]->stream.stream_id, blocks[k],
+							body, nbody, reqs[k]->get_output_body_size(),
+							false, &ended, this->output,
+							vectors, i, max - 2 - (n - 1 - k));
+		if (ended)
+			ends.push_back(reqs[k]->stream.stream_id);
+	}
+
+	/* The streams sent in full end together, after all of their frames, so
+	 * a server sees every stream of the request before any of them ends. */
+	head = this->output.size();
+	for (uint32_t id : ends)
+		__frame_header(0, HTTP2_DATA, HTTP2_FLAG_END_STREAM, id, this->output);
+
+	if (!ends.empty())
+	{
+		i = __add_vector(vectors, i, this->output.data() + head,
+						 this->output.size() - head);
+	}
+
+	__blocked_frames(session, INT64_MAX, this->tail);
+	if (!this->tail.empty())
+		i = __add_vector(vectors, i, this->tail.data(), this->tail.size());
+
+	return i;
+}
+
+int Http2Request::parse_stream()
+{
+	std::string text;
+	std::string method;
+	std::string path;
+	std::string authority;
+	size_t n;
+	int ret;
+
+	if (!__find_pseudo(this->stream.headers, ":method", method) ||
+		!__find_pseudo(this->stream.headers, ":path", path))
+	{
+		errno = EBADMSG;
+		return -1;
+	}
+
+	text = method + " " + path + " HTTP/2\r\n";
+	if (__find_pseudo(this->stream.headers, ":authority", authority))
+		text += "host: " + authority + "\r\n";
+
+	__to_http1(&this->stream, text);
+	n = text.size();
+	ret = this->HttpRequest::append(text.data(), &n);
+	if (ret == 0 && !this->stream.body.empty())
+	{
+		n = this->stream.body.size();
+		ret = this->HttpRequest::append(this->stream.body.data(), &n);
+	}
+
+	this->stream.body.clear();
+	this->stream.body.shrink_to_fit();
+	if (ret == 0)
+	{
+		errno = EBADMSG;
+		ret = -1;
+	}
+
+	return ret;
+}
+
+int Http2Request::append(const void *buf, size_t *size)
+{
+	__Http2Input in;
+	int ret;
+
+	in.session = this->session;
+	in.handshake = false;
+	if (this->stream.stream_id != 0)
+		in.streams.push_back(&this->stream);
+
+	for (Http2Request& req : this->received)
+		in.streams.push_back(&req.stream);
+
+	/* The first stream is this request's, more are kept aside. */
+	in.accept = [this]() -> Http2Stream * {
+		if (this->stream.stream_id == 0)
+			return &this->stream;
+
+		if (this->received.size() + 1 >= HTTP2_MAX_STREAMS)
+			return NULL;
+
+		this->received.emplace_back();
+		Http2Request& req = this->received.back();
+
+		req.session = this->session;
+		req.size_limit = this->size_limit;
+		req.stream.size_limit = this->size_limit;
+		return &req.stream;
+	};
+
+	this->stream.size_limit = this->size_limit;
+	ret = __input(buf, *size, &in);
+	if (ret >= 0 && __write_reply(in.session, in.reply,
+								  [this](const void *data, size_t n) {
+		return this->feedback(data, n);
+	}) < 0)
+		return -1;
+
+	/* No stream, only frames to write. */
+	if (ret <= 0 || this->stream.stream_id == 0)
+		return ret;
+
+	/* Reset streams are dropped, and this request takes the first left. */
+	if (this->stream.reset)
+	{
+		for (Http2Request& req : this->received)
+		{
+			if (!req.stream.reset)
+			{
+				std::swap(this->stream, req.stream);
+				break;
+			}
+		}
+	}
+
+	this->received.remove_if([](const Http2Request& req) {
+		return req.stream.reset;
+	});
+
+	ret = this->parse_stream();
+	for (Http2Request& req : this->received)
+	{
+		if (ret > 0)
+			ret = req.parse_stream();
+	}
+
+	return ret;
+}
+
+void Http2Response::set_session(Http2Session *session,
+								const Http2Request *req)
+{
+	size_t size_limit;
+
+	this->session = session;
+	this->stream = Http2Stream();
+	this->stream.stream_id = req->stream.stream_id;
+	this->streams.clear();
+	for (const auto& stream : req->streams)
+	{
+		Http2Response *resp = stream.second;
+
+		/* Nothing of an earlier try is kept. */
+		size_limit = resp->size_limit;
+		*resp = Http2Response();
+		resp->size_limit = size_limit;
+		resp->session = session;
+		resp->stream.stream_id = stream.first->stream.stream_id;
+		resp->stream.size_limit = size_limit;
+		if (resp->stream.stream_id == 0)
+		{
+			resp->stream.reset = true;
+			resp->stream.refused = true;
+		}
+
+		this->streams.push_back(resp);
+	}
+}
+
+int Http2Response::encode(struct iovec vectors[], int max)
+{
+	Http2Session *session = this->session;
+	struct iovec body[max];
+	std::vector<Http2Response *> resps;
+	std::vector<std::string> blocks;
+	size_t block_size = 0;
+	size_t body_size = 0;
+	size_t prefix;
+	size_t head;
+	size_t n;
+	size_t k;
+	bool ended;
+	int nbody;
+	int i = 0;
+
+	if (!session || max < 4)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* A server request with no stream is replied with no stream. */
+	if (this->stream.stream_id != 0)
+		resps.push_back(this);
+
+	resps.insert(resps.end(), this->streams.begin(), this->streams.end());
+	n = resps.size();
+	if (n > (size_t)(max - 2) / 2)
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	blocks.resize(n);
+	for (k = 0; k < n; k++)
+	{
+		if (resps[k]->stream.reset)
+			continue;
+
+		__response_block(resps[k], session->encoder, blocks[k]);
+		block_size += blocks[k].size();
+		body_size += resps[k]->get_output_body_size();
+	}
+
+	this->output.clear();
+	this->output.swap(session->unsent);
+	this->tail.clear();
+	prefix = this->output.size();
+	__reserve_frames(session, block_size, body_size, n, this->output);
+	if (prefix != 0)
+		i = __add_vector(vectors, i, this->output.data(), prefix);
+
+	for (k = 0; k < n; k++)
+	{
+		if (resps[k]->stream.reset)
+		{
+			head = this->output.size();
+			__rst_stream(resps[k]->stream.stream_id, HTTP2_CANCEL, this->output);
+			i = __add_vector(vectors, i, this->output.data() + head,
+							 this->output.size() - head);
+			continue;
+		}
+
+		nbody = resps[k]->encode_output_body(body, max - 1);
+		if (nbody < 0)
+			return -1;
+
+		i = __encode_frames(session, resps[k]->stream.stream_id, blocks[k],
+							body, nbody, resps[k]->get_output_body_size(),
+							true, &ended, this->output,
+							vectors, i, max - 1 - (n - 1 - k));
+	}
+
+	__blocked_frames(session, INT64_MAX, this->tail);
+	if (!this->tail.empty())
+		i = __add_vector(vectors, i, this->tail.data(), this->tail.size());
+
+	return i;
+}
+
+int Http2Response::parse_stream()
+{
+	std::string text;
+	std::string status;
+	size_t n;
+	int ret;
+
+	if (!__find_pseudo(this->stream.headers, ":status", status))
+	{
+		errno = EBADMSG;
+		return -1;
+	}
+
+	text = "HTTP/2 " + status + " \r\n";
+	__to_http1(&this->stream, text);
+	n = text.size();
+	ret = this->HttpResponse::append(text.data(), &n);
+	if (ret == 0 && !this->stream.body.empty())
+	{
+		n = this->stream.body.size();
+		ret = this->HttpResponse::append(this->stream.body.data(), &n);
+	}
+
+	this->stream.body.clear();
+	this->stream.body.shrink_to_fit();
+	if (ret == 0)
+	{
+		errno = EBADMSG;
+		ret = -1;
+	}
+
+	return ret;
+}
+
+int Http2Response::append(const void *buf, size_t *size)
+{
+	__Http2Input in;
+	int ret;
+
+	in.session = this->session;
+	in.handshake = false;
+	in.streams.push_back(&this->stream);
+	for (Http2Response *resp : this->streams)
+		in.streams.push_back(&resp->stream);
+
+	this->stream.size_limit = this->size_limit;
+	ret = __input(buf, *size, &in);
+	if (ret >= 0 && __write_reply(in.session, in.reply,
+								  [this](const void *data, size_t n) {
+		return this->feedback(data, n);
+	}) < 0)
+		return -1;
+
+	if (ret <= 0)
+		return ret;
+
+	if (this->streams.empty() && this->stream.reset)
+	{
+		errno = ECONNRESET;
+		return -1;
+	}
+
+	/* Reset streams are left empty. */
+	for (size_t k = 0; k <= this->streams.size() && ret > 0; k++)
+	{
+		Http2Response *resp = k == 0 ? this : this->streams[k - 1];
+
+		if (!resp->stream.reset)
+			ret = resp->parse_stream();
+	}
+
+	return ret;
+}
+
+}
+
@@ -117,9 +117,7 @@ int HttpMessage::encode(struct iovec vectors[], int max)
 	const char *start_line[3];
 	http_header_cursor_t cursor;
 	struct HttpMessageHeader header;
-	struct HttpMessageBlock *block;
-	struct list_head *pos;
-	size_t size;
+	int ret;
 	int i;
 
 	start_line[0] = http_parser_get_method(this->parser);
@@ -181,7 +179,20 @@ int HttpMessage::encode(struct iovec vectors[], int max)
 	vectors[i].iov_len = 2;
 	i++;
 
-	size = this->output_body_size;
+	ret = this->encode_output_body(vectors + i, max - i);
+	if (ret < 0)
+		return -1;
+
+	return i + ret;
+}
+
+int HttpMessage::encode_output_body(struct iovec vectors[], int max)
+{
+	struct HttpMessageBlock *block;
+	struct list_head *pos;
+	size_t size = this->output_body_size;
+	int i = 0;
+
 	list_for_each(pos, &this->output_body)
 	{
 		if (i + 1 == max && pos != this->output_body.prev)
@@ -204,6 +215,8 @@ int HttpMessage::encode(struct iovec vectors[], int max)
 inline int HttpMessage::append(const void *buf, size_t *size)
 {
 	int ret = http_parser_append_message(buf, size, this->parser);
+	http_parser_t *parser = this->parser;
+	size_t remaining;
 
 	if (ret >= 0)
 	{
@@ -213,6 +226,18 @@ inline int HttpMessage::append(const void *buf, size_t *size)
 			errno = EMSGSIZE;
 			ret = -1;
 		}
+		else if (ret == 0 && http_parser_header_complete(parser) &&
+				 parser->transfer_length != (size_t)-1)
+		{
+			/* Fail as soon as the length is known to be over the limit. */
+			remaining = parser->transfer_length -
+						(parser->msgsize - parser->header_offset);
+			if (remaining > this->size_limit - this->cur_size)
+			{
+				errno = EMSGSIZE;
+				ret = -1;
+			}
+		}
 	}
 	else if (ret == -2)
 	{
@@ -223,6 +248,17 @@ inline int HttpMessage::append(const void *buf, size_t *size)
 	return ret;
 }
 
+void *HttpMessage::get_buffer(size_t *size)
+{
+	/* Once the header is parsed, a body with a Content-Length is received
+	 * straight into the parser's buffer, which grows as the body arrives. */
+	if (this->cur_size >= this->size_limit)
+		return NULL;
+
+	*size = this->size_limit - this->cur_size;
+	return http_parser_get_buffer(size, this->parser);
+}
+
 HttpMessage::HttpMessage(HttpMessage&& msg) :
 	ProtocolMessage(std::move(msg))
 {
@@ -187,6 +187,10 @@ public:
 protected:
 	virtual int encode(struct iovec vectors[], int max);
 	virtual int append(const void *buf, size_t *size);
+	virtual void *get_buffer(size_t *size);
+
+	/* Output body only, for messages framed in other ways. */
+	int encode_output_body(struct iovec vectors[], int max);
 
 private:
 	struct list_head *combine_from(struct list_head *pos, size_t size);
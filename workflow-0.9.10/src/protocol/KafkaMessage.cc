@@ -329,6 +329,105 @@ static constexpr LZ4F_preferences_t kPrefs =
 	.compressionLevel = 0,
 };
 
+/* Compression contexts are kept by each thread and reset for every record
+ * batch, rather than created and freed per batch. A context that failed is
+ * dropped, and the next batch creates a new one. */
+class __CompressContexts
+{
+public:
+	z_stream *get_gzip()
+	{
+		if (this->gzip)
+		{
+			if (deflateReset(this->gzip) == Z_OK)
+				return this->gzip;
+
+			this->drop(Kafka_Gzip);
+		}
+
+		this->gzip = new z_stream;
+		this->gzip->zalloc = (alloc_func)0;
+		this->gzip->zfree = (free_func)0;
+		this->gzip->opaque = (voidpf)0;
+		if (deflateInit2(this->gzip, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | 16,
+						 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			delete this->gzip;
+			this->gzip = NULL;
+			errno = EBADMSG;
+		}
+
+		return this->gzip;
+	}
+
+	LZ4F_cctx *get_lz4()
+	{
+		if (!this->lz4)
+		{
+			if (LZ4F_isError(LZ4F_createCompressionContext(&this->lz4,
+														   LZ4F_VERSION)))
+			{
+				LZ4F_freeCompressionContext(this->lz4);
+				this->lz4 = NULL;
+				errno = EBADMSG;
+			}
+		}
+
+		return this->lz4;
+	}
+
+	ZSTD_CStream *get_zstd()
+	{
+		if (!this->zstd)
+			this->zstd = ZSTD_createCStream();
+
+		return this->zstd;
+	}
+
+	void drop(int compress_type)
+	{
+		switch (compress_type)
+		{
+		case Kafka_Gzip:
+			if (this->gzip)
+			{
+				deflateEnd(this->gzip);
+				delete this->gzip;
+				this->gzip = NULL;
+			}
+
+			break;
+
+		case Kafka_Lz4:
+			LZ4F_freeCompressionContext(this->lz4);
+			this->lz4 = NULL;
+			break;
+
+		case Kafka_Zstd:
+			ZSTD_freeCStream(this->zstd);
+			this->zstd = NULL;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	~__CompressContexts()
+	{
+		this->drop(Kafka_Gzip);
+		this->drop(Kafka_Lz4);
+		this->drop(Kafka_Zstd);
+	}
+
+private:
+	z_stream *gzip = NULL;
+	LZ4F_cctx *lz4 = NULL;
+	ZSTD_CStream *zstd = NULL;
+};
+
+static thread_local __CompressContexts __compress_contexts;
+
 static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 {
 	z_stream *c_stream;
@@ -360,7 +459,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 				bound_size = compressBound(c_stream->avail_in);
 				if (!nblock.allocate(bound_size))
 				{
-					delete c_stream;
+					__compress_contexts.drop(Kafka_Gzip);
 					return -1;
 				}
 
@@ -370,7 +469,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 
 			if (deflate(c_stream, Z_NO_FLUSH) != Z_OK)
 			{
-				delete c_stream;
+				__compress_contexts.drop(Kafka_Gzip);
 				errno = EBADMSG;
 				return -1;
 			}
@@ -394,7 +493,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 		bound_size = LZ4F_compressBound(block->get_len(), &kPrefs);
 		if (!nblock.allocate(bound_size))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			return -1;
 		}
 
@@ -405,7 +504,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 
 		if (LZ4F_isError(lz4_r))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -419,7 +518,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 		bound_size = ZSTD_compressBound(block->get_len());
 		if (!nblock.allocate(bound_size))
 		{
-			ZSTD_freeCStream(zstd_cctx);
+			__compress_contexts.drop(Kafka_Zstd);
 			return -1;
 		}
 
@@ -432,7 +531,7 @@ static int compress_buf(KafkaBlock *block, int compress_type, void *env)
 		zstd_r = ZSTD_compressStream(zstd_cctx, &out, &in);
 		if (ZSTD_isError(zstd_r) || in.pos < in.size)
 		{
-			ZSTD_freeCStream(zstd_cctx);
+			__compress_contexts.drop(Kafka_Zstd);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -1813,24 +1912,16 @@ static int kafka_compress_prepare(int compress_type, void **env,
 	KafkaBuffer *snappy_buffer;
 	size_t lz4_out_len;
 	LZ4F_errorCode_t lz4_r;
-	LZ4F_cctx *lz4_cctx = NULL;
+	LZ4F_cctx *lz4_cctx;
 	ZSTD_CStream *zstd_cctx;
 	size_t zstd_r;
 
 	switch (compress_type)
 	{
 	case Kafka_Gzip:
-		c_stream = new z_stream;
-		c_stream->zalloc = (alloc_func)0;
-		c_stream->zfree = (free_func)0;
-		c_stream->opaque = (voidpf)0;
-		if (deflateInit2(c_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | 16,
-						 8, Z_DEFAULT_STRATEGY) != Z_OK)
-		{
-			delete c_stream;
-			errno = EBADMSG;
+		c_stream = __compress_contexts.get_gzip();
+		if (!c_stream)
 			return -1;
-		}
 
 		c_stream->avail_in = 0;
 		c_stream->avail_out = 0;
@@ -1845,19 +1936,15 @@ static int kafka_compress_prepare(int compress_type, void **env,
 		break;
 
 	case Kafka_Lz4:
-		lz4_r = LZ4F_createCompressionContext(&lz4_cctx, LZ4F_VERSION);
-		if (LZ4F_isError(lz4_r))
-		{
-			LZ4F_freeCompressionContext(lz4_cctx);
-			errno = EBADMSG;
+		lz4_cctx = __compress_contexts.get_lz4();
+		if (!lz4_cctx)
 			return -1;
-		}
 
 		lz4_out_len = LZ4F_HEADER_SIZE_MAX;
 
 		if (!block->allocate(lz4_out_len))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			return -1;
 		}
 
@@ -1865,7 +1952,7 @@ static int kafka_compress_prepare(int compress_type, void **env,
 								   block->get_len(), &kPrefs);
 		if (LZ4F_isError(lz4_r))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -1876,14 +1963,14 @@ static int kafka_compress_prepare(int compress_type, void **env,
 		break;
 
 	case Kafka_Zstd:
-		zstd_cctx = ZSTD_createCStream();
+		zstd_cctx = __compress_contexts.get_zstd();
 		if (!zstd_cctx)
 			return -1;
 
 		zstd_r = ZSTD_initCStream(zstd_cctx, ZSTD_CLEVEL_DEFAULT);
 		if (ZSTD_isError(zstd_r))
 		{
-			ZSTD_freeCStream(zstd_cctx);
+			__compress_contexts.drop(Kafka_Zstd);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -1934,7 +2021,7 @@ static int kafka_compress_finish(int compress_type, void *env,
 
 			if (gzip_err != Z_OK)
 			{
-				delete c_stream;
+				__compress_contexts.drop(Kafka_Gzip);
 				errno = EBADMSG;
 				return -1;
 			}
@@ -1948,13 +2035,6 @@ static int kafka_compress_finish(int compress_type, void *env,
 			}
 		}
 
-		if (deflateEnd(c_stream) != Z_OK)
-		{
-			delete c_stream;
-			errno = EBADMSG;
-			return -1;
-		}
-
 		if (block.get_len() > 0)
 		{
 			size_t use_bytes = block.get_len() - c_stream->avail_out;
@@ -1972,7 +2052,6 @@ static int kafka_compress_finish(int compress_type, void *env,
 			*addon += -remainer;
 		}
 
-		delete c_stream;
 		break;
 
 	case Kafka_Snappy:
@@ -2003,14 +2082,14 @@ static int kafka_compress_finish(int compress_type, void *env,
 		out_len = LZ4F_compressBound(0, &kPrefs);
 		if (!block.allocate(out_len))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			return -1;
 		}
 
 		lz4_r = LZ4F_compressEnd(lz4_cctx, block.get_block(), block.get_len(), NULL);
 		if (LZ4F_isError(lz4_r))
 		{
-			LZ4F_freeCompressionContext(lz4_cctx);
+			__compress_contexts.drop(Kafka_Lz4);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -2018,7 +2097,6 @@ static int kafka_compress_finish(int compress_type, void *env,
 		block.set_len(lz4_r);
 		buffer->add_item(std::move(block));
 		*addon = lz4_r;
-		LZ4F_freeCompressionContext(lz4_cctx);
 		break;
 
 	case Kafka_Zstd:
@@ -2032,7 +2110,7 @@ static int kafka_compress_finish(int compress_type, void *env,
 		zstd_r = ZSTD_endStream(zstd_cctx, &out);
 		if (ZSTD_isError(zstd_r) || zstd_r > 0)
 		{
-			ZSTD_freeCStream(zstd_cctx);
+			__compress_contexts.drop(Kafka_Zstd);
 			errno = EBADMSG;
 			return -1;
 		}
@@ -2040,7 +2118,6 @@ static int kafka_compress_finish(int compress_type, void *env,
 		block.set_len(out.pos);
 		buffer->add_item(std::move(block));
 		*addon = out.pos;
-		ZSTD_freeCStream(zstd_cctx);
 		break;
 
 	default:
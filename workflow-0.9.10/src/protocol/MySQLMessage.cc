@@ -380,6 +380,51 @@ int MySQLAuthRequest::decode_packet(const unsigned char *buf, size_t buflen)
 	return 1;
 }
 
+MySQLResponse::MySQLResponse()
+{
+	batch_rows_ = 0;
+	batch_ = NULL;
+	result_columns_ = 0;
+}
+
+MySQLResponse::~MySQLResponse()
+{
+	delete batch_;
+}
+
+MySQLResponse::MySQLResponse(MySQLResponse&& move) :
+	MySQLMessage(std::move(move)),
+	row_handler_(std::move(move.row_handler_))
+{
+	batch_rows_ = move.batch_rows_;
+	batch_ = move.batch_;
+	result_columns_ = move.result_columns_;
+
+	move.batch_rows_ = 0;
+	move.batch_ = NULL;
+	move.result_columns_ = 0;
+}
+
+MySQLResponse& MySQLResponse::operator= (MySQLResponse&& move)
+{
+	if (this != &move)
+	{
+		*(MySQLMessage *)this = std::move(move);
+
+		delete batch_;
+		row_handler_ = std::move(move.row_handler_);
+		batch_rows_ = move.batch_rows_;
+		batch_ = move.batch_;
+		result_columns_ = move.result_columns_;
+
+		move.batch_rows_ = 0;
+		move.batch_ = NULL;
+		move.result_columns_ = 0;
+	}
+
+	return *this;
+}
+
 void MySQLResponse::set_ok_packet()
 {
 	uint16_t zero16 = 0;
@@ -388,11 +433,238 @@ void MySQLResponse::set_ok_packet()
 	buf_.append((const char *)&zero16, 2);
 	buf_.append((const char *)&zero16, 2);
 	buf_.append((const char *)&zero16, 2);
+	result_columns_ = 0;
+}
+
+static void __append_length(std::string& buf, unsigned long long n)
+{
+	unsigned char head[9];
+
+	if (n < 251)
+	{
+		buf.push_back((char)n);
+		return;
+	}
+
+	if (n < (1 << 16))
+	{
+		head[0] = 252;
+		int2store(head + 1, n);
+		buf.append((const char *)head, 3);
+	}
+	else if (n < (1 << 24))
+	{
+		head[0] = 253;
+		int3store(head + 1, n);
+		buf.append((const char *)head, 4);
+	}
+	else
+	{
+		head[0] = 254;
+		int8store(head + 1, n);
+		buf.append((const char *)head, 9);
+	}
+}
+
+static void __append_string(std::string& buf, const char *str, size_t n)
+{
+	__append_length(buf, n);
+	buf.append(str, n);
+}
+
+/* The head is filled when the packet is done, and the sequence id when
+ * encoding. */
+static size_t __begin_packet(std::string& buf)
+{
+	size_t pos = buf.size();
+
+	buf.append(4, '\0');
+	return pos;
+}
+
+static void __end_packet(std::string& buf, size_t pos)
+{
+	int3store((unsigned char *)&buf[pos], buf.size() - pos - 4);
+}
+
+// 1:0xfe|2:warnings|2:status_flag
+static void __append_eof_packet(std::string& buf)
+{
+	static const char eof[5] = { (char)0xfe, 0, 0, 2, 0 };
+	size_t pos = __begin_packet(buf);
+
+	buf.append(eof, 5);
+	__end_packet(buf, pos);
+}
+
+void MySQLResponse::set_result_set(const std::vector<std::pair<std::string, int>>& columns)
+{
+	unsigned char def[13] = {0x0c};
+	size_t pos;
+
+	if (columns.empty())
+		return this->set_ok_packet();
+
+	buf_.clear();
+	pos = __begin_packet(buf_);
+	__append_length(buf_, columns.size());
+	__end_packet(buf_, pos);
+
+	for (const auto& column : columns)
+	{
+		pos = __begin_packet(buf_);
+		__append_string(buf_, "def", 3);
+		__append_string(buf_, "", 0);
+		__append_string(buf_, "", 0);
+		__append_string(buf_, "", 0);
+		__append_string(buf_, column.first.c_str(), column.first.size());
+		__append_string(buf_, column.first.c_str(), column.first.size());
+		int2store(def + 1, 33);
+		int4store(def + 3, 0);
+		def[7] = (unsigned char)column.second;
+		buf_.append((const char *)def, 13);
+		__end_packet(buf_, pos);
+	}
+
+	__append_eof_packet(buf_);
+	result_columns_ = columns.size();
+}
+
+void MySQLResponse::add_result_row(const char *const cells[],
+								   const size_t lens[])
+{
+	size_t pos;
+	int i;
+
+	if (result_columns_ <= 0)
+		return;
+
+	pos = __begin_packet(buf_);
+	for (i = 0; i < result_columns_; i++)
+	{
+		if (cells[i])
+			__append_string(buf_, cells[i], lens[i]);
+		else
+			buf_.push_back((char)MYSQL_PACKET_HEADER_NULL);
+	}
+
+	__end_packet(buf_, pos);
+}
+
+int MySQLResponse::encode(struct iovec vectors[], int max)
+{
+	unsigned char *p = (unsigned char *)&buf_[0];
+	uint8_t seqid = seqid_;
+	size_t pos = 0;
+
+	if (result_columns_ == 0)
+		return this->MySQLMessage::encode(vectors, max);
+
+	/* Packets are already in the buffer, with the EOF after the rows. */
+	if (result_columns_ > 0)
+	{
+		__append_eof_packet(buf_);
+		p = (unsigned char *)&buf_[0];
+		result_columns_ = -1;
+	}
+
+	while (pos < buf_.size())
+	{
+		p[pos + 3] = seqid++;
+		pos += 4 + uint3korr(p + pos);
+	}
+
+	if (max < 1)
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	vectors[0].iov_base = p;
+	vectors[0].iov_len = buf_.size();
+	return 1;
+}
+
+void MySQLResponse::set_row_handler(size_t batch_rows,
+									std::function<void (const MySQLRowBatch&)> handler)
+{
+	batch_rows_ = batch_rows > 0 ? batch_rows : 1;
+	row_handler_ = std::move(handler);
+}
+
+/* Hands the rows parsed so far to the handler, if they are a batch or the
+ * last of the result set, and removes them from the buffer. The buffer ends
+ * with whole packets, and the parser is right after the rows. */
+int MySQLResponse::handle_rows(unsigned char *buf, size_t *buflen)
+{
+	struct __mysql_result_set *result_set = parser_->current_result_set;
+	size_t begin, end;
+	int i;
+
+	if (parser_->result_set_count == 0 ||
+		result_set->type != MYSQL_PACKET_GET_RESULT ||
+		result_set->rows_begin_offset == 0 || result_set->row_count == 0)
+	{
+		return 0;
+	}
+
+	if (result_set->rows_end_offset == 0)
+	{
+		if ((size_t)result_set->row_count < batch_rows_)
+			return 0;
+
+		end = parser_->offset;
+	}
+	else
+		end = result_set->rows_end_offset;
+
+	begin = result_set->rows_begin_offset;
+	if (!batch_)
+		batch_ = new MySQLRowBatch;
+
+	batch_->reset(parser_->result_set_count - 1);
+	for (i = 0; i < result_set->field_count; i++)
+		batch_->add_field(MySQLField(buf, result_set->fields[i]));
+
+	if (!batch_->set_rows(buf + begin, buf + end, result_set->row_count))
+		return -2;
+
+	row_handler_(*batch_);
+
+	memmove(buf + begin, buf + end, *buflen - end);
+	*buflen -= end - begin;
+	stream_->length = *buflen;
+	cur_size_ -= end - begin;
+	parser_->offset -= end - begin;
+	if (result_set->rows_end_offset != 0)
+		result_set->rows_end_offset = begin;
+
+	result_set->row_count = 0;
+	return 0;
 }
 
 int MySQLResponse::decode_packet(const unsigned char *buf, size_t buflen)
 {
-	return mysql_parser_parse(buf, buflen, parser_);
+	int ret;
+
+	if (!row_handler_)
+		return mysql_parser_parse(buf, buflen, parser_);
+
+	/* As mysql_parser_parse(), checking for rows after each step. */
+	do {
+		ret = parser_->parse(buf, buflen, parser_);
+		if (ret < 0)
+			return ret;
+
+		if (ret > 0 && parser_->offset != buflen)
+			return -2;
+
+		if (handle_rows(const_cast<unsigned char *>(buf), &buflen) < 0)
+			return -2;
+
+	} while (parser_->offset < buflen);
+
+	return ret;
 }
 
 unsigned long long MySQLResponse::get_affected_rows() const
@@ -20,7 +20,10 @@
 #define _MYSQLMESSAGE_H_
 
 #include <stdint.h>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 #include "ProtocolMessage.h"
 #include "mysql_stream.h"
 #include "mysql_parser.h"
@@ -33,6 +36,8 @@
 namespace protocol
 {
 
+class MySQLRowBatch;
+
 class MySQLMessage : public ProtocolMessage
 {
 public:
@@ -102,15 +107,39 @@ public:
 
 	void set_ok_packet();
 
+	// Server side, a result set in place of the OK packet. The columns as
+	// {name, data type}, then each row with a NULL pointer for a NULL cell.
+	// A row is sent in one packet, so has to be less than 16MB.
+	void set_result_set(const std::vector<std::pair<std::string, int>>& columns);
+	void add_result_row(const char *const cells[], const size_t lens[]);
+
+	// Client side, rows are handed to the handler in batches of up to
+	// 'batch_rows' as they arrive, and are then dropped from the response.
+	// So the rows are not all in memory, and the cursor sees none of them.
+	// The handler runs in the thread receiving the response, and the batch
+	// is valid only inside. A retry would hand the rows again.
+	void set_row_handler(size_t batch_rows,
+						 std::function<void (const MySQLRowBatch&)> handler);
+
 public:
-	MySQLResponse() = default;
+	MySQLResponse();
+	virtual ~MySQLResponse();
 	//move constructor
-	MySQLResponse(MySQLResponse&& move) = default;
+	MySQLResponse(MySQLResponse&& move);
 	//move operator
-	MySQLResponse& operator= (MySQLResponse&& move) = default;
+	MySQLResponse& operator= (MySQLResponse&& move);
 
 protected:
+	virtual int encode(struct iovec vectors[], int max);
 	virtual int decode_packet(const unsigned char *buf, size_t buflen);
+
+private:
+	int handle_rows(unsigned char *buf, size_t *buflen);
+
+	std::function<void (const MySQLRowBatch&)> row_handler_;
+	size_t batch_rows_;
+	MySQLRowBatch *batch_;
+	int result_columns_;
 };
 
 }
@@ -16,6 +16,9 @@
   Authors: Li Yingxin (liyingxin@sogou-inc.com)
 */
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 #include "mysql_types.h"
 #include "mysql_byteorder.h"
@@ -63,6 +66,333 @@ MySQLField::MySQLField(const void *buf, mysql_field_t *field)
 	this->data_type = field->data_type;
 }
 
+const void *MySQLRowBatch::set_rows(const void *pos, const void *end, int rows)
+{
+	const unsigned char *p = (const unsigned char *)pos;
+	const unsigned char *buf_end = (const unsigned char *)end;
+	size_t field_count = this->fields.size();
+	const unsigned char *data;
+	unsigned long long len;
+	size_t i;
+
+	this->cell_data.resize(field_count * rows);
+	this->cell_len.resize(field_count * rows);
+	this->row_count = 0;
+	for (int row = 0; row < rows; row++)
+	{
+		for (i = 0; i < field_count; i++)
+		{
+			if (p >= buf_end)
+				return NULL;
+
+			if (*p == MYSQL_PACKET_HEADER_NULL)
+			{
+				data = NULL;
+				len = 0;
+				p++;
+			}
+			else if (decode_string(&data, &len, &p, buf_end) == false)
+				return NULL;
+			else if (!data)
+				data = p;	/* an empty string, not NULL */
+
+			this->cell_data[i * rows + row] = data;
+			this->cell_len[i * rows + row] = len;
+		}
+	}
+
+	this->row_count = rows;
+	return p;
+}
+
+bool MySQLRowBatch::get_column_nocopy(int col, const char *data[],
+									  size_t len[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+
+	for (int i = 0; i < this->row_count; i++)
+	{
+		data[i] = (const char *)this->cell_data[base + i];
+		len[i] = this->cell_len[base + i];
+	}
+
+	return true;
+}
+
+static bool __parse_ulonglong(const unsigned char *p, size_t len,
+							  unsigned long long *value)
+{
+	unsigned long long v = 0;
+	unsigned int digit;
+	size_t i;
+
+	if (len == 0)
+		return false;
+
+	for (i = 0; i < len; i++)
+	{
+		digit = p[i] - '0';
+		if (digit > 9 || v > (ULLONG_MAX - digit) / 10)
+			return false;
+
+		v = v * 10 + digit;
+	}
+
+	*value = v;
+	return true;
+}
+
+static bool __parse_longlong(const unsigned char *p, size_t len,
+							 long long *value)
+{
+	bool neg = (len > 0 && *p == '-');
+	unsigned long long v;
+
+	if (!__parse_ulonglong(p + neg, len - neg, &v))
+		return false;
+
+	if (v > (unsigned long long)LLONG_MAX + neg)
+		return false;
+
+	if (!neg)
+		*value = (long long)v;
+	else if (v == (unsigned long long)LLONG_MAX + 1)
+		*value = LLONG_MIN;
+	else
+		*value = -(long long)v;
+
+	return true;
+}
+
+static bool __parse_double(const unsigned char *p, size_t len, double *value)
+{
+	char num[128];
+	char *end;
+
+	if (len == 0 || len >= sizeof num)
+		return false;
+
+	memcpy(num, p, len);
+	num[len] = '\0';
+	*value = strtod(num, &end);
+	return end == num + len;
+}
+
+static bool __parse_digits(const unsigned char *p, size_t n, int *value)
+{
+	unsigned int digit;
+	int v = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		digit = p[i] - '0';
+		if (digit > 9)
+			return false;
+
+		v = v * 10 + digit;
+	}
+
+	*value = v;
+	return true;
+}
+
+/* Fraction of a second, as ".f" to ".ffffff", or nothing. */
+static bool __parse_usec(const unsigned char *p, size_t len, long long *usec)
+{
+	int v;
+	size_t i;
+
+	*usec = 0;
+	if (len == 0)
+		return true;
+
+	if (*p != '.' || len == 1 || len > 7 || !__parse_digits(p + 1, len - 1, &v))
+		return false;
+
+	for (i = len; i < 7; i++)
+		v *= 10;
+
+	*usec = v;
+	return true;
+}
+
+static long long __days_from_civil(int year, int month, int day)
+{
+	long long era;
+	unsigned int yoe, doy, doe;
+
+	year -= (month <= 2);
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = (unsigned int)(year - era * 400);
+	doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+/* YYYY-MM-DD[ hh:mm:ss[.ffffff]] */
+static bool __parse_datetime(const unsigned char *p, size_t len,
+							 long long *usecs)
+{
+	int year, month, day;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	long long usec = 0;
+
+	if (len < 10 || !__parse_digits(p, 4, &year) || p[4] != '-' ||
+		!__parse_digits(p + 5, 2, &month) || p[7] != '-' ||
+		!__parse_digits(p + 8, 2, &day))
+	{
+		return false;
+	}
+
+	if (len > 10)
+	{
+		if (len < 19 || p[10] != ' ' ||
+			!__parse_digits(p + 11, 2, &hour) || p[13] != ':' ||
+			!__parse_digits(p + 14, 2, &minute) || p[16] != ':' ||
+			!__parse_digits(p + 17, 2, &second) ||
+			!__parse_usec(p + 19, len - 19, &usec))
+		{
+			return false;
+		}
+	}
+
+	if (month == 0 || day == 0)
+	{
+		*usecs = 0;
+		return true;
+	}
+
+	if (month > 12 || day > 31 || hour > 23 || minute > 59 || second > 59)
+		return false;
+
+	*usecs = (((__days_from_civil(year, month, day) * 24 + hour) * 60 +
+			   minute) * 60 + second) * 1000000 + usec;
+	return true;
+}
+
+/* [-]h:mm:ss[.ffffff], up to 838 hours. */
+static bool __parse_time(const unsigned char *p, size_t len, long long *usecs)
+{
+	bool neg = (len > 0 && *p == '-');
+	size_t i = neg;
+	int hour, minute, second;
+	long long usec;
+
+	while (i < len && p[i] >= '0' && p[i] <= '9')
+		i++;
+
+	if (i == (size_t)neg || i - neg > 3 || len - i < 6 ||
+		!__parse_digits(p + neg, i - neg, &hour) || p[i] != ':' ||
+		!__parse_digits(p + i + 1, 2, &minute) || p[i + 3] != ':' ||
+		!__parse_digits(p + i + 4, 2, &second) ||
+		!__parse_usec(p + i + 6, len - i - 6, &usec))
+	{
+		return false;
+	}
+
+	if (minute > 59 || second > 59)
+		return false;
+
+	usec += (((long long)hour * 60 + minute) * 60 + second) * 1000000;
+	*usecs = neg ? -usec : usec;
+	return true;
+}
+
+template<class T, bool PARSE(const unsigned char *, size_t, T *)>
+static bool __decode_column(const unsigned char *const *data,
+							const size_t *len, int rows,
+							T values[], bool nulls[])
+{
+	for (int i = 0; i < rows; i++)
+	{
+		if (nulls)
+			nulls[i] = (data[i] == NULL);
+
+		if (data[i] == NULL)
+			values[i] = 0;
+		else if (!PARSE(data[i], len[i], &values[i]))
+			return false;
+	}
+
+	return true;
+}
+
+bool MySQLRowBatch::get_column_int(int col, long long values[],
+								   bool nulls[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+	const unsigned char *const *data = this->cell_data.data() + base;
+	const size_t *len = this->cell_len.data() + base;
+
+	return __decode_column<long long, __parse_longlong>(data, len,
+					this->row_count, values, nulls);
+}
+
+bool MySQLRowBatch::get_column_ulonglong(int col, unsigned long long values[],
+										 bool nulls[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+	const unsigned char *const *data = this->cell_data.data() + base;
+	const size_t *len = this->cell_len.data() + base;
+
+	return __decode_column<unsigned long long, __parse_ulonglong>(data, len,
+					this->row_count, values, nulls);
+}
+
+bool MySQLRowBatch::get_column_double(int col, double values[],
+									  bool nulls[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+	const unsigned char *const *data = this->cell_data.data() + base;
+	const size_t *len = this->cell_len.data() + base;
+
+	return __decode_column<double, __parse_double>(data, len,
+					this->row_count, values, nulls);
+}
+
+bool MySQLRowBatch::get_column_datetime(int col, long long usecs[],
+										bool nulls[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+	const unsigned char *const *data = this->cell_data.data() + base;
+	const size_t *len = this->cell_len.data() + base;
+
+	return __decode_column<long long, __parse_datetime>(data, len,
+					this->row_count, usecs, nulls);
+}
+
+bool MySQLRowBatch::get_column_time(int col, long long usecs[],
+									bool nulls[]) const
+{
+	if (col < 0 || col >= (int)this->fields.size())
+		return false;
+
+	size_t base = (size_t)col * this->row_count;
+	const unsigned char *const *data = this->cell_data.data() + base;
+	const size_t *len = this->cell_len.data() + base;
+
+	return __decode_column<long long, __parse_time>(data, len,
+					this->row_count, usecs, nulls);
+}
+
 MySQLResultCursor::MySQLResultCursor()
 {
 	this->init();
@@ -74,6 +404,7 @@ void MySQLResultCursor::init()
 	this->current_row = 0;
 	this->field_count = 0;
 	this->fields = NULL;
+	this->result_set_index = 0;
 	this->parser = NULL;
 	this->status = MYSQL_STATUS_NOT_INIT;
 }
@@ -132,6 +463,7 @@ void MySQLResultCursor::init(const MySQLResponse *resp)
 	this->current_row = 0;
 	this->field_count = 0;
 	this->fields = NULL;
+	this->result_set_index = 0;
 	this->parser = resp->get_parser();
 	this->status = MYSQL_STATUS_NOT_INIT;
 
@@ -164,6 +496,7 @@ bool MySQLResultCursor::next_result_set()
 
 		this->current_field = 0;
 		this->current_row = 0;
+		this->result_set_index++;
 
 		this->fetch_result_set(result_set);
 		return true;
@@ -307,6 +640,36 @@ bool MySQLResultCursor::fetch_all(std::vector<std::vector<MySQLCell>>& rows)
 	return true;
 }
 
+bool MySQLResultCursor::fetch_batch(MySQLRowBatch& batch, int max_rows)
+{
+	if (this->status != MYSQL_STATUS_GET_RESULT || max_rows <= 0)
+		return false;
+
+	int rows = this->row_count - this->current_row;
+
+	if (rows > max_rows)
+		rows = max_rows;
+
+	batch.reset(this->result_set_index);
+	for (int i = 0; i < this->field_count; i++)
+		batch.add_field(*this->fields[i]);
+
+	const void *p = batch.set_rows(this->pos, this->end, rows);
+
+	if (!p)
+	{
+		this->status = MYSQL_STATUS_ERROR;
+		return false;
+	}
+
+	this->pos = p;
+	this->current_row += rows;
+	if (this->current_row == this->row_count)
+		this->status = MYSQL_STATUS_END;
+
+	return true;
+}
+
 void MySQLResultCursor::first_result_set()
 {
 	if (this->status == MYSQL_STATUS_NOT_INIT ||
@@ -327,6 +690,7 @@ void MySQLResultCursor::first_result_set()
 
 		this->current_field = 0;
 		this->current_row = 0;
+		this->result_set_index = 0;
 
 		this->fetch_result_set(result_set);
 	}
@@ -117,6 +117,49 @@ private:
 	int data_type;				/* Type of field. See mysql_types.h for types */
 };
 
+/* Rows of a result set, read by column. The cells are not copied, and the
+ * column decoders fill arrays of one value for each row, with NULL cells
+ * as 0 (or a NULL pointer) and 'nulls[i]' true. 'nulls' may be NULL.
+ * Text that is not of the type makes the decoder return false. */
+class MySQLRowBatch
+{
+public:
+	int get_result_set_index() const;
+	int get_field_count() const;
+	int get_rows_count() const;
+	const MySQLField *get_field(int col) const;
+
+	// for nocopy, a NULL data pointer for a NULL cell
+	void get_cell_nocopy(int row, int col, const void **data, size_t *len) const;
+	bool get_column_nocopy(int col, const char *data[], size_t len[]) const;
+
+	bool get_column_int(int col, long long values[], bool nulls[]) const;
+	bool get_column_ulonglong(int col, unsigned long long values[],
+							  bool nulls[]) const;
+	bool get_column_double(int col, double values[], bool nulls[]) const;
+
+	// DATE, DATETIME and TIMESTAMP as microseconds since the epoch, the time
+	// taken as UTC, and zero dates as 0. TIME as microseconds.
+	bool get_column_datetime(int col, long long usecs[], bool nulls[]) const;
+	bool get_column_time(int col, long long usecs[], bool nulls[]) const;
+
+public:
+	MySQLRowBatch();
+
+	//not for users
+	void reset(int result_set_index);
+	void add_field(const MySQLField& field);
+	// returns the end of the rows, NULL for a bad message
+	const void *set_rows(const void *pos, const void *end, int rows);
+
+private:
+	std::vector<MySQLField> fields;
+	std::vector<const unsigned char *> cell_data;	/* by column */
+	std::vector<size_t> cell_len;
+	int row_count;
+	int result_set_index;
+};
+
 class MySQLResultCursor
 {
 public:
@@ -140,6 +183,9 @@ public:
 	bool fetch_row_nocopy(const void **data, size_t *len, int *data_type);
 	bool fetch_all(std::vector<std::vector<MySQLCell>>& rows);
 
+	// the next rows, at most 'max_rows', to be read by column
+	bool fetch_batch(MySQLRowBatch& batch, int max_rows);
+
 	int get_cursor_status() const;
 	int get_server_status() const;
 
@@ -178,6 +224,7 @@ private:
 	int field_count;
 	int current_row;
 	int current_field;
+	int result_set_index;
 
 	unsigned long long affected_rows;
 	unsigned long long insert_id;
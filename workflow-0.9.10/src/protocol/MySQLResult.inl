@@ -287,6 +287,54 @@ inline std::string MySQLCell::as_string() const
 	return std::string((char *)this->data, this->len);
 }
 
+inline MySQLRowBatch::MySQLRowBatch()
+{
+	this->row_count = 0;
+	this->result_set_index = 0;
+}
+
+inline int MySQLRowBatch::get_result_set_index() const
+{
+	return this->result_set_index;
+}
+
+inline int MySQLRowBatch::get_field_count() const
+{
+	return (int)this->fields.size();
+}
+
+inline int MySQLRowBatch::get_rows_count() const
+{
+	return this->row_count;
+}
+
+inline const MySQLField *MySQLRowBatch::get_field(int col) const
+{
+	return &this->fields[col];
+}
+
+inline void MySQLRowBatch::get_cell_nocopy(int row, int col,
+										   const void **data,
+										   size_t *len) const
+{
+	size_t i = (size_t)col * this->row_count + row;
+
+	*data = this->cell_data[i];
+	*len = this->cell_len[i];
+}
+
+inline void MySQLRowBatch::reset(int result_set_index)
+{
+	this->fields.clear();
+	this->row_count = 0;
+	this->result_set_index = result_set_index;
+}
+
+inline void MySQLRowBatch::add_field(const MySQLField& field)
+{
+	this->fields.push_back(field);
+}
+
 template<class T>
 bool MySQLResultCursor::fetch_row(T& row_map)
 {	
@@ -449,6 +497,7 @@ inline MySQLResultCursor::MySQLResultCursor(MySQLResultCursor&& move)
 	this->field_count = move.field_count;
 	this->current_row = move.current_row;
 	this->current_field = move.current_field;
+	this->result_set_index = move.result_set_index;
 	this->affected_rows = move.affected_rows;
 	this->insert_id = move.insert_id;
 	this->warning_count = move.warning_count;
@@ -475,6 +524,7 @@ inline MySQLResultCursor& MySQLResultCursor::operator=(MySQLResultCursor&& move)
 		this->field_count = move.field_count;
 		this->current_row = move.current_row;
 		this->current_field = move.current_field;
+		this->result_set_index = move.result_set_index;
 		this->affected_rows = move.affected_rows;
 		this->insert_id = move.insert_id;
 		this->warning_count = move.warning_count;
@@ -58,6 +58,10 @@ protected:
 		return -1;
 	}
 
+	/* Optional. Storage inside the message for the next '*size' bytes, which
+	 * are then passed to append() at the same address. See HttpMessage. */
+	virtual void *get_buffer(size_t *size) { return NULL; }
+
 public:
 	void set_size_limit(size_t limit) { this->size_limit = limit; }
 	size_t get_size_limit() const { return this->size_limit; }
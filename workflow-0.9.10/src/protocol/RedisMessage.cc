@@ -434,6 +434,7 @@ RedisValue::~RedisValue()
 RedisMessage::RedisMessage():
 	parser_(new redis_parser_t),
 	stream_(new EncodeStream),
+	pipeline_(false),
 	cur_size_(0),
 	asking_(false)
 {
@@ -455,11 +456,13 @@ RedisMessage::RedisMessage(RedisMessage&& move) :
 {
 	parser_ = move.parser_;
 	stream_ = move.stream_;
+	pipeline_ = move.pipeline_;
 	cur_size_ = move.cur_size_;
 	asking_ = move.asking_;
 
 	move.parser_ = NULL;
 	move.stream_ = NULL;
+	move.pipeline_ = false;
 	move.cur_size_ = 0;
 	move.asking_ = false;
 }
@@ -479,11 +482,13 @@ RedisMessage& RedisMessage::operator= (RedisMessage &&move)
 
 		parser_ = move.parser_;
 		stream_ = move.stream_;
+		pipeline_ = move.pipeline_;
 		cur_size_ = move.cur_size_;
 		asking_ = move.asking_;
 
 		move.parser_ = NULL;
 		move.stream_ = NULL;
+		move.pipeline_ = false;
 		move.cur_size_ = 0;
 		move.asking_ = false;
 	}
@@ -532,11 +537,31 @@ bool RedisMessage::encode_reply(redis_reply_t *reply)
 	return true;
 }
 
+/* The values of a pipelined message are written back to back. */
+bool RedisMessage::encode_message()
+{
+	redis_reply_t *reply = &parser_->reply;
+
+	if (!pipeline_)
+		return encode_reply(reply);
+
+	if (reply->type != REDIS_REPLY_TYPE_ARRAY)
+		return false;
+
+	for (size_t i = 0; i < reply->elements; i++)
+	{
+		if (!encode_reply(reply->element[i]))
+			return false;
+	}
+
+	return true;
+}
+
 int RedisMessage::encode(struct iovec vectors[], int max)
 {
 	stream_->reset(vectors, max);
 
-	if (encode_reply(&parser_->reply))
+	if (encode_message())
 		return stream_->size();
 
 	return 0;
@@ -574,6 +599,10 @@ void RedisRequest::set_request(const std::string& command,
 	for (size_t i = 0; i < params.size(); i++)
 		user_request_.push_back(params[i]);
 
+	redis_parser_deinit(parser_);
+	redis_parser_init(parser_);
+	pipeline_ = false;
+
 	redis_reply_t *reply = &parser_->reply;
 	redis_reply_set_array(n, reply);
 	for (size_t i = 0; i < n; i++)
@@ -584,6 +613,87 @@ void RedisRequest::set_request(const std::string& command,
 	}
 }
 
+void RedisRequest::set_pipeline(const std::vector<std::vector<std::string>>& requests)
+{
+	size_t n = requests.size();
+
+	user_pipeline_ = requests;
+	redis_parser_deinit(parser_);
+	redis_parser_init(parser_);
+	pipeline_ = true;
+
+	redis_reply_t *reply = &parser_->reply;
+	redis_reply_set_array(n, reply);
+	for (size_t i = 0; i < n; i++)
+	{
+		const std::vector<std::string>& request = user_pipeline_[i];
+
+		redis_reply_set_array(request.size(), reply->element[i]);
+		for (size_t j = 0; j < request.size(); j++)
+		{
+			redis_reply_set_string(request[j].c_str(), request[j].size(),
+								   reply->element[i]->element[j]);
+		}
+	}
+}
+
+void RedisRequest::accept_pipeline()
+{
+	redis_parser_deinit(parser_);
+	redis_parser_init(parser_);
+	pipeline_ = (redis_parser_set_pipeline(0, parser_) >= 0);
+}
+
+bool RedisRequest::get_pipeline(std::vector<std::vector<std::string>>& requests) const
+{
+	const redis_reply_t *reply = &parser_->reply;
+
+	if (!pipeline_ || reply->type != REDIS_REPLY_TYPE_ARRAY)
+		return false;
+
+	requests.clear();
+	requests.resize(reply->elements);
+	for (size_t i = 0; i < reply->elements; i++)
+	{
+		const redis_reply_t *request = reply->element[i];
+
+		if (request->type != REDIS_REPLY_TYPE_ARRAY)
+			return false;
+
+		requests[i].reserve(request->elements);
+		for (size_t j = 0; j < request->elements; j++)
+		{
+			if (request->element[j]->type != REDIS_REPLY_TYPE_STRING &&
+				request->element[j]->type != REDIS_REPLY_TYPE_NIL)
+				return false;
+
+			requests[i].emplace_back(request->element[j]->str,
+									 request->element[j]->len);
+		}
+	}
+
+	return true;
+}
+
+bool RedisRequest::get_pipeline_command(size_t i, std::string& command) const
+{
+	const redis_reply_t *reply = &parser_->reply;
+
+	if (pipeline_ && reply->type == REDIS_REPLY_TYPE_ARRAY &&
+		i < reply->elements)
+	{
+		reply = reply->element[i];
+		if (reply->type == REDIS_REPLY_TYPE_ARRAY && reply->elements > 0 &&
+			reply->element[0]->type == REDIS_REPLY_TYPE_STRING)
+		{
+			command.assign(reply->element[0]->str, reply->element[0]->len);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 bool RedisRequest::get_command(std::string& command) const
 {
 	const redis_reply_t *reply = &parser_->reply;
@@ -635,7 +745,7 @@ int RedisRequest::encode(struct iovec vectors[], int max)
 
 	if (is_asking())
 		(*stream_) << REDIS_ASK_REQUEST;
-	if (encode_reply(&parser_->reply))
+	if (encode_message())
 		return stream_->size();
 
 	return 0;
@@ -686,13 +796,46 @@ int RedisResponse::append(const void *buf, size_t *size)
 }
 
 bool RedisResponse::set_result(const RedisValue& value)
+{
+	return this->set_result(RedisValue(value));
+}
+
+bool RedisResponse::set_result(RedisValue&& value)
 {
 	redis_reply_t *reply = &parser_->reply;
-	redis_reply_deinit(reply);
-	redis_reply_init(reply);
 
-	value_ = value;
-	return value_.transform(reply);
+	redis_parser_deinit(parser_);
+	redis_parser_init(parser_);
+	value_ = std::move(value);
+	pipeline_ = false;
+	if (!value_.transform(reply))
+		return false;
+
+	/* Complete, as if received. */
+	parser_->parse_succ = 1;
+	return true;
+}
+
+bool RedisResponse::set_pipeline_result(const RedisValue& value)
+{
+	return this->set_pipeline_result(RedisValue(value));
+}
+
+bool RedisResponse::set_pipeline_result(RedisValue&& value)
+{
+	if (!value.is_array() || !this->set_result(std::move(value)))
+		return false;
+
+	pipeline_ = true;
+	return true;
+}
+
+bool RedisResponse::expect_pipeline(size_t n)
+{
+	redis_parser_deinit(parser_);
+	redis_parser_init(parser_);
+	pipeline_ = (redis_parser_set_pipeline(n, parser_) >= 0);
+	return pipeline_;
 }
 
 }
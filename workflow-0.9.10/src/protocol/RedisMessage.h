@@ -116,6 +116,43 @@ private:
 	void *data_;
 };
 
+// A value of a received message, read without copying. Valid while the
+// message is alive and not changed.
+class RedisValueView
+{
+public:
+	// nil
+	RedisValueView() : reply_(NULL) { }
+	explicit RedisValueView(const redis_reply_t *reply) : reply_(reply) { }
+
+	bool is_ok() const;
+	bool is_error() const;
+	bool is_nil() const;
+	bool is_int() const;
+	bool is_array() const;
+	// Return true if string/status
+	bool is_string() const;
+	int get_type() const;
+
+	// If type isnot string/status/error, returns NULL and 0
+	const char *string_data() const;
+	size_t string_size() const;
+	// Copy. If type isnot string/status/error, returns an empty std::string
+	std::string string_value() const;
+	// If type isnot integer, returns 0
+	int64_t int_value() const;
+	// If type isnot array, returns 0
+	size_t arr_size() const;
+	// No bounds check
+	RedisValueView operator[] (size_t pos) const;
+
+	// C style data struct, NULL for nil
+	const redis_reply_t *get_reply() const { return reply_; }
+
+private:
+	const redis_reply_t *reply_;
+};
+
 class RedisMessage : public ProtocolMessage
 {
 public:
@@ -133,14 +170,19 @@ public:
 	bool is_asking() const;
 	void set_asking(bool asking);
 
+	// Number of commands or replies of a pipelined message, or 0
+	size_t pipeline_size() const;
+
 protected:
 	redis_parser_t *parser_;
 
 	virtual int encode(struct iovec vectors[], int max);
 	virtual int append(const void *buf, size_t *size);
 	bool encode_reply(redis_reply_t *reply);
+	bool encode_message();
 
 	class EncodeStream *stream_;
+	bool pipeline_;
 
 private:
 	size_t cur_size_;
@@ -167,12 +209,27 @@ public:// C++ style
 	bool get_command(std::string& command) const;
 	bool get_params(std::vector<std::string>& params) const;
 
+	// no copy, valid while the request is alive and not changed.
+	// an array of strings, or of such arrays if pipelined
+	void get_request(RedisValueView& view) const;
+
+	// Pipelining. The commands, each one as {command, params...}, are
+	// written back to back, and the result is an array of their replies.
+	void set_pipeline(const std::vector<std::vector<std::string>>& requests);
+
+	// Server side, before receiving. The commands that arrive together
+	// make one pipelined request, to be answered by set_pipeline_result().
+	void accept_pipeline();
+	bool get_pipeline(std::vector<std::vector<std::string>>& requests) const;
+	bool get_pipeline_command(size_t i, std::string& command) const;
+
 protected:
 	virtual int encode(struct iovec vectors[], int max);
 	virtual int append(const void *buf, size_t *size);
 
 private:
 	std::vector<std::string> user_request_;
+	std::vector<std::vector<std::string>> user_pipeline_;
 };
 
 class RedisResponse : public RedisMessage
@@ -187,9 +244,21 @@ public:
 public:// C++ style
 	// client use get_result to get result from server, copy
 	void get_result(RedisValue& value) const;
+	// no copy, valid while the response is alive and not changed
+	void get_result(RedisValueView& view) const;
 
 	// server use set_result to (prepare)send result to client, copy
 	bool set_result(const RedisValue& value);
+	bool set_result(RedisValue&& value);
+
+	// server answers a pipelined request with an array of one reply for
+	// each command, and they are written back to back, copy
+	bool set_pipeline_result(const RedisValue& value);
+	bool set_pipeline_result(RedisValue&& value);
+
+	//before receiving the replies of a pipelined request
+	//not for users.
+	bool expect_pipeline(size_t n);
 
 public:// C style
 	// redis_parser_t is absolutely same as hiredis-redisReply in memory
@@ -298,12 +367,73 @@ inline void RedisValue::clear()
 	set_nil();
 }
 
+inline int RedisValueView::get_type() const
+{
+	return reply_ ? reply_->type : REDIS_REPLY_TYPE_NIL;
+}
+
+inline bool RedisValueView::is_ok() const { return get_type() != REDIS_REPLY_TYPE_ERROR; }
+inline bool RedisValueView::is_error() const { return get_type() == REDIS_REPLY_TYPE_ERROR; }
+inline bool RedisValueView::is_nil() const { return get_type() == REDIS_REPLY_TYPE_NIL; }
+inline bool RedisValueView::is_int() const { return get_type() == REDIS_REPLY_TYPE_INTEGER; }
+inline bool RedisValueView::is_array() const { return get_type() == REDIS_REPLY_TYPE_ARRAY; }
+
+inline bool RedisValueView::is_string() const
+{
+	return get_type() == REDIS_REPLY_TYPE_STRING ||
+		   get_type() == REDIS_REPLY_TYPE_STATUS;
+}
+
+inline const char *RedisValueView::string_data() const
+{
+	if (is_string() || is_error())
+		return reply_->str;
+	else
+		return NULL;
+}
+
+inline size_t RedisValueView::string_size() const
+{
+	if (is_string() || is_error())
+		return reply_->len;
+	else
+		return 0;
+}
+
+inline std::string RedisValueView::string_value() const
+{
+	if (is_string() || is_error())
+		return std::string(reply_->str, reply_->len);
+	else
+		return "";
+}
+
+inline int64_t RedisValueView::int_value() const
+{
+	return is_int() ? reply_->integer : 0;
+}
+
+inline size_t RedisValueView::arr_size() const
+{
+	return is_array() ? reply_->elements : 0;
+}
+
+inline RedisValueView RedisValueView::operator[] (size_t pos) const
+{
+	return RedisValueView(reply_->element[pos]);
+}
+
 inline bool RedisMessage::parse_success() const { return parser_->parse_succ; }
 
 inline bool RedisMessage::is_asking() const { return asking_; }
 
 inline void RedisMessage::set_asking(bool asking) { asking_ = asking; }
 
+inline size_t RedisMessage::pipeline_size() const
+{
+	return pipeline_ ? parser_->reply.elements : 0;
+}
+
 inline redis_reply_t *RedisResponse::result_ptr()
 {
 	return &parser_->reply;
@@ -317,6 +447,22 @@ inline void RedisResponse::get_result(RedisValue& value) const
 		value.set_nil();
 }
 
+inline void RedisRequest::get_request(RedisValueView& view) const
+{
+	if (parser_->parse_succ)
+		view = RedisValueView(&parser_->reply);
+	else
+		view = RedisValueView();
+}
+
+inline void RedisResponse::get_result(RedisValueView& view) const
+{
+	if (parser_->parse_succ)
+		view = RedisValueView(&parser_->reply);
+	else
+		view = RedisValueView();
+}
+
 }
 
 #endif
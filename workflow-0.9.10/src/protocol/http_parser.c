@@ -18,7 +18,11 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include "list.h"
+#ifdef __AVX2__
+# include <immintrin.h>
+#elif defined __SSE2__
+# include <emmintrin.h>
+#endif
 #include "http_parser.h"
 
 #define MIN(x, y)	((x) <= (y) ? (x) : (y))
@@ -29,6 +33,8 @@
 #define HTTP_CHUNK_LINE_MAX		1024
 #define HTTP_TRAILER_LINE_MAX	8192
 #define HTTP_MSGBUF_INIT_SIZE	2048
+#define HTTP_HEADER_BLOCK_SIZE	2048
+#define HTTP_BODYBUF_WINDOW		(256 * 1024)
 
 enum
 {
@@ -45,67 +51,215 @@ enum
 	CPS_CHUNK_COMPLETE
 };
 
-struct __header_line
+/* Returns the index of the first byte equal to 'c1' or 'c2', or also of the
+ * first byte not below 0x80 if 'high' is set, or 'len' if there is none. */
+static inline size_t __scan(const char *ptr, size_t len,
+							char c1, char c2, int high)
 {
-	struct list_head list;
-	int name_len;
-	int value_len;
-	char *buf;
+	size_t i = 0;
+
+#ifdef __AVX2__
+	{
+		__m256i v1 = _mm256_set1_epi8(c1);
+		__m256i v2 = _mm256_set1_epi8(c2);
+		unsigned int mask;
+		__m256i x;
+
+		for (; i + 32 <= len; i += 32)
+		{
+			x = _mm256_loadu_si256((const __m256i *)(ptr + i));
+			mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, v1),
+														_mm256_cmpeq_epi8(x, v2)));
+			if (high)
+				mask |= _mm256_movemask_epi8(x);
+
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+#ifdef __SSE2__
+	{
+		__m128i v1 = _mm_set1_epi8(c1);
+		__m128i v2 = _mm_set1_epi8(c2);
+		unsigned int mask;
+		__m128i x;
+
+		for (; i + 16 <= len; i += 16)
+		{
+			x = _mm_loadu_si128((const __m128i *)(ptr + i));
+			mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, v1),
+												  _mm_cmpeq_epi8(x, v2)));
+			if (high)
+				mask |= _mm_movemask_epi8(x);
+
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; i < len; i++)
+	{
+		if (ptr[i] == c1 || ptr[i] == c2 || (high && (signed char)ptr[i] < 0))
+			break;
+	}
+
+	return i;
+}
+
+struct __header_block
+{
+	struct __header_block *next;
+	size_t size;
+	size_t used;
 };
 
+static inline struct __http_header_line *__header_lines(const http_parser_t *parser)
+{
+	if (parser->header_lines)
+		return parser->header_lines;
+
+	return (struct __http_header_line *)parser->inline_headers;
+}
+
+/* Header texts are allocated from blocks, which are freed only by deinit,
+ * so pointers returned by the cursor stay valid while headers are added. */
+static char *__alloc_header_text(size_t size, http_parser_t *parser)
+{
+	struct __header_block *block = (struct __header_block *)parser->header_block;
+	size_t block_size;
+
+	if (!block || block->size - block->used < size)
+	{
+		block_size = MAX(HTTP_HEADER_BLOCK_SIZE,
+						 sizeof (struct __header_block) + size);
+		block = (struct __header_block *)malloc(block_size);
+		if (!block)
+			return NULL;
+
+		block->next = (struct __header_block *)parser->header_block;
+		block->size = block_size;
+		block->used = sizeof (struct __header_block);
+		parser->header_block = block;
+	}
+
+	block->used += size;
+	return (char *)block + block->used - size;
+}
+
 static int __add_message_header(const void *name, size_t name_len,
 								const void *value, size_t value_len,
 								http_parser_t *parser)
 {
-	size_t size = sizeof (struct __header_line) + name_len + value_len + 4;
-	struct __header_line *line;
-
-	line = (struct __header_line *)malloc(size);
-	if (line)
-	{
-		line->buf = (char *)(line + 1);
-		memcpy(line->buf, name, name_len);
-		line->buf[name_len] = ':';
-		line->buf[name_len + 1] = ' ';
-		memcpy(line->buf + name_len + 2, value, value_len);
-		line->buf[name_len + 2 + value_len] = '\r';
-		line->buf[name_len + 2 + value_len + 1] = '\n';
-		line->name_len = name_len;
-		line->value_len = value_len;
-		list_add_tail(&line->list, &parser->header_list);
-		return 0;
+	struct __http_header_line *lines = __header_lines(parser);
+	struct __http_header_line *line;
+	int max;
+	char *buf;
+
+	if (parser->header_count == parser->header_max)
+	{
+		max = 2 * parser->header_max;
+		if (parser->header_lines)
+			lines = (struct __http_header_line *)realloc(lines, max * sizeof *lines);
+		else
+		{
+			lines = (struct __http_header_line *)malloc(max * sizeof *lines);
+			if (lines)
+				memcpy(lines, parser->inline_headers, sizeof parser->inline_headers);
+		}
+
+		if (!lines)
+			return -1;
+
+		parser->header_lines = lines;
+		parser->header_max = max;
 	}
 
-	return -1;
+	buf = __alloc_header_text(name_len + value_len + 4, parser);
+	if (!buf)
+		return -1;
+
+	memcpy(buf, name, name_len);
+	buf[name_len] = ':';
+	buf[name_len + 1] = ' ';
+	memcpy(buf + name_len + 2, value, value_len);
+	buf[name_len + 2 + value_len] = '\r';
+	buf[name_len + 2 + value_len + 1] = '\n';
+	line = &lines[parser->header_count++];
+	line->buf = buf;
+	line->name_len = name_len;
+	line->value_len = value_len;
+	line->size = name_len + value_len + 4;
+	line->own = 0;
+	return 0;
+}
+
+/* Grows the text of 'line' to 'size', keeping its name. The last text of
+ * the current block grows in place while the block has room, or else gives
+ * its room back. Other texts move to a buffer of their own, which later
+ * growth reallocs and deinit frees, so a header set again and again does
+ * not use up blocks. */
+static char *__grow_header_text(struct __http_header_line *line, size_t size,
+								http_parser_t *parser)
+{
+	struct __header_block *block = (struct __header_block *)parser->header_block;
+	int last;
+	char *buf;
+
+	if (line->own)
+	{
+		buf = (char *)realloc(line->buf, size);
+		if (!buf)
+			return NULL;
+	}
+	else
+	{
+		last = (block && line->buf + line->size == (char *)block + block->used);
+		if (last && block->size - block->used >= size - line->size)
+		{
+			block->used += size - line->size;
+			buf = line->buf;
+		}
+		else
+		{
+			buf = (char *)malloc(size);
+			if (!buf)
+				return NULL;
+
+			memcpy(buf, line->buf, line->name_len + 2);
+			if (last)
+				block->used -= line->size;
+
+			line->own = 1;
+		}
+	}
+
+	line->buf = buf;
+	line->size = size;
+	return buf;
 }
 
 static int __set_message_header(const void *name, size_t name_len,
 								const void *value, size_t value_len,
 								http_parser_t *parser)
 {
-	struct __header_line *line;
-	struct list_head *pos;
-	char *buf;
+	struct __http_header_line *lines = __header_lines(parser);
+	struct __http_header_line *line;
+	size_t size = name_len + value_len + 4;
+	int i;
 
-	list_for_each(pos, &parser->header_list)
+	for (i = 0; i < parser->header_count; i++)
 	{
-		line = list_entry(pos, struct __header_line, list);
+		line = &lines[i];
 		if (line->name_len == name_len &&
 			strncasecmp(line->buf, name, name_len) == 0)
 		{
-			if (value_len > line->value_len)
+			if (size > (size_t)line->size)
 			{
-				buf = (char *)malloc(name_len + value_len + 4);
-				if (!buf)
+				if (!__grow_header_text(line, size, parser))
 					return -1;
-
-				if (line->buf != (char *)(line + 1))
-					free(line->buf);
-
-				line->buf = buf;
-				memcpy(buf, name, name_len);
-				buf[name_len] = ':';
-				buf[name_len + 1] = ' ';
 			}
 
 			memcpy(line->buf + name_len + 2, value, value_len);
@@ -264,52 +418,50 @@ static int __parse_start_line(const char *ptr, size_t len,
 		return 1;
 	}
 
-	for (i = 0; i < min; i++)
+	i = __scan(ptr, min, '\r', '\0', 0);
+	if (i == min)
 	{
-		start_line[i] = ptr[i];
-		if (start_line[i] == '\r')
-		{
-			if (i == len - 1)
-				return 0;
+		if (i == HTTP_START_LINE_MAX)
+			return -2;
 
-			if (ptr[i + 1] != '\n')
-				return -2;
+		return 0;
+	}
 
-			start_line[i] = '\0';
-			p1 = start_line;
-			p2 = strchr(p1, ' ');
-			if (p2)
-				*p2++ = '\0';
-			else
-				return -2;
+	if (ptr[i] == '\0')
+		return -2;
 
-			p3 = strchr(p2, ' ');
-			if (p3)
-				*p3++ = '\0';
-			else
-				return -2;
+	if (i == len - 1)
+		return 0;
 
-			if (parser->is_resp)
-				ret = __match_status_line(p1, p2, p3, parser);
-			else
-				ret = __match_request_line(p1, p2, p3, parser);
+	if (ptr[i + 1] != '\n')
+		return -2;
 
-			if (ret < 0)
-				return -1;
+	memcpy(start_line, ptr, i);
+	start_line[i] = '\0';
+	p1 = start_line;
+	p2 = strchr(p1, ' ');
+	if (p2)
+		*p2++ = '\0';
+	else
+		return -2;
 
-			parser->header_offset += i + 2;
-			parser->header_state = HPS_HEADER_NAME;
-			return 1;
-		}
+	p3 = strchr(p2, ' ');
+	if (p3)
+		*p3++ = '\0';
+	else
+		return -2;
 
-		if (start_line[i] == 0)
-			return -2;
-	}
+	if (parser->is_resp)
+		ret = __match_status_line(p1, p2, p3, parser);
+	else
+		ret = __match_request_line(p1, p2, p3, parser);
 
-	if (i == HTTP_START_LINE_MAX)
-		return -2;
+	if (ret < 0)
+		return -1;
 
-	return 0;
+	parser->header_offset += i + 2;
+	parser->header_state = HPS_HEADER_NAME;
+	return 1;
 }
 
 static int __parse_header_name(const char *ptr, size_t len,
@@ -325,26 +477,23 @@ static int __parse_header_name(const char *ptr, size_t len,
 		return 1;
 	}
 
-	for (i = 0; i < min; i++)
+	i = __scan(ptr, min, ':', '\0', 1);
+	if (i == min)
 	{
-		if (ptr[i] == ':')
-		{
-			parser->namebuf[i] = '\0';
-			parser->header_offset += i + 1;
-			parser->header_state = HPS_HEADER_VALUE;
-			return 1;
-		}
-
-		if ((signed char)ptr[i] <= 0)
+		if (i == HTTP_HEADER_NAME_MAX)
 			return -2;
 
-		parser->namebuf[i] = ptr[i];
+		return 0;
 	}
 
-	if (i == HTTP_HEADER_NAME_MAX)
+	if (ptr[i] != ':')
 		return -2;
 
-	return 0;
+	memcpy(parser->namebuf, ptr, i);
+	parser->namebuf[i] = '\0';
+	parser->header_offset += i + 1;
+	parser->header_state = HPS_HEADER_VALUE;
+	return 1;
 }
 
 static int __parse_header_value(const char *ptr, size_t len,
@@ -354,6 +503,7 @@ static int __parse_header_value(const char *ptr, size_t len,
 	const char *end = ptr + len;
 	const char *begin = ptr;
 	size_t i = 0;
+	size_t n;
 
 	while (1)
 	{
@@ -368,23 +518,21 @@ static int __parse_header_value(const char *ptr, size_t len,
 				break;
 		}
 
-		while (1)
-		{
-			if (i == HTTP_HEADER_VALUE_MAX)
-				return -2;
-
-			header_value[i] = *ptr++;
-			if (ptr == end)
-				return 0;
+		n = __scan(ptr, end - ptr, '\r', '\0', 1);
+		if (n >= HTTP_HEADER_VALUE_MAX - i)
+			return -2;
 
-			if (header_value[i] == '\r')
-				break;
+		if (n == end - ptr)
+			return 0;
 
-			if ((signed char)header_value[i] <= 0)
-				return -2;
+		if (ptr[n] != '\r')
+			return -2;
 
-			i++;
-		}
+		memcpy(header_value + i, ptr, n);
+		i += n;
+		ptr += n + 1;
+		if (ptr == end)
+			return 0;
 
 		if (*ptr == '\n')
 			ptr++;
@@ -456,45 +604,43 @@ static int __parse_chunk_data(const char *ptr, size_t len,
 	char *end;
 	size_t i;
 
-	for (i = 0; i < min; i++)
+	i = __scan(ptr, min, '\r', '\r', 0);
+	if (i == min)
 	{
-		chunk_line[i] = ptr[i];
-		if (chunk_line[i] == '\r')
-		{
-			if (i == len - 1)
-				return 0;
+		if (i == HTTP_CHUNK_LINE_MAX)
+			return -2;
 
-			if (ptr[i + 1] != '\n')
-				return -2;
+		return 0;
+	}
 
-			chunk_line[i] = '\0';
-			chunk_size = strtol(chunk_line, &end, 16);
-			if (end == chunk_line)
-				return -2;
+	if (i == len - 1)
+		return 0;
 
-			if (chunk_size == 0)
-			{
-				chunk_size = i + 2;
-				parser->chunk_state = CPS_TRAILER_PART;
-			}
-			else if ((unsigned long)chunk_size < CHUNK_SIZE_MAX)
-			{
-				chunk_size += i + 4;
-				if (len < (size_t)chunk_size)
-					return 0;
-			}
-			else
-				return -2;
+	if (ptr[i + 1] != '\n')
+		return -2;
 
-			parser->chunk_offset += chunk_size;
-			return 1;
-		}
-	}
+	memcpy(chunk_line, ptr, i);
+	chunk_line[i] = '\0';
+	chunk_size = strtol(chunk_line, &end, 16);
+	if (end == chunk_line)
+		return -2;
 
-	if (i == HTTP_CHUNK_LINE_MAX)
+	if (chunk_size == 0)
+	{
+		chunk_size = i + 2;
+		parser->chunk_state = CPS_TRAILER_PART;
+	}
+	else if ((unsigned long)chunk_size < CHUNK_SIZE_MAX)
+	{
+		chunk_size += i + 4;
+		if (len < (size_t)chunk_size)
+			return 0;
+	}
+	else
 		return -2;
 
-	return 0;
+	parser->chunk_offset += chunk_size;
+	return 1;
 }
 
 static int __parse_trailer_part(const char *ptr, size_t len,
@@ -503,28 +649,26 @@ static int __parse_trailer_part(const char *ptr, size_t len,
 	size_t min = MIN(HTTP_TRAILER_LINE_MAX, len);
 	size_t i;
 
-	for (i = 0; i < min; i++)
+	i = __scan(ptr, min, '\r', '\r', 0);
+	if (i == min)
 	{
-		if (ptr[i] == '\r')
-		{
-			if (i == len - 1)
-				return 0;
-
-			if (ptr[i + 1] != '\n')
-				return -2;
-
-			parser->chunk_offset += i + 2;
-			if (i == 0)
-				parser->chunk_state = CPS_CHUNK_COMPLETE;
+		if (i == HTTP_TRAILER_LINE_MAX)
+			return -2;
 
-			return 1;
-		}
+		return 0;
 	}
 
-	if (i == HTTP_TRAILER_LINE_MAX)
+	if (i == len - 1)
+		return 0;
+
+	if (ptr[i + 1] != '\n')
 		return -2;
 
-	return 0;
+	parser->chunk_offset += i + 2;
+	if (i == 0)
+		parser->chunk_state = CPS_CHUNK_COMPLETE;
+
+	return 1;
 }
 
 static int __parse_chunk(const void *message, size_t size,
@@ -562,7 +706,10 @@ void http_parser_init(int is_resp, http_parser_t *parser)
 	parser->uri = NULL;
 	parser->code = NULL;
 	parser->phrase = NULL;
-	INIT_LIST_HEAD(&parser->header_list);
+	parser->header_lines = NULL;
+	parser->header_count = 0;
+	parser->header_max = HTTP_HEADER_INLINE_MAX;
+	parser->header_block = NULL;
 	parser->msgbuf = NULL;
 	parser->msgsize = 0;
 	parser->bufsize = 0;
@@ -587,23 +734,28 @@ int http_parser_append_message(const void *buf, size_t *n,
 		return 1;
 	}
 
-	if (parser->msgsize + *n + 1 > parser->bufsize)
+	/* Bytes received in place by http_parser_get_buffer() need no copy. */
+	if (buf != (char *)parser->msgbuf + parser->msgsize)
 	{
-		size_t new_size = MAX(HTTP_MSGBUF_INIT_SIZE, 2 * parser->bufsize);
-		void *new_base;
+		if (parser->msgsize + *n + 1 > parser->bufsize)
+		{
+			size_t new_size = MAX(HTTP_MSGBUF_INIT_SIZE, 2 * parser->bufsize);
+			void *new_base;
 
-		while (new_size < parser->msgsize + *n + 1)
-			new_size *= 2;
+			while (new_size < parser->msgsize + *n + 1)
+				new_size *= 2;
 
-		new_base = realloc(parser->msgbuf, new_size);
-		if (!new_base)
-			return -1;
+			new_base = realloc(parser->msgbuf, new_size);
+			if (!new_base)
+				return -1;
 
-		parser->msgbuf = new_base;
-		parser->bufsize = new_size;
+			parser->msgbuf = new_base;
+			parser->bufsize = new_size;
+		}
+
+		memcpy((char *)parser->msgbuf + parser->msgsize, buf, *n);
 	}
 
-	memcpy((char *)parser->msgbuf + parser->msgsize, buf, *n);
 	parser->msgsize += *n;
 	if (parser->header_state != HPS_HEADER_COMPLETE)
 	{
@@ -651,6 +803,42 @@ int http_parser_append_message(const void *buf, size_t *n,
 	return 1;
 }
 
+void *http_parser_get_buffer(size_t *n, http_parser_t *parser)
+{
+	size_t remaining;
+	size_t new_size;
+	void *new_base;
+
+	if (parser->complete || parser->header_state != HPS_HEADER_COMPLETE ||
+		parser->transfer_length == (size_t)-1)
+		return NULL;
+
+	/* Only a body of known length, and not more than '*n' bytes of it. */
+	remaining = parser->transfer_length -
+				(parser->msgsize - parser->header_offset);
+	if (remaining == 0 || remaining > *n)
+		return NULL;
+
+	/* The length is the peer's word, so the buffer is not sized to it. It
+	 * starts a window ahead of the data received, and doubles when full. */
+	if (parser->bufsize - parser->msgsize - 1 <
+		MIN(remaining, HTTP_MSGBUF_INIT_SIZE))
+	{
+		new_size = parser->msgsize + MIN(remaining, HTTP_BODYBUF_WINDOW) + 1;
+		new_size = MAX(new_size, 2 * parser->bufsize);
+		new_size = MIN(new_size, parser->msgsize + remaining + 1);
+		new_base = realloc(parser->msgbuf, new_size);
+		if (!new_base)
+			return NULL;
+
+		parser->msgbuf = new_base;
+		parser->bufsize = new_size;
+	}
+
+	*n = MIN(remaining, parser->bufsize - parser->msgsize - 1);
+	return (char *)parser->msgbuf + parser->msgsize;
+}
+
 int http_parser_header_complete(http_parser_t *parser)
 {
 	return parser->header_state == HPS_HEADER_COMPLETE;
@@ -767,19 +955,25 @@ int http_parser_set_header(const void *name, size_t name_len,
 
 void http_parser_deinit(http_parser_t *parser)
 {
-	struct __header_line *line;
-	struct list_head *pos, *tmp;
+	struct __http_header_line *lines = __header_lines(parser);
+	struct __header_block *block = (struct __header_block *)parser->header_block;
+	struct __header_block *next;
+	int i;
 
-	list_for_each_safe(pos, tmp, &parser->header_list)
+	for (i = 0; i < parser->header_count; i++)
 	{
-		line = list_entry(pos, struct __header_line, list);
-		list_del(pos);
-		if (line->buf != (char *)(line + 1))
-			free(line->buf);
+		if (lines[i].own)
+			free(lines[i].buf);
+	}
 
-		free(line);
+	while (block)
+	{
+		next = block->next;
+		free(block);
+		block = next;
 	}
 
+	free(parser->header_lines);
 	free(parser->version);
 	free(parser->method);
 	free(parser->uri);
@@ -792,12 +986,11 @@ int http_header_cursor_next(const void **name, size_t *name_len,
 							const void **value, size_t *value_len,
 							http_header_cursor_t *cursor)
 {
-	struct __header_line *line;
+	const struct __http_header_line *line;
 
-	if (cursor->next->next != cursor->head)
+	if (cursor->next < cursor->parser->header_count)
 	{
-		cursor->next = cursor->next->next;
-		line = list_entry(cursor->next, struct __header_line, list);
+		line = &__header_lines(cursor->parser)[cursor->next++];
 		*name = line->buf;
 		*name_len = line->name_len;
 		*value = line->buf + line->name_len + 2;
@@ -812,12 +1005,12 @@ int http_header_cursor_find(const void *name, size_t name_len,
 							const void **value, size_t *value_len,
 							http_header_cursor_t *cursor)
 {
-	struct __header_line *line;
+	const struct __http_header_line *lines = __header_lines(cursor->parser);
+	const struct __http_header_line *line;
 
-	while (cursor->next->next != cursor->head)
+	while (cursor->next < cursor->parser->header_count)
 	{
-		cursor->next = cursor->next->next;
-		line = list_entry(cursor->next, struct __header_line, list);
+		line = &lines[cursor->next++];
 		if (line->name_len == name_len)
 		{
 			if (strncasecmp(line->buf, name, name_len) == 0)
@@ -20,9 +20,19 @@
 #define _HTTP_PARSER_H_
 
 #include <stddef.h>
-#include "list.h"
 
 #define HTTP_HEADER_NAME_MAX	64
+#define HTTP_HEADER_INLINE_MAX	16
+
+struct __http_header_line
+{
+	char *buf;
+	int name_len;
+	int value_len;
+	/* Bytes of 'buf', and if it is malloc'd apart from the blocks. */
+	int size;
+	int own;
+};
 
 typedef struct __http_parser
 {
@@ -37,7 +47,15 @@ typedef struct __http_parser
 	char *uri;
 	char *code;
 	char *phrase;
-	struct list_head header_list;
+	/* The first HTTP_HEADER_INLINE_MAX headers are kept in 'inline_headers'.
+	 * More move all of them to the malloc'd 'header_lines'. Their texts are
+	 * in blocks chained from 'header_block', and move only when a set header
+	 * outgrows its text. */
+	struct __http_header_line *header_lines;
+	int header_count;
+	int header_max;
+	void *header_block;
+	struct __http_header_line inline_headers[HTTP_HEADER_INLINE_MAX];
 	char namebuf[HTTP_HEADER_NAME_MAX];
 	void *msgbuf;
 	size_t msgsize;
@@ -54,8 +72,8 @@ typedef struct __http_parser
 
 typedef struct __http_header_cursor
 {
-	const struct list_head *head;
-	const struct list_head *next;
+	const http_parser_t *parser;
+	int next;
 } http_header_cursor_t;
 
 #ifdef __cplusplus
@@ -68,6 +86,7 @@ int http_parser_append_message(const void *buf, size_t *n,
 							   http_parser_t *parser);
 int http_parser_get_body(const void **body, size_t *size,
 						 http_parser_t *parser);
+void *http_parser_get_buffer(size_t *n, http_parser_t *parser);
 int http_parser_header_complete(http_parser_t *parser);
 int http_parser_set_method(const char *method, http_parser_t *parser);
 int http_parser_set_uri(const char *uri, http_parser_t *parser);
@@ -151,13 +170,13 @@ static inline void http_parser_close_message(http_parser_t *parser)
 static inline void http_header_cursor_init(http_header_cursor_t *cursor,
 										   const http_parser_t *parser)
 {
-	cursor->head = &parser->header_list;
-	cursor->next = cursor->head;
+	cursor->parser = parser;
+	cursor->next = 0;
 }
 
 static inline void http_header_cursor_rewind(http_header_cursor_t *cursor)
 {
-	cursor->next = cursor->head;
+	cursor->next = 0;
 }
 
 static inline void http_header_cursor_deinit(http_header_cursor_t *cursor)
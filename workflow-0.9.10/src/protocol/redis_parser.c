@@ -18,30 +18,40 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include "list.h"
+#include <limits.h>
 #include "redis_parser.h"
 
 #define MIN(x, y)	((x) <= (y) ? (x) : (y))
 #define MAX(x, y)	((x) >= (y) ? (x) : (y))
 
 #define REDIS_MSGBUF_INIT_SIZE	8
+#define REDIS_ARENA_BLOCK_SIZE	4096
+#define REDIS_STACK_INIT_SIZE	8
 
 enum
 {
 	//REDIS_PARSE_INIT = 0,
 	REDIS_GET_CMD = 1,
-	REDIS_GET_CR,
-	REDIS_GET_LF,
 	REDIS_UNTIL_CRLF,
 	REDIS_GET_NCHAR,
 	REDIS_PARSE_END
 };
 
-typedef struct __read_record
+/* The values of a received reply, their element vectors and the parsing
+ * stack are allocated from blocks that are freed together. */
+struct __redis_arena
 {
-	redis_reply_t *reply;
-	struct list_head read_list;
-}__read_record;
+	struct __redis_arena *next;
+	size_t size;
+	size_t used;
+};
+
+/* The elements still to be read of an array being received. */
+struct __redis_frame
+{
+	redis_reply_t **element;
+	size_t left;
+};
 
 void redis_reply_deinit(redis_reply_t *reply)
 {
@@ -104,53 +114,238 @@ int redis_reply_set_array(size_t size, redis_reply_t *reply)
 	return 0;
 }
 
-static int __redis_parse_cmd(const char ch, redis_parser_t *parser)
+static void *__redis_arena_alloc(size_t size, redis_parser_t *parser)
 {
-	switch (ch)
+	struct __redis_arena *block = (struct __redis_arena *)parser->arena;
+	struct __redis_arena *large;
+
+	size = (size + sizeof (long long) - 1) & ~(sizeof (long long) - 1);
+	if (block && block->size - block->used >= size)
 	{
-	case '+':
-	case '-':
-	case ':':
-	case '$':
-	case '*':
-		parser->cmd = ch;
-		parser->status = REDIS_UNTIL_CRLF;
-		parser->findidx = parser->msgidx;
+		block->used += size;
+		return (char *)block + block->used - size;
+	}
+
+	/* A large one gets a block of its own, behind the current block. */
+	if (size > REDIS_ARENA_BLOCK_SIZE / 4)
+	{
+		large = (struct __redis_arena *)malloc(sizeof (struct __redis_arena) +
+											   size);
+		if (!large)
+			return NULL;
+
+		large->size = sizeof (struct __redis_arena) + size;
+		large->used = large->size;
+		if (block)
+		{
+			large->next = block->next;
+			block->next = large;
+		}
+		else
+		{
+			large->next = NULL;
+			parser->arena = large;
+		}
+
+		return large + 1;
+	}
+
+	block = (struct __redis_arena *)malloc(REDIS_ARENA_BLOCK_SIZE);
+	if (!block)
+		return NULL;
+
+	block->next = (struct __redis_arena *)parser->arena;
+	block->size = REDIS_ARENA_BLOCK_SIZE;
+	block->used = sizeof (struct __redis_arena) + size;
+	parser->arena = block;
+	return block + 1;
+}
+
+static redis_reply_t **__redis_create_array(size_t n, redis_parser_t *parser)
+{
+	redis_reply_t **element;
+	redis_reply_t *values;
+	size_t i;
+
+	element = (redis_reply_t **)__redis_arena_alloc(n * (sizeof (void *) +
+												sizeof (redis_reply_t)), parser);
+	if (!element)
+		return NULL;
+
+	values = (redis_reply_t *)(element + n);
+	for (i = 0; i < n; i++)
+	{
+		redis_reply_init(&values[i]);
+		element[i] = &values[i];
+	}
+
+	return element;
+}
+
+static int __redis_push(redis_reply_t **element, size_t left,
+						redis_parser_t *parser)
+{
+	struct __redis_frame *stack = (struct __redis_frame *)parser->stack;
+	int stack_max;
+
+	if (parser->depth == parser->stack_max)
+	{
+		stack_max = MAX(REDIS_STACK_INIT_SIZE, 2 * parser->stack_max);
+		stack = (struct __redis_frame *)__redis_arena_alloc(stack_max *
+										sizeof (struct __redis_frame), parser);
+		if (!stack)
+			return -1;
+
+		if (parser->depth > 0)
+		{
+			memcpy(stack, parser->stack,
+				   parser->depth * sizeof (struct __redis_frame));
+		}
+
+		parser->stack = stack;
+		parser->stack_max = stack_max;
+	}
+
+	stack[parser->depth].element = element;
+	stack[parser->depth].left = left;
+	parser->depth++;
+	return 0;
+}
+
+static int __redis_parse_array(size_t n, redis_parser_t *parser)
+{
+	redis_reply_t *reply = parser->cur;
+	redis_reply_t **element = NULL;
+
+	if (n > 0)
+	{
+		element = __redis_create_array(n, parser);
+		if (!element)
+			return -1;
+
+		if (n > 1 && __redis_push(element + 1, n - 1, parser) < 0)
+			return -1;
+	}
+
+	reply->type = REDIS_REPLY_TYPE_ARRAY;
+	reply->elements = n;
+	reply->element = element;
+	if (n == 0)
+		return 1;
+
+	parser->cur = element[0];
+	parser->status = REDIS_GET_CMD;
+	return 0;
+}
+
+/* Collecting the values that arrive together: one more element, if there
+ * are more bytes after the last value. */
+static int __redis_parse_more(redis_parser_t *parser)
+{
+	redis_reply_t *reply = &parser->reply;
+	redis_reply_t **element;
+
+	if (parser->msgidx >= parser->msgsize)
 		return 0;
+
+	if (reply->elements == parser->collect)
+	{
+		element = (redis_reply_t **)__redis_arena_alloc(2 * parser->collect *
+													sizeof (void *), parser);
+		if (!element)
+			return -1;
+
+		memcpy(element, reply->element, reply->elements * sizeof (void *));
+		reply->element = element;
+		parser->collect *= 2;
 	}
 
-	return -2;
+	element = __redis_create_array(1, parser);
+	if (!element)
+		return -1;
+
+	reply->element[reply->elements++] = element[0];
+	parser->cur = element[0];
+	parser->status = REDIS_GET_CMD;
+	return 1;
 }
 
-static int __redis_parse_cr(const char ch, redis_parser_t *parser)
+/* After a value: the next one to read, or 0 if the reply is complete. */
+static int __redis_parse_next(redis_parser_t *parser)
 {
-	if (ch != '\r')
-		return -2;
+	struct __redis_frame *frame;
+
+	if (parser->depth > 0)
+	{
+		frame = (struct __redis_frame *)parser->stack + parser->depth - 1;
+		parser->cur = *frame->element++;
+		if (--frame->left == 0)
+			parser->depth--;
+
+		parser->status = REDIS_GET_CMD;
+		return 1;
+	}
+
+	if (parser->collect)
+		return __redis_parse_more(parser);
+
+	return 0;
+}
+
+static int __redis_parse_integer(const char *str, size_t len, long long *num)
+{
+	unsigned long long n = 0;
+	int neg = 0;
 
-	parser->status = REDIS_GET_LF;
+	if (len > 0 && (*str == '-' || *str == '+'))
+	{
+		neg = (*str == '-');
+		str++;
+		len--;
+	}
+
+	if (len == 0 || len > 19)
+		return -1;
+
+	while (len > 0)
+	{
+		if (*str < '0' || *str > '9')
+			return -1;
+
+		n = n * 10 + (*str - '0');
+		str++;
+		len--;
+	}
+
+	*num = neg ? -(long long)n : (long long)n;
 	return 0;
 }
 
-static int __redis_parse_lf(const char ch, redis_parser_t *parser)
+static int __redis_parse_nchar(redis_parser_t *parser)
 {
-	if (ch != '\n')
+	char *buf = (char *)parser->msgbuf + parser->msgidx;
+
+	if (parser->msgsize - parser->msgidx < parser->nchar + 2)
+		return 2;
+
+	if (buf[parser->nchar] != '\r' || buf[parser->nchar + 1] != '\n')
 		return -2;
 
+	redis_reply_set_string((const char *)parser->msgidx, parser->nchar,
+						   parser->cur);
+	parser->msgidx += parser->nchar + 2;
 	return 1;
 }
 
 static int __redis_parse_line(redis_parser_t *parser)
 {
-	char *buf = (char *)parser->msgbuf;
-	char *str = buf + parser->msgidx;
+	char *str = (char *)parser->msgbuf + parser->msgidx;
 	size_t slen = parser->findidx - parser->msgidx;
-	char data[32];
-	int i, n;
 	const char *offset = (const char *)parser->msgidx;
-	__read_record *node;
+	long long n;
 
 	parser->msgidx = parser->findidx + 2;
-	switch (parser->cmd)
+	switch (str[-1])
 	{
 	case '+':
 		redis_reply_set_status(offset, slen, parser->cur);
@@ -161,115 +356,93 @@ static int __redis_parse_line(redis_parser_t *parser)
 		return 1;
 
 	case ':':
-		if (slen == 0 || slen > 30)
-			return -1;
+		if (__redis_parse_integer(str, slen, &n) < 0)
+			return -2;
 
-		memcpy(data, str, slen);
-		data[slen] = '\0';
-		redis_reply_set_integer(atoll(data), parser->cur);
+		redis_reply_set_integer(n, parser->cur);
 		return 1;
 
 	case '$':
-		n = atoi(str);
+		if (__redis_parse_integer(str, slen, &n) < 0 || n > INT_MAX)
+			return -2;
+
 		if (n < 0)
 		{
 			redis_reply_set_null(parser->cur);
 			return 1;
 		}
-		else if (n == 0)
-		{
-			redis_reply_set_string(offset, 0, parser->cur);
-			parser->status = REDIS_GET_CR;
-			return 0;
-		}
 
 		parser->nchar = n;
 		parser->status = REDIS_GET_NCHAR;
-		return 0;
+		return __redis_parse_nchar(parser);
 
 	case '*':
-		n = atoi(str);
+		if (__redis_parse_integer(str, slen, &n) < 0 || n > INT_MAX)
+			return -2;
+
 		if (n < 0)
 		{
 			redis_reply_set_null(parser->cur);
 			return 1;
 		}
 
-		parser->nleft += n;
-		if (redis_reply_set_array(n, parser->cur) < 0)
-			return -1;
-
-		if (n == 0)
-			return 1;
-
-		parser->nleft--;
-		for (i = 0; i < n - 1; i++)
-		{
-			node = (__read_record *)malloc(sizeof (__read_record));
-			if (!node)
-				return -1;
-
-			node->reply = parser->cur->element[n - 1 - i];
-			list_add(&node->read_list, &parser->read_list);
-		}
-
-		parser->cur = parser->cur->element[0];
-		parser->status = REDIS_GET_CMD;
-		return 0;
-
+		return __redis_parse_array(n, parser);
 	}
 
-	return -1;
+	return -2;
 }
 
 static int __redis_parse_crlf(redis_parser_t *parser)
 {
 	char *buf = (char *)parser->msgbuf;
+	char *p;
 
-	for (; parser->findidx + 1 < parser->msgsize; parser->findidx++)
+	while (parser->findidx + 1 < parser->msgsize)
 	{
-		if (buf[parser->findidx] == '\r' && buf[parser->findidx + 1] == '\n')
-			return __redis_parse_line(parser);
-	}
-
-	return 2;
-}
-
-static int __redis_parse_nchar(redis_parser_t *parser)
-{
-	//char *buf = (char *)parser->msgbuf;
+		p = (char *)memchr(buf + parser->findidx, '\r',
+						   parser->msgsize - 1 - parser->findidx);
+		if (!p)
+		{
+			parser->findidx = parser->msgsize - 1;
+			break;
+		}
 
-	if (parser->nchar <= parser->msgsize - parser->msgidx)
-	{
-		redis_reply_set_string((const char *)parser->msgidx, parser->nchar,
-							   parser->cur);
+		parser->findidx = p - buf;
+		if (p[1] == '\n')
+			return __redis_parse_line(parser);
 
-		parser->msgidx += parser->nchar;
-		parser->status = REDIS_GET_CR;
-		return 0;
+		parser->findidx++;
 	}
 
 	return 2;
 }
 
-//-1 error | 0 continue | 1 finish-one | 2 not-enough
+//-1 error | -2 bad message | 0 continue | 1 finish-one | 2 not-enough
 static int __redis_parser_forward(redis_parser_t *parser)
 {
 	char *buf = (char *)parser->msgbuf;
 
-	if (parser->msgidx >= parser->msgsize)
-		return 2;
-
 	switch (parser->status)
 	{
 	case REDIS_GET_CMD:
-		return __redis_parse_cmd(buf[parser->msgidx++], parser);
+		if (parser->msgidx >= parser->msgsize)
+			return 2;
 
-	case REDIS_GET_CR:
-		return __redis_parse_cr(buf[parser->msgidx++], parser);
+		switch (buf[parser->msgidx++])
+		{
+		case '+':
+		case '-':
+		case ':':
+		case '$':
+		case '*':
+			break;
+		default:
+			return -2;
+		}
 
-	case REDIS_GET_LF:
-		return __redis_parse_lf(buf[parser->msgidx++], parser);
+		parser->status = REDIS_UNTIL_CRLF;
+		parser->findidx = parser->msgidx;
+		/* fall through */
 
 	case REDIS_UNTIL_CRLF:
 		return __redis_parse_crlf(parser);
@@ -289,30 +462,45 @@ void redis_parser_init(redis_parser_t *parser)
 	parser->msgsize = 0;
 	parser->bufsize = 0;
 	//parser->status = REDIS_PARSE_INIT;
-	//parser->nleft = 0;
 	parser->status = REDIS_GET_CMD;
-	parser->nleft = 1;
 	parser->cur = &parser->reply;
-	INIT_LIST_HEAD(&parser->read_list);
+	parser->stack = NULL;
+	parser->depth = 0;
+	parser->stack_max = 0;
 	parser->msgidx = 0;
-	parser->cmd = '\0';
-	parser->nchar = 0;
 	parser->findidx = 0;
+	parser->nchar = 0;
+	parser->collect = 0;
+	parser->arena = NULL;
+}
+
+int redis_parser_set_pipeline(size_t n, redis_parser_t *parser)
+{
+	if (n == 0)
+	{
+		parser->collect = 1;
+		n = 1;
+	}
+
+	return __redis_parse_array(n, parser) < 0 ? -1 : 0;
 }
 
 void redis_parser_deinit(redis_parser_t *parser)
 {
-	struct list_head *pos, *tmp;
-	__read_record *next;
+	struct __redis_arena *block = (struct __redis_arena *)parser->arena;
+	struct __redis_arena *next;
+
+	/* A reply set by users is not in the arena. */
+	if (!block)
+		redis_reply_deinit(&parser->reply);
 
-	list_for_each_safe(pos, tmp, &parser->read_list)
+	while (block)
 	{
-		next = list_entry(pos, __read_record, read_list);
-		list_del(pos);
-		free(next);
+		next = block->next;
+		free(block);
+		block = next;
 	}
 
-	redis_reply_deinit(&parser->reply);
 	free(parser->msgbuf);
 }
 
@@ -344,6 +532,7 @@ int redis_parser_append_message(const void *buf,
 								redis_parser_t *parser)
 {
 	size_t msgsize_bak = parser->msgsize;
+	int ret;
 
 	if (parser->status == REDIS_PARSE_END)
 	{
@@ -369,46 +558,28 @@ int redis_parser_append_message(const void *buf,
 
 	memcpy((char *)parser->msgbuf + parser->msgsize, buf, *size);
 	parser->msgsize += *size;
-/*
-	if (parser->status == REDIS_PARSE_INIT)
-	{
-		parser->nleft = 1;
-		parser->status = REDIS_GET_CMD;
-	}
-*/
 
 	do
 	{
-		int ret = __redis_parser_forward(parser);
-
+		ret = __redis_parser_forward(parser);
 		if (ret < 0)
 			return ret;
 
+		if (ret == 2)
+			return 0;
+
 		if (ret == 1)
 		{
-			struct list_head *lnext = parser->read_list.next;
-			__read_record *next;
+			ret = __redis_parse_next(parser);
+			if (ret < 0)
+				return ret;
 
-			parser->nleft--;
-			if (lnext && lnext != &parser->read_list)
-			{
-				next = list_entry(lnext, __read_record, read_list);
-				parser->cur = next->reply;
-				list_del(lnext);
-				free(next);
-			}
-
-			if (parser->nleft > 0)
-				parser->status = REDIS_GET_CMD;
-			else
+			if (ret == 0)
 			{
 				parser->parse_succ = 1;
 				parser->status = REDIS_PARSE_END;
 			}
 		}
-		else if (ret == 2)
-			return 0;
-
 	} while (parser->status != REDIS_PARSE_END);
 
 	*size = parser->msgidx - msgsize_bak;
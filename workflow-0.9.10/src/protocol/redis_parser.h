@@ -20,7 +20,6 @@
 #define _REDIS_PARSER_H_
 
 #include <stddef.h>
-#include "list.h"
 
 // redis_parser_t is absolutely same as hiredis-redisReply in memory
 // If you include hiredis.h, redisReply* can cast to redis_reply_t* safely
@@ -49,12 +48,14 @@ typedef struct __redis_parser
 	size_t msgsize;
 	size_t bufsize;
 	redis_reply_t *cur;
-	struct list_head read_list;
+	void *stack;
+	int depth;
+	int stack_max;
 	size_t msgidx;
 	size_t findidx;
-	int nleft;
-	int nchar;
-	char cmd;
+	size_t nchar;
+	size_t collect;
+	void *arena;
 	redis_reply_t reply;
 } redis_parser_t;
 
@@ -63,11 +64,19 @@ extern "C"
 {
 #endif
 
+/* The values of a received reply are kept in one arena of the parser, and
+ * their strings point into its message buffer. So they are valid until the
+ * parser is deinited, and must not be changed by redis_reply_set_array(). */
+
 void redis_parser_init(redis_parser_t *parser);
 void redis_parser_deinit(redis_parser_t *parser);
 int redis_parser_append_message(const void *buf, size_t *size,
 								redis_parser_t *parser);
 
+/* Pipelining, before any message is appended. The reply is an array of
+ * 'n' values, or with 'n' 0, of the values that arrive together. */
+int redis_parser_set_pipeline(size_t n, redis_parser_t *parser);
+
 void redis_reply_deinit(redis_reply_t *reply);
 
 int redis_reply_set_array(size_t size, redis_reply_t *reply);
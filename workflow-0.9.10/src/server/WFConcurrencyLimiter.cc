@@ -0,0 +1,133 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <math.h>
+#include <mutex>
+#include "WFConcurrencyLimiter.h"
+
+/* How fast the no-load latency follows a rise of the latency, per window. */
+#define NOLOAD_LATENCY_DRIFT	0.01
+
+void WFConcurrencyLimiter::init(const struct WFConcurrencyLimitParams *params)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->params = *params;
+	if (this->params.priority_classes < 1)
+		this->params.priority_classes = 1;
+
+	if (this->params.min_limit < 1)
+		this->params.min_limit = 1;
+
+	if (this->params.max_limit < this->params.min_limit)
+		this->params.max_limit = this->params.min_limit;
+
+	this->limit = this->params.initial_limit;
+	if (this->limit < this->params.min_limit)
+		this->limit = this->params.min_limit;
+	else if (this->limit > this->params.max_limit)
+		this->limit = this->params.max_limit;
+
+	this->enabled = true;
+}
+
+bool WFConcurrencyLimiter::try_acquire(int priority)
+{
+	int classes = this->params.priority_classes;
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if (priority < 0)
+		priority = 0;
+	else if (priority >= classes)
+		priority = classes - 1;
+
+	if (this->inflight == 0 ||
+		this->inflight < this->limit * (classes - priority) / classes)
+	{
+		this->inflight++;
+		this->accepted++;
+		if (this->max_inflight < this->inflight)
+			this->max_inflight = this->inflight;
+
+		return true;
+	}
+
+	this->rejected++;
+	return false;
+}
+
+void WFConcurrencyLimiter::release(long long latency, bool dropped)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->inflight--;
+	if (dropped || (this->params.max_latency >= 0 &&
+					latency > this->params.max_latency * 1000LL))
+	{
+		this->backoff = true;
+	}
+
+	this->samples++;
+	this->total_latency += latency;
+	if (this->samples >= this->limit)
+		this->update_limit();
+}
+
+void WFConcurrencyLimiter::update_limit()
+{
+	double latency = (double)this->total_latency / this->samples;
+	double limit = this->limit;
+	double gradient;
+
+	if (latency < 1)
+		latency = 1;
+
+	if (this->noload_latency == 0 || latency < this->noload_latency)
+		this->noload_latency = latency;
+	else
+		this->noload_latency += (latency - this->noload_latency) * NOLOAD_LATENCY_DRIFT;
+
+	if (this->backoff)
+		limit *= this->params.backoff_ratio;
+	else
+	{
+		gradient = this->params.tolerance * this->noload_latency / latency;
+		if (gradient < 0.5)
+			gradient = 0.5;
+		else if (gradient > 1.0)
+			gradient = 1.0;
+
+		/* Grow only if the limit is what holds the requests back. */
+		if (gradient < 1.0 || this->max_inflight * 2 >= this->limit)
+		{
+			limit = limit * gradient + sqrt(limit);
+			limit = this->limit * (1 - this->params.smoothing) +
+					limit * this->params.smoothing;
+		}
+	}
+
+	if (limit < this->params.min_limit)
+		limit = this->params.min_limit;
+	else if (limit > this->params.max_limit)
+		limit = this->params.max_limit;
+
+	this->limit = limit;
+	this->samples = 0;
+	this->max_inflight = this->inflight;
+	this->total_latency = 0;
+	this->backoff = false;
+}
+
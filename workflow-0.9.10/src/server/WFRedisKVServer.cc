@@ -0,0 +1,1197 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <ctype.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "WFGlobal.h"
+#include "WFRedisKVServer.h"
+
+using namespace protocol;
+
+#define GET_CURRENT_MS	std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+#define REDIS_KV_EXPIRE_STEP	16
+
+#define REDIS_KV_ERR_WRONGTYPE	"WRONGTYPE Operation against a key holding the wrong kind of value"
+#define REDIS_KV_ERR_INTEGER	"ERR value is not an integer or out of range"
+#define REDIS_KV_ERR_OVERFLOW	"ERR increment or decrement would overflow"
+#define REDIS_KV_ERR_SYNTAX		"ERR syntax error"
+
+enum
+{
+	REDIS_KV_STRING,
+	REDIS_KV_HASH,
+};
+
+typedef std::multimap<int64_t, const std::string *> __RedisKVTimers;
+
+struct __RedisKVEntry
+{
+	int type;
+	bool expires;
+	std::string str;
+	std::unordered_map<std::string, std::string> hash;
+	__RedisKVTimers::iterator timer;
+
+	__RedisKVEntry() : type(REDIS_KV_STRING), expires(false) { }
+};
+
+typedef std::unordered_map<std::string, __RedisKVEntry> __RedisKVMap;
+
+struct __RedisKVShard
+{
+	std::mutex mutex;
+	__RedisKVMap map;
+	__RedisKVTimers timers;
+
+	__RedisKVMap::iterator lookup(const std::string& key, int64_t now);
+	__RedisKVMap::iterator create(const std::string& key, int type,
+								  int64_t now);
+	void erase(__RedisKVMap::iterator it);
+	void set_expire(__RedisKVMap::iterator it, int64_t when);
+	bool persist(__RedisKVMap::iterator it);
+	void clear();
+};
+
+/* Removes some of the expired keys, then looks up one. */
+__RedisKVMap::iterator __RedisKVShard::lookup(const std::string& key,
+											  int64_t now)
+{
+	__RedisKVMap::iterator it;
+	int i;
+
+	for (i = 0; i < REDIS_KV_EXPIRE_STEP; i++)
+	{
+		if (this->timers.empty() || this->timers.begin()->first > now)
+			break;
+
+		this->erase(this->map.find(*this->timers.begin()->second));
+	}
+
+	it = this->map.find(key);
+	if (it != this->map.end() && it->second.expires &&
+		it->second.timer->first <= now)
+	{
+		this->erase(it);
+		return this->map.end();
+	}
+
+	return it;
+}
+
+__RedisKVMap::iterator __RedisKVShard::create(const std::string& key,
+											  int type, int64_t now)
+{
+	__RedisKVMap::iterator it = this->lookup(key, now);
+
+	if (it == this->map.end())
+	{
+		it = this->map.emplace(key, __RedisKVEntry()).first;
+		it->second.type = type;
+	}
+
+	return it;
+}
+
+void __RedisKVShard::erase(__RedisKVMap::iterator it)
+{
+	this->persist(it);
+	this->map.erase(it);
+}
+
+void __RedisKVShard::set_expire(__RedisKVMap::iterator it, int64_t when)
+{
+	this->persist(it);
+	it->second.timer = this->timers.emplace(when, &it->first);
+	it->second.expires = true;
+}
+
+bool __RedisKVShard::persist(__RedisKVMap::iterator it)
+{
+	if (!it->second.expires)
+		return false;
+
+	this->timers.erase(it->second.timer);
+	it->second.expires = false;
+	return true;
+}
+
+void __RedisKVShard::clear()
+{
+	this->timers.clear();
+	this->map.clear();
+}
+
+class __RedisKVEngine
+{
+public:
+	__RedisKVEngine(size_t n);
+	~__RedisKVEngine() { delete []this->shards; }
+
+	void execute(const RedisValueView& cmd, RedisValue& reply);
+	size_t key_count();
+
+private:
+	typedef void (__RedisKVEngine::*handler_t)(const RedisValueView& cmd,
+											   RedisValue& reply,
+											   int64_t now);
+
+	struct Command
+	{
+		const char *name;
+		int arity;		/* -N for at least N */
+		handler_t handler;
+	};
+
+	static const Command command_table[];
+
+	__RedisKVShard& shard_of(const std::string& key);
+	void set_string(const std::string& key, const std::string& value,
+					int64_t when, int64_t now);
+	void incr_by(const RedisValueView& cmd, long long delta,
+				 RedisValue& reply, int64_t now);
+	void expire(const RedisValueView& cmd, int64_t scale,
+				RedisValue& reply, int64_t now);
+	void ttl(const RedisValueView& cmd, int64_t scale,
+			 RedisValue& reply, int64_t now);
+	void hash_list(const RedisValueView& cmd, bool keys, bool values,
+				   RedisValue& reply, int64_t now);
+
+	void cmd_ping(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_echo(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_select(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_dbsize(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_flushdb(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_empty(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_get(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_set(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_setex(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_setnx(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_getset(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_mget(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_mset(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_append(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_strlen(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_incr(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_decr(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_incrby(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_decrby(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_del(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_exists(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_type(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_expire(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_pexpire(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_ttl(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_pttl(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_persist(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hset(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hsetnx(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hget(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hmget(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hdel(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hlen(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hexists(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hgetall(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hkeys(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hvals(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+	void cmd_hincrby(const RedisValueView& cmd, RedisValue& reply, int64_t now);
+
+	__RedisKVShard *shards;
+	size_t nshards;
+	std::unordered_map<std::string, const Command *> commands;
+};
+
+const __RedisKVEngine::Command __RedisKVEngine::command_table[] =
+{
+	{ "PING",		-1,	&__RedisKVEngine::cmd_ping		},
+	{ "ECHO",		2,	&__RedisKVEngine::cmd_echo		},
+	{ "SELECT",		2,	&__RedisKVEngine::cmd_select	},
+	{ "DBSIZE",		1,	&__RedisKVEngine::cmd_dbsize	},
+	{ "FLUSHDB",	-1,	&__RedisKVEngine::cmd_flushdb	},
+	{ "FLUSHALL",	-1,	&__RedisKVEngine::cmd_flushdb	},
+	{ "CONFIG",		-2,	&__RedisKVEngine::cmd_empty		},
+	{ "COMMAND",	-1,	&__RedisKVEngine::cmd_empty		},
+	{ "GET",		2,	&__RedisKVEngine::cmd_get		},
+	{ "SET",		-3,	&__RedisKVEngine::cmd_set		},
+	{ "SETEX",		4,	&__RedisKVEngine::cmd_setex		},
+	{ "SETNX",		3,	&__RedisKVEngine::cmd_setnx		},
+	{ "GETSET",		3,	&__RedisKVEngine::cmd_getset	},
+	{ "MGET",		-2,	&__RedisKVEngine::cmd_mget		},
+	{ "MSET",		-3,	&__RedisKVEngine::cmd_mset		},
+	{ "APPEND",		3,	&__RedisKVEngine::cmd_append	},
+	{ "STRLEN",		2,	&__RedisKVEngine::cmd_strlen	},
+	{ "INCR",		2,	&__RedisKVEngine::cmd_incr		},
+	{ "DECR",		2,	&__RedisKVEngine::cmd_decr		},
+	{ "INCRBY",		3,	&__RedisKVEngine::cmd_incrby	},
+	{ "DECRBY",		3,	&__RedisKVEngine::cmd_decrby	},
+	{ "DEL",		-2,	&__RedisKVEngine::cmd_del		},
+	{ "EXISTS",		-2,	&__RedisKVEngine::cmd_exists	},
+	{ "TYPE",		2,	&__RedisKVEngine::cmd_type		},
+	{ "EXPIRE",		3,	&__RedisKVEngine::cmd_expire	},
+	{ "PEXPIRE",	3,	&__RedisKVEngine::cmd_pexpire	},
+	{ "TTL",		2,	&__RedisKVEngine::cmd_ttl		},
+	{ "PTTL",		2,	&__RedisKVEngine::cmd_pttl		},
+	{ "PERSIST",	2,	&__RedisKVEngine::cmd_persist	},
+	{ "HSET",		-4,	&__RedisKVEngine::cmd_hset		},
+	{ "HMSET",		-4,	&__RedisKVEngine::cmd_hset		},
+	{ "HSETNX",		4,	&__RedisKVEngine::cmd_hsetnx	},
+	{ "HGET",		3,	&__RedisKVEngine::cmd_hget		},
+	{ "HMGET",		-3,	&__RedisKVEngine::cmd_hmget		},
+	{ "HDEL",		-3,	&__RedisKVEngine::cmd_hdel		},
+	{ "HLEN",		2,	&__RedisKVEngine::cmd_hlen		},
+	{ "HEXISTS",	3,	&__RedisKVEngine::cmd_hexists	},
+	{ "HGETALL",	2,	&__RedisKVEngine::cmd_hgetall	},
+	{ "HKEYS",		2,	&__RedisKVEngine::cmd_hkeys		},
+	{ "HVALS",		2,	&__RedisKVEngine::cmd_hvals		},
+	{ "HINCRBY",	4,	&__RedisKVEngine::cmd_hincrby	},
+};
+
+static bool __str_integer(const char *str, size_t len, long long *num)
+{
+	char buf[32];
+	char *end;
+
+	if (!str || len == 0 || len >= sizeof buf)
+		return false;
+
+	if (!isdigit((unsigned char)str[0]) && str[0] != '-')
+		return false;
+
+	memcpy(buf, str, len);
+	buf[len] = '\0';
+	errno = 0;
+	*num = strtoll(buf, &end, 10);
+	return errno == 0 && *end == '\0';
+}
+
+static bool __arg_integer(const RedisValueView& arg, long long *num)
+{
+	return __str_integer(arg.string_data(), arg.string_size(), num);
+}
+
+static bool __add_overflow(long long a, long long b, long long *sum)
+{
+	if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b))
+		return true;
+
+	*sum = a + b;
+	return false;
+}
+
+__RedisKVEngine::__RedisKVEngine(size_t n)
+{
+	size_t i;
+
+	this->shards = new __RedisKVShard[n];
+	this->nshards = n;
+	for (i = 0; i < sizeof command_table / sizeof *command_table; i++)
+		this->commands.emplace(command_table[i].name, &command_table[i]);
+}
+
+__RedisKVShard& __RedisKVEngine::shard_of(const std::string& key)
+{
+	uint64_t h = std::hash<std::string>()(key);
+
+	/* Not the low bits, which also pick the bucket in the shard. */
+	return this->shards[(h * 0x9E3779B97F4A7C15ULL >> 32) % this->nshards];
+}
+
+void __RedisKVEngine::execute(const RedisValueView& cmd, RedisValue& reply)
+{
+	std::string name;
+	size_t n = cmd.arr_size();
+	size_t i;
+
+	if (n == 0 || !cmd[0].is_string())
+	{
+		reply.set_error("ERR Protocol error: expected a command");
+		return;
+	}
+
+	name = cmd[0].string_value();
+	for (i = 0; i < name.size(); i++)
+		name[i] = toupper((unsigned char)name[i]);
+
+	auto it = this->commands.find(name);
+	if (it == this->commands.end())
+	{
+		reply.set_error("ERR unknown command '" + cmd[0].string_value() + "'");
+		return;
+	}
+
+	int arity = it->second->arity;
+
+	if ((arity > 0 && n != (size_t)arity) || (arity < 0 && n < (size_t)-arity))
+	{
+		for (i = 0; i < name.size(); i++)
+			name[i] = tolower((unsigned char)name[i]);
+
+		reply.set_error("ERR wrong number of arguments for '" + name +
+						"' command");
+		return;
+	}
+
+	(this->*it->second->handler)(cmd, reply, GET_CURRENT_MS);
+}
+
+size_t __RedisKVEngine::key_count()
+{
+	size_t count = 0;
+	size_t i;
+
+	for (i = 0; i < this->nshards; i++)
+	{
+		std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+		count += this->shards[i].map.size();
+	}
+
+	return count;
+}
+
+void __RedisKVEngine::cmd_ping(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	if (cmd.arr_size() == 1)
+		reply.set_status("PONG");
+	else if (cmd.arr_size() == 2)
+		reply.set_string(cmd[1].string_value());
+	else
+		reply.set_error("ERR wrong number of arguments for 'ping' command");
+}
+
+void __RedisKVEngine::cmd_echo(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	reply.set_string(cmd[1].string_value());
+}
+
+void __RedisKVEngine::cmd_select(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	long long db;
+
+	if (!__arg_integer(cmd[1], &db))
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+	else if (db != 0)
+		reply.set_error("ERR DB index is out of range");
+	else
+		reply.set_status("OK");
+}
+
+void __RedisKVEngine::cmd_dbsize(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	reply.set_int(this->key_count());
+}
+
+void __RedisKVEngine::cmd_flushdb(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	size_t i;
+
+	for (i = 0; i < this->nshards; i++)
+	{
+		std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+		this->shards[i].clear();
+	}
+
+	reply.set_status("OK");
+}
+
+/* CONFIG and COMMAND, which clients may send on connecting. */
+void __RedisKVEngine::cmd_empty(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	reply.set_array(0);
+}
+
+void __RedisKVEngine::cmd_get(const RedisValueView& cmd, RedisValue& reply,
+							  int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		return;
+
+	if (it->second.type != REDIS_KV_STRING)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+		reply.set_string(it->second.str);
+}
+
+/* Any value is replaced, and the expiry too, with 'when' 0 for none. */
+void __RedisKVEngine::set_string(const std::string& key,
+								 const std::string& value,
+								 int64_t when, int64_t now)
+{
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.create(key, REDIS_KV_STRING, now);
+
+	it->second.type = REDIS_KV_STRING;
+	it->second.hash.clear();
+	it->second.str = value;
+	if (when != 0)
+		shard.set_expire(it, when);
+	else
+		shard.persist(it);
+}
+
+void __RedisKVEngine::cmd_set(const RedisValueView& cmd, RedisValue& reply,
+							  int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	std::string opt;
+	long long expire = 0;
+	bool nx = false;
+	bool xx = false;
+	size_t i;
+
+	for (i = 3; i < cmd.arr_size(); i++)
+	{
+		opt = cmd[i].string_value();
+		if (strcasecmp(opt.c_str(), "NX") == 0 && !xx)
+			nx = true;
+		else if (strcasecmp(opt.c_str(), "XX") == 0 && !nx)
+			xx = true;
+		else if ((strcasecmp(opt.c_str(), "EX") == 0 ||
+				  strcasecmp(opt.c_str(), "PX") == 0) &&
+				 expire == 0 && i + 1 < cmd.arr_size())
+		{
+			if (!__arg_integer(cmd[++i], &expire))
+			{
+				reply.set_error(REDIS_KV_ERR_INTEGER);
+				return;
+			}
+
+			if (expire <= 0 || expire > LLONG_MAX / 1000 - now)
+			{
+				reply.set_error("ERR invalid expire time in 'set' command");
+				return;
+			}
+
+			if (toupper((unsigned char)opt[0]) == 'E')
+				expire *= 1000;
+		}
+		else
+		{
+			reply.set_error(REDIS_KV_ERR_SYNTAX);
+			return;
+		}
+	}
+
+	if (nx || xx)
+	{
+		__RedisKVShard& shard = this->shard_of(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		bool exists = (shard.lookup(key, now) != shard.map.end());
+
+		if (nx == exists)
+			return;
+
+		auto it = shard.create(key, REDIS_KV_STRING, now);
+
+		it->second.type = REDIS_KV_STRING;
+		it->second.hash.clear();
+		it->second.str = cmd[2].string_value();
+		if (expire != 0)
+			shard.set_expire(it, now + expire);
+		else
+			shard.persist(it);
+	}
+	else
+		this->set_string(key, cmd[2].string_value(), expire ? now + expire : 0, now);
+
+	reply.set_status("OK");
+}
+
+void __RedisKVEngine::cmd_setex(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	long long expire;
+
+	if (!__arg_integer(cmd[2], &expire))
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+	else if (expire <= 0 || expire > LLONG_MAX / 1000 - now)
+		reply.set_error("ERR invalid expire time in 'setex' command");
+	else
+	{
+		this->set_string(cmd[1].string_value(), cmd[3].string_value(),
+						 now + expire * 1000, now);
+		reply.set_status("OK");
+	}
+}
+
+void __RedisKVEngine::cmd_setnx(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	if (shard.lookup(key, now) != shard.map.end())
+		reply.set_int(0);
+	else
+	{
+		shard.create(key, REDIS_KV_STRING, now)->second.str = cmd[2].string_value();
+		reply.set_int(1);
+	}
+}
+
+void __RedisKVEngine::cmd_getset(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		it = shard.create(key, REDIS_KV_STRING, now);
+	else if (it->second.type != REDIS_KV_STRING)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+	else
+		reply.set_string(it->second.str);
+
+	it->second.str = cmd[2].string_value();
+	shard.persist(it);
+}
+
+void __RedisKVEngine::cmd_mget(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	size_t n = cmd.arr_size() - 1;
+	size_t i;
+
+	reply.set_array(n);
+	for (i = 0; i < n; i++)
+	{
+		std::string key = cmd[i + 1].string_value();
+		__RedisKVShard& shard = this->shard_of(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.lookup(key, now);
+
+		if (it != shard.map.end() && it->second.type == REDIS_KV_STRING)
+			reply[i].set_string(it->second.str);
+	}
+}
+
+void __RedisKVEngine::cmd_mset(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	size_t i;
+
+	if (cmd.arr_size() % 2 == 0)
+	{
+		reply.set_error("ERR wrong number of arguments for 'mset' command");
+		return;
+	}
+
+	for (i = 1; i < cmd.arr_size(); i += 2)
+		this->set_string(cmd[i].string_value(), cmd[i + 1].string_value(), 0, now);
+
+	reply.set_status("OK");
+}
+
+void __RedisKVEngine::cmd_append(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.create(key, REDIS_KV_STRING, now);
+
+	if (it->second.type != REDIS_KV_STRING)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+	{
+		it->second.str.append(cmd[2].string_data(), cmd[2].string_size());
+		reply.set_int(it->second.str.size());
+	}
+}
+
+void __RedisKVEngine::cmd_strlen(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_int(0);
+	else if (it->second.type != REDIS_KV_STRING)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+		reply.set_int(it->second.str.size());
+}
+
+/* The expiry of the key is kept. */
+void __RedisKVEngine::incr_by(const RedisValueView& cmd, long long delta,
+							  RedisValue& reply, int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+	long long value = 0;
+
+	if (it != shard.map.end())
+	{
+		if (it->second.type != REDIS_KV_STRING)
+		{
+			reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+			return;
+		}
+
+		if (!__str_integer(it->second.str.c_str(), it->second.str.size(),
+						   &value))
+		{
+			reply.set_error(REDIS_KV_ERR_INTEGER);
+			return;
+		}
+	}
+
+	if (__add_overflow(value, delta, &value))
+	{
+		reply.set_error(REDIS_KV_ERR_OVERFLOW);
+		return;
+	}
+
+	if (it == shard.map.end())
+		it = shard.create(key, REDIS_KV_STRING, now);
+
+	it->second.str = std::to_string(value);
+	reply.set_int(value);
+}
+
+void __RedisKVEngine::cmd_incr(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	this->incr_by(cmd, 1, reply, now);
+}
+
+void __RedisKVEngine::cmd_decr(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	this->incr_by(cmd, -1, reply, now);
+}
+
+void __RedisKVEngine::cmd_incrby(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	long long delta;
+
+	if (!__arg_integer(cmd[2], &delta))
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+	else
+		this->incr_by(cmd, delta, reply, now);
+}
+
+void __RedisKVEngine::cmd_decrby(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	long long delta;
+
+	if (!__arg_integer(cmd[2], &delta) || delta == LLONG_MIN)
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+	else
+		this->incr_by(cmd, -delta, reply, now);
+}
+
+void __RedisKVEngine::cmd_del(const RedisValueView& cmd, RedisValue& reply,
+							  int64_t now)
+{
+	long long count = 0;
+	size_t i;
+
+	for (i = 1; i < cmd.arr_size(); i++)
+	{
+		std::string key = cmd[i].string_value();
+		__RedisKVShard& shard = this->shard_of(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.lookup(key, now);
+
+		if (it != shard.map.end())
+		{
+			shard.erase(it);
+			count++;
+		}
+	}
+
+	reply.set_int(count);
+}
+
+void __RedisKVEngine::cmd_exists(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	long long count = 0;
+	size_t i;
+
+	for (i = 1; i < cmd.arr_size(); i++)
+	{
+		std::string key = cmd[i].string_value();
+		__RedisKVShard& shard = this->shard_of(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if (shard.lookup(key, now) != shard.map.end())
+			count++;
+	}
+
+	reply.set_int(count);
+}
+
+void __RedisKVEngine::cmd_type(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_status("none");
+	else if (it->second.type == REDIS_KV_STRING)
+		reply.set_status("string");
+	else
+		reply.set_status("hash");
+}
+
+/* A time not in the future removes the key. */
+void __RedisKVEngine::expire(const RedisValueView& cmd, int64_t scale,
+							 RedisValue& reply, int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	long long expire;
+
+	if (!__arg_integer(cmd[2], &expire))
+	{
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+		return;
+	}
+
+	if (expire > (LLONG_MAX - now) / scale || expire < LLONG_MIN / scale)
+	{
+		reply.set_error("ERR invalid expire time");
+		return;
+	}
+
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_int(0);
+	else
+	{
+		if (expire > 0)
+			shard.set_expire(it, now + expire * scale);
+		else
+			shard.erase(it);
+
+		reply.set_int(1);
+	}
+}
+
+void __RedisKVEngine::cmd_expire(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	this->expire(cmd, 1000, reply, now);
+}
+
+void __RedisKVEngine::cmd_pexpire(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	this->expire(cmd, 1, reply, now);
+}
+
+void __RedisKVEngine::ttl(const RedisValueView& cmd, int64_t scale,
+						  RedisValue& reply, int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_int(-2);
+	else if (!it->second.expires)
+		reply.set_int(-1);
+	else
+		reply.set_int((it->second.timer->first - now + scale / 2) / scale);
+}
+
+void __RedisKVEngine::cmd_ttl(const RedisValueView& cmd, RedisValue& reply,
+							  int64_t now)
+{
+	this->ttl(cmd, 1000, reply, now);
+}
+
+void __RedisKVEngine::cmd_pttl(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	this->ttl(cmd, 1, reply, now);
+}
+
+void __RedisKVEngine::cmd_persist(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	reply.set_int(it != shard.map.end() && shard.persist(it));
+}
+
+void __RedisKVEngine::cmd_hset(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	long long count = 0;
+	size_t i;
+
+	if (cmd.arr_size() % 2 != 0)
+	{
+		reply.set_error("ERR wrong number of arguments for 'hset' command");
+		return;
+	}
+
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.create(key, REDIS_KV_HASH, now);
+
+	if (it->second.type != REDIS_KV_HASH)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+
+	for (i = 2; i < cmd.arr_size(); i += 2)
+	{
+		auto ret = it->second.hash.emplace(cmd[i].string_value(),
+										   cmd[i + 1].string_value());
+
+		if (ret.second)
+			count++;
+		else
+			ret.first->second = cmd[i + 1].string_value();
+	}
+
+	if (strcasecmp(cmd[0].string_value().c_str(), "HMSET") == 0)
+		reply.set_status("OK");
+	else
+		reply.set_int(count);
+}
+
+void __RedisKVEngine::cmd_hsetnx(const RedisValueView& cmd, RedisValue& reply,
+								 int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.create(key, REDIS_KV_HASH, now);
+
+	if (it->second.type != REDIS_KV_HASH)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+	{
+		auto ret = it->second.hash.emplace(cmd[2].string_value(),
+										   cmd[3].string_value());
+
+		reply.set_int(ret.second);
+	}
+}
+
+void __RedisKVEngine::cmd_hget(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		return;
+
+	if (it->second.type != REDIS_KV_HASH)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+
+	auto field = it->second.hash.find(cmd[2].string_value());
+
+	if (field != it->second.hash.end())
+		reply.set_string(field->second);
+}
+
+void __RedisKVEngine::cmd_hmget(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+	size_t i;
+
+	if (it != shard.map.end() && it->second.type != REDIS_KV_HASH)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+
+	reply.set_array(cmd.arr_size() - 2);
+	if (it == shard.map.end())
+		return;
+
+	for (i = 2; i < cmd.arr_size(); i++)
+	{
+		auto field = it->second.hash.find(cmd[i].string_value());
+
+		if (field != it->second.hash.end())
+			reply[i - 2].set_string(field->second);
+	}
+}
+
+void __RedisKVEngine::cmd_hdel(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+	long long count = 0;
+	size_t i;
+
+	if (it != shard.map.end())
+	{
+		if (it->second.type != REDIS_KV_HASH)
+		{
+			reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+			return;
+		}
+
+		for (i = 2; i < cmd.arr_size(); i++)
+			count += it->second.hash.erase(cmd[i].string_value());
+
+		if (it->second.hash.empty())
+			shard.erase(it);
+	}
+
+	reply.set_int(count);
+}
+
+void __RedisKVEngine::cmd_hlen(const RedisValueView& cmd, RedisValue& reply,
+							   int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_int(0);
+	else if (it->second.type != REDIS_KV_HASH)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+		reply.set_int(it->second.hash.size());
+}
+
+void __RedisKVEngine::cmd_hexists(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+
+	if (it == shard.map.end())
+		reply.set_int(0);
+	else if (it->second.type != REDIS_KV_HASH)
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+	else
+		reply.set_int(it->second.hash.count(cmd[2].string_value()));
+}
+
+void __RedisKVEngine::hash_list(const RedisValueView& cmd, bool keys,
+								bool values, RedisValue& reply, int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.lookup(key, now);
+	size_t i = 0;
+
+	if (it == shard.map.end())
+	{
+		reply.set_array(0);
+		return;
+	}
+
+	if (it->second.type != REDIS_KV_HASH)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+
+	reply.set_array(it->second.hash.size() * (keys + values));
+	for (const auto& field : it->second.hash)
+	{
+		if (keys)
+			reply[i++].set_string(field.first);
+
+		if (values)
+			reply[i++].set_string(field.second);
+	}
+}
+
+void __RedisKVEngine::cmd_hgetall(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	this->hash_list(cmd, true, true, reply, now);
+}
+
+void __RedisKVEngine::cmd_hkeys(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	this->hash_list(cmd, true, false, reply, now);
+}
+
+void __RedisKVEngine::cmd_hvals(const RedisValueView& cmd, RedisValue& reply,
+								int64_t now)
+{
+	this->hash_list(cmd, false, true, reply, now);
+}
+
+void __RedisKVEngine::cmd_hincrby(const RedisValueView& cmd, RedisValue& reply,
+								  int64_t now)
+{
+	std::string key = cmd[1].string_value();
+	long long delta;
+	long long value = 0;
+
+	if (!__arg_integer(cmd[3], &delta))
+	{
+		reply.set_error(REDIS_KV_ERR_INTEGER);
+		return;
+	}
+
+	__RedisKVShard& shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.create(key, REDIS_KV_HASH, now);
+
+	if (it->second.type != REDIS_KV_HASH)
+	{
+		reply.set_error(REDIS_KV_ERR_WRONGTYPE);
+		return;
+	}
+
+	std::string& field = it->second.hash[cmd[2].string_value()];
+
+	if (!field.empty())
+	{
+		if (!__str_integer(field.c_str(), field.size(), &value))
+		{
+			reply.set_error("ERR hash value is not an integer");
+			return;
+		}
+	}
+
+	if (__add_overflow(value, delta, &value))
+	{
+		reply.set_error(REDIS_KV_ERR_OVERFLOW);
+		return;
+	}
+
+	field = std::to_string(value);
+	reply.set_int(value);
+}
+
+WFRedisKVServer::WFRedisKVServer(const struct WFServerParams *params,
+								 size_t shards) :
+	WFRedisServer(params, std::bind(&WFRedisKVServer::process_pipeline, this,
+									std::placeholders::_1))
+{
+	if (shards == 0)
+		shards = WFGlobal::get_global_settings()->handler_threads;
+
+	this->engine = new __RedisKVEngine(shards > 0 ? shards : 1);
+}
+
+WFRedisKVServer::~WFRedisKVServer()
+{
+	delete this->engine;
+}
+
+void WFRedisKVServer::execute(const RedisValueView& command, RedisValue& reply)
+{
+	this->engine->execute(command, reply);
+}
+
+size_t WFRedisKVServer::get_key_count() const
+{
+	return this->engine->key_count();
+}
+
+CommSession *WFRedisKVServer::new_session(long long seq, CommConnection *conn)
+{
+	CommSession *session = this->WFRedisServer::new_session(seq, conn);
+
+	static_cast<WFRedisTask *>(session)->get_req()->accept_pipeline();
+	return session;
+}
+
+void WFRedisKVServer::process_pipeline(WFRedisTask *task)
+{
+	RedisRequest *req = task->get_req();
+	RedisResponse *resp = task->get_resp();
+	RedisValueView request;
+	RedisValue result;
+	size_t i;
+
+	req->get_request(request);
+	if (req->pipeline_size() == 0)
+	{
+		this->engine->execute(request, result);
+		resp->set_result(std::move(result));
+		return;
+	}
+
+	result.set_array(request.arr_size());
+	for (i = 0; i < request.arr_size(); i++)
+		this->engine->execute(request[i], result[i]);
+
+	resp->set_pipeline_result(std::move(result));
+}
+
@@ -23,16 +23,20 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <openssl/ssl.h>
 #include "CommScheduler.h"
+#include "Workflow.h"
 #include "WFConnection.h"
 #include "WFGlobal.h"
 #include "WFServer.h"
 
 #define PORT_STR_MAX	5
 
+#define GET_CURRENT_MICRO	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
 class WFServerConnection : public WFConnection
 {
 public:
@@ -50,6 +54,46 @@ private:
 	std::atomic<size_t> *conn_count;
 };
 
+/* Put before the server task, as the last task of the series. A series
+ * that is canceled deletes it without dispatching. */
+class WFServerLimitGate : public SubTask
+{
+public:
+	WFServerLimitGate(WFConcurrencyLimiter *limiter, SubTask *next)
+	{
+		this->limiter = limiter;
+		this->next = next;
+		this->start_time = GET_CURRENT_MICRO;
+	}
+
+	virtual ~WFServerLimitGate()
+	{
+		if (this->limiter)
+			this->limiter->release(GET_CURRENT_MICRO - this->start_time, true);
+	}
+
+private:
+	virtual void dispatch()
+	{
+		this->limiter->release(GET_CURRENT_MICRO - this->start_time, false);
+		this->limiter = NULL;
+		this->subtask_done();
+	}
+
+	virtual SubTask *done()
+	{
+		SubTask *next = this->next;
+
+		delete this;
+		return next;
+	}
+
+private:
+	WFConcurrencyLimiter *limiter;
+	SubTask *next;
+	long long start_time;
+};
+
 long WFServerBase::ssl_ctx_callback(SSL *ssl, int *al, void *arg)
 {
 	WFServerBase *server = (WFServerBase *)arg;
@@ -156,6 +200,19 @@ void WFServerBase::delete_connection(WFConnection *conn)
 	delete (WFServerConnection *)conn;
 }
 
+bool WFServerBase::limiter_acquire(SeriesWork *series, int priority)
+{
+	SubTask *last;
+
+	if (!this->limiter.try_acquire(priority))
+		return false;
+
+	/* The server task is the last, and the only task in the series yet. */
+	last = series->pop();
+	series->set_last_task(new WFServerLimitGate(&this->limiter, last));
+	return true;
+}
+
 void WFServerBase::handle_unbound()
 {
 	this->mutex.lock();
@@ -29,6 +29,7 @@
 #include <condition_variable>
 #include <openssl/ssl.h>
 #include "WFTaskFactory.h"
+#include "WFConcurrencyLimiter.h"
 
 struct WFServerParams
 {
@@ -145,6 +146,11 @@ public:
 public:
 	size_t get_conn_count() const { return this->conn_count; }
 
+	const WFConcurrencyLimiter& get_concurrency_limiter() const
+	{
+		return this->limiter;
+	}
+
 	/* Get the listening address. This is often used after starting
 	 * server on a random port (start() with port == 0). */
 	int get_listen_addr(struct sockaddr *addr, socklen_t *addrlen) const
@@ -172,6 +178,11 @@ protected:
 	virtual WFConnection *new_connection(int accept_fd);
 	void delete_connection(WFConnection *conn);
 
+protected:
+	/* Returns false if the request is to be rejected. Otherwise it is counted
+	 * in flight until its series reaches the reply. */
+	bool limiter_acquire(SeriesWork *series, int priority);
+
 private:
 	int init(const struct sockaddr *bind_addr, socklen_t addrlen,
 			 const char *cert_file, const char *key_file);
@@ -182,6 +193,7 @@ private:
 
 protected:
 	std::atomic<size_t> conn_count;
+	WFConcurrencyLimiter limiter;
 
 private:
 	int listen_fd;
@@ -210,13 +222,54 @@ public:
 	{
 	}
 
+public:
+	/* Limits the requests in process. Call before start(). A request over
+	 * the limit goes to 'reject' instead, to set the response, or if it is
+	 * nullptr, is not replied. 'classify' gives the priority class of a
+	 * request, 0 for all if nullptr. */
+	void set_concurrency_limit(const struct WFConcurrencyLimitParams *params,
+			std::function<void (WFNetworkTask<REQ, RESP> *)> reject,
+			std::function<int (WFNetworkTask<REQ, RESP> *)> classify = nullptr);
+
 protected:
 	virtual CommSession *new_session(long long seq, CommConnection *conn);
 
 protected:
 	std::function<void (WFNetworkTask<REQ, RESP> *)> process;
+
+private:
+	std::function<void (WFNetworkTask<REQ, RESP> *)> reject;
+	std::function<int (WFNetworkTask<REQ, RESP> *)> classify;
 };
 
+template<class REQ, class RESP>
+void WFServer<REQ, RESP>::set_concurrency_limit(
+			const struct WFConcurrencyLimitParams *params,
+			std::function<void (WFNetworkTask<REQ, RESP> *)> reject,
+			std::function<int (WFNetworkTask<REQ, RESP> *)> classify)
+{
+	this->reject = std::move(reject);
+	this->classify = std::move(classify);
+	if (!this->limiter.is_enabled())
+	{
+		std::function<void (WFNetworkTask<REQ, RESP> *)> proc;
+
+		proc = std::move(this->process);
+		this->process = [this, proc](WFNetworkTask<REQ, RESP> *task) {
+			int priority = this->classify ? this->classify(task) : 0;
+
+			if (this->limiter_acquire(series_of(task), priority))
+				proc(task);
+			else if (this->reject)
+				this->reject(task);
+			else
+				task->noreply();
+		};
+	}
+
+	this->limiter.init(params);
+}
+
 template<class REQ, class RESP>
 CommSession *WFServer<REQ, RESP>::new_session(long long seq, CommConnection *conn)
 {
@@ -16,11 +16,19 @@
   Author: Wu Jiaxu (wujiaxu@sogou-inc.com)
 */
 
+#include <stdint.h>
+#include <stdio.h>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 #include "workflow/WFAlgoTaskFactory.h"
+#include "workflow/WFFacilities.h"
 
 static void __arr_init(int *arr, int n)
 {
@@ -95,3 +103,284 @@ TEST(algo_unittest, parallel_sort)
 	delete []arr;
 }
 
+/* Sorts a copy with the task, and checks it against std::sort. */
+template<typename T, class CMP = std::less<T>>
+static void __sort_check(std::vector<T> arr,
+						 std::function<WFSortTask<T> *(T *, T *,
+													   sort_callback_t<T>)> create,
+						 CMP cmp = CMP())
+{
+	std::vector<T> sorted = arr;
+	WFFacilities::WaitGroup wait_group(1);
+	WFSortTask<T> *task;
+
+	std::sort(sorted.begin(), sorted.end(), cmp);
+	task = create(arr.data(), arr.data() + arr.size(),
+				  [&wait_group](WFSortTask<T> *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		wait_group.done();
+	});
+	task->start();
+	wait_group.wait();
+	EXPECT_TRUE(arr == sorted);
+}
+
+TEST(algo_unittest, parallel_sort_cmp)
+{
+	std::mt19937 gen(1);
+	std::vector<int> ints(300000);
+	std::vector<std::string> strs(100000);
+
+	for (int& x : ints)
+		x = gen() % 1000;
+
+	__sort_check<int, std::greater<int>>(ints,
+		[](int *first, int *last, sort_callback_t<int> cb) {
+			return WFAlgoTaskFactory::create_psort_task("psort", first, last,
+														std::greater<int>(),
+														std::move(cb));
+		});
+
+	for (std::string& str : strs)
+		str = "string" + std::to_string(gen());
+
+	__sort_check<std::string>(strs,
+		[](std::string *first, std::string *last,
+		   sort_callback_t<std::string> cb) {
+			return WFAlgoTaskFactory::create_psort_task("psort", first, last,
+														std::move(cb));
+		});
+
+	/* Skewed: 90% of one value, which gets buckets of its own. */
+	for (int& x : ints)
+		x = gen() % 10 == 0 ? (int)(gen() % 1000000) : 500000;
+
+	__sort_check<int, std::greater<int>>(ints,
+		[](int *first, int *last, sort_callback_t<int> cb) {
+			return WFAlgoTaskFactory::create_psort_task("psort", first, last,
+														std::greater<int>(),
+														std::move(cb));
+		});
+
+	for (std::string& str : strs)
+		str = gen() % 10 == 0 ? "string" + std::to_string(gen()) : "same";
+
+	__sort_check<std::string>(strs,
+		[](std::string *first, std::string *last,
+		   sort_callback_t<std::string> cb) {
+			return WFAlgoTaskFactory::create_psort_task("psort", first, last,
+														std::move(cb));
+		});
+}
+
+template<typename T>
+static WFSortTask<T> *__create_radix(T *first, T *last, sort_callback_t<T> cb)
+{
+	return WFAlgoTaskFactory::create_radix_sort_task("rsort", first, last,
+													 std::move(cb));
+}
+
+TEST(algo_unittest, radix_sort)
+{
+	std::mt19937_64 gen(1);
+	std::vector<int> ints(200000);
+	std::vector<uint64_t> u64s(200000);
+	std::vector<double> doubles(200000);
+	std::vector<short> shorts(1000);
+
+	for (int& x : ints)
+		x = (int)gen();
+
+	__sort_check<int>(ints, __create_radix<int>);
+
+	/* Only the low digits differ. */
+	for (int& x : ints)
+		x = (int)(gen() % 1000) - 500;
+
+	__sort_check<int>(ints, __create_radix<int>);
+
+	for (uint64_t& x : u64s)
+		x = gen();
+
+	__sort_check<uint64_t>(u64s, __create_radix<uint64_t>);
+
+	for (double& x : doubles)
+		x = ((double)gen() / UINT64_MAX - 0.5) * 1e6;
+
+	doubles[0] = -0.0;
+	doubles[1] = 0.0;
+	__sort_check<double>(doubles, __create_radix<double>);
+
+	for (short& x : shorts)
+		x = (short)gen();
+
+	__sort_check<short>(shorts, __create_radix<short>);
+
+	/* All the same, no pass at all. */
+	std::fill(ints.begin(), ints.end(), 7);
+	__sort_check<int>(ints, __create_radix<int>);
+}
+
+template<typename KEY, typename VAL>
+static algorithm::ReduceOutput<KEY, VAL>
+__reduce(bool parallel, algorithm::ReduceInput<KEY, VAL> input,
+		 algorithm::reduce_function_t<KEY, VAL> reduce)
+{
+	algorithm::ReduceOutput<KEY, VAL> output;
+	WFFacilities::WaitGroup wait_group(1);
+	auto callback = [&wait_group, &output](WFReduceTask<KEY, VAL> *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		output = std::move(*task->get_output());
+		wait_group.done();
+	};
+	WFReduceTask<KEY, VAL> *task;
+
+	if (parallel)
+		task = WFAlgoTaskFactory::create_preduce_task("preduce", std::move(input),
+													  std::move(reduce),
+													  std::move(callback));
+	else
+		task = WFAlgoTaskFactory::create_reduce_task("reduce", std::move(input),
+													 std::move(reduce),
+													 std::move(callback));
+
+	task->start();
+	wait_group.wait();
+	return output;
+}
+
+static void __count_words(const std::string *key,
+						  algorithm::ReduceIterator<size_t> *iter,
+						  size_t *res)
+{
+	const size_t *count;
+
+	*res = 0;
+	while ((count = iter->next()) != NULL)
+		*res += *count;
+}
+
+/* Sorted vectors, two at a time, as tutorial-20. */
+static void __merge_vectors(const int *key,
+							algorithm::ReduceIterator<std::vector<int>> *iter,
+							std::vector<int> *res)
+{
+	const std::vector<int> *v1 = iter->next();
+	const std::vector<int> *v2 = iter->next();
+
+	res->resize(v1->size() + v2->size());
+	std::merge(v1->begin(), v1->end(), v2->begin(), v2->end(), res->begin());
+}
+
+TEST(algo_unittest, parallel_reduce)
+{
+	std::mt19937 gen(1);
+	algorithm::ReduceInput<std::string, size_t> words;
+	algorithm::ReduceInput<int, std::vector<int>> arrays;
+
+	for (int i = 0; i < 300000; i++)
+		words.emplace_back("word" + std::to_string(gen() % 5000), 1);
+
+	auto word_counts = __reduce<std::string, size_t>(false, words, __count_words);
+	auto par_counts = __reduce<std::string, size_t>(true, words, __count_words);
+	EXPECT_EQ(word_counts.size(), 5000);
+	EXPECT_TRUE(par_counts == word_counts);
+
+	for (int i = 0; i < 100000; i++)
+		arrays.emplace_back(i % 1000, std::vector<int>(1, (int)(gen() % 65536)));
+
+	auto merged = __reduce<int, std::vector<int>>(true, arrays, __merge_vectors);
+	ASSERT_EQ(merged.size(), 1000);
+	for (int i = 0; i < 1000; i++)
+	{
+		EXPECT_EQ(merged[i].first, i);
+		EXPECT_EQ(merged[i].second.size(), 100);
+		EXPECT_TRUE(std::is_sorted(merged[i].second.begin(),
+								   merged[i].second.end()));
+	}
+
+	auto serial_merged = __reduce<int, std::vector<int>>(false, arrays,
+														 __merge_vectors);
+	EXPECT_TRUE(serial_merged == merged);
+
+	/* Small input is reduced in one go. */
+	words.resize(1000);
+	word_counts = __reduce<std::string, size_t>(false, words, __count_words);
+	par_counts = __reduce<std::string, size_t>(true, words, __count_words);
+	EXPECT_TRUE(par_counts == word_counts);
+}
+
+TEST(algo_unittest, hash_reducer)
+{
+	algorithm::HashReducer<int, std::vector<int>> reducer;
+	algorithm::ReduceOutput<int, std::vector<int>> output;
+	size_t max_size = 0;
+	auto reduce = [&max_size](const int *key,
+							  algorithm::ReduceIterator<std::vector<int>> *iter,
+							  std::vector<int> *res) {
+		max_size = std::max(max_size, iter->size());
+		__merge_vectors(key, iter, res);
+	};
+
+	/* Reused after start(), with more values of a key than a heap takes. */
+	for (int round = 0; round < 2; round++)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			reducer.insert(i % 2, std::vector<int>(1, i),
+						   std::hash<int>()(i % 2));
+		}
+
+		output.clear();
+		reducer.start(reduce, &output);
+		ASSERT_EQ(output.size(), 2);
+		for (int i = 0; i < 2; i++)
+		{
+			EXPECT_EQ(output[i].first, i);
+			EXPECT_EQ(output[i].second.size(), 500);
+			EXPECT_TRUE(std::is_sorted(output[i].second.begin(),
+									   output[i].second.end()));
+		}
+	}
+
+	EXPECT_LE(max_size, 256);
+}
+
+/* Run with --gtest_also_run_disabled_tests. */
+TEST(algo_unittest, DISABLED_sort_benchmark)
+{
+	static constexpr size_t n = 100 * 1000 * 1000;
+	std::mt19937 gen(1);
+	std::vector<int> input(n);
+	std::vector<int> arr;
+
+	for (int& x : input)
+		x = (int)gen();
+
+	auto run = [&arr, &input](const char *name,
+							  std::function<WFSortTask<int> *(int *, int *,
+												sort_callback_t<int>)> create) {
+		WFFacilities::WaitGroup wait_group(1);
+		arr = input;
+		auto start = std::chrono::steady_clock::now();
+
+		create(arr.data(), arr.data() + n,
+			   [&wait_group](WFSortTask<int> *task) { wait_group.done(); })->start();
+		wait_group.wait();
+
+		std::chrono::duration<double, std::milli> ms =
+			std::chrono::steady_clock::now() - start;
+		printf("%-8s %zu ints %8.0f ms\n", name, n, ms.count());
+		EXPECT_TRUE(std::is_sorted(arr.begin(), arr.end()));
+	};
+
+	run("sort", [](int *first, int *last, sort_callback_t<int> cb) {
+		return WFAlgoTaskFactory::create_sort_task("sort", first, last,
+												   std::move(cb));
+	});
+	run("psort", [](int *first, int *last, sort_callback_t<int> cb) {
+		return WFAlgoTaskFactory::create_psort_task("psort", first, last,
+													std::move(cb));
+	});
+	run("radix", __create_radix<int>);
+}
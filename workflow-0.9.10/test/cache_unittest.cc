@@ -0,0 +1,225 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "workflow/HashLRUCache.h"
+
+static std::atomic<int> deleted(0);
+
+struct CountDeleter
+{
+	void operator() (const std::string& value) const { deleted++; }
+};
+
+using Cache = HashLRUCache<int, std::string, CountDeleter>;
+using Sharded = ShardedLRUCache<std::string, std::string, CountDeleter>;
+
+TEST(cache_unittest, get_put_del)
+{
+	Cache cache;
+	const Cache::Handle *handle;
+
+	deleted = 0;
+	EXPECT_TRUE(cache.get(1) == NULL);
+	for (int i = 0; i < 1000; i++)
+		cache.release(cache.put(i, std::to_string(i)));
+
+	EXPECT_EQ(cache.get_size(), 1000U);
+	for (int i = 0; i < 1000; i++)
+	{
+		handle = cache.get(i);
+		ASSERT_TRUE(handle != NULL);
+		EXPECT_EQ(handle->value, std::to_string(i));
+		cache.release(handle);
+	}
+
+	/* A replaced value lives until its handle is released. */
+	handle = cache.get(7);
+	cache.release(cache.put(7, "seven"));
+	EXPECT_EQ(handle->value, "7");
+	EXPECT_EQ(deleted, 0);
+	cache.release(handle);
+	EXPECT_EQ(deleted, 1);
+
+	handle = cache.get(7);
+	EXPECT_EQ(handle->value, "seven");
+	cache.del(7);
+	EXPECT_TRUE(cache.get(7) == NULL);
+	EXPECT_EQ(handle->value, "seven");
+	cache.release(handle);
+	EXPECT_EQ(deleted, 2);
+	EXPECT_EQ(cache.get_size(), 999U);
+
+	cache.prune();
+	EXPECT_EQ(cache.get_size(), 0U);
+	EXPECT_EQ(deleted, 1001);
+}
+
+TEST(cache_unittest, lru)
+{
+	Cache cache(CACHE_POLICY_LRU);
+	const Cache::Handle *handle;
+
+	cache.set_max_size(3);
+	for (int i = 0; i < 3; i++)
+		cache.release(cache.put(i, std::to_string(i)));
+
+	cache.release(cache.get(0));
+	handle = cache.get(1);
+	cache.release(cache.put(3, "3"));
+
+	/* 2 is the least recently used, and 1 is in use. */
+	EXPECT_TRUE(cache.get(2) == NULL);
+	cache.release(cache.put(4, "4"));
+	EXPECT_TRUE(cache.get(0) == NULL);
+	EXPECT_EQ(cache.get_size(), 3U);
+	EXPECT_EQ(handle->value, "1");
+	cache.release(handle);
+}
+
+TEST(cache_unittest, clock)
+{
+	Cache cache(CACHE_POLICY_CLOCK);
+	const Cache::Handle *handle;
+
+	cache.set_max_size(3);
+	for (int i = 0; i < 3; i++)
+		cache.release(cache.put(i, std::to_string(i)));
+
+	/* 0 gets a second chance, 1 does not. */
+	cache.release(cache.get(0));
+	cache.release(cache.put(3, "3"));
+	handle = cache.get(0);
+	ASSERT_TRUE(handle != NULL);
+	cache.release(handle);
+	EXPECT_TRUE(cache.get(1) == NULL);
+	EXPECT_EQ(cache.get_size(), 3U);
+}
+
+TEST(cache_unittest, memory)
+{
+	Cache cache;
+	size_t handle_size = cache.get_memory();
+
+	cache.release(cache.put(0, "x", 0));
+	handle_size = cache.get_memory() - handle_size;
+	cache.prune();
+
+	cache.set_max_memory(10 * (handle_size + 1000));
+	for (int i = 0; i < 100; i++)
+		cache.release(cache.put(i, std::string(1000, 'x'), 1000));
+
+	EXPECT_EQ(cache.get_size(), 10U);
+	EXPECT_LE(cache.get_memory(), 10 * (handle_size + 1000));
+	EXPECT_TRUE(cache.get(89) == NULL);
+	cache.release(cache.get(90));
+
+	/* One big value pushes many small ones out. */
+	cache.release(cache.put(1000, std::string(5000, 'x'), 5000));
+	EXPECT_EQ(cache.get_size(), 6U);
+}
+
+struct PtrDeleter
+{
+	void operator() (const std::unique_ptr<int>& value) const { }
+};
+
+TEST(cache_unittest, move_value)
+{
+	HashLRUCache<int, std::unique_ptr<int>, PtrDeleter> cache;
+	ShardedLRUCache<int, std::unique_ptr<int>, PtrDeleter> sharded;
+	std::unique_ptr<int> value(new int(1));
+	int *p = value.get();
+
+	/* A value that cannot be copied is moved into the cache. */
+	auto *handle = cache.put(1, std::move(value));
+	EXPECT_EQ(handle->value.get(), p);
+	cache.release(handle);
+
+	auto *sharded_handle = sharded.put(1, std::unique_ptr<int>(new int(2)));
+	EXPECT_EQ(*sharded_handle->value, 2);
+	sharded.release(sharded_handle);
+}
+
+TEST(cache_unittest, sharded)
+{
+	Sharded cache(8, CACHE_POLICY_CLOCK);
+	std::vector<std::thread> threads;
+	std::atomic<int> mismatches(0);
+	const Sharded::Handle *handle;
+	std::string value;
+
+	cache.set_max_size(800);
+
+	/* Far below the limit of any shard, so all of them stay. */
+	for (int i = 0; i < 50; i++)
+	{
+		value = std::to_string(i);
+		cache.release(cache.put(std::to_string(i), std::move(value)));
+	}
+
+	for (int i = 0; i < 50; i++)
+	{
+		handle = cache.get(std::to_string(i));
+		ASSERT_TRUE(handle != NULL);
+		EXPECT_EQ(handle->value, std::to_string(i));
+		cache.release(handle);
+	}
+
+	/* Only consistency under contention, as hits depend on scheduling. */
+	for (int i = 0; i < 4; i++)
+	{
+		threads.emplace_back([&cache, &mismatches, i]() {
+			for (int j = 0; j < 20000; j++)
+			{
+				std::string key = std::to_string((i * 7 + j) % 1000);
+				auto *handle = cache.get(key);
+
+				if (handle)
+				{
+					if (handle->value != key)
+						mismatches++;
+
+					cache.release(handle);
+				}
+				else
+					cache.release(cache.put(key, key));
+
+				if (j % 100 == 0)
+					cache.del(key);
+			}
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	EXPECT_EQ(mismatches, 0);
+	for (int i = 0; i < 1000; i++)
+	{
+		handle = cache.get(std::to_string(i));
+		if (handle)
+		{
+			EXPECT_EQ(handle->value, std::to_string(i));
+			cache.release(handle);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <pthread.h>
+#include <string>
+#include <gtest/gtest.h>
+#include "workflow/WFCoroutine.h"
+#include "workflow/WFTaskFactory.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/WFHttpServer.h"
+#include "workflow/HttpUtil.h"
+
+static WFCoroutine __timer_and_go(int *result, WFFacilities::WaitGroup *wg)
+{
+	pthread_t tid = pthread_self();
+	int n = 0;
+
+	auto *timer = co_await WFCoroutine::await(
+		WFTaskFactory::create_timer_task(1000, nullptr));
+	EXPECT_EQ(timer->get_state(), WFT_STATE_SUCCESS);
+	EXPECT_TRUE(pthread_equal(tid, pthread_self()) == 0);
+
+	for (int i = 0; i < 10; i++)
+	{
+		auto *go = co_await WFCoroutine::await(
+			WFTaskFactory::create_go_task("coroutine", [&n]() { n++; }));
+		EXPECT_EQ(go->get_state(), WFT_STATE_SUCCESS);
+	}
+
+	*result = n;
+	wg->done();
+}
+
+TEST(coroutine_unittest, timer_and_go)
+{
+	WFFacilities::WaitGroup wg(1);
+	int result = 0;
+
+	__timer_and_go(&result, &wg);
+	wg.wait();
+	EXPECT_EQ(result, 10);
+}
+
+static WFCoroutine __parallel(int *result, WFFacilities::WaitGroup *wg)
+{
+	ParallelWork *pwork = Workflow::create_parallel_work(nullptr);
+	int values[4] = { };
+
+	for (int i = 0; i < 4; i++)
+	{
+		int *value = &values[i];
+		auto *go = WFTaskFactory::create_go_task("coroutine",
+												 [value, i]() { *value = i + 1; });
+		pwork->add_series(Workflow::create_series_work(go, nullptr));
+	}
+
+	auto *done = co_await WFCoroutine::await(pwork);
+	EXPECT_EQ(done->size(), 4U);
+	*result = values[0] + values[1] + values[2] + values[3];
+	wg->done();
+}
+
+TEST(coroutine_unittest, parallel)
+{
+	WFFacilities::WaitGroup wg(1);
+	int result = 0;
+
+	__parallel(&result, &wg);
+	wg.wait();
+	EXPECT_EQ(result, 10);
+}
+
+/* The response is sent only after the coroutine returns. */
+static WFCoroutine __http_process(WFHttpTask *server_task)
+{
+	co_await WFCoroutine::join(series_of(server_task));
+	co_await WFCoroutine::await(WFTaskFactory::create_timer_task(10000, nullptr));
+	server_task->get_resp()->append_output_body("coroutine");
+}
+
+static WFCoroutine __http_request(std::string *body, WFFacilities::WaitGroup *wg)
+{
+	auto *task = co_await WFCoroutine::await(
+		WFTaskFactory::create_http_task("http://127.0.0.1:8833/", 0, 0, nullptr));
+
+	EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+	if (task->get_state() == WFT_STATE_SUCCESS)
+		*body = protocol::HttpUtil::decode_chunked_body(task->get_resp());
+
+	wg->done();
+}
+
+TEST(coroutine_unittest, http)
+{
+	WFHttpServer server(__http_process);
+	WFFacilities::WaitGroup wg(1);
+	std::string body;
+
+	ASSERT_EQ(server.start("127.0.0.1", 8833), 0);
+	__http_request(&body, &wg);
+	wg.wait();
+	EXPECT_EQ(body, "coroutine");
+	server.stop();
+}
+
@@ -16,10 +16,15 @@
   Author: Liu Kai (liukaidx@sogou-inc.com)
 */
 
+#include <netdb.h>
+#include <atomic>
 #include <future>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFDnsClient.h"
+#include "workflow/DnsCache.h"
 
 #define RETRY_MAX	3
 
@@ -120,6 +125,156 @@ TEST(dns_unittest, WFDnsClient)
 	fut.get();
 }
 
+static struct addrinfo *__numeric_addrinfo(const char *ip)
+{
+	struct addrinfo hints = { };
+	struct addrinfo *ai;
+
+	hints.ai_flags = AI_NUMERICHOST | AI_PASSIVE;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(ip, "80", &hints, &ai) != 0)
+		return NULL;
+
+	return ai;
+}
+
+TEST(dns_unittest, DnsCache)
+{
+	DnsCache cache;
+	const DnsCache::DnsHandle *handle;
+	const DnsCache::DnsHandle *old;
+
+	EXPECT_TRUE(cache.get_ttl("a.test", 80) == NULL);
+
+	/* Expired at once: the first lookup misses and extends the ttl, so
+	 * the next ones use the stale entry while it is refreshed. */
+	cache.release(cache.put("a.test", 80, __numeric_addrinfo("127.0.0.1"), 0, 0));
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	EXPECT_TRUE(cache.get_ttl("a.test", 80) == NULL);
+	handle = cache.get_ttl("a.test", 80);
+	ASSERT_TRUE(handle != NULL);
+	old = handle;
+
+	/* A replaced entry stays valid until released. */
+	cache.release(cache.put("a.test", 80, __numeric_addrinfo("127.0.0.2"), 60, 60));
+	handle = cache.get_confident("a.test", 80);
+	ASSERT_TRUE(handle != NULL);
+	EXPECT_NE(handle, old);
+	EXPECT_EQ(old->value.addrinfo->ai_family, AF_INET);
+	cache.release(old);
+	cache.release(handle);
+
+	EXPECT_TRUE(cache.get("a.test", 81) == NULL);
+	cache.del("a.test", 80);
+	EXPECT_TRUE(cache.get("a.test", 80) == NULL);
+}
+
+TEST(dns_unittest, DnsCacheConcurrent)
+{
+	DnsCache cache;
+	std::vector<std::thread> readers;
+	std::atomic<bool> stop(false);
+	std::atomic<int> found(0);
+	std::atomic<int> bad(0);
+
+	cache.release(cache.put("b.test", 80, __numeric_addrinfo("127.0.0.1"), 60, 60));
+	for (int i = 0; i < 4; i++)
+	{
+		readers.emplace_back([&cache, &stop, &found, &bad]() {
+			while (!stop)
+			{
+				auto *handle = cache.get_ttl("b.test", 80);
+
+				if (handle)
+				{
+					if (handle->value.addrinfo->ai_family != AF_INET)
+						bad++;
+
+					found++;
+
+					cache.release(handle);
+				}
+			}
+		});
+	}
+
+	while (found == 0)
+		std::this_thread::yield();
+
+	for (int i = 0; i < 1000; i++)
+	{
+		if (i % 10 == 9)
+			cache.del("b.test", 80);
+		else
+			cache.release(cache.put("b.test", 80, __numeric_addrinfo("127.0.0.1"), 60, 60));
+	}
+
+	stop = true;
+	for (auto& t : readers)
+		t.join();
+
+	EXPECT_EQ(bad, 0);
+}
+
+/* Tables double as hosts are added, while readers keep finding an entry
+ * that is there all along. */
+TEST(dns_unittest, DnsCacheGrow)
+{
+	static constexpr int n = 20000;
+	DnsCache cache;
+	std::vector<std::thread> readers;
+	std::atomic<bool> stop(false);
+	std::atomic<int> missed(0);
+
+	cache.release(cache.put("c.test", 80, __numeric_addrinfo("127.0.0.1"), 60, 60));
+	for (int i = 0; i < 2; i++)
+	{
+		readers.emplace_back([&cache, &stop, &missed]() {
+			while (!stop)
+			{
+				auto *handle = cache.get("c.test", 80);
+
+				if (handle)
+					cache.release(handle);
+				else
+					missed++;
+			}
+		});
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		std::string host = "host" + std::to_string(i) + ".test";
+		cache.release(cache.put(host, 80, __numeric_addrinfo("127.0.0.1"), 60, 60));
+	}
+
+	stop = true;
+	for (auto& t : readers)
+		t.join();
+
+	EXPECT_EQ(missed, 0);
+	for (int i = 0; i < n; i++)
+	{
+		std::string host = "host" + std::to_string(i) + ".test";
+		auto *handle = cache.get(host, 80);
+
+		ASSERT_TRUE(handle != NULL);
+		cache.release(handle);
+		if (i % 2 == 0)
+			cache.del(host, 80);
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		std::string host = "host" + std::to_string(i) + ".test";
+		auto *handle = cache.get(host, 80);
+
+		EXPECT_EQ(handle != NULL, i % 2 == 1);
+		if (handle)
+			cache.release(handle);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	::testing::InitGoogleTest(&argc, argv);
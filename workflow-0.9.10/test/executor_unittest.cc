@@ -0,0 +1,177 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "workflow/Executor.h"
+#include "workflow/WFTaskFactory.h"
+#include "workflow/WFFacilities.h"
+
+using TinyTask = WFThreadTask<int, int>;
+using TinyFactory = WFThreadTaskFactory<int, int>;
+
+/* One thread, so that the order of execution is the order of scheduling. */
+static void __test_order(int type)
+{
+	Executor executor;
+	ExecQueue big;
+	ExecQueue small;
+	std::vector<int> order;
+	WFFacilities::WaitGroup wg(101);
+
+	ASSERT_EQ(executor.init(1, type), 0);
+	ASSERT_EQ(big.init(), 0);
+	ASSERT_EQ(small.init(), 0);
+
+	auto *block = TinyFactory::create_thread_task(&big, &executor,
+		[](int *in, int *out) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}, [&wg](TinyTask *task) { wg.done(); });
+	block->start();
+
+	for (int i = 0; i < 99; i++)
+	{
+		auto *task = TinyFactory::create_thread_task(&big, &executor,
+			[&order, i](int *in, int *out) { order.push_back(i); },
+			[&wg](TinyTask *task) { wg.done(); });
+		task->start();
+	}
+
+	/* Comes late, but need not wait for the big queue to drain. */
+	auto *task = TinyFactory::create_thread_task(&small, &executor,
+		[&order](int *in, int *out) { order.push_back(-1); },
+		[&wg](TinyTask *task) { wg.done(); });
+	task->start();
+
+	wg.wait();
+	ASSERT_EQ(order.size(), 100U);
+	EXPECT_LE(std::find(order.begin(), order.end(), -1) - order.begin(), 1);
+	order.erase(std::find(order.begin(), order.end(), -1));
+	for (int i = 0; i < 99; i++)
+		EXPECT_EQ(order[i], i);
+
+	executor.deinit();
+	small.deinit();
+	big.deinit();
+}
+
+TEST(executor_unittest, shared_queue_order)
+{
+	__test_order(EXECUTOR_SHARED_QUEUE);
+}
+
+TEST(executor_unittest, work_stealing_order)
+{
+	__test_order(EXECUTOR_WORK_STEALING);
+}
+
+TEST(executor_unittest, work_stealing_cancel)
+{
+	Executor executor;
+	ExecQueue queue;
+	std::atomic<int> canceled(0);
+	std::atomic<int> finished(0);
+
+	ASSERT_EQ(executor.init(2, EXECUTOR_WORK_STEALING), 0);
+	ASSERT_EQ(queue.init(), 0);
+	for (int i = 0; i < 100; i++)
+	{
+		auto *task = TinyFactory::create_thread_task(&queue, &executor,
+			[](int *in, int *out) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}, [&canceled, &finished](TinyTask *task) {
+			if (task->get_state() == WFT_STATE_SUCCESS)
+				finished++;
+			else
+				canceled++;
+		});
+		task->start();
+	}
+
+	executor.deinit();
+	EXPECT_EQ(finished + canceled, 100);
+	EXPECT_GT(canceled, 0);
+	queue.deinit();
+}
+
+/* Many tiny tasks over a few queues. Every finished task starts the next one
+ * of its chain from its callback, as go tasks in a series do. */
+static double __run_tiny_tasks(int type, int nthreads, int nqueues,
+							   int chains, int length)
+{
+	Executor executor;
+	std::vector<ExecQueue> queues(nqueues);
+	WFFacilities::WaitGroup wg(chains);
+	std::atomic<long> sum(0);
+	std::function<void (TinyTask *)> next;
+
+	EXPECT_EQ(executor.init(nthreads, type), 0);
+	for (auto& queue : queues)
+		EXPECT_EQ(queue.init(), 0);
+
+	next = [&](TinyTask *task) {
+		int left = *task->get_input() - 1;
+
+		sum += *task->get_output();
+		if (left == 0)
+		{
+			wg.done();
+			return;
+		}
+
+		auto *t = TinyFactory::create_thread_task(&queues[left % nqueues],
+			&executor, [](int *in, int *out) { *out = *in & 1; }, next);
+		*t->get_input() = left;
+		series_of(task)->push_back(t);
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < chains; i++)
+	{
+		auto *t = TinyFactory::create_thread_task(&queues[i % nqueues],
+			&executor, [](int *in, int *out) { *out = *in & 1; }, next);
+		*t->get_input() = length;
+		t->start();
+	}
+
+	wg.wait();
+	std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+	EXPECT_EQ(sum, (long)chains * (length / 2));
+	executor.deinit();
+	for (auto& queue : queues)
+		queue.deinit();
+
+	return chains * length / seconds.count();
+}
+
+TEST(executor_unittest, tiny_tasks_bench)
+{
+	for (int nthreads : {1, 4, 16})
+	{
+		double shared = __run_tiny_tasks(EXECUTOR_SHARED_QUEUE, nthreads, 8, 64, 2000);
+		double stealing = __run_tiny_tasks(EXECUTOR_WORK_STEALING, nthreads, 8, 64, 2000);
+
+		fprintf(stderr, "%2d threads: shared queue %.0f tasks/s, "
+				"work stealing %.0f tasks/s\n", nthreads, shared, stealing);
+	}
+}
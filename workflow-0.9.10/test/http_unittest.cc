@@ -16,14 +16,21 @@
   Author: Wu Jiaxu (wujiaxu@sogou-inc.com)
 */
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <string>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFOperator.h"
 #include "workflow/WFHttpServer.h"
 #include "workflow/HttpUtil.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/WFHttpCacheClient.h"
+#include "workflow/WFHttp2Server.h"
+#include "workflow/WFHttp2Client.h"
+#include "workflow/http_parser.h"
 
 #define RETRY_MAX  3
 
@@ -205,6 +212,676 @@ KZ1lOvb+vi3TLrQf4tfBekrXXe5tZK40QSJ7UdtY7HHrrbAXU+8=
 	https_server.stop();
 }
 
+static void __http_echo(WFHttpTask *task)
+{
+	const void *body;
+	size_t size;
+
+	if (task->get_req()->get_parsed_body(&body, &size))
+		task->get_resp()->append_output_body(body, size);
+}
+
+TEST(http_unittest, WFHttpTask4)
+{
+	/* Bodies with a Content-Length are received in place, check that large
+	 * ones arrive intact over plain and SSL connections, back to back on
+	 * the same connection, and that the size limit still applies. */
+	struct WFServerParams params = HTTP_SERVER_PARAMS_DEFAULT;
+	params.request_size_limit = 8 * 1024 * 1024;
+	WFHttpServer http_server(&params, __http_echo);
+	EXPECT_TRUE(http_server.start("127.0.0.1", 8811) == 0) << "http server start failed";
+
+	WFHttpServer https_server(&params, __http_echo);
+	EXPECT_TRUE(https_server.start("127.0.0.1", 8822, "server.crt", "server.key") == 0) << "https server start failed";
+
+	std::string body(4 * 1024 * 1024 + 1, '\0');
+	for (size_t i = 0; i < body.size(); i++)
+		body[i] = 'a' + i % 26;
+
+	std::string huge(params.request_size_limit + 1, 'x');
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+	auto cb = [&body](WFHttpTask *task) {
+		const void *data;
+		size_t size;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		if (task->get_state() == WFT_STATE_SUCCESS)
+		{
+			EXPECT_TRUE(task->get_resp()->get_parsed_body(&data, &size));
+			EXPECT_TRUE(std::string((const char *)data, size) == body);
+		}
+	};
+
+	auto *series = Workflow::create_series_work(WFTaskFactory::create_empty_task(), [&mutex, &cond, &done](const SeriesWork *series) {
+		mutex.lock();
+		done = true;
+		mutex.unlock();
+		cond.notify_one();
+	});
+
+	for (const char *url : {"http://127.0.0.1:8811/", "https://127.0.0.1:8822/"})
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			auto *task = WFTaskFactory::create_http_task(url, 0, 0, cb);
+			task->get_req()->set_method(HttpMethodPost);
+			task->get_req()->append_output_body_nocopy(body.data(), body.size());
+			series->push_back(task);
+		}
+	}
+
+	/* The server may close before reading all, so only a reply is checked. */
+	auto *task = WFTaskFactory::create_http_task("http://127.0.0.1:8811/", 0, 0, [](WFHttpTask *task) {
+		if (task->get_state() == WFT_STATE_SUCCESS)
+		{
+			EXPECT_EQ(atoi(task->get_resp()->get_status_code()), HttpStatusRequestEntityTooLarge);
+		}
+	});
+	task->get_req()->set_method(HttpMethodPost);
+	task->get_req()->append_output_body_nocopy(huge.data(), huge.size());
+	series->push_back(task);
+
+	series->start();
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!done)
+		cond.wait(lock);
+
+	lock.unlock();
+	http_server.stop();
+	https_server.stop();
+}
+
+static std::atomic<int> __cache_server_hits;
+
+static void __http_cache_process(WFHttpTask *task)
+{
+	auto *req = task->get_req();
+	auto *resp = task->get_resp();
+	std::string uri = req->get_request_uri();
+	protocol::HttpHeaderCursor cursor(req);
+	std::string etag;
+
+	__cache_server_hits++;
+	if (uri == "/max-age")
+		resp->add_header_pair("Cache-Control", "max-age=60");
+	else if (uri == "/private")
+		resp->add_header_pair("Cache-Control", "private, max-age=60");
+	else if (uri == "/s-maxage")
+		resp->add_header_pair("Cache-Control", "max-age=0, s-maxage=60");
+	else if (uri == "/expires")
+		resp->add_header_pair("Expires", "Fri, 01 Jan 2100 00:00:00 GMT");
+	else if (uri == "/expired")
+	{
+		resp->add_header_pair("Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+		resp->add_header_pair("Expires", "Sun, 06 Nov 1994 08:49:37 GMT");
+	}
+	else if (uri == "/etag")
+	{
+		resp->add_header_pair("Cache-Control", "no-cache");
+		resp->add_header_pair("ETag", "\"v1\"");
+		if (cursor.find("If-None-Match", etag) && etag == "\"v1\"")
+		{
+			protocol::HttpUtil::set_response_status(resp, HttpStatusNotModified);
+			return;
+		}
+	}
+	else
+	{
+		/* Slow and never stored, so only coalescing can save requests. */
+		resp->add_header_pair("Cache-Control", "no-store");
+		series_of(task)->push_back(WFTaskFactory::create_timer_task(100000, nullptr));
+	}
+
+	resp->append_output_body(uri);
+}
+
+static void __cache_run(WFHttpCacheClient *client, const char *path, int n,
+						const char *method)
+{
+	std::string url = std::string("http://127.0.0.1:8844") + path;
+	WFFacilities::WaitGroup wg(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		auto *task = client->create_http_task(url, 0, 0, [&wg, path](WFHttpTask *task) {
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			if (task->get_state() == WFT_STATE_SUCCESS)
+			{
+				const void *body;
+				size_t size;
+
+				EXPECT_EQ(atoi(task->get_resp()->get_status_code()), HttpStatusOK);
+				EXPECT_TRUE(task->get_resp()->get_parsed_body(&body, &size));
+				EXPECT_EQ(std::string((const char *)body, size), path);
+			}
+
+			wg.done();
+		});
+		task->get_req()->set_method(method);
+		task->start();
+	}
+
+	wg.wait();
+}
+
+TEST(http_unittest, WFHttpCacheClient)
+{
+	WFHttpServer server(__http_cache_process);
+	WFHttpCacheClient client;
+	WFHttpCacheStats stats;
+
+	ASSERT_EQ(server.start("127.0.0.1", 8844), 0);
+	ASSERT_EQ(client.init(1024 * 1024), 0);
+
+	/* Concurrent identical requests share one upstream request. */
+	__cache_run(&client, "/slow", 8, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 1);
+	__cache_run(&client, "/slow", 1, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 2);
+	stats = client.get_stats();
+	EXPECT_EQ(stats.coalesced, 7U);
+	EXPECT_EQ(stats.upstream, 2U);
+
+	__cache_server_hits = 0;
+	__cache_run(&client, "/max-age", 1, HttpMethodGet);
+	__cache_run(&client, "/max-age", 4, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 1);
+	EXPECT_EQ(client.get_stats().hits, 4U);
+
+	/* Always revalidated, answered by 304 after the first. */
+	__cache_server_hits = 0;
+	__cache_run(&client, "/etag", 1, HttpMethodGet);
+	__cache_run(&client, "/etag", 1, HttpMethodGet);
+	__cache_run(&client, "/etag", 1, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 3);
+	EXPECT_EQ(client.get_stats().revalidated, 2U);
+
+	__cache_server_hits = 0;
+	__cache_run(&client, "/max-age", 2, HttpMethodPost);
+	EXPECT_EQ(__cache_server_hits, 2);
+	stats = client.get_stats();
+	EXPECT_EQ(stats.bypassed, 2U);
+	EXPECT_EQ(stats.requests, 9U + 5U + 3U + 2U);
+
+	/* A shared cache never stores private responses. */
+	__cache_server_hits = 0;
+	__cache_run(&client, "/private", 1, HttpMethodGet);
+	__cache_run(&client, "/private", 1, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 2);
+
+	/* s-maxage overrides max-age, and Expires applies without either. */
+	__cache_server_hits = 0;
+	__cache_run(&client, "/s-maxage", 1, HttpMethodGet);
+	__cache_run(&client, "/s-maxage", 1, HttpMethodGet);
+	__cache_run(&client, "/expires", 1, HttpMethodGet);
+	__cache_run(&client, "/expires", 1, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 2);
+
+	__cache_server_hits = 0;
+	__cache_run(&client, "/expired", 1, HttpMethodGet);
+	__cache_run(&client, "/expired", 1, HttpMethodGet);
+	EXPECT_EQ(__cache_server_hits, 2);
+
+	client.deinit();
+	server.stop();
+}
+
+static void __http_slow_process(WFHttpTask *task)
+{
+	task->get_resp()->append_output_body(task->get_req()->get_request_uri());
+	series_of(task)->push_back(WFTaskFactory::create_timer_task(100000, nullptr));
+}
+
+static void __http_reject(WFHttpTask *task)
+{
+	protocol::HttpUtil::set_response_status(task->get_resp(),
+											HttpStatusServiceUnavailable);
+}
+
+static int __http_classify(WFHttpTask *task)
+{
+	return strcmp(task->get_req()->get_request_uri(), "/low") == 0 ? 1 : 0;
+}
+
+/* Sends n requests at once, and returns how many are served. */
+static int __limit_run(unsigned short port, const char *path, int n)
+{
+	std::string url = "http://127.0.0.1:" + std::to_string(port) + path;
+	WFFacilities::WaitGroup wg(n);
+	std::atomic<int> served(0);
+
+	for (int i = 0; i < n; i++)
+	{
+		auto *task = WFTaskFactory::create_http_task(url, 0, 0, [&](WFHttpTask *task) {
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			if (strcmp(task->get_resp()->get_status_code(), "200") == 0)
+				served++;
+			else
+				EXPECT_STREQ(task->get_resp()->get_status_code(), "503");
+
+			wg.done();
+		});
+		task->start();
+	}
+
+	wg.wait();
+	return served;
+}
+
+TEST(http_unittest, ConcurrencyLimit)
+{
+	struct WFConcurrencyLimitParams params = CONCURRENCY_LIMIT_PARAMS_DEFAULT;
+	WFHttpServer server(__http_slow_process);
+
+	params.initial_limit = 4;
+	params.min_limit = 4;
+	params.max_limit = 4;
+	params.priority_classes = 2;
+	server.set_concurrency_limit(&params, __http_reject, __http_classify);
+	ASSERT_EQ(server.start("127.0.0.1", 8877), 0);
+
+	const WFConcurrencyLimiter& limiter = server.get_concurrency_limiter();
+
+	EXPECT_EQ(__limit_run(8877, "/high", 8), 4);
+	/* The lower class gets half of the limit. */
+	EXPECT_EQ(__limit_run(8877, "/low", 8), 2);
+	EXPECT_EQ(limiter.get_accepted(), 6U);
+	EXPECT_EQ(limiter.get_rejected(), 10U);
+	EXPECT_EQ(limiter.get_inflight(), 0);
+	server.stop();
+
+	WFHttpServer adaptive(__http_slow_process);
+
+	params.initial_limit = 8;
+	params.min_limit = 2;
+	params.max_limit = 8;
+	params.priority_classes = 1;
+	params.max_latency = 10;
+	adaptive.set_concurrency_limit(&params, __http_reject);
+	ASSERT_EQ(adaptive.start("127.0.0.1", 8878), 0);
+
+	/* Slower than 'max_latency', so the window backs off. */
+	EXPECT_EQ(__limit_run(8878, "/", 8), 8);
+	EXPECT_EQ(adaptive.get_concurrency_limiter().get_limit(), 7);
+	adaptive.stop();
+}
+
+static void __http2_echo(WFHttp2Task *task)
+{
+	protocol::HttpHeaderCursor cursor(task->get_req());
+	std::string value;
+	const void *body;
+	size_t size;
+
+	if (cursor.find("X-Echo", value))
+		task->get_resp()->add_header_pair("X-Echo", value);
+
+	task->get_resp()->add_header_pair("X-Path", task->get_req()->get_request_uri());
+	if (task->get_req()->get_parsed_body(&body, &size))
+		task->get_resp()->append_output_body(body, size);
+}
+
+TEST(http_unittest, WFHttp2Task)
+{
+	WFHttp2Server http2_server(__http2_echo);
+	EXPECT_TRUE(http2_server.start("127.0.0.1", 8855) == 0) << "http2 server start failed";
+
+	WFHttp2Server https2_server(__http2_echo);
+	EXPECT_TRUE(https2_server.start("127.0.0.1", 8866, "server.crt", "server.key") == 0) << "https2 server start failed";
+
+	/* Bodies of many frames, and headers the dynamic table is reused for,
+	 * back to back on one connection with growing stream ids. The bodies
+	 * are larger than the default window, so they are sent as the peer's
+	 * WINDOW_UPDATE frames arrive. */
+	static const size_t sizes[] = { 64 * 1024 + 1, 4 * 1024 * 1024 + 1 };
+	std::string body(sizes[1], '\0');
+	for (size_t i = 0; i < body.size(); i++)
+		body[i] = 'a' + i % 26;
+
+	WFFacilities::WaitGroup wait_group(1);
+	uint32_t last_stream_id = 0;
+	auto cb = [&body, &last_stream_id](WFHttp2Task *task) {
+		protocol::HttpHeaderCursor cursor(task->get_resp());
+		std::string value;
+		const void *data;
+		size_t size;
+
+		ASSERT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		EXPECT_STREQ(task->get_resp()->get_status_code(), "200");
+		EXPECT_TRUE(cursor.find("x-echo", value));
+		EXPECT_EQ(value, "workflow");
+		EXPECT_TRUE(cursor.find("x-path", value));
+		EXPECT_EQ(value, "/echo?a=1");
+		EXPECT_TRUE(task->get_resp()->get_parsed_body(&data, &size));
+		EXPECT_EQ(size, task->get_req()->get_output_body_size());
+		if (strcmp(task->get_req()->get_method(), HttpMethodPost) == 0)
+		{
+			EXPECT_TRUE(size != 0 &&
+						memcmp(data, body.data(), size) == 0);
+		}
+
+		if (last_stream_id != 0)
+		{
+			EXPECT_EQ(task->get_req()->get_stream_id(), last_stream_id + 2);
+		}
+
+		last_stream_id = task->get_req()->get_stream_id();
+	};
+
+	auto *series = Workflow::create_series_work(WFTaskFactory::create_empty_task(), [&wait_group](const SeriesWork *) {
+		wait_group.done();
+	});
+
+	for (const char *url : {"http://127.0.0.1:8855/echo?a=1", "https://127.0.0.1:8866/echo?a=1"})
+	{
+		series->push_back(WFTaskFactory::create_empty_task());
+		series->push_back(WFTaskFactory::create_go_task("reset", [&last_stream_id] {
+			last_stream_id = 0;
+		}));
+
+		for (int i = 0; i < 4; i++)
+		{
+			auto *task = WFTaskFactory::create_http2_task(url, 0, cb);
+			task->get_req()->add_header_pair("X-Echo", "workflow");
+			if (i % 2 == 1)
+			{
+				task->get_req()->set_method(HttpMethodPost);
+				task->get_req()->append_output_body_nocopy(body.data(), sizes[i / 2]);
+			}
+
+			series->push_back(task);
+		}
+	}
+
+	series->start();
+	wait_group.wait();
+
+	/* Parallel requests open more connections, one stream on each. */
+	WFFacilities::WaitGroup parallel_wait(16);
+	for (int i = 0; i < 16; i++)
+	{
+		auto *task = WFTaskFactory::create_http2_task("http://127.0.0.1:8855/" + std::to_string(i), 0,
+			[&parallel_wait, i](WFHttp2Task *task) {
+			protocol::HttpHeaderCursor cursor(task->get_resp());
+			std::string value;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			EXPECT_TRUE(cursor.find("x-path", value));
+			EXPECT_EQ(value, "/" + std::to_string(i));
+			parallel_wait.done();
+		});
+
+		task->start();
+	}
+
+	parallel_wait.wait();
+	http2_server.stop();
+	https2_server.stop();
+}
+
+/* Concurrent tasks are multiplexed, more than the server takes on one
+ * request, so some streams are refused and sent again. */
+TEST(http_unittest, WFHttp2Client)
+{
+	/* The first request is slow, so that all of the others wait for it. */
+	WFHttp2Server http2_server([](WFHttp2Task *task) {
+		__http2_echo(task);
+		if (strcmp(task->get_req()->get_request_uri(), "/0") == 0)
+			series_of(task)->push_back(WFTaskFactory::create_timer_task(100 * 1000, nullptr));
+	});
+	EXPECT_TRUE(http2_server.start("127.0.0.1", 8857) == 0) << "http2 server start failed";
+
+	static constexpr int n = 300;
+	WFHttp2Client client;
+	ASSERT_EQ(client.init(150, 1), 0);
+
+	WFFacilities::WaitGroup wait_group(n);
+	for (int i = 0; i < n; i++)
+	{
+		std::string path = "/" + std::to_string(i);
+		auto *task = client.create_http2_task("http://127.0.0.1:8857" + path, 0,
+			[&wait_group, path, i](WFHttp2Task *task) {
+			protocol::HttpHeaderCursor cursor(task->get_resp());
+			std::string value;
+			const void *body;
+			size_t size;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			EXPECT_TRUE(cursor.find("x-path", value));
+			EXPECT_EQ(value, path);
+			EXPECT_TRUE(task->get_resp()->get_parsed_body(&body, &size));
+			EXPECT_EQ(std::string((const char *)body, size),
+					  i % 2 ? path : "");
+			wait_group.done();
+		});
+
+		if (i % 2 == 1)
+		{
+			task->get_req()->set_method(HttpMethodPost);
+			task->get_req()->append_output_body(path);
+		}
+
+		task->start();
+	}
+
+	wait_group.wait();
+	WFHttp2ClientStats stats = client.get_stats();
+	EXPECT_EQ(stats.requests, n);
+	EXPECT_LT(stats.batches, n);
+	EXPECT_GT(stats.refused, 0);
+	EXPECT_EQ(stats.streams, n + stats.refused);
+
+	/* Tasks are sent only with others of the same timeouts, so the slow
+	 * ones time out alone. */
+	WFFacilities::WaitGroup timeout_wait(8);
+	for (int i = 0; i < 8; i++)
+	{
+		auto *task = client.create_http2_task("http://127.0.0.1:8857/" + std::to_string(i % 2), 0,
+			[&timeout_wait, i](WFHttp2Task *task) {
+			if (i % 2 == 0)
+			{
+				EXPECT_EQ(task->get_state(), WFT_STATE_SYS_ERROR);
+				EXPECT_EQ(task->get_error(), ETIMEDOUT);
+				EXPECT_EQ(task->get_timeout_reason(), TOR_TRANSMIT_TIMEOUT);
+			}
+			else
+				EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+
+			timeout_wait.done();
+		});
+
+		if (i % 2 == 0)
+			task->set_receive_timeout(20);
+
+		task->start();
+	}
+
+	/* The first is sent at once, and the others wait for it. */
+	timeout_wait.wait();
+	EXPECT_EQ(client.get_stats().batches, stats.batches + 3);
+	client.deinit();
+	http2_server.stop();
+
+	/* Over TLS a request arrives in records, and ends with the last one. */
+	WFHttp2Server https2_server(__http2_echo);
+	EXPECT_TRUE(https2_server.start("127.0.0.1", 8858, "server.crt", "server.key") == 0) << "https2 server start failed";
+	ASSERT_EQ(client.init(100, 1), 0);
+
+	std::string body(100000, 'b');
+	WFFacilities::WaitGroup ssl_wait(n);
+	for (int i = 0; i < n; i++)
+	{
+		auto *task = client.create_http2_task("https://127.0.0.1:8858/" + std::to_string(i), 0,
+			[&ssl_wait, &body](WFHttp2Task *task) {
+			const void *data;
+			size_t size;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			EXPECT_TRUE(task->get_resp()->get_parsed_body(&data, &size));
+			EXPECT_EQ(size, body.size());
+			ssl_wait.done();
+		});
+
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(body.data(), body.size());
+		task->start();
+	}
+
+	ssl_wait.wait();
+	client.deinit();
+	https2_server.stop();
+}
+
+static int __parse_message(const std::string& msg, size_t fragment, http_parser_t *parser)
+{
+	size_t pos = 0;
+	size_t n;
+	int ret = 0;
+
+	while (pos < msg.size())
+	{
+		n = std::min(fragment, msg.size() - pos);
+		ret = http_parser_append_message(msg.data() + pos, &n, parser);
+		if (ret != 0)
+			break;
+
+		pos += n;
+	}
+
+	return ret;
+}
+
+TEST(http_unittest, http_parser)
+{
+	/* More headers than are kept inline, a folded one, and a chunked body,
+	 * parsed at once and byte by byte. */
+	std::string msg = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n";
+	for (int i = 0; i < 40; i++)
+		msg += "X-Header-" + std::to_string(i) + ":   value" + std::string(i * 7, 'v') + " \t\r\n";
+
+	msg += "X-Folded: first\r\n \t second  \r\n\r\n";
+	msg += "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n20;ext=1\r\n" + std::string(32, '0') + "\r\n0\r\nX-Trailer: 1\r\n\r\n";
+
+	for (size_t fragment : {msg.size(), (size_t)1, (size_t)17})
+	{
+		http_parser_t parser;
+		http_header_cursor_t cursor;
+		const void *name;
+		const void *value;
+		size_t name_len;
+		size_t value_len;
+		const void *body;
+		size_t size;
+		int i = 0;
+
+		http_parser_init(1, &parser);
+		ASSERT_EQ(__parse_message(msg, fragment, &parser), 1);
+		EXPECT_STREQ(http_parser_get_code(&parser), "200");
+		EXPECT_TRUE(http_parser_chunked(&parser));
+
+		http_header_cursor_init(&cursor, &parser);
+		EXPECT_EQ(http_header_cursor_next(&name, &name_len, &value, &value_len, &cursor), 0);
+		EXPECT_EQ(std::string((const char *)value, value_len), "chunked");
+		while (http_header_cursor_next(&name, &name_len, &value, &value_len, &cursor) == 0 && i < 40)
+		{
+			EXPECT_EQ(std::string((const char *)name, name_len), "X-Header-" + std::to_string(i));
+			EXPECT_EQ(std::string((const char *)value, value_len), "value" + std::string(i * 7, 'v'));
+			EXPECT_EQ(memcmp((const char *)name + name_len + 2 + value_len, "\r\n", 2), 0);
+			i++;
+		}
+
+		EXPECT_EQ(i, 40);
+		EXPECT_EQ(std::string((const char *)value, value_len), "first second");
+		EXPECT_EQ(http_header_cursor_next(&name, &name_len, &value, &value_len, &cursor), 1);
+
+		/* Longer values take new text, shorter ones are written in place. */
+		EXPECT_EQ(http_parser_set_header("x-header-39", 11, "long value", 10, &parser), 0);
+		EXPECT_EQ(http_parser_set_header("X-Header-0", 10, std::string(1000, 'L').c_str(), 1000, &parser), 0);
+		EXPECT_EQ(http_parser_set_header("X-New", 5, "new", 3, &parser), 0);
+		http_header_cursor_rewind(&cursor);
+		EXPECT_EQ(http_header_cursor_find("X-HEADER-0", 10, &value, &value_len, &cursor), 0);
+		EXPECT_EQ(std::string((const char *)value, value_len), std::string(1000, 'L'));
+		EXPECT_EQ(http_header_cursor_find("x-header-39", 11, &value, &value_len, &cursor), 0);
+		EXPECT_EQ(std::string((const char *)value, value_len), "long value");
+		EXPECT_EQ(http_header_cursor_find("x-new", 5, &value, &value_len, &cursor), 0);
+		EXPECT_EQ(http_header_cursor_find("x-new", 5, &value, &value_len, &cursor), 1);
+
+		/* The last text grows in place, and a value shrunk and grown back
+		 * keeps its text. Others move once, then grow their own buffer. */
+		const void *text;
+
+		http_header_cursor_rewind(&cursor);
+		EXPECT_EQ(http_header_cursor_find("X-New", 5, &text, &value_len, &cursor), 0);
+		EXPECT_EQ(http_parser_set_header("X-New", 5, "newer value", 11, &parser), 0);
+		EXPECT_EQ(http_parser_set_header("X-New", 5, "n", 1, &parser), 0);
+		EXPECT_EQ(http_parser_set_header("X-New", 5, "new value", 9, &parser), 0);
+		http_header_cursor_rewind(&cursor);
+		EXPECT_EQ(http_header_cursor_find("X-New", 5, &value, &value_len, &cursor), 0);
+		EXPECT_EQ(value, text);
+		EXPECT_EQ(std::string((const char *)value, value_len), "new value");
+		for (i = 1; i <= 100; i++)
+		{
+			std::string v(i * 100, 'g');
+
+			EXPECT_EQ(http_parser_set_header("X-Header-1", 10, v.c_str(), v.size(), &parser), 0);
+			http_header_cursor_rewind(&cursor);
+			EXPECT_EQ(http_header_cursor_find("X-Header-1", 10, &value, &value_len, &cursor), 0);
+			EXPECT_EQ(std::string((const char *)value, value_len), v);
+			EXPECT_EQ(memcmp((const char *)value - 12, "X-Header-1: ", 12), 0);
+			EXPECT_EQ(memcmp((const char *)value + value_len, "\r\n", 2), 0);
+		}
+
+		http_header_cursor_deinit(&cursor);
+
+		ASSERT_EQ(http_parser_get_body(&body, &size, &parser), 0);
+		EXPECT_EQ(size, msg.size() - msg.find("\r\n\r\n") - 4);
+		http_parser_deinit(&parser);
+	}
+
+	/* Bytes not allowed in names and values, and a missing '\n'. */
+	for (const char *bad : {"GET / HTTP/1.1\r\nHo\x80st: a\r\n\r\n",
+							"GET / HTTP/1.1\r\nHost: a\xff\r\n\r\n",
+							"GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n"})
+	{
+		http_parser_t parser;
+		size_t n = strlen(bad);
+
+		http_parser_init(0, &parser);
+		EXPECT_EQ(http_parser_append_message(bad, &n, &parser), -2);
+		http_parser_deinit(&parser);
+	}
+
+	/* A huge Content-Length gets a buffer that grows with the body
+	 * received, not one of that length. */
+	{
+		std::string head = "POST / HTTP/1.1\r\nContent-Length: 100000000000\r\n\r\n";
+		http_parser_t parser;
+		size_t received = 0;
+		size_t n = head.size();
+		char *p;
+
+		http_parser_init(0, &parser);
+		ASSERT_EQ(http_parser_append_message(head.data(), &n, &parser), 0);
+		for (int i = 0; i < 8; i++)
+		{
+			n = (size_t)-1;
+			p = (char *)http_parser_get_buffer(&n, &parser);
+			ASSERT_TRUE(p != NULL);
+			memset(p, 'x', n);
+			ASSERT_EQ(http_parser_append_message(p, &n, &parser), 0);
+			received += n;
+			EXPECT_LE(parser.bufsize, 2 * (head.size() + received) + 1024 * 1024);
+		}
+
+		/* Over the room given, it is received through append only. */
+		n = 100;
+		EXPECT_TRUE(http_parser_get_buffer(&n, &parser) == NULL);
+		http_parser_deinit(&parser);
+	}
+}
+
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L
 
 #include <openssl/ssl.h>
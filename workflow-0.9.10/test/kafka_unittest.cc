@@ -0,0 +1,664 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <lz4frame.h>
+#include <zstd.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "workflow/WFKafkaProducer.h"
+
+#define STUB_PARTITIONS  3
+
+/* A broker speaking just enough of the protocol for producing: ApiVersions,
+ * Metadata v4 and Produce v7. It decompresses every record batch and
+ * counts its records by partition. */
+class __KafkaStub
+{
+public:
+	int start(unsigned short port)
+	{
+		struct sockaddr_in addr = { };
+		int reuse = 1;
+
+		this->port = port;
+		this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(this->listen_fd, (struct sockaddr *)&addr, sizeof addr) < 0 ||
+			listen(this->listen_fd, 64) < 0)
+		{
+			close(this->listen_fd);
+			return -1;
+		}
+
+		this->accept_thread = std::thread(&__KafkaStub::accept_loop, this);
+		return 0;
+	}
+
+	void stop()
+	{
+		shutdown(this->listen_fd, SHUT_RDWR);
+		this->accept_thread.join();
+		close(this->listen_fd);
+
+		this->mutex.lock();
+		for (int fd : this->conn_fds)
+			shutdown(fd, SHUT_RDWR);
+
+		this->mutex.unlock();
+		for (std::thread& t : this->conn_threads)
+			t.join();
+
+		for (int fd : this->conn_fds)
+			close(fd);
+	}
+
+	size_t get_records(const std::string& topic, int partition)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		return this->records[std::make_pair(topic, partition)];
+	}
+
+	size_t get_records(const std::string& topic)
+	{
+		size_t n = 0;
+
+		for (int i = 0; i < STUB_PARTITIONS; i++)
+			n += this->get_records(topic, i);
+
+		return n;
+	}
+
+	int batches = 0;
+	int bad_batches = 0;
+	int compress_type = -1;
+
+private:
+	void accept_loop()
+	{
+		int fd;
+
+		while ((fd = accept(this->listen_fd, NULL, NULL)) >= 0)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			this->conn_fds.push_back(fd);
+			this->conn_threads.emplace_back(&__KafkaStub::conn_loop, this, fd);
+		}
+	}
+
+	static bool read_full(int fd, void *buf, size_t n)
+	{
+		while (n > 0)
+		{
+			ssize_t ret = read(fd, buf, n);
+
+			if (ret <= 0)
+				return false;
+
+			buf = (char *)buf + ret;
+			n -= ret;
+		}
+
+		return true;
+	}
+
+	void conn_loop(int fd)
+	{
+		std::string req;
+		std::string resp;
+		uint32_t size;
+
+		while (read_full(fd, &size, 4))
+		{
+			req.resize(ntohl(size));
+			if (!read_full(fd, &req[0], req.size()))
+				break;
+
+			resp.assign(4, '\0');
+			if (!this->handle(req, resp))
+				break;
+
+			*(uint32_t *)&resp[0] = htonl(resp.size() - 4);
+			if (write(fd, resp.data(), resp.size()) != (ssize_t)resp.size())
+				break;
+		}
+	}
+
+	static void put16(std::string& s, int16_t v) { v = htons(v); s.append((char *)&v, 2); }
+	static void put32(std::string& s, int32_t v) { v = htonl(v); s.append((char *)&v, 4); }
+	static void put64(std::string& s, int64_t v) { put32(s, v >> 32); put32(s, v); }
+	static void putstr(std::string& s, const std::string& v) { put16(s, v.size()); s.append(v); }
+
+	struct Reader
+	{
+		const unsigned char *p;
+		const unsigned char *end;
+
+		bool ok() const { return p <= end; }
+		int8_t i8() { p += 1; return ok() ? p[-1] : 0; }
+		int16_t i16() { p += 2; return ok() ? (int16_t)(p[-2] << 8 | p[-1]) : 0; }
+		int32_t i32() { p += 4; return ok() ? (int32_t)((uint32_t)p[-4] << 24 | p[-3] << 16 | p[-2] << 8 | p[-1]) : 0; }
+		int64_t i64() { int64_t h = (uint32_t)i32(); return h << 32 | (uint32_t)i32(); }
+
+		std::string str()
+		{
+			int16_t n = i16();
+
+			if (n < 0 || p + n > end)
+				return "";
+
+			p += n;
+			return std::string((const char *)p - n, n);
+		}
+
+		int64_t varint()
+		{
+			uint64_t n = 0;
+			int shift = 0;
+
+			while (p < end)
+			{
+				n |= (uint64_t)(*p & 0x7f) << shift;
+				shift += 7;
+				if (!(*p++ & 0x80))
+					return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+			}
+
+			p = end + 1;
+			return 0;
+		}
+	};
+
+	bool handle(const std::string& req, std::string& resp)
+	{
+		Reader r = { (const unsigned char *)req.data(),
+					 (const unsigned char *)req.data() + req.size() };
+		int api_key = r.i16();
+		int api_version = r.i16();
+
+		put32(resp, r.i32());	// correlation id
+		r.str();				// client id
+		switch (api_key)
+		{
+		case Kafka_ApiVersions:
+			put16(resp, 0);
+			put32(resp, 5);
+			put16(resp, Kafka_Produce); put16(resp, 0); put16(resp, 7);
+			put16(resp, Kafka_Fetch); put16(resp, 0); put16(resp, 11);
+			put16(resp, Kafka_Metadata); put16(resp, 0); put16(resp, 4);
+			put16(resp, Kafka_FindCoordinator); put16(resp, 0); put16(resp, 2);
+			put16(resp, Kafka_ApiVersions); put16(resp, 0); put16(resp, 0);
+			return true;
+
+		case Kafka_Metadata:
+			return api_version == 4 && this->handle_metadata(r, resp);
+
+		case Kafka_Produce:
+			return api_version == 7 && this->handle_produce(r, resp);
+
+		default:
+			return false;
+		}
+	}
+
+	bool handle_metadata(Reader& r, std::string& resp)
+	{
+		std::vector<std::string> topics;
+		int n = r.i32();
+
+		for (int i = 0; i < n; i++)
+			topics.push_back(r.str());
+
+		put32(resp, 0);			// throttle time
+		put32(resp, 1);
+		put32(resp, 0);			// node id
+		putstr(resp, "127.0.0.1");
+		put32(resp, this->port);
+		put16(resp, -1);		// rack
+		put16(resp, -1);		// cluster id
+		put32(resp, 0);			// controller id
+		put32(resp, topics.size());
+		for (const std::string& topic : topics)
+		{
+			put16(resp, 0);
+			putstr(resp, topic);
+			resp.push_back(0);	// is internal
+			put32(resp, STUB_PARTITIONS);
+			for (int i = 0; i < STUB_PARTITIONS; i++)
+			{
+				put16(resp, 0);
+				put32(resp, i);
+				put32(resp, 0);	// leader
+				put32(resp, 1);
+				put32(resp, 0);
+				put32(resp, 1);
+				put32(resp, 0);
+			}
+		}
+
+		return r.ok();
+	}
+
+	bool handle_produce(Reader& r, std::string& resp)
+	{
+		r.str();				// transactional id
+		r.i16();				// acks
+		r.i32();				// timeout
+
+		int topics = r.i32();
+
+		put32(resp, topics);
+		for (int i = 0; i < topics; i++)
+		{
+			std::string topic = r.str();
+			int partitions = r.i32();
+
+			putstr(resp, topic);
+			put32(resp, partitions);
+			for (int j = 0; j < partitions; j++)
+			{
+				int partition = r.i32();
+				int set_size = r.i32();
+				Reader set = { r.p, r.p + set_size };
+				int64_t offset;
+
+				r.p += set_size;
+				if (!r.ok())
+					return false;
+
+				offset = this->add_record_set(topic, partition, set);
+				put32(resp, partition);
+				put16(resp, 0);
+				put64(resp, offset);
+				put64(resp, -1);	// log append time
+				put64(resp, 0);		// log start offset
+			}
+		}
+
+		put32(resp, 0);			// throttle time
+		return r.ok();
+	}
+
+	static bool decompress(int type, const unsigned char *p, size_t n,
+						   std::string& out)
+	{
+		char buf[4096];
+
+		if (type == Kafka_Lz4)
+		{
+			LZ4F_dctx *dctx;
+			size_t ret = 1;
+
+			LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+			while (n > 0 && ret != 0)
+			{
+				size_t in = n;
+				size_t len = sizeof buf;
+
+				ret = LZ4F_decompress(dctx, buf, &len, p, &in, NULL);
+				if (LZ4F_isError(ret))
+					break;
+
+				out.append(buf, len);
+				p += in;
+				n -= in;
+			}
+
+			LZ4F_freeDecompressionContext(dctx);
+			return ret == 0 && n == 0;
+		}
+		else if (type == Kafka_Zstd)
+		{
+			ZSTD_DStream *dctx = ZSTD_createDStream();
+			ZSTD_inBuffer in = { p, n, 0 };
+			size_t ret = 1;
+
+			ZSTD_initDStream(dctx);
+			while (in.pos < in.size)
+			{
+				ZSTD_outBuffer o = { buf, sizeof buf, 0 };
+
+				ret = ZSTD_decompressStream(dctx, &o, &in);
+				if (ZSTD_isError(ret))
+					break;
+
+				out.append(buf, o.pos);
+			}
+
+			ZSTD_freeDStream(dctx);
+			return ret == 0;
+		}
+
+		else if (type == Kafka_Gzip)
+		{
+			z_stream strm = { };
+			int ret = Z_OK;
+
+			inflateInit2(&strm, 15 | 16);
+			strm.next_in = (Bytef *)p;
+			strm.avail_in = n;
+			while (ret == Z_OK)
+			{
+				strm.next_out = (Bytef *)buf;
+				strm.avail_out = sizeof buf;
+				ret = inflate(&strm, Z_NO_FLUSH);
+				out.append(buf, sizeof buf - strm.avail_out);
+			}
+
+			inflateEnd(&strm);
+			return ret == Z_STREAM_END;
+		}
+
+		out.assign((const char *)p, n);
+		return true;
+	}
+
+	/* Returns the base offset of the records. */
+	int64_t add_record_set(const std::string& topic, int partition, Reader& set)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto key = std::make_pair(topic, partition);
+		int64_t offset = this->records[key];
+
+		while (set.p < set.end)
+		{
+			std::string records;
+
+			set.i64();			// base offset
+			int length = set.i32();
+			const unsigned char *end = set.p + length;
+
+			set.i32();			// leader epoch
+			int magic = set.i8();
+			set.i32();			// crc
+			int type = set.i16() & 7;
+			set.p += 4 + 8 + 8 + 8 + 2 + 4;
+			int count = set.i32();
+
+			this->batches++;
+			this->compress_type = type;
+			if (magic != 2 || end > set.end || set.p > end ||
+				!decompress(type, set.p, end - set.p, records))
+			{
+				this->bad_batches++;
+				break;
+			}
+
+			Reader rec = { (const unsigned char *)records.data(),
+						   (const unsigned char *)records.data() + records.size() };
+			int n = 0;
+
+			while (rec.p < rec.end)
+			{
+				int64_t len = rec.varint();
+
+				rec.p += len;
+				n++;
+			}
+
+			if (!rec.ok() || n != count)
+				this->bad_batches++;
+			else
+				this->records[key] += n;
+
+			set.p = end;
+		}
+
+		return offset;
+	}
+
+	unsigned short port;
+	int listen_fd;
+	std::thread accept_thread;
+	std::vector<int> conn_fds;
+	std::vector<std::thread> conn_threads;
+	std::map<std::pair<std::string, int>, size_t> records;
+	std::mutex mutex;
+};
+
+static void __produce(WFKafkaProducer& producer, const std::string& topic,
+					  int partition, int n)
+{
+	std::string value(100, 'x');
+
+	for (int i = 0; i < n; i++)
+	{
+		protocol::KafkaRecord record;
+		std::string key = "key" + std::to_string(i);
+
+		record.set_key(key.c_str(), key.size());
+		record.set_value(value.c_str(), value.size());
+		EXPECT_EQ(producer.send(topic, partition, std::move(record)), 0);
+	}
+}
+
+static void __test_producer(int compress_type, unsigned short port)
+{
+	struct WFKafkaProducerParams params = KAFKA_PRODUCER_PARAMS_DEFAULT;
+	struct WFKafkaPartitionStats stats;
+	protocol::KafkaConfig config;
+	WFKafkaProducer *producer;
+	__KafkaStub stub;
+	std::atomic<int> tasks(0);
+
+	ASSERT_EQ(stub.start(port), 0);
+	params.batch_size = 1024;
+	params.linger_ms = 20;
+	producer = new WFKafkaProducer(&params);
+	config.set_compress_type(compress_type);
+	producer->set_config(std::move(config));
+	producer->set_callback([&tasks](WFKafkaTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		tasks++;
+	});
+
+	ASSERT_EQ(producer->init("127.0.0.1:" + std::to_string(port)), 0);
+	for (int i = 0; i < STUB_PARTITIONS; i++)
+		__produce(*producer, "workflow_test", i, 100);
+
+	__produce(*producer, "workflow_spread", -1, 30);
+	producer->deinit();
+	EXPECT_EQ(producer->get_inflight_bytes(), 0);
+
+	for (int i = 0; i < STUB_PARTITIONS; i++)
+	{
+		EXPECT_EQ(stub.get_records("workflow_test", i), 100);
+		ASSERT_TRUE(producer->get_partition_stats("workflow_test", i, &stats));
+		EXPECT_EQ(stats.records, 100);
+		EXPECT_EQ(stats.failed, 0);
+		EXPECT_GE(stats.batches, 100 * 104 / 1024);
+		EXPECT_GT(stats.max_latency, 0);
+		EXPECT_LE(stats.total_latency, stats.max_latency * 100);
+	}
+
+	/* Records of partition -1 count where they were sent. */
+	EXPECT_EQ(stub.get_records("workflow_spread"), 30);
+	for (int i = 0; i < STUB_PARTITIONS; i++)
+	{
+		size_t records = 0;
+
+		if (producer->get_partition_stats("workflow_spread", i, &stats))
+			records = stats.records;
+
+		EXPECT_EQ(records, stub.get_records("workflow_spread", i));
+	}
+
+	if (producer->get_partition_stats("workflow_spread", -1, &stats))
+	{
+		EXPECT_EQ(stats.records, 0);
+	}
+	EXPECT_EQ(stub.bad_batches, 0);
+	EXPECT_EQ(stub.compress_type, compress_type);
+	EXPECT_GE(stub.batches, tasks);
+
+	delete producer;
+	stub.stop();
+}
+
+/* A produce request that encode() can be called on directly. */
+class __ProduceRequest : public protocol::KafkaRequest
+{
+public:
+	using protocol::KafkaMessage::encode;
+};
+
+/* Encodes a produce request of 'n' records to the stub's partition 0. */
+static bool __encode_produce(int compress_type, int n, std::string& out)
+{
+	static kafka_api_version_t versions[] = { { Kafka_Produce, 0, 7 } };
+	kafka_api_t api = { KAFKA_FEATURE_MSGVER2 | KAFKA_FEATURE_LZ4 |
+						KAFKA_FEATURE_ZSTD, versions, 1 };
+	std::string value(100, 'x');
+	protocol::KafkaTopparList toppar_list;
+	protocol::KafkaToppar toppar;
+	protocol::KafkaConfig config;
+	__ProduceRequest req;
+	struct iovec vectors[1024];
+	int cnt;
+
+	if (!toppar.set_topic_partition("workflow_twice", 0))
+		return false;
+
+	for (int i = 0; i < n; i++)
+	{
+		protocol::KafkaRecord record;
+		std::string key = "key" + std::to_string(i);
+
+		record.set_key(key.c_str(), key.size());
+		record.set_value(value.c_str(), value.size());
+		toppar.add_record(std::move(record));
+	}
+
+	toppar_list.add_item(std::move(toppar));
+	config.set_compress_type(compress_type);
+	req.set_config(config);
+	req.set_toppar_list(toppar_list);
+	req.set_api_type(Kafka_Produce);
+	req.set_api(&api);
+	cnt = req.encode(vectors, 1024);
+	if (cnt < 0)
+		return false;
+
+	out.clear();
+	for (int i = 0; i < cnt; i++)
+		out.append((const char *)vectors[i].iov_base, vectors[i].iov_len);
+
+	return true;
+}
+
+/* The second batch on a thread reuses the compression context of the
+ * first, and both must decompress. */
+static void __test_encode_twice(int compress_type, unsigned short port)
+{
+	struct sockaddr_in addr = { };
+	__KafkaStub stub;
+	std::string msg;
+	char resp[4096];
+	uint32_t size;
+	int fd;
+
+	ASSERT_EQ(stub.start(port), 0);
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof addr), 0);
+	for (int i = 0; i < 2; i++)
+	{
+		ASSERT_TRUE(__encode_produce(compress_type, 50, msg));
+		ASSERT_EQ(write(fd, msg.data(), msg.size()), (ssize_t)msg.size());
+		ASSERT_EQ(recv(fd, &size, 4, MSG_WAITALL), 4);
+		ASSERT_LE(ntohl(size), sizeof resp);
+		ASSERT_EQ(recv(fd, resp, ntohl(size), MSG_WAITALL), (ssize_t)ntohl(size));
+	}
+
+	close(fd);
+	EXPECT_EQ(stub.get_records("workflow_twice", 0), 100);
+	EXPECT_EQ(stub.bad_batches, 0);
+	EXPECT_EQ(stub.compress_type, compress_type);
+	stub.stop();
+}
+
+TEST(kafka_unittest, EncodeTwice)
+{
+	__test_encode_twice(Kafka_Gzip, 8799);
+	__test_encode_twice(Kafka_Lz4, 8799);
+	__test_encode_twice(Kafka_Zstd, 8799);
+}
+
+TEST(kafka_unittest, ProducerNoCompress)
+{
+	__test_producer(Kafka_NoCompress, 8797);
+}
+
+TEST(kafka_unittest, ProducerGzip)
+{
+	__test_producer(Kafka_Gzip, 8797);
+}
+
+TEST(kafka_unittest, ProducerLz4)
+{
+	__test_producer(Kafka_Lz4, 8797);
+}
+
+TEST(kafka_unittest, ProducerZstd)
+{
+	__test_producer(Kafka_Zstd, 8797);
+}
+
+TEST(kafka_unittest, ProducerInflightLimit)
+{
+	struct WFKafkaProducerParams params = KAFKA_PRODUCER_PARAMS_DEFAULT;
+	protocol::KafkaRecord record;
+	std::string value(100, 'x');
+	__KafkaStub stub;
+
+	params.linger_ms = 1000;
+	params.max_inflight_bytes = 1000;
+
+	WFKafkaProducer producer(&params);
+
+	ASSERT_EQ(stub.start(8798), 0);
+	ASSERT_EQ(producer.init("127.0.0.1:8798"), 0);
+
+	__produce(producer, "workflow_test", 0, 9);
+	record.set_value(value.c_str(), value.size());
+	EXPECT_EQ(producer.send("workflow_test", 0, std::move(record)), -1);
+	EXPECT_EQ(errno, EAGAIN);
+	EXPECT_GE(producer.get_inflight_bytes(), 900);
+
+	producer.deinit();
+	EXPECT_EQ(producer.get_inflight_bytes(), 0);
+	EXPECT_EQ(stub.get_records("workflow_test", 0), 9);
+	stub.stop();
+}
@@ -0,0 +1,137 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "workflow/msgqueue.h"
+
+#define PRODUCERS	4
+#define CONSUMERS	3
+
+struct message
+{
+	int producer;
+	int seq;
+	void *link;
+};
+
+typedef msgqueue_t *(*create_func)(size_t, int);
+
+/* Every message is received exactly once, and the messages of one producer
+ * are seen in order by each consumer. */
+static void __test_queue(create_func create, size_t maxlen, int n)
+{
+	msgqueue_t *queue = create(maxlen, offsetof(struct message, link));
+	std::vector<message> msgs(PRODUCERS * n);
+	std::vector<std::thread> producers;
+	std::vector<std::thread> consumers;
+	std::atomic<int> received(0);
+	std::atomic<int> disordered(0);
+
+	ASSERT_TRUE(queue != NULL);
+	for (int i = 0; i < CONSUMERS; i++)
+	{
+		consumers.emplace_back([queue, &received, &disordered]() {
+			std::vector<int> last(PRODUCERS, -1);
+			message *msg;
+
+			while ((msg = (message *)msgqueue_get(queue)) != NULL)
+			{
+				if (msg->seq <= last[msg->producer])
+					disordered++;
+
+				last[msg->producer] = msg->seq;
+				received++;
+			}
+
+			EXPECT_EQ(errno, ENOENT);
+		});
+	}
+
+	for (int i = 0; i < PRODUCERS; i++)
+	{
+		producers.emplace_back([queue, &msgs, i, n]() {
+			for (int j = 0; j < n; j++)
+			{
+				message *msg = &msgs[i * n + j];
+
+				msg->producer = i;
+				msg->seq = j;
+				msgqueue_put(msg, queue);
+			}
+		});
+	}
+
+	for (auto& t : producers)
+		t.join();
+
+	while (received < PRODUCERS * n)
+		std::this_thread::yield();
+
+	/* Wakes up the consumers parked on an empty queue. */
+	msgqueue_set_nonblock(queue);
+	for (auto& t : consumers)
+		t.join();
+
+	EXPECT_EQ(received, PRODUCERS * n);
+	EXPECT_EQ(disordered, 0);
+	msgqueue_destroy(queue);
+}
+
+TEST(msgqueue_unittest, mutex)
+{
+	__test_queue(msgqueue_create, 4096, 100000);
+}
+
+TEST(msgqueue_unittest, mutex_small)
+{
+	__test_queue(msgqueue_create, 2, 10000);
+}
+
+TEST(msgqueue_unittest, lockfree)
+{
+	__test_queue(msgqueue_create_lockfree, 4096, 100000);
+}
+
+TEST(msgqueue_unittest, lockfree_small)
+{
+	/* Producers keep blocking on the max length. */
+	__test_queue(msgqueue_create_lockfree, 2, 10000);
+}
+
+TEST(msgqueue_unittest, nonblock)
+{
+	msgqueue_t *queue = msgqueue_create_lockfree(1, offsetof(struct message, link));
+	message msgs[3];
+
+	ASSERT_TRUE(queue != NULL);
+	msgqueue_set_nonblock(queue);
+	for (int i = 0; i < 3; i++)
+	{
+		msgs[i].seq = i;
+		msgqueue_put(&msgs[i], queue);
+	}
+
+	for (int i = 0; i < 3; i++)
+		EXPECT_EQ(((message *)msgqueue_get(queue))->seq, i);
+
+	EXPECT_TRUE(msgqueue_get(queue) == NULL);
+	EXPECT_EQ(errno, ENOENT);
+	msgqueue_destroy(queue);
+}
@@ -17,15 +17,22 @@
 */
 
 #include <string.h>
+#include <unistd.h>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <vector>
 #include <string>
+#include <map>
+#include <atomic>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFRedisServer.h"
+#include "workflow/WFRedisKVServer.h"
+#include "workflow/WFRedisPipelineClient.h"
+#include "workflow/WFFacilities.h"
 #include "workflow/WFOperator.h"
+#include "workflow/redis_parser.h"
 
 #define RETRY_MAX  3
 
@@ -167,3 +174,465 @@ TEST(redis_unittest, WFRedisTask2)
 	lock.unlock();
 }
 
+
+/* Answers the commands that arrive together, from a map. */
+class __PipelineRedisServer : public WFRedisServer
+{
+public:
+	__PipelineRedisServer() :
+		WFRedisServer(std::bind(&__PipelineRedisServer::process_pipeline,
+								this, std::placeholders::_1))
+	{
+		max_pipeline = 0;
+	}
+
+	std::atomic<size_t> max_pipeline;
+
+protected:
+	virtual CommSession *new_session(long long seq, CommConnection *conn)
+	{
+		CommSession *session = WFRedisServer::new_session(seq, conn);
+
+		static_cast<WFRedisTask *>(session)->get_req()->accept_pipeline();
+		return session;
+	}
+
+private:
+	void process_pipeline(WFRedisTask *task)
+	{
+		std::vector<std::vector<std::string>> requests;
+		protocol::RedisValue result;
+
+		EXPECT_TRUE(task->get_req()->get_pipeline(requests));
+		if (requests.size() > max_pipeline)
+			max_pipeline = requests.size();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		result.set_array(requests.size());
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const std::vector<std::string>& req = requests[i];
+			protocol::RedisValue& val = result[i];
+
+			if (req[0] == "SET" && req.size() == 3)
+			{
+				kv[req[1]] = req[2];
+				val.set_status("OK");
+			}
+			else if (req[0] == "GET" && req.size() == 2)
+			{
+				if (kv.count(req[1]))
+					val.set_string(kv[req[1]]);
+			}
+			else if (req[0] == "MSET" && req.size() % 2 == 1)
+			{
+				for (size_t j = 1; j < req.size(); j += 2)
+					kv[req[j]] = req[j + 1];
+
+				val.set_status("OK");
+			}
+			else if (req[0] == "MGET" && req.size() > 1)
+			{
+				val.set_array(req.size() - 1);
+				for (size_t j = 1; j < req.size(); j++)
+				{
+					if (kv.count(req[j]))
+						val[j - 1].set_string(kv[req[j]]);
+				}
+			}
+			else
+				val.set_error("ERR unknown command");
+		}
+
+		task->get_resp()->set_pipeline_result(result);
+	}
+
+	std::mutex mutex;
+	std::map<std::string, std::string> kv;
+};
+
+TEST(redis_unittest, WFRedisPipelineClient)
+{
+	__PipelineRedisServer server;
+	WFRedisPipelineClient client;
+	const char *url = "redis://127.0.0.1:6688";
+
+	ASSERT_EQ(server.start("127.0.0.1", 6688), 0) << "server start failed";
+	ASSERT_EQ(client.init(64, 1), 0);
+
+	/* Concurrent tasks on one connection, replies matched in order. */
+	WFFacilities::WaitGroup set_wait(200);
+	for (int i = 0; i < 200; i++)
+	{
+		auto *task = client.create_redis_task(url, 0, [&set_wait](WFRedisTask *task) {
+			protocol::RedisValue val;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			task->get_resp()->get_result(val);
+			EXPECT_TRUE(val.is_string() && val.string_value() == "OK");
+			set_wait.done();
+		});
+
+		task->get_req()->set_request("SET", {"key" + std::to_string(i), "value" + std::to_string(i)});
+		task->start();
+	}
+
+	set_wait.wait();
+
+	WFFacilities::WaitGroup get_wait(200);
+	for (int i = 0; i < 200; i++)
+	{
+		auto *task = client.create_redis_task(url, 0, [&get_wait, i](WFRedisTask *task) {
+			protocol::RedisValue val;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			task->get_resp()->get_result(val);
+			EXPECT_EQ(val.string_value(), "value" + std::to_string(i));
+			get_wait.done();
+		});
+
+		task->get_req()->set_request("GET", {"key" + std::to_string(i)});
+		task->start();
+	}
+
+	get_wait.wait();
+	WFRedisPipelineStats stats = client.get_stats();
+	EXPECT_EQ(stats.requests, 400U);
+	EXPECT_EQ(stats.commands, 400U);
+	EXPECT_LT(stats.batches, 400U);
+	EXPECT_GT(server.max_pipeline.load(), 1U);
+
+	/* More keys than one MGET or MSET command takes. */
+	std::vector<std::pair<std::string, std::string>> pairs;
+	std::vector<std::string> keys;
+	for (int i = 0; i < 600; i++)
+	{
+		pairs.emplace_back("mkey" + std::to_string(i), std::to_string(i));
+		keys.push_back("mkey" + std::to_string(i));
+	}
+
+	keys.push_back("missing");
+	WFFacilities::WaitGroup mwait(1);
+	auto *mset = client.create_mset_task(url, pairs, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_EQ(val.string_value(), "OK");
+	});
+	auto *mget = client.create_mget_task(url, keys, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		ASSERT_TRUE(val.is_array());
+		ASSERT_EQ(val.arr_size(), 601U);
+		for (int i = 0; i < 600; i++)
+			EXPECT_EQ(val[i].string_value(), std::to_string(i));
+
+		EXPECT_TRUE(val[600].is_nil());
+	});
+	auto *unknown = client.create_redis_task(url, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_TRUE(val.is_error());
+	});
+	auto *auth = client.create_redis_task(url, 0, [](WFRedisTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_TASK_ERROR);
+		EXPECT_EQ(task->get_error(), WFT_ERR_REDIS_COMMAND_DISALLOWED);
+	});
+	auto *multi = client.create_redis_task(url, 0, [&mwait](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_TRUE(val.is_error());
+		mwait.done();
+	});
+	/* No keys are replied without a command. */
+	auto *empty_mget = client.create_mget_task(url, {}, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		ASSERT_TRUE(val.is_array());
+		EXPECT_EQ(val.arr_size(), 0U);
+	});
+	auto *empty_mset = client.create_mset_task(url, {}, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_EQ(val.string_value(), "OK");
+	});
+
+	unknown->get_req()->set_request("HGET", {"h", "f"});
+	auth->get_req()->set_request("AUTH", {"pass"});
+	multi->get_req()->set_request("MULTI", {});
+	auto& flow = *mset > mget > empty_mget > empty_mset > unknown > auth > multi;
+	flow.start();
+	mwait.wait();
+
+	stats = client.get_stats();
+	EXPECT_EQ(stats.bypassed, 1U);
+	EXPECT_EQ(stats.commands, 400U + 3 + 3 + 1);
+	server.stop();
+	client.deinit();
+}
+
+/* Feeds the message in fragments of 'step' bytes. */
+static int __parse_reply(const std::string& msg, size_t step,
+						 redis_parser_t *parser, size_t *consumed)
+{
+	size_t pos = 0;
+	size_t n;
+	int ret = 0;
+
+	redis_parser_init(parser);
+	while (pos < msg.size())
+	{
+		n = std::min(step, msg.size() - pos);
+		ret = redis_parser_append_message(msg.data() + pos, &n, parser);
+		pos += n;
+		if (ret != 0)
+			break;
+	}
+
+	*consumed = pos;
+	return ret;
+}
+
+TEST(redis_unittest, redis_parser)
+{
+	std::string big(100000, 'b');
+	std::string msg = "*5\r\n+OK\r\n:-42\r\n$-1\r\n*3\r\n$0\r\n\r\n"
+					  "-ERR wrong\r\n*0\r\n$100000\r\n" + big + "\r\n";
+	redis_parser_t parser;
+	size_t consumed;
+
+	for (size_t step : {(size_t)1, (size_t)7, msg.size()})
+	{
+		ASSERT_EQ(__parse_reply(msg + "+next\r\n", step, &parser, &consumed), 1);
+		/* A value that follows is left to the next message. */
+		EXPECT_EQ(consumed, msg.size());
+
+		protocol::RedisValueView view(&parser.reply);
+
+		ASSERT_TRUE(view.is_array());
+		ASSERT_EQ(view.arr_size(), 5U);
+		EXPECT_EQ(view[0].get_type(), REDIS_REPLY_TYPE_STATUS);
+		EXPECT_EQ(view[0].string_value(), "OK");
+		EXPECT_EQ(view[1].int_value(), -42);
+		EXPECT_TRUE(view[2].is_nil());
+		ASSERT_EQ(view[3].arr_size(), 3U);
+		EXPECT_TRUE(view[3][0].is_string());
+		EXPECT_EQ(view[3][0].string_size(), 0U);
+		EXPECT_TRUE(view[3][1].is_error());
+		EXPECT_EQ(view[3][1].string_value(), "ERR wrong");
+		EXPECT_TRUE(view[3][2].is_array());
+		EXPECT_EQ(view[3][2].arr_size(), 0U);
+		EXPECT_EQ(view[4].string_size(), big.size());
+		EXPECT_EQ(memcmp(view[4].string_data(), big.data(), big.size()), 0);
+
+		protocol::RedisValue value;
+
+		value.set(&parser.reply);
+		EXPECT_EQ(value[3][1].string_value(), "ERR wrong");
+		EXPECT_EQ(value[4].string_value(), big);
+		redis_parser_deinit(&parser);
+	}
+
+	/* Deeply nested arrays. */
+	msg.clear();
+	for (int i = 0; i < 100; i++)
+		msg += "*2\r\n:" + std::to_string(i) + "\r\n";
+
+	msg += "$3\r\nend\r\n";
+	ASSERT_EQ(__parse_reply(msg, 3, &parser, &consumed), 1);
+	protocol::RedisValueView view(&parser.reply);
+	for (int i = 0; i < 100; i++)
+	{
+		ASSERT_EQ(view.arr_size(), 2U);
+		EXPECT_EQ(view[0].int_value(), i);
+		view = view[1];
+	}
+
+	EXPECT_EQ(view.string_value(), "end");
+	redis_parser_deinit(&parser);
+
+	/* Collecting the values that arrive together. */
+	std::string values;
+	for (int i = 0; i < 20; i++)
+		values += "*2\r\n$3\r\nGET\r\n$2\r\nk" + std::to_string(i % 10) + "\r\n";
+
+	redis_parser_init(&parser);
+	redis_parser_set_pipeline(0, &parser);
+	consumed = values.size();
+	ASSERT_EQ(redis_parser_append_message(values.data(), &consumed, &parser), 1);
+	ASSERT_EQ(parser.reply.elements, 20U);
+	EXPECT_EQ(std::string(parser.reply.element[19]->element[1]->str, 2), "k9");
+	redis_parser_deinit(&parser);
+
+	for (const char *bad : {"?\r\n", ":12a\r\n", ":\r\n", "$3\r\nabcd\r\n", "*x\r\n"})
+	{
+		std::string str(bad);
+
+		EXPECT_EQ(__parse_reply(str, str.size(), &parser, &consumed), -2) << bad;
+		redis_parser_deinit(&parser);
+	}
+}
+
+static protocol::RedisValue __kv_execute(WFRedisKVServer& server,
+										 const std::vector<std::string>& args)
+{
+	protocol::RedisValue cmd;
+	protocol::RedisValue reply;
+	redis_reply_t r;
+
+	cmd.set_array(args.size());
+	for (size_t i = 0; i < args.size(); i++)
+		cmd[i].set_string(args[i]);
+
+	redis_reply_init(&r);
+	cmd.transform(&r);
+	server.execute(protocol::RedisValueView(&r), reply);
+	redis_reply_deinit(&r);
+	return reply;
+}
+
+TEST(redis_unittest, WFRedisKVServer)
+{
+	WFRedisKVServer server(4);
+	protocol::RedisValue val;
+
+	/* Strings. */
+	EXPECT_EQ(__kv_execute(server, {"set", "k", "v"}).string_value(), "OK");
+	EXPECT_EQ(__kv_execute(server, {"GET", "k"}).string_value(), "v");
+	EXPECT_TRUE(__kv_execute(server, {"GET", "none"}).is_nil());
+	EXPECT_TRUE(__kv_execute(server, {"SET", "k", "x", "NX"}).is_nil());
+	EXPECT_TRUE(__kv_execute(server, {"SET", "n", "x", "XX"}).is_nil());
+	EXPECT_EQ(__kv_execute(server, {"APPEND", "k", "12"}).int_value(), 3);
+	EXPECT_EQ(__kv_execute(server, {"GETSET", "k", "w"}).string_value(), "v12");
+	EXPECT_EQ(__kv_execute(server, {"SETNX", "k", "z"}).int_value(), 0);
+	EXPECT_EQ(__kv_execute(server, {"STRLEN", "k"}).int_value(), 1);
+	EXPECT_EQ(__kv_execute(server, {"MSET", "a", "1", "b", "2"}).string_value(), "OK");
+	val = __kv_execute(server, {"MGET", "a", "none", "b"});
+	ASSERT_EQ(val.arr_size(), 3U);
+	EXPECT_EQ(val[0].string_value(), "1");
+	EXPECT_TRUE(val[1].is_nil());
+	EXPECT_EQ(val[2].string_value(), "2");
+	EXPECT_EQ(__kv_execute(server, {"INCR", "a"}).int_value(), 2);
+	EXPECT_EQ(__kv_execute(server, {"DECRBY", "c", "5"}).int_value(), -5);
+	EXPECT_TRUE(__kv_execute(server, {"INCR", "k"}).is_error());
+	EXPECT_EQ(__kv_execute(server, {"SET", "m", "9223372036854775807"}).string_value(), "OK");
+	EXPECT_TRUE(__kv_execute(server, {"INCR", "m"}).is_error());
+
+	/* Hashes. */
+	EXPECT_EQ(__kv_execute(server, {"HSET", "h", "f1", "1", "f2", "2"}).int_value(), 2);
+	EXPECT_EQ(__kv_execute(server, {"HSET", "h", "f1", "3"}).int_value(), 0);
+	EXPECT_EQ(__kv_execute(server, {"HGET", "h", "f1"}).string_value(), "3");
+	EXPECT_EQ(__kv_execute(server, {"HINCRBY", "h", "f2", "10"}).int_value(), 12);
+	EXPECT_EQ(__kv_execute(server, {"HLEN", "h"}).int_value(), 2);
+	EXPECT_EQ(__kv_execute(server, {"HGETALL", "h"}).arr_size(), 4U);
+	val = __kv_execute(server, {"HMGET", "h", "f2", "f3"});
+	ASSERT_EQ(val.arr_size(), 2U);
+	EXPECT_EQ(val[0].string_value(), "12");
+	EXPECT_TRUE(val[1].is_nil());
+	EXPECT_EQ(__kv_execute(server, {"TYPE", "h"}).string_value(), "hash");
+	val = __kv_execute(server, {"GET", "h"});
+	EXPECT_EQ(val.string_value().compare(0, 9, "WRONGTYPE"), 0);
+	EXPECT_TRUE(__kv_execute(server, {"HGET", "k", "f"}).is_error());
+	EXPECT_EQ(__kv_execute(server, {"HDEL", "h", "f1", "f2", "f3"}).int_value(), 2);
+	EXPECT_EQ(__kv_execute(server, {"EXISTS", "h"}).int_value(), 0);
+
+	/* Expiry. */
+	EXPECT_EQ(__kv_execute(server, {"TTL", "none"}).int_value(), -2);
+	EXPECT_EQ(__kv_execute(server, {"TTL", "a"}).int_value(), -1);
+	EXPECT_EQ(__kv_execute(server, {"SET", "t", "v", "EX", "100"}).string_value(), "OK");
+	EXPECT_EQ(__kv_execute(server, {"TTL", "t"}).int_value(), 100);
+	EXPECT_EQ(__kv_execute(server, {"PERSIST", "t"}).int_value(), 1);
+	EXPECT_EQ(__kv_execute(server, {"TTL", "t"}).int_value(), -1);
+	EXPECT_EQ(__kv_execute(server, {"PEXPIRE", "t", "50"}).int_value(), 1);
+	EXPECT_EQ(__kv_execute(server, {"SET", "p", "v", "PX", "50"}).string_value(), "OK");
+	EXPECT_EQ(__kv_execute(server, {"SETEX", "s", "100", "v"}).string_value(), "OK");
+	EXPECT_EQ(__kv_execute(server, {"SET", "s", "v"}).string_value(), "OK");
+	EXPECT_EQ(__kv_execute(server, {"TTL", "s"}).int_value(), -1);
+	EXPECT_TRUE(__kv_execute(server, {"SET", "t", "v", "EX", "0"}).is_error());
+	usleep(100 * 1000);
+	EXPECT_TRUE(__kv_execute(server, {"GET", "t"}).is_nil());
+	EXPECT_EQ(__kv_execute(server, {"EXISTS", "p", "a", "b"}).int_value(), 2);
+	EXPECT_EQ(__kv_execute(server, {"EXPIRE", "b", "-1"}).int_value(), 1);
+
+	/* Errors. */
+	EXPECT_TRUE(__kv_execute(server, {"GET"}).is_error());
+	EXPECT_TRUE(__kv_execute(server, {"NOSUCH", "k"}).is_error());
+	EXPECT_TRUE(__kv_execute(server, {"SET", "k", "v", "EX"}).is_error());
+	EXPECT_TRUE(__kv_execute(server, {"MSET", "k"}).is_error());
+	EXPECT_EQ(__kv_execute(server, {"DBSIZE"}).int_value(), 5);
+	EXPECT_EQ(server.get_key_count(), 5U);
+
+	/* Over the network, one command each and pipelined. */
+	const char *url = "redis://127.0.0.1:6699";
+	WFRedisPipelineClient client;
+	std::vector<std::pair<std::string, std::string>> pairs;
+	std::vector<std::string> keys;
+
+	ASSERT_EQ(server.start("127.0.0.1", 6699), 0) << "server start failed";
+	ASSERT_EQ(client.init(64, 1), 0);
+	for (int i = 0; i < 300; i++)
+	{
+		pairs.emplace_back("key" + std::to_string(i), std::to_string(i));
+		keys.push_back("key" + std::to_string(i));
+	}
+
+	WFFacilities::WaitGroup wait_group(1);
+	auto *ping = WFTaskFactory::create_redis_task(url, RETRY_MAX, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_EQ(val.string_value(), "PONG");
+	});
+	auto *mset = client.create_mset_task(url, pairs, 0, [](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_EQ(val.string_value(), "OK");
+	});
+	auto *mget = client.create_mget_task(url, keys, 0, [&wait_group](WFRedisTask *task) {
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		EXPECT_EQ(val.arr_size(), 300U);
+		for (size_t i = 0; i < val.arr_size(); i++)
+			EXPECT_EQ(val[i].string_value(), std::to_string(i));
+
+		wait_group.done();
+	});
+
+	ping->get_req()->set_request("PING", {});
+	auto& flow = *ping > mset > mget;
+	flow.start();
+	wait_group.wait();
+
+	WFFacilities::WaitGroup incr_wait(100);
+	for (int i = 0; i < 100; i++)
+	{
+		auto *task = client.create_redis_task(url, 0, [&incr_wait](WFRedisTask *task) {
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			incr_wait.done();
+		});
+
+		task->get_req()->set_request("INCR", {"counter"});
+		task->start();
+	}
+
+	incr_wait.wait();
+	EXPECT_EQ(__kv_execute(server, {"GET", "counter"}).string_value(), "100");
+	server.stop();
+	client.deinit();
+}
@@ -16,6 +16,10 @@
   Author: Li Yingxin (liyingxin@sogou-inc.com)
 */
 
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 #include "workflow/UpstreamManager.h"
 #include "workflow/WFHttpServer.h"
@@ -353,6 +357,246 @@ TEST(upstream_unittest, Tracing)
 	UpstreamManager::upstream_enable_server("test_tracing", "127.0.0.1:8003");
 }
 
+static void __http_slow_process(WFHttpTask *task, const char *name)
+{
+	__http_process(task, name);
+	series_of(task)->push_back(WFTaskFactory::create_timer_task(20000, nullptr));
+}
+
+/* Rounds of 10 concurrent requests. Counts the replies of each server. */
+static void __p2c_run(int rounds, int retry_max, std::atomic<int> hits[3])
+{
+	for (int i = 0; i < rounds; i++)
+	{
+		WFFacilities::WaitGroup wait_group(10);
+
+		for (int j = 0; j < 10; j++)
+		{
+			auto *task = WFTaskFactory::create_http_task("http://p2c", 0, retry_max,
+											[&wait_group, hits](WFHttpTask *task) {
+				const void *body;
+				size_t len;
+
+				EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+				if (task->get_resp()->get_parsed_body(&body, &len) && len == 5)
+					hits[((const char *)body)[4] - '4']++;
+
+				wait_group.done();
+			});
+			task->start();
+		}
+
+		wait_group.wait();
+	}
+}
+
+TEST(upstream_unittest, P2CLatency)
+{
+	WFHttpServer server4(std::bind(&__http_process,
+								   std::placeholders::_1, "fast4"));
+	WFHttpServer server5(std::bind(&__http_process,
+								   std::placeholders::_1, "fast5"));
+	WFHttpServer server6(std::bind(&__http_slow_process,
+								   std::placeholders::_1, "slow6"));
+	std::atomic<int> hits[3];
+
+	for (int i = 0; i < 3; i++)
+		hits[i] = 0;
+
+	ASSERT_EQ(server4.start("127.0.0.1", 8004), 0);
+	ASSERT_EQ(server5.start("127.0.0.1", 8005), 0);
+	ASSERT_EQ(server6.start("127.0.0.1", 8006), 0);
+	EXPECT_EQ(UpstreamManager::upstream_create_p2c("p2c"), 0);
+	UpstreamManager::upstream_add_server("p2c", "127.0.0.1:8004");
+	UpstreamManager::upstream_add_server("p2c", "127.0.0.1:8005");
+	UpstreamManager::upstream_add_server("p2c", "127.0.0.1:8006");
+
+	/* Random would send a third to the slow one. */
+	__p2c_run(20, 0, hits);
+	EXPECT_EQ(hits[0] + hits[1] + hits[2], 200);
+	EXPECT_GT(hits[0], 0);
+	EXPECT_GT(hits[1], 0);
+	EXPECT_LT(hits[2], 20);
+
+	/* A fused server is never one of the choices. */
+	int fast4 = hits[0];
+
+	UpstreamManager::upstream_disable_server("p2c", "127.0.0.1:8004");
+	__p2c_run(5, 0, hits);
+	EXPECT_EQ(hits[0], fast4);
+	UpstreamManager::upstream_enable_server("p2c", "127.0.0.1:8004");
+	__p2c_run(5, 0, hits);
+	EXPECT_GT(hits[0], fast4);
+
+	/* A failure counts as slow, so the stopped server is seldom tried, and
+	 * the retry goes to another. */
+	int fast5 = hits[1];
+
+	server5.stop();
+	__p2c_run(5, 1, hits);
+	EXPECT_EQ(hits[1], fast5);
+
+	EXPECT_EQ(UpstreamManager::upstream_delete("p2c"), 0);
+	server4.stop();
+	server6.stop();
+}
+
+static unsigned int __path_hash(const char *path, const char *query,
+								const char *fragment)
+{
+	return std::hash<std::string>()(path);
+}
+
+/* The server of each key, as selected by the policy itself. */
+static void __select_keys(UPSGroupPolicy *policy, int keys,
+						  std::vector<std::string>& servers)
+{
+	WFNSTracing tracing;
+	EndpointAddress *addr;
+	ParsedURI uri;
+
+	servers.clear();
+	for (int i = 0; i < keys; i++)
+	{
+		URIParser::parse("http://jump/key" + std::to_string(i), uri);
+		if (policy->select(uri, &tracing, &addr))
+		{
+			servers.push_back(addr->address);
+			addr->ref--;
+		}
+		else
+			servers.push_back("");
+	}
+}
+
+TEST(upstream_unittest, JumpHash)
+{
+	UPSJumpHashPolicy policy(__path_hash);
+	AddressParams params = ADDRESS_PARAMS_DEFAULT;
+	std::vector<std::string> before;
+	std::vector<std::string> after;
+	std::map<std::string, int> count;
+
+	for (int i = 0; i < 100; i++)
+		policy.add_server("10.0.0." + std::to_string(i) + ":80", &params);
+
+	__select_keys(&policy, 10000, before);
+	for (const std::string& server : before)
+		count[server]++;
+
+	EXPECT_EQ(count.size(), 100);
+	for (const auto& kv : count)
+	{
+		EXPECT_GT(kv.second, 50);
+		EXPECT_LT(kv.second, 200);
+	}
+
+	/* Only the keys of the removed server move. */
+	policy.remove_server("10.0.0.50:80");
+	__select_keys(&policy, 10000, after);
+	for (int i = 0; i < 10000; i++)
+	{
+		if (before[i] == "10.0.0.50:80")
+			EXPECT_NE(after[i], before[i]);
+		else
+			EXPECT_EQ(after[i], before[i]);
+	}
+
+	/* The next one added takes its slot, and exactly its keys. */
+	policy.add_server("10.0.1.0:80", &params);
+	__select_keys(&policy, 10000, after);
+	for (int i = 0; i < 10000; i++)
+	{
+		if (before[i] == "10.0.0.50:80")
+			before[i] = "10.0.1.0:80";
+
+		EXPECT_EQ(after[i], before[i]);
+	}
+
+	/* A fused server's keys jump on, and come back on recovery. */
+	policy.disable_server("10.0.0.10:80");
+	__select_keys(&policy, 10000, after);
+	for (int i = 0; i < 10000; i++)
+	{
+		if (before[i] == "10.0.0.10:80")
+			EXPECT_NE(after[i], before[i]);
+		else
+			EXPECT_EQ(after[i], before[i]);
+	}
+
+	policy.enable_server("10.0.0.10:80");
+	__select_keys(&policy, 10000, after);
+	EXPECT_EQ(after, before);
+
+	/* Weight 4 of a total of 104. */
+	params.weight = 4;
+	policy.add_server("10.0.2.0:80", &params);
+	__select_keys(&policy, 10000, after);
+	count.clear();
+	for (const std::string& server : after)
+		count[server]++;
+
+	EXPECT_GT(count["10.0.2.0:80"], 250);
+	EXPECT_LT(count["10.0.2.0:80"], 550);
+}
+
+TEST(upstream_unittest, BoundedLoadHash)
+{
+	WFHttpServer server7(std::bind(&__http_slow_process,
+								   std::placeholders::_1, "slow7"));
+	WFHttpServer server8(std::bind(&__http_slow_process,
+								   std::placeholders::_1, "slow8"));
+	WFHttpServer server9(std::bind(&__http_slow_process,
+								   std::placeholders::_1, "slow9"));
+	WFFacilities::WaitGroup wait_group(30);
+	std::atomic<int> hits[3];
+
+	for (int i = 0; i < 3; i++)
+		hits[i] = 0;
+
+	ASSERT_EQ(server7.start("127.0.0.1", 8007), 0);
+	ASSERT_EQ(server8.start("127.0.0.1", 8008), 0);
+	ASSERT_EQ(server9.start("127.0.0.1", 8009), 0);
+	EXPECT_EQ(UpstreamManager::upstream_create_bounded_load_hash("bounded",
+		[](const char *path, const char *query, const char *fragment) -> unsigned int {
+			return 1;
+		}, 1.25), 0);
+	UpstreamManager::upstream_add_server("bounded", "127.0.0.1:8007");
+	UpstreamManager::upstream_add_server("bounded", "127.0.0.1:8008");
+	UpstreamManager::upstream_add_server("bounded", "127.0.0.1:8009");
+
+	/* One hot key. On the plain ring all would go to one server; here none
+	 * takes more than ceil(1.25 * 30 / 3). */
+	for (int i = 0; i < 30; i++)
+	{
+		auto *task = WFTaskFactory::create_http_task("http://bounded", 0, 0,
+										[&wait_group, &hits](WFHttpTask *task) {
+			const void *body;
+			size_t len;
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			if (task->get_resp()->get_parsed_body(&body, &len) && len == 5)
+				hits[((const char *)body)[4] - '7']++;
+
+			wait_group.done();
+		});
+		task->start();
+	}
+
+	wait_group.wait();
+	EXPECT_EQ(hits[0] + hits[1] + hits[2], 30);
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_GT(hits[i], 0);
+		EXPECT_LE(hits[i], 13);
+	}
+
+	EXPECT_EQ(UpstreamManager::upstream_delete("bounded"), 0);
+	server7.stop();
+	server8.stop();
+	server9.stop();
+}
+
 int main(int argc, char* argv[])
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,207 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <gtest/gtest.h>
+#include "workflow/WFGlobal.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/WFTaskFactory.h"
+#include "workflow/WFHttpServer.h"
+#include "workflow/HttpUtil.h"
+
+/* Same tasks as the other unittests, with the pollers waiting on io_uring
+ * polls and file I/O going through io_uring (or the default backend if the
+ * running kernel has no io_uring). */
+
+#define URING_PORT		8833
+#define CONCURRENCY		64
+#define ROUNDS			8
+
+static void __http_process(WFHttpTask *task)
+{
+	auto *req = task->get_req();
+	auto *resp = task->get_resp();
+	const void *body;
+	size_t size;
+
+	resp->add_header_pair("Content-Type", "text/plain");
+	if (req->get_parsed_body(&body, &size))
+		resp->append_output_body(body, size);
+}
+
+TEST(uring_unittest, timer)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	WFFacilities::usleep(100000);
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start).count();
+	EXPECT_GE(ms, 100);
+	EXPECT_LT(ms, 1000);
+}
+
+TEST(uring_unittest, http)
+{
+	WFHttpServer server(__http_process);
+	std::atomic<int> success(0);
+
+	ASSERT_EQ(server.start("127.0.0.1", URING_PORT), 0);
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		WFFacilities::WaitGroup wg(CONCURRENCY);
+		std::string url = "http://127.0.0.1:" + std::to_string(URING_PORT);
+
+		for (int i = 0; i < CONCURRENCY; i++)
+		{
+			std::string body(1 + (i * 4099) % 100000, 'a' + i % 26);
+			auto *task = WFTaskFactory::create_http_task(url, 0, 0,
+				[&wg, &success, body](WFHttpTask *task) {
+				const void *data;
+				size_t size;
+
+				EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS) << task->get_error();
+				if (task->get_state() == WFT_STATE_SUCCESS &&
+					task->get_resp()->get_parsed_body(&data, &size) &&
+					std::string((const char *)data, size) == body)
+				{
+					success++;
+				}
+
+				wg.done();
+			});
+
+			task->get_req()->set_method(HttpMethodPost);
+			task->get_req()->append_output_body(body.c_str(), body.size());
+			/* Odd rounds close the connections, even rounds keep them. */
+			if (round % 2)
+				task->set_keep_alive(0);
+
+			task->start();
+		}
+
+		wg.wait();
+	}
+
+	server.stop();
+	EXPECT_EQ(success, ROUNDS * CONCURRENCY);
+}
+
+TEST(uring_unittest, fileIO)
+{
+	char buf1[4096];
+	char buf2[4096];
+	struct iovec iov[2];
+	ssize_t sz;
+	int fd = open("uring.test", O_RDWR | O_TRUNC | O_CREAT, 0644);
+
+	ASSERT_GE(fd, 0);
+	memset(buf1, '1', sizeof buf1);
+	memset(buf2, '2', sizeof buf2);
+	sz = WFFacilities::async_pwrite(fd, buf1, sizeof buf1, 0).get();
+	EXPECT_EQ(sz, (ssize_t)sizeof buf1);
+
+	iov[0].iov_base = buf2;
+	iov[0].iov_len = sizeof buf2;
+	iov[1].iov_base = buf1;
+	iov[1].iov_len = sizeof buf1;
+	sz = WFFacilities::async_pwritev(fd, iov, 2, sizeof buf1).get();
+	EXPECT_EQ(sz, (ssize_t)(sizeof buf1 + sizeof buf2));
+	EXPECT_EQ(WFFacilities::async_fsync(fd).get(), 0);
+
+	WFFacilities::WaitGroup wg(1);
+	auto *fdsync = WFTaskFactory::create_fdsync_task(fd, [&wg](WFFileSyncTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		EXPECT_EQ(task->get_retval(), 0);
+		wg.done();
+	});
+	fdsync->start();
+	wg.wait();
+
+	memset(buf1, 0, sizeof buf1);
+	memset(buf2, 0, sizeof buf2);
+	iov[0].iov_base = buf1;
+	iov[1].iov_base = buf2;
+	sz = WFFacilities::async_preadv(fd, iov, 2, 0).get();
+	EXPECT_EQ(sz, (ssize_t)(sizeof buf1 + sizeof buf2));
+	EXPECT_TRUE(buf1[0] == '1' && buf1[sizeof buf1 - 1] == '1');
+	EXPECT_TRUE(buf2[0] == '2' && buf2[sizeof buf2 - 1] == '2');
+
+	sz = WFFacilities::async_pread(fd, buf1, sizeof buf1, 2 * sizeof buf1).get();
+	EXPECT_EQ(sz, (ssize_t)sizeof buf1);
+	EXPECT_EQ(buf1[0], '1');
+	sz = WFFacilities::async_pread(fd, buf1, sizeof buf1, 3 * sizeof buf1).get();
+	EXPECT_EQ(sz, 0);
+	close(fd);
+
+	/* Errors come back through the same completion path. */
+	sz = WFFacilities::async_pread(fd, buf1, sizeof buf1, 0).get();
+	EXPECT_LT(sz, 0);
+	unlink("uring.test");
+}
+
+TEST(uring_unittest, fileIO_concurrent)
+{
+	int fd = open("uring.test", O_RDWR | O_TRUNC | O_CREAT, 0644);
+	std::atomic<int> success(0);
+	WFFacilities::WaitGroup wg(1000);
+	static unsigned int values[1000];
+
+	ASSERT_GE(fd, 0);
+	for (int i = 0; i < 1000; i++)
+	{
+		values[i] = i;
+		auto *task = WFTaskFactory::create_pwrite_task(fd, &values[i], 4, i * 4,
+			[&wg, &success](WFFileIOTask *task) {
+			if (task->get_state() == WFT_STATE_SUCCESS && task->get_retval() == 4)
+				success++;
+
+			wg.done();
+		});
+
+		task->start();
+	}
+
+	wg.wait();
+	EXPECT_EQ(success, 1000);
+	for (int i = 0; i < 1000; i++)
+	{
+		unsigned int value;
+
+		EXPECT_EQ(pread(fd, &value, 4, i * 4), 4);
+		EXPECT_EQ(value, (unsigned int)i);
+	}
+
+	close(fd);
+	unlink("uring.test");
+}
+
+int main(int argc, char *argv[])
+{
+	struct WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
+
+	settings.io_backend = IO_BACKEND_URING_POLL;
+	WORKFLOW_library_init(&settings);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}